@@ -0,0 +1,95 @@
+﻿#include "VoxelMeshBuildHandoff.h"
+
+#include "Async/Async.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVoxelMeshBuildHandoffTest, "VoxelMesh.BuildHandoff", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FVoxelMeshBuildHandoffTest::RunTest(const FString& Parameters)
+{
+	// The requester fails to claim, then the generation gives the proxy back: the generation runs the request
+	{
+		FVoxelMeshBuildHandoff Handoff;
+		TestTrue(TEXT("Idle proxy is claimed"), Handoff.TryClaim(true));
+		Handoff.Request();
+		TestFalse(TEXT("Claim while generating"), Handoff.TryClaim(true));
+		TestTrue(TEXT("Release keeps the proxy for the request"), Handoff.Release());
+		TestTrue(TEXT("Claimed for the request"), Handoff.IsClaimed());
+		TestFalse(TEXT("Request taken"), Handoff.IsRequested());
+		TestFalse(TEXT("Nothing left after the request"), Handoff.Release());
+		TestFalse(TEXT("Released"), Handoff.IsClaimed());
+	}
+
+	// The generation gives the proxy back between the request and the claim: only one of them takes the request
+	{
+		FVoxelMeshBuildHandoff Handoff;
+		TestTrue(TEXT("Idle proxy is claimed"), Handoff.TryClaim(true));
+		Handoff.Request();
+		const bool bReleaseTakes = Handoff.Release();
+		const bool bRequesterTakes = Handoff.TryClaim(true);
+		TestTrue(TEXT("Request taken exactly once"), bReleaseTakes != bRequesterTakes);
+		TestTrue(TEXT("Claimed for the request"), Handoff.IsClaimed());
+		TestFalse(TEXT("Nothing left after the request"), Handoff.Release());
+	}
+
+	// A request taken by the claim isn't run again by the release
+	{
+		FVoxelMeshBuildHandoff Handoff;
+		Handoff.Request();
+		TestTrue(TEXT("Idle proxy is claimed"), Handoff.TryClaim(true));
+		TestFalse(TEXT("Request already taken"), Handoff.Release());
+	}
+
+	// Claims leaving the requests to the next generation, like the sectioned remesh
+	{
+		FVoxelMeshBuildHandoff Handoff;
+		Handoff.Request();
+		TestTrue(TEXT("Idle proxy is claimed"), Handoff.TryClaim(false));
+		TestTrue(TEXT("Request kept"), Handoff.IsRequested());
+		TestTrue(TEXT("Release keeps the proxy for the request"), Handoff.Release());
+		TestFalse(TEXT("Nothing left after the request"), Handoff.Release());
+	}
+
+	// Requests racing with a worker finishing generations, none of them may be left behind
+	{
+		FVoxelMeshBuildHandoff Handoff;
+		std::atomic<bool> bHasWork = false;
+		std::atomic<bool> bDone = false;
+		std::atomic<int32> NumGenerating = 0;
+		std::atomic<int32> NumOverlaps = 0;
+		TFuture<void> Worker = Async(EAsyncExecution::Thread, [&]
+		{
+			while (!bDone.load() || bHasWork.load())
+			{
+				if (!bHasWork.exchange(false))
+				{
+					continue;
+				}
+				do
+				{
+					NumOverlaps += NumGenerating.fetch_add(1) != 0;
+					NumGenerating.fetch_sub(1);
+				}
+				while (Handoff.Release());
+			}
+		});
+		for (int32 Index = 0; Index < 100000; ++Index)
+		{
+			Handoff.Request();
+			if (Handoff.TryClaim(true))
+			{
+				bHasWork.store(true);
+			}
+		}
+		bDone.store(true);
+		Worker.Wait();
+		TestEqual(TEXT("Overlapping generations"), NumOverlaps.load(), 0);
+		TestFalse(TEXT("Request left behind"), Handoff.IsRequested());
+		TestFalse(TEXT("Proxy left claimed"), Handoff.IsClaimed());
+	}
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
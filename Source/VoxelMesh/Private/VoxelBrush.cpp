@@ -0,0 +1,46 @@
+﻿#include "VoxelBrush.h"
+
+FVoxelSdfBrush FVoxelBrush::ToSdfBrush() const
+{
+	const FVector3f BrushCenter(Center);
+	const FQuat4f InvRotation = FQuat4f(Rotation.Quaternion()).Inverse();
+	const float BrushRadius = FMath::Max(Radius, 0.0f);
+	const FVector3f BrushHalfExtent = FVector3f(HalfExtent).ComponentMax(FVector3f::ZeroVector);
+	const float BrushHalfHeight = FMath::Max(HalfHeight, 0.0f);
+
+	FVoxelSdfBrush SdfBrush;
+	SdfBrush.Operation = Operation;
+	SdfBrush.Smoothness = FMath::Max(Smoothness, 0.0f);
+
+	// Rotated shapes are bounded by their circumscribed sphere
+	float BoundsRadius = BrushRadius;
+	switch (Shape)
+	{
+	case EVoxelBrushShape::Sphere:
+		SdfBrush.Sdf = [BrushCenter, BrushRadius](const FVector3f& Position)
+		{
+			return (Position - BrushCenter).Size() - BrushRadius;
+		};
+		break;
+	case EVoxelBrushShape::Box:
+		BoundsRadius = BrushHalfExtent.Size();
+		SdfBrush.Sdf = [BrushCenter, InvRotation, BrushHalfExtent](const FVector3f& Position)
+		{
+			const FVector3f Local = InvRotation.RotateVector(Position - BrushCenter);
+			const FVector3f Q = Local.GetAbs() - BrushHalfExtent;
+			return Q.ComponentMax(FVector3f::ZeroVector).Size() + FMath::Min(Q.GetMax(), 0.0f);
+		};
+		break;
+	case EVoxelBrushShape::Capsule:
+		BoundsRadius = BrushHalfHeight + BrushRadius;
+		SdfBrush.Sdf = [BrushCenter, InvRotation, BrushRadius, BrushHalfHeight](const FVector3f& Position)
+		{
+			FVector3f Local = InvRotation.RotateVector(Position - BrushCenter);
+			Local.Z -= FMath::Clamp(Local.Z, -BrushHalfHeight, BrushHalfHeight);
+			return Local.Size() - BrushRadius;
+		};
+		break;
+	}
+	SdfBrush.Bounds = FBox3f(BrushCenter - FVector3f(BoundsRadius), BrushCenter + FVector3f(BoundsRadius));
+	return SdfBrush;
+}
@@ -0,0 +1,75 @@
+﻿#include "VoxelChunkApron.h"
+
+#include "Async/ParallelFor.h"
+
+FVoxelChunkApron FVoxelChunkApron::Build(const FIntVector& InVoxelSize, const FNeighbourGrids& Grids)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelChunkApron::Build);
+	check(Grids[0]);
+
+	FVoxelChunkApron Apron;
+	Apron.VoxelSize = InVoxelSize;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		if (Grids[1 << Axis])
+		{
+			Apron.Faces |= 1u << Axis;
+		}
+	}
+	if (Apron.IsEmpty())
+	{
+		return Apron;
+	}
+
+	const FIntVector PaddedVoxelSize = Apron.GetPaddedVoxelSize();
+	Apron.Values.SetNumUninitialized(Apron.GetPlaneOffset(3));
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		if (!Apron.HasFace(Axis))
+		{
+			continue;
+		}
+
+		const int32 AxisU = Axis == 0 ? 1 : 0;
+		const int32 AxisV = Axis == 2 ? 1 : 2;
+		float* PlaneValues = Apron.Values.GetData() + Apron.GetPlaneOffset(Axis);
+		ParallelFor(PaddedVoxelSize[AxisU], [&](int32 U)
+		{
+			TStaticArray<TOptional<nanovdb::DefaultReadAccessor<nanovdb::Fp4>>, 8> Accessors;
+			for (int32 V = 0; V < PaddedVoxelSize[AxisV]; ++V)
+			{
+				FIntVector Coord;
+				Coord[Axis] = InVoxelSize[Axis];
+				Coord[AxisU] = U;
+				Coord[AxisV] = V;
+
+				// Chunk owning the voxel, diagonal neighbours may be missing: fall back on the closest existing one,
+				// clamping the coordinates that were past it
+				uint32 Offset = 0;
+				for (int32 OffsetAxis = 0; OffsetAxis < 3; ++OffsetAxis)
+				{
+					Offset |= Coord[OffsetAxis] >= InVoxelSize[OffsetAxis] ? 1u << OffsetAxis : 0u;
+				}
+				uint32 Existing = Offset;
+				while (!Grids[Existing])
+				{
+					Existing = (Existing - 1) & Offset;
+				}
+				for (int32 OffsetAxis = 0; OffsetAxis < 3; ++OffsetAxis)
+				{
+					if (Offset & (1u << OffsetAxis))
+					{
+						Coord[OffsetAxis] = (Existing & (1u << OffsetAxis)) ? 0 : InVoxelSize[OffsetAxis] - 1;
+					}
+				}
+
+				if (!Accessors[Existing].IsSet())
+				{
+					Accessors[Existing].Emplace(Grids[Existing]->getAccessor());
+				}
+				PlaneValues[U * PaddedVoxelSize[AxisV] + V] = Accessors[Existing]->getValue(nanovdb::Coord(Coord.X, Coord.Y, Coord.Z));
+			}
+		});
+	}
+	return Apron;
+}
@@ -0,0 +1,28 @@
+﻿#include "VoxelChunkGrid.h"
+
+bool FVoxelChunkGrid::AddLeaf(FBuildGrid& Grid, FBuildLeaf* Leaf, bool bInside, const FIntVector& LeafOrigin)
+{
+	if (Leaf)
+	{
+		Grid.root().addNode(Leaf);
+		return true;
+	}
+	if (bInside)
+	{
+		Grid.root().addTile<1>(nanovdb::Coord(LeafOrigin.X, LeafOrigin.Y, LeafOrigin.Z), -Grid.root().background(), false);
+	}
+	return false;
+}
+
+uint32 FVoxelChunkGrid::AddLeaves(FBuildGrid& Grid, TConstArrayView<FBuildLeaf*> Leaves, TConstArrayView<uint8> Inside, TFunctionRef<FIntVector(int32 LeafIndex)> GetLeafOrigin)
+{
+	uint32 NumLeaves = 0;
+	for (int32 LeafIndex = 0; LeafIndex < Leaves.Num(); ++LeafIndex)
+	{
+		if (Leaves[LeafIndex] || Inside[LeafIndex])
+		{
+			NumLeaves += AddLeaf(Grid, Leaves[LeafIndex], Inside[LeafIndex] != 0, GetLeafOrigin(LeafIndex));
+		}
+	}
+	return NumLeaves;
+}
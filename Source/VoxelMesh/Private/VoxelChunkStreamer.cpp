@@ -0,0 +1,186 @@
+﻿#include "VoxelChunkStreamer.h"
+
+void FVoxelChunkStreamer::AddChunk(const FIntVector& ChunkCoord)
+{
+	Chunks.FindOrAdd(ChunkCoord, EVoxelChunkStreamingState::Unloaded);
+}
+
+EVoxelChunkStreamingState FVoxelChunkStreamer::RemoveChunk(const FIntVector& ChunkCoord)
+{
+	EVoxelChunkStreamingState State = EVoxelChunkStreamingState::Unloaded;
+	Chunks.RemoveAndCopyValue(ChunkCoord, State);
+	ActiveChunks.Remove(ChunkCoord);
+	return State;
+}
+
+EVoxelChunkStreamingState FVoxelChunkStreamer::GetState(const FIntVector& ChunkCoord) const
+{
+	const EVoxelChunkStreamingState* State = Chunks.Find(ChunkCoord);
+	return State ? *State : EVoxelChunkStreamingState::Unloaded;
+}
+
+void FVoxelChunkStreamer::SetState(const FIntVector& ChunkCoord, EVoxelChunkStreamingState NewState)
+{
+	EVoxelChunkStreamingState* State = Chunks.Find(ChunkCoord);
+	if (State && *State != EVoxelChunkStreamingState::Unloaded)
+	{
+		*State = NewState;
+	}
+}
+
+double FVoxelChunkStreamer::GetDistance(const FIntVector& ChunkCoord, const FVector& Position, double ChunkWorldSize)
+{
+	double DistanceSquared = 0.0;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		const double Min = ChunkCoord[Axis] * ChunkWorldSize;
+		const double Delta = FMath::Max3(Min - Position[Axis], Position[Axis] - (Min + ChunkWorldSize), 0.0);
+		DistanceSquared += Delta * Delta;
+	}
+	return FMath::Sqrt(DistanceSquared);
+}
+
+void FVoxelChunkStreamer::Update(TConstArrayView<FVector> ViewOrigins, const FVoxelStreamingSettings& Settings, FUpdate& OutUpdate)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelChunkStreamer::Update);
+	OutUpdate.Reset();
+	const double ChunkWorldSize = FMath::Max(Settings.ChunkWorldSize, 1.0f);
+	const double LoadDistance = Settings.LoadDistance;
+	const double UnloadDistance = FMath::Max(Settings.UnloadDistance, Settings.LoadDistance);
+	auto GetViewDistance = [&](const FIntVector& ChunkCoord)
+	{
+		double Distance = TNumericLimits<double>::Max();
+		for (const FVector& Origin : ViewOrigins)
+		{
+			Distance = FMath::Min(Distance, GetDistance(ChunkCoord, Origin, ChunkWorldSize));
+		}
+		return Distance;
+	};
+
+	// Queues of the update, closest chunks first
+	using FQueue = TArray<TPair<double, FIntVector>>;
+	FQueue LoadQueue;
+	FQueue MeshQueue;
+	FQueue UploadQueue;
+	Stats = FVoxelStreamingStats();
+	Stats.NumRegistered = Chunks.Num();
+
+	if (!ViewOrigins.IsEmpty())
+	{
+		for (const FIntVector& ChunkCoord : ActiveChunks)
+		{
+			if (GetViewDistance(ChunkCoord) > UnloadDistance)
+			{
+				OutUpdate.ToUnload.Add(ChunkCoord);
+			}
+		}
+		for (const FIntVector& ChunkCoord : OutUpdate.ToUnload)
+		{
+			Chunks[ChunkCoord] = EVoxelChunkStreamingState::Unloaded;
+			ActiveChunks.Remove(ChunkCoord);
+		}
+
+		// Chunks in range of the views when there are fewer of them than registered chunks, every registered chunk otherwise
+		auto TryQueueLoad = [&](const FIntVector& ChunkCoord, EVoxelChunkStreamingState State)
+		{
+			if (State == EVoxelChunkStreamingState::Unloaded)
+			{
+				const double Distance = GetViewDistance(ChunkCoord);
+				if (Distance <= LoadDistance)
+				{
+					LoadQueue.Emplace(Distance, ChunkCoord);
+				}
+			}
+		};
+		const int64 Reach = FMath::CeilToInt64(LoadDistance / ChunkWorldSize) + 1;
+		if (ViewOrigins.Num() * FMath::Cube(2 * Reach + 1) < Chunks.Num())
+		{
+			TSet<FIntVector> Visited;
+			for (const FVector& Origin : ViewOrigins)
+			{
+				const FIntVector Min(
+					FMath::FloorToInt32((Origin.X - LoadDistance) / ChunkWorldSize),
+					FMath::FloorToInt32((Origin.Y - LoadDistance) / ChunkWorldSize),
+					FMath::FloorToInt32((Origin.Z - LoadDistance) / ChunkWorldSize));
+				const FIntVector Max(
+					FMath::FloorToInt32((Origin.X + LoadDistance) / ChunkWorldSize),
+					FMath::FloorToInt32((Origin.Y + LoadDistance) / ChunkWorldSize),
+					FMath::FloorToInt32((Origin.Z + LoadDistance) / ChunkWorldSize));
+				for (int32 X = Min.X; X <= Max.X; ++X)
+				{
+					for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+					{
+						for (int32 Z = Min.Z; Z <= Max.Z; ++Z)
+						{
+							const FIntVector ChunkCoord(X, Y, Z);
+							const EVoxelChunkStreamingState* State = Chunks.Find(ChunkCoord);
+							if (State && *State == EVoxelChunkStreamingState::Unloaded && !Visited.Contains(ChunkCoord))
+							{
+								Visited.Add(ChunkCoord);
+								TryQueueLoad(ChunkCoord, *State);
+							}
+						}
+					}
+				}
+			}
+		}
+		else
+		{
+			for (const TPair<FIntVector, EVoxelChunkStreamingState>& Chunk : Chunks)
+			{
+				TryQueueLoad(Chunk.Key, Chunk.Value);
+			}
+		}
+	}
+
+	for (const FIntVector& ChunkCoord : ActiveChunks)
+	{
+		switch (Chunks[ChunkCoord])
+		{
+		case EVoxelChunkStreamingState::Loading:
+			++Stats.LoadsInFlight;
+			break;
+		case EVoxelChunkStreamingState::Loaded:
+			MeshQueue.Emplace(GetViewDistance(ChunkCoord), ChunkCoord);
+			break;
+		case EVoxelChunkStreamingState::Meshing:
+			++Stats.MeshesInFlight;
+			break;
+		case EVoxelChunkStreamingState::Meshed:
+			UploadQueue.Emplace(GetViewDistance(ChunkCoord), ChunkCoord);
+			break;
+		case EVoxelChunkStreamingState::Visible:
+			++Stats.NumVisible;
+			break;
+		case EVoxelChunkStreamingState::Empty:
+			++Stats.NumEmpty;
+			break;
+		default:
+			break;
+		}
+	}
+
+	auto Dequeue = [this](FQueue& Queue, int32 Budget, EVoxelChunkStreamingState NewState, TArray<FIntVector>& OutChunks)
+	{
+		Queue.Sort([](const TPair<double, FIntVector>& A, const TPair<double, FIntVector>& B) { return A.Key < B.Key; });
+		const int32 Num = FMath::Min(Queue.Num(), FMath::Max(Budget, 0));
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			const FIntVector& ChunkCoord = Queue[Index].Value;
+			Chunks[ChunkCoord] = NewState;
+			ActiveChunks.Add(ChunkCoord);
+			OutChunks.Add(ChunkCoord);
+		}
+		return Queue.Num() - Num;
+	};
+	Stats.PendingLoads = Dequeue(LoadQueue, Settings.MaxLoadsPerFrame, EVoxelChunkStreamingState::Loading, OutUpdate.ToLoad);
+	Stats.PendingMeshes = Dequeue(MeshQueue, Settings.MaxMeshesPerFrame, EVoxelChunkStreamingState::Meshing, OutUpdate.ToMesh);
+	Stats.PendingUploads = Dequeue(UploadQueue, Settings.MaxUploadsPerFrame, EVoxelChunkStreamingState::Visible, OutUpdate.ToUpload);
+	Stats.LoadsInFlight += OutUpdate.ToLoad.Num();
+	Stats.MeshesInFlight += OutUpdate.ToMesh.Num();
+	Stats.NumVisible += OutUpdate.ToUpload.Num();
+	Stats.NumLoadsStarted = OutUpdate.ToLoad.Num();
+	Stats.NumMeshesStarted = OutUpdate.ToMesh.Num();
+	Stats.NumUploadsStarted = OutUpdate.ToUpload.Num();
+	Stats.NumUnloaded = OutUpdate.ToUnload.Num();
+}
@@ -3,6 +3,7 @@
 
 #include "VoxelChunkView.h"
 #include "VoxelMeshLog.h"
+#include "VoxelMeshRebuildScheduler.h"
 
 #include "RenderGraphBuilder.h"
 #include "RenderGraphUtils.h"
@@ -11,7 +12,13 @@
 
 #include "IRenderCaptureProvider.h"
 #include "VoxelUtilities.h"
+#include "VoxelBrickTraversal.h"
+#include "VoxelCpuMesher.h"
+#include "VoxelSurfaceNetsMesher.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
 #include "Engine/TextureRenderTarget2D.h"
+#include "Tasks/Task.h"
 #include "nanovdb/io/IO.h"
 #include "VoxelMeshLog.h"
 
@@ -27,6 +34,8 @@ UVoxelChunkView::UVoxelChunkView(const FObjectInitializer& ObjectInitializer)
 
 UVoxelChunkView::~UVoxelChunkView()
 {
+	FTSTicker::GetCoreTicker().RemoveTicker(FlushBrushesHandle);
+	FTSTicker::GetCoreTicker().RemoveTicker(QueuedVdbBufferHandle);
 }
 
 bool UVoxelChunkView::IsDirty() const
@@ -39,20 +48,43 @@ bool UVoxelChunkView::IsEmpty() const
 	return VdbBulkData.IsEmpty();
 }
 
+bool UVoxelChunkView::HasSurface() const
+{
+	const nanovdb::NanoGrid<nanovdb::Fp4>* Grid = HostVdbBuffer.grid<nanovdb::Fp4>();
+	return Grid && Grid->tree().nodeCount(0) > 0;
+}
+
 void UVoxelChunkView::MarkAsDirty()
 {
+	// The mesh generated in flight comes from the previous grid
+	if (RHIProxy)
+	{
+		RHIProxy->CancelGeneration();
+	}
 	RHIProxy = MakeShared<FVoxelChunkViewRHIProxy>(this);
 }
 
+void UVoxelChunkView::ReleaseRHIProxy()
+{
+	if (RHIProxy)
+	{
+		RHIProxy->CancelGeneration();
+		RHIProxy.Reset();
+	}
+}
+
 void UVoxelChunkView::SetVdbBuffer_GameThread(nanovdb::GridHandle<nanovdb::HostBuffer>&& NewBuffer)
 {
+	EditableGrid.Reset();
 	if (NewBuffer)
 	{
 		nanovdb::HostBuffer& Buffer = NewBuffer.buffer();
 		VdbBulkData.SetNumUninitialized(Buffer.size());
 		FMemory::Memcpy(VdbBulkData.GetData(), Buffer.data(), Buffer.size());
 		HostVdbBuffer = nanovdb::HostBuffer::createFull(VdbBulkData.NumBytes(), VdbBulkData.GetData());
-		
+
+
+		// The index bounding box is the chunk extent, see FVoxelChunkGrid::Encode
 		const auto& Grid = HostVdbBuffer.grid<nanovdb::Fp4>();
 		const auto& Bbox = Grid->indexBBox();
 		const auto& BboxMin = Bbox.min();
@@ -72,6 +104,249 @@ void UVoxelChunkView::SetVdbBuffer_GameThread(nanovdb::GridHandle<nanovdb::HostB
 	MarkAsDirty();
 }
 
+void UVoxelChunkView::QueueVdbBuffer_GameThread(nanovdb::GridHandle<nanovdb::HostBuffer>&& NewBuffer)
+{
+	QueuedVdbBuffer = MoveTemp(NewBuffer);
+	const auto ApplyQueuedVdbBuffer = [this]
+	{
+		// A new proxy would cancel the mesh in flight, let it land first
+		if (RHIProxy && RHIProxy->IsGenerating())
+		{
+			return false;
+		}
+		SetVdbBuffer_GameThread(MoveTemp(QueuedVdbBuffer));
+		if (RHIProxy)
+		{
+			RebuildMesh();
+		}
+		return true;
+	};
+
+	// Already waiting, the ticker picks the newest grid up
+	if (QueuedVdbBufferHandle.IsValid() || ApplyQueuedVdbBuffer())
+	{
+		return;
+	}
+	QueuedVdbBufferHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this, ApplyQueuedVdbBuffer](float)
+	{
+		if (!ApplyQueuedVdbBuffer())
+		{
+			return true;
+		}
+		QueuedVdbBufferHandle.Reset();
+		return false;
+	}));
+}
+
+void UVoxelChunkView::SetMaterialBuffer_GameThread(nanovdb::GridHandle<nanovdb::HostBuffer>&& NewBuffer)
+{
+	if (NewBuffer)
+	{
+		nanovdb::HostBuffer& Buffer = NewBuffer.buffer();
+		MaterialBulkData.SetNumUninitialized(Buffer.size());
+		FMemory::Memcpy(MaterialBulkData.GetData(), Buffer.data(), Buffer.size());
+		HostMaterialBuffer = nanovdb::HostBuffer::createFull(MaterialBulkData.NumBytes(), MaterialBulkData.GetData());
+	}
+	else
+	{
+		HostMaterialBuffer.reset();
+		MaterialBulkData.Reset();
+	}
+}
+
+int32 UVoxelChunkView::GetVoxelMaterial(FIntVector Coord) const
+{
+	if (const nanovdb::NanoGrid<uint8_t>* Grid = HostMaterialBuffer.grid<uint8_t>())
+	{
+		return Grid->getAccessor().getValue(nanovdb::Coord(Coord.X, Coord.Y, Coord.Z));
+	}
+	return 0;
+}
+
+void UVoxelChunkView::UpdateVdbBuffer_GameThread(nanovdb::GridHandle<nanovdb::HostBuffer>&& NewBuffer, const FIntVector& DirtyMin, const FIntVector& DirtyMax)
+{
+	const FIntVector PreviousDimension(DimensionX, DimensionY, DimensionZ);
+	const TSharedPtr<FVoxelChunkViewRHIProxy> PreviousProxy = RHIProxy;
+	SetVdbBuffer_GameThread(MoveTemp(NewBuffer));
+
+	// Sections are meshed on the CPU, chunks generated by the compute passes stay on them. Surface nets vertices depend on all
+	// the cells around them, they are meshed as a whole.
+	if (RHIProxy && PreviousProxy && PreviousDimension == FIntVector(DimensionX, DimensionY, DimensionZ)
+		&& GetGenerationMode() == EVoxelMeshGenerationMode::CpuReference && GetMeshingAlgorithm() == EVoxelMeshingAlgorithm::MarchingCubes
+		&& LodIndex == 0 && RHIProxy->InheritMesh(*PreviousProxy))
+	{
+		RHIProxy->RemeshVoxels_GameThread(DirtyMin, DirtyMax);
+		return;
+	}
+	if (RHIProxy)
+	{
+		// Edits are waited for, they go before the rebuilds of the streaming and the levels of detail
+		RebuildMesh(1.0f);
+	}
+}
+
+void UVoxelChunkView::BeginEditing()
+{
+	if (EditableGrid)
+	{
+		return;
+	}
+	if (HostVdbBuffer.isEmpty())
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("Can't edit %s, it has no grid"), *GetName());
+		return;
+	}
+	EditableGrid = MakeUnique<FVoxelEditableGrid>(*HostVdbBuffer.grid<nanovdb::Fp4>(), FIntVector(DimensionX, DimensionY, DimensionZ));
+	EditableGrid->SetMaxJournalSize(static_cast<uint64>(UndoHistoryMiB) * 1024 * 1024);
+}
+
+void UVoxelChunkView::EndEditing()
+{
+	RebakeEdits();
+	EditableGrid.Reset();
+}
+
+void UVoxelChunkView::SetVoxelValue(FIntVector Coord, float Value)
+{
+	if (!EditableGrid)
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("SetVoxelValue called on %s outside of BeginEditing/EndEditing"), *GetName());
+		return;
+	}
+	EditableGrid->SetValue(Coord, Value);
+}
+
+float UVoxelChunkView::GetVoxelValue(FIntVector Coord) const
+{
+	if (EditableGrid)
+	{
+		return EditableGrid->GetValue(Coord);
+	}
+	if (const nanovdb::NanoGrid<nanovdb::Fp4>* Grid = HostVdbBuffer.grid<nanovdb::Fp4>())
+	{
+		return Grid->getAccessor().getValue(nanovdb::Coord(Coord.X, Coord.Y, Coord.Z));
+	}
+	return 0.0f;
+}
+
+void UVoxelChunkView::RebakeEdits()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UVoxelChunkView::RebakeEdits);
+	if (!EditableGrid || !EditableGrid->IsDirty())
+	{
+		return;
+	}
+
+	FIntVector DirtyMin, DirtyMax;
+	FVoxelEditableGrid::FBakeStats Stats;
+	nanovdb::GridHandle<nanovdb::HostBuffer> NewBuffer = EditableGrid->Bake(DirtyMin, DirtyMax, &Stats);
+	UE_LOG(LogVoxelMesh, Log, TEXT("Rebaked %s: renormalize %.2f ms, flood fill %.2f ms, prune %.2f ms, encode %.2f ms, %u leaves (%u pruned), %.1f KiB"),
+		*GetName(), Stats.RenormalizeSeconds * 1000.0, Stats.FloodFillSeconds * 1000.0, Stats.PruneSeconds * 1000.0, Stats.EncodeSeconds * 1000.0,
+		Stats.NumLeaves, Stats.NumPrunedLeaves, Stats.NumBytes / 1024.0);
+
+	// Setting the buffer drops the editable copy, it is still up to date here
+	TUniquePtr<FVoxelEditableGrid> KeptGrid = MoveTemp(EditableGrid);
+	UpdateVdbBuffer_GameThread(MoveTemp(NewBuffer), DirtyMin, DirtyMax);
+	EditableGrid = MoveTemp(KeptGrid);
+}
+
+void UVoxelChunkView::ApplyBrush(const FVoxelBrush& Brush)
+{
+	ApplySdfBrush(Brush.ToSdfBrush());
+}
+
+void UVoxelChunkView::ApplySdfBrush(FVoxelSdfBrush&& Brush)
+{
+	PendingBrushes.Add(MoveTemp(Brush));
+	if (!FlushBrushesHandle.IsValid())
+	{
+		FlushBrushesHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this](float)
+		{
+			FlushBrushesHandle.Reset();
+			FlushBrushes();
+			return false;
+		}));
+	}
+}
+
+void UVoxelChunkView::FlushBrushes()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UVoxelChunkView::FlushBrushes);
+	if (PendingBrushes.IsEmpty())
+	{
+		return;
+	}
+
+	BeginEditing();
+	if (EditableGrid)
+	{
+		for (const FVoxelSdfBrush& Brush : PendingBrushes)
+		{
+			EditableGrid->ApplyBrush(Brush);
+		}
+		RebakeEdits();
+	}
+	PendingBrushes.Reset();
+}
+
+void UVoxelChunkView::BeginEditTransaction()
+{
+	BeginEditing();
+	if (EditableGrid)
+	{
+		FlushBrushes();
+		RebakeEdits();
+		EditableGrid->BeginTransaction();
+	}
+}
+
+void UVoxelChunkView::EndEditTransaction()
+{
+	if (EditableGrid)
+	{
+		FlushBrushes();
+		RebakeEdits();
+		EditableGrid->EndTransaction();
+	}
+}
+
+bool UVoxelChunkView::UndoEdit()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UVoxelChunkView::UndoEdit);
+	if (!EditableGrid)
+	{
+		return false;
+	}
+
+	// Pending edits become their own step first
+	FlushBrushes();
+	RebakeEdits();
+	if (!EditableGrid->Undo())
+	{
+		return false;
+	}
+	RebakeEdits();
+	return true;
+}
+
+bool UVoxelChunkView::RedoEdit()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UVoxelChunkView::RedoEdit);
+	if (!EditableGrid)
+	{
+		return false;
+	}
+
+	FlushBrushes();
+	RebakeEdits();
+	if (!EditableGrid->Redo())
+	{
+		return false;
+	}
+	RebakeEdits();
+	return true;
+}
+
 void UVoxelChunkView::UpdateSurfaceIsoValue(float NewValue)
 {
 	if (NewValue != SurfaceIsoValue)
@@ -81,6 +356,56 @@ void UVoxelChunkView::UpdateSurfaceIsoValue(float NewValue)
 	}
 }
 
+void UVoxelChunkView::SetLodIndex(int32 NewLodIndex)
+{
+	NewLodIndex = FMath::Clamp(NewLodIndex, 0, NumLods - 1);
+	if (NewLodIndex != LodIndex)
+	{
+		LodIndex = NewLodIndex;
+		RebuildMesh();
+	}
+}
+
+void UVoxelChunkView::SetTransitionFaces(int32 NewTransitionFaces)
+{
+	NewTransitionFaces &= 0x3F;
+	if (NewTransitionFaces != TransitionFaces)
+	{
+		TransitionFaces = NewTransitionFaces;
+		RebuildMesh();
+	}
+}
+
+void UVoxelChunkView::SetNeighbour(FIntVector Offset, UVoxelChunkView* Neighbour)
+{
+	if (Offset.X < 0 || Offset.X > 1 || Offset.Y < 0 || Offset.Y > 1 || Offset.Z < 0 || Offset.Z > 1 || Offset == FIntVector::ZeroValue)
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("Invalid neighbour offset %s, expected a positive unit offset"), *Offset.ToString());
+		return;
+	}
+
+	const int32 OffsetBits = Offset.X | (Offset.Y << 1) | (Offset.Z << 2);
+	if (Neighbours[OffsetBits] != Neighbour)
+	{
+		Neighbours[OffsetBits] = Neighbour;
+		RebuildMesh();
+	}
+}
+
+FBox UVoxelChunkView::GetLocalBounds() const
+{
+	const FIntVector Dimension(DimensionX, DimensionY, DimensionZ);
+	FVector Max(0.5);
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		if (IsValid(Neighbours[1 << Axis]))
+		{
+			Max[Axis] += 1.0 / FMath::Max(Dimension[Axis] - 1, 1);
+		}
+	}
+	return FBox(FVector(-0.5), Max);
+}
+
 void UVoxelChunkView::Serialize(FArchive& Ar)
 {
 	UObject::Serialize(Ar);
@@ -94,6 +419,10 @@ void UVoxelChunkView::Serialize(FArchive& Ar)
 			
 			MarkAsDirty();
 		}
+		if (MaterialBulkData.NumBytes() > 0)
+		{
+			HostMaterialBuffer = nanovdb::HostBuffer::createFull(MaterialBulkData.NumBytes(), MaterialBulkData.GetData());
+		}
 	}
 }
 
@@ -101,15 +430,18 @@ void UVoxelChunkView::PostEditChangeProperty(struct FPropertyChangedEvent& Prope
 {
 	UObject::PostEditChangeProperty(PropertyChangedEvent);
 	FName PropertyName = PropertyChangedEvent.GetMemberPropertyName();
-	if (PropertyName == GET_MEMBER_NAME_CHECKED(UVoxelChunkView, SurfaceIsoValue))
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(UVoxelChunkView, SurfaceIsoValue)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(UVoxelChunkView, MeshingAlgorithm)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(UVoxelChunkView, NumLods)
+		|| PropertyName == GET_MEMBER_NAME_CHECKED(UVoxelChunkView, TransitionFaces))
 	{
-		RebuildMesh();
+		RebuildMesh(1.0f);
 	}
 }
 
-void UVoxelChunkView::RebuildMesh()
+void UVoxelChunkView::RebuildMesh(float Urgency)
 {
-	GetRHIProxy()->RegenerateMesh();
+	FVoxelMeshRebuildScheduler::Get().Request(this, Urgency);
 }
 
 TSharedPtr<FVoxelChunkViewRHIProxy> UVoxelChunkView::GetRHIProxy()
@@ -123,13 +455,95 @@ FVoxelChunkViewRHIProxy::FVoxelChunkViewRHIProxy(const UVoxelChunkView* ChunkVie
 	, VoxelSizeY(ChunkView->DimensionY)
 	, VoxelSizeZ(ChunkView->DimensionZ)
 	, SurfaceIsoValue(ChunkView->SurfaceIsoValue)
-	, bIsReady(true)
+	, NumLods(FMath::Clamp(ChunkView->NumLods, 1, FVoxelGridPyramid::MaxNumLevels))
+	, LodScreenSize(ChunkView->LodScreenSize)
+	, DesiredLodIndex(0)
+	, ScreenSize(0.0f)
+	, LastBuildMs(0.0f)
+	, NumBuilds(0)
+	, RequestedGeneration(0)
 {
 	check(IsValid(ChunkView) && !ChunkView->HostVdbBuffer.isEmpty());
+	if (const FVoxelChunkViewRHIProxy* Previous = ChunkView->RHIProxy.Get())
+	{
+		ScreenSize.store(Previous->ScreenSize.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		BuildMsPerVoxel = Previous->BuildMsPerVoxel;
+	}
 	// const nanovdb::HostBuffer& HostBuffer = ChunkView->HostVdbBuffer.buffer();
 	// const nanovdb::NanoGrid<float>* GridData = ChunkView->HostVdbBuffer.grid<float>();
 	// const uint64_t GridByteSize = ChunkView->HostVdbBuffer.size();
 	VoxelDataBuffer = ChunkView->VdbBulkData;
+	BaseVoxelSize = FIntVector(VoxelSizeX, VoxelSizeY, VoxelSizeZ);
+	Apron.VoxelSize = BaseVoxelSize;
+	CoarseLevels.SetNum(FVoxelGridPyramid::MaxNumLevels - 1);
+}
+
+int32 FVoxelChunkViewRHIProxy::ComputeLodIndex(float ScreenSize) const
+{
+	int32 Lod = 0;
+	for (float Threshold = LodScreenSize; Lod + 1 < NumLods && ScreenSize < Threshold; Threshold *= 0.5f)
+	{
+		++Lod;
+	}
+	return Lod;
+}
+
+void FVoxelChunkViewRHIProxy::BuildLods_AnyThread(int32 InLodIndex)
+{
+	FScopeLock Lock(&CoarseLevelsLock);
+	for (int32 Level = 1; Level <= InLodIndex; ++Level)
+	{
+		if (CoarseLevels[Level - 1])
+		{
+			continue;
+		}
+
+		TUniquePtr<FVoxelGridLevel> NewLevel = MakeUnique<FVoxelGridLevel>();
+		if (Level == 1)
+		{
+			const nanovdb::NanoGrid<nanovdb::Fp4>* Grid = reinterpret_cast<const nanovdb::NanoGrid<nanovdb::Fp4>*>(VoxelDataBuffer.GetData());
+			FVoxelGridPyramid::BuildCoarseLevel(*Grid, BaseVoxelSize, *NewLevel);
+		}
+		else
+		{
+			const FVoxelGridLevel& FineLevel = *CoarseLevels[Level - 2];
+			FVoxelGridPyramid::BuildCoarseLevel(*FineLevel.GetGrid(), FineLevel.VoxelSize, *NewLevel);
+		}
+		CoarseLevels[Level - 1] = MoveTemp(NewLevel);
+	}
+}
+
+FVoxelChunkApron FVoxelChunkViewRHIProxy::BuildApron_AnyThread(const FNeighbourProxies& NeighbourProxies) const
+{
+	FVoxelChunkApron::FNeighbourGrids Grids;
+	Grids[0] = reinterpret_cast<const FVoxelChunkApron::FGridType*>(VoxelDataBuffer.GetData());
+	for (int32 OffsetBits = 1; OffsetBits < NeighbourProxies.Num(); ++OffsetBits)
+	{
+		const FVoxelChunkViewRHIProxy* Neighbour = NeighbourProxies[OffsetBits].Get();
+		Grids[OffsetBits] = Neighbour ? reinterpret_cast<const FVoxelChunkApron::FGridType*>(Neighbour->VoxelDataBuffer.GetData()) : nullptr;
+	}
+	return FVoxelChunkApron::Build(BaseVoxelSize, Grids);
+}
+
+void FVoxelChunkViewRHIProxy::SelectLod(int32 InLodIndex)
+{
+	check(IsInRenderingThread() && IsGenerating());
+	check(InLodIndex == 0 || Apron.IsEmpty());
+	LodIndex = InLodIndex;
+	const FIntVector LodVoxelSize = LodIndex > 0 ? GetLodGridSize(LodIndex) : Apron.GetPaddedVoxelSize();
+	VoxelSizeX = LodVoxelSize.X;
+	VoxelSizeY = LodVoxelSize.Y;
+	VoxelSizeZ = LodVoxelSize.Z;
+}
+
+const TArray<uint8>& FVoxelChunkViewRHIProxy::GetLodVoxelData(int32 InLodIndex) const
+{
+	return InLodIndex > 0 ? CoarseLevels[InLodIndex - 1]->VoxelDataBuffer : VoxelDataBuffer;
+}
+
+FIntVector FVoxelChunkViewRHIProxy::GetLodGridSize(int32 InLodIndex) const
+{
+	return InLodIndex > 0 ? CoarseLevels[InLodIndex - 1]->VoxelSize : BaseVoxelSize;
 }
 
 void FVoxelChunkViewRHIProxy::ResizeBuffer_RenderThread(uint32_t NewVBSize, uint32 NewIBSize)
@@ -163,20 +577,28 @@ static TAutoConsoleVariable<int32> CVarVoxelMeshGenerationComputeDebug(
 	TEXT("1: on\n"),
 	ECVF_RenderThreadSafe);
 
-void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmediate& RHICmdList)
+void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmediate& RHICmdList, int32 InLodIndex, TSharedPtr<FVoxelChunkApron> InApron)
 {
-    if (bool Expected = true; !bIsReady.compare_exchange_strong(Expected, false))
+    check(IsGenerating());
+    if (IsStale())
     {
+        FinishGeneration_AnyThread(0.0f);
         return;
     }
+    const double StartTime = FPlatformTime::Seconds();
+    const auto GetElapsedMs = [StartTime] { return static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0); };
+    Apron = InApron ? MoveTemp(*InApron) : FVoxelChunkApron{ BaseVoxelSize };
+    SectionLayout.Reset();
+    SelectLod(InLodIndex);
     SCOPED_GPU_STAT(RHICmdList, FVoxelMeshGeneration);
     RHI_BREADCRUMB_EVENT(RHICmdList, "VoxelMeshGeneration");
     
     FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
     check(ShaderMap);
 
-    // Calculate the total number of cubes using all three dimensions
-    const size_t TotalCubes = VoxelSizeX * VoxelSizeY * VoxelSizeZ;
+    // Cubes are traversed brick by brick, partially covered bricks are padded
+    const FVoxelBrickTraversal Traversal(VoxelSizeX, VoxelSizeY, VoxelSizeZ);
+    const size_t TotalCubes = Traversal.GetNumTraversalIds();
 
     // RenderDoc Capture
 	if (CVarVoxelMeshGenerationComputeDebug->GetBool())
@@ -200,16 +622,33 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
     UniformParameters.VoxelSizeZ = VoxelSizeZ;
     UniformParameters.SurfaceIsoValue = SurfaceIsoValue;
     UniformParameters.TotalCubes = TotalCubes;
+    UniformParameters.BrickCountX = Traversal.BrickCount.X;
+    UniformParameters.BrickCountY = Traversal.BrickCount.Y;
+    UniformParameters.BrickCountZ = Traversal.BrickCount.Z;
+    UniformParameters.TransitionFaces = TransitionFaces;
+    UniformParameters.ApronFaces = Apron.Faces;
     TUniformBufferRef<FVoxelMarchingCubeUniformParameters> UniformParametersBuffer = CreateUniformBufferImmediate(UniformParameters, UniformBuffer_SingleFrame);
 
     // Nanovdb data buffer
     FRHIResourceCreateInfo UniformBufferCreateInfo(TEXT("VoxelMeshGridBuffer"));
-    FBufferRHIRef GridBuffer = RHICmdList.CreateStructuredBuffer(sizeof(uint32), VoxelDataBuffer.NumBytes(), EBufferUsageFlags::ShaderResource | EBufferUsageFlags::VertexBuffer, ERHIAccess::SRVMask, UniformBufferCreateInfo);
-    uint8* GridStagingPtr = static_cast<uint8*>(RHICmdList.LockBuffer(GridBuffer, 0, VoxelDataBuffer.NumBytes(), RLM_WriteOnly));
-    FMemory::Memcpy(GridStagingPtr, VoxelDataBuffer.GetData(), VoxelDataBuffer.NumBytes());
+    const TArray<uint8>& GridData = GetLodVoxelData(LodIndex);
+    FBufferRHIRef GridBuffer = RHICmdList.CreateStructuredBuffer(sizeof(uint32), GridData.NumBytes(), EBufferUsageFlags::ShaderResource | EBufferUsageFlags::VertexBuffer, ERHIAccess::SRVMask, UniformBufferCreateInfo);
+    uint8* GridStagingPtr = static_cast<uint8*>(RHICmdList.LockBuffer(GridBuffer, 0, GridData.NumBytes(), RLM_WriteOnly));
+    FMemory::Memcpy(GridStagingPtr, GridData.GetData(), GridData.NumBytes());
     RHICmdList.UnlockBuffer(GridBuffer);
     FShaderResourceViewRHIRef GridBufferSRV = RHICmdList.CreateShaderResourceView(GridBuffer, FRHIViewDesc::CreateBufferSRV().SetTypeFromBuffer(GridBuffer));
 
+    // Apron data buffer, a single value keeps it valid when there is no neighbour
+    static const float EmptyApronValue = 0.0f;
+    const void* ApronData = Apron.IsEmpty() ? static_cast<const void*>(&EmptyApronValue) : Apron.Values.GetData();
+    const uint32 ApronBytes = Apron.IsEmpty() ? sizeof(EmptyApronValue) : Apron.Values.NumBytes();
+    FRHIResourceCreateInfo ApronBufferCreateInfo(TEXT("VoxelMeshApronBuffer"));
+    FBufferRHIRef ApronBuffer = RHICmdList.CreateStructuredBuffer(sizeof(float), ApronBytes, EBufferUsageFlags::ShaderResource, ERHIAccess::SRVMask, ApronBufferCreateInfo);
+    void* ApronStagingPtr = RHICmdList.LockBuffer(ApronBuffer, 0, ApronBytes, RLM_WriteOnly);
+    FMemory::Memcpy(ApronStagingPtr, ApronData, ApronBytes);
+    RHICmdList.UnlockBuffer(ApronBuffer);
+    FShaderResourceViewRHIRef ApronBufferSRV = RHICmdList.CreateShaderResourceView(ApronBuffer, FRHIViewDesc::CreateBufferSRV().SetTypeFromBuffer(ApronBuffer));
+
     // Cube index offset buffer
     FRDGBufferDesc CubeIndexOffsetBufferDesc = FRDGBufferDesc::CreateBufferDesc(sizeof(uint32), TotalCubes);
     FRHIResourceCreateInfo IndexOffsetBufferCreateInfo(TEXT("VoxelMeshIndexOffsetBuffer"));
@@ -220,9 +659,9 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
     // Create resources for all three steps upfront to avoid waiting
     struct FVoxelProcessingResources
     {
-        TRefCountPtr<FRHIBuffer> NonEmptyCubeLinearIdBuffer = nullptr;
-        TRefCountPtr<FRHIUnorderedAccessView> NonEmptyCubeLinearIdBufferUAV = nullptr;
-        TRefCountPtr<FRHIShaderResourceView> NonEmptyCubeLinearIdBufferSRV = nullptr;
+        TRefCountPtr<FRHIBuffer> NonEmptyBrickIndexBuffer = nullptr;
+        TRefCountPtr<FRHIUnorderedAccessView> NonEmptyBrickIndexBufferUAV = nullptr;
+        TRefCountPtr<FRHIShaderResourceView> NonEmptyBrickIndexBufferSRV = nullptr;
         
         TRefCountPtr<FRHIBuffer> NonEmptyCubeIndexBuffer = nullptr;
         TRefCountPtr<FRHIUnorderedAccessView> NonEmptyCubeIndexBufferUAV = nullptr;
@@ -238,7 +677,7 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
         // Add helper function to check if resources are valid
         bool AreResourcesValid() const
         {
-            return NonEmptyCubeLinearIdBuffer && NonEmptyCubeLinearIdBufferUAV && NonEmptyCubeLinearIdBufferSRV &&
+            return NonEmptyBrickIndexBuffer && NonEmptyBrickIndexBufferUAV && NonEmptyBrickIndexBufferSRV &&
                    NonEmptyCubeIndexBuffer && NonEmptyCubeIndexBufferUAV && NonEmptyCubeIndexBufferSRV &&
                    VertexIndexOffsetBuffer && VertexIndexOffsetBufferUAV && VertexIndexOffsetBufferSRV;
         }
@@ -249,18 +688,18 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
     Resources.EstimatedNonEmptyCubes = FMath::Max<uint32>(TotalCubes, 1024u); // 50% estimate with minimum size
     
     // Create all buffer resources upfront with more realistic size estimates
-    FRHIResourceCreateInfo NonEmptyCubeLinearIdBufferInfo(TEXT("NonEmptyCube LinearId"));
-    Resources.NonEmptyCubeLinearIdBuffer = RHICmdList.CreateBuffer(sizeof(uint32) * Resources.EstimatedNonEmptyCubes, 
-        EBufferUsageFlags::Static | EBufferUsageFlags::ShaderResource | EBufferUsageFlags::UnorderedAccess, 0, ERHIAccess::UAVMask, NonEmptyCubeLinearIdBufferInfo);
-    if (!Resources.NonEmptyCubeLinearIdBuffer)
+    FRHIResourceCreateInfo NonEmptyBrickIndexBufferInfo(TEXT("NonEmptyBrick Index"));
+    Resources.NonEmptyBrickIndexBuffer = RHICmdList.CreateBuffer(sizeof(uint32) * Traversal.GetNumBricks(), 
+        EBufferUsageFlags::Static | EBufferUsageFlags::ShaderResource | EBufferUsageFlags::UnorderedAccess, 0, ERHIAccess::UAVMask, NonEmptyBrickIndexBufferInfo);
+    if (!Resources.NonEmptyBrickIndexBuffer)
     {
-        UE_LOG(LogVoxelMesh, Error, TEXT("Failed to create NonEmptyCubeLinearIdBuffer"));
-        bIsReady.store(true, std::memory_order_release);
+        UE_LOG(LogVoxelMesh, Error, TEXT("Failed to create NonEmptyBrickIndexBuffer"));
+        FinishGeneration_AnyThread(GetElapsedMs());
         return;
     }
-    Resources.NonEmptyCubeLinearIdBufferSRV = RHICmdList.CreateShaderResourceView(Resources.NonEmptyCubeLinearIdBuffer, 
+    Resources.NonEmptyBrickIndexBufferSRV = RHICmdList.CreateShaderResourceView(Resources.NonEmptyBrickIndexBuffer, 
         FRHIViewDesc::CreateBufferSRV().SetType(FRHIViewDesc::EBufferType::Typed).SetFormat(EPixelFormat::PF_R32_UINT));
-    Resources.NonEmptyCubeLinearIdBufferUAV = RHICmdList.CreateUnorderedAccessView(Resources.NonEmptyCubeLinearIdBuffer, 
+    Resources.NonEmptyBrickIndexBufferUAV = RHICmdList.CreateUnorderedAccessView(Resources.NonEmptyBrickIndexBuffer, 
         FRHIViewDesc::CreateBufferUAV().SetType(FRHIViewDesc::EBufferType::Typed).SetFormat(EPixelFormat::PF_R32_UINT));
 
     FRHIResourceCreateInfo NonEmptyCubeIndexBufferInfo(TEXT("NonEmptyCube CubeIndex"));
@@ -269,7 +708,7 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
     if (!Resources.NonEmptyCubeIndexBuffer)
     {
         UE_LOG(LogVoxelMesh, Error, TEXT("Failed to create NonEmptyCubeIndexBuffer"));
-        bIsReady.store(true, std::memory_order_release);
+        FinishGeneration_AnyThread(GetElapsedMs());
         return;
     }
     Resources.NonEmptyCubeIndexBufferSRV = RHICmdList.CreateShaderResourceView(Resources.NonEmptyCubeIndexBuffer, 
@@ -283,7 +722,7 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
     if (!Resources.VertexIndexOffsetBuffer)
     {
         UE_LOG(LogVoxelMesh, Error, TEXT("Failed to create VertexIndexOffsetBuffer"));
-        bIsReady.store(true, std::memory_order_release);
+        FinishGeneration_AnyThread(GetElapsedMs());
         return;
     }
     Resources.VertexIndexOffsetBufferSRV = RHICmdList.CreateShaderResourceView(Resources.VertexIndexOffsetBuffer, 
@@ -295,7 +734,7 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
     if (!Resources.AreResourcesValid())
     {
         UE_LOG(LogVoxelMesh, Error, TEXT("Failed to create one or more resources for Marching Cubes algorithm"));
-        bIsReady.store(true, std::memory_order_release);
+        FinishGeneration_AnyThread(GetElapsedMs());
         return;
     }
     
@@ -306,32 +745,34 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
     CalcCubeIndexParameters.Counter = CounterBufferUAV;
     CalcCubeIndexParameters.MarchingCubeParameters = UniformParametersBuffer;
     CalcCubeIndexParameters.SrcVoxelData = GridBufferSRV;
+    CalcCubeIndexParameters.SrcApronData = ApronBufferSRV;
     CalcCubeIndexParameters.OutCubeIndexOffsets = CubeIndexOffsetBufferUAV;
+    CalcCubeIndexParameters.OutNonEmptyBrickIndex = Resources.NonEmptyBrickIndexBufferUAV;
+    CalcCubeIndexParameters.OutNonEmptyCubeIndex = Resources.NonEmptyCubeIndexBufferUAV;
 
-    const FIntVector DispatchSize = GetDispatchSize(TotalCubes);
-    FComputeShaderUtils::Dispatch(RHICmdList, CalcCubeIndexCSRef, CalcCubeIndexParameters, DispatchSize);
+    // One group per brick for the classification and generation passes, one thread per cube for the scan
+    const FIntVector BrickDispatchSize = GetDispatchSize(Traversal.GetNumBricks());
+    const FIntVector DispatchSize = GetDispatchSize(FMath::DivideAndRoundUp<size_t>(TotalCubes, VoxelMarchingCubesWorkgroupSize));
+    FComputeShaderUtils::Dispatch(RHICmdList, CalcCubeIndexCSRef, CalcCubeIndexParameters, BrickDispatchSize);
     
     // Use a UAV barrier instead of a fence to ensure the previous dispatch is complete
 	RHICmdList.Transition(FRHITransitionInfo{CubeIndexOffsetBufferUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute});
 	RHICmdList.Transition(FRHITransitionInfo{CounterBufferUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute});
+	RHICmdList.Transition(FRHITransitionInfo{Resources.NonEmptyBrickIndexBuffer, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute});
+	RHICmdList.Transition(FRHITransitionInfo{Resources.NonEmptyCubeIndexBuffer, ERHIAccess::UAVCompute, ERHIAccess::SRVCompute});
     
-    // Step 2: Prefix Sum and resource preparation
+    // Step 2: Prefix Sum over the non-empty cubes classified by step 1, no grid sampling
     auto PrefixSumCSRef = ShaderMap->GetShader<FVoxelMarchingCubesCalcCubeOffsetCS>();
     FVoxelMarchingCubesCalcCubeOffsetCS::FParameters PrefixSumParameters{};
     
     PrefixSumParameters.Counter = CounterBufferUAV;
     PrefixSumParameters.MarchingCubeParameters = UniformParametersBuffer;
-    PrefixSumParameters.SrcVoxelData = GridBufferSRV;
-    PrefixSumParameters.InCubeIndexOffsets = CubeIndexOffsetBufferSRV;
-    PrefixSumParameters.OutNonEmptyCubeLinearId = Resources.NonEmptyCubeLinearIdBufferUAV;
-    PrefixSumParameters.OutNonEmptyCubeIndex = Resources.NonEmptyCubeIndexBufferUAV;
+    PrefixSumParameters.InNonEmptyCubeIndex = Resources.NonEmptyCubeIndexBufferSRV;
     PrefixSumParameters.OutVertexIndexOffset = Resources.VertexIndexOffsetBufferUAV;
 
     FComputeShaderUtils::Dispatch(RHICmdList, PrefixSumCSRef, PrefixSumParameters, DispatchSize);
     
     // Use UAV barriers instead of fences
-	RHICmdList.Transition(FRHITransitionInfo{Resources.NonEmptyCubeLinearIdBufferUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute});
-	RHICmdList.Transition(FRHITransitionInfo{Resources.NonEmptyCubeIndexBufferUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute});
 	RHICmdList.Transition(FRHITransitionInfo{Resources.VertexIndexOffsetBufferUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute});
 	RHICmdList.Transition(FRHITransitionInfo{CounterBufferUAV, ERHIAccess::UAVCompute, ERHIAccess::UAVCompute});
 
@@ -361,9 +802,6 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
         // Create exact-sized buffers
         ResizeBuffer_RenderThread(RequiredVertexCount * sizeof(FVector4f), RequiredIndexCount * sizeof(uint32));
         
-        // Reset the counter for the final pass
-        RHICmdList.ClearUAVUint(CounterBufferUAV, FUintVector4(0, 0, 0, 0));
-        
         // Update estimated count for the generate mesh pass
         Resources.EstimatedNonEmptyCubes = NumNonEmptyCubes;
         
@@ -384,26 +822,27 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
     // Step 3: Generate Mesh
     FVoxelMarchingCubesGenerateMeshCS::FParameters GenerateMeshParameter;
     
-    GenerateMeshParameter.NumNonEmptyCubes = Resources.EstimatedNonEmptyCubes;
+    GenerateMeshParameter.Counter = CounterBufferUAV;
     GenerateMeshParameter.InNonEmptyCubeIndex = Resources.NonEmptyCubeIndexBufferSRV;
-    GenerateMeshParameter.InNonEmptyCubeLinearId = Resources.NonEmptyCubeLinearIdBufferSRV;
+    GenerateMeshParameter.InNonEmptyBrickIndex = Resources.NonEmptyBrickIndexBufferSRV;
     GenerateMeshParameter.InVertexIndexOffset = Resources.VertexIndexOffsetBufferSRV;
     GenerateMeshParameter.OutVertexBuffer = MeshVertexBufferUAV;
     GenerateMeshParameter.OutIndexBuffer = MeshIndexBufferUAV;
     GenerateMeshParameter.MarchingCubeParameters = UniformParametersBuffer;
     GenerateMeshParameter.SrcVoxelData = GridBufferSRV;
+    GenerateMeshParameter.SrcApronData = ApronBufferSRV;
     GenerateMeshParameter.InCubeIndexOffsets = CubeIndexOffsetBufferSRV;
     
     auto GenerateMeshCSRef = ShaderMap->GetShader<FVoxelMarchingCubesGenerateMeshCS>();
-    FComputeShaderUtils::Dispatch(RHICmdList, GenerateMeshCSRef, GenerateMeshParameter, DispatchSize);
+    FComputeShaderUtils::Dispatch(RHICmdList, GenerateMeshCSRef, GenerateMeshParameter, BrickDispatchSize);
 
     // Notify finished building after the final dispatch
-    ENQUEUE_RENDER_COMMAND(NotifyMeshReady)([this](FRHICommandListImmediate& RHICmdList) {
-        if (const UVoxelChunkView* VoxelChunkView = Parent.Get())
+    ENQUEUE_RENDER_COMMAND(NotifyMeshReady)([Self = AsShared(), BuildMs = GetElapsedMs()](FRHICommandListImmediate& RHICmdList) {
+        if (const UVoxelChunkView* VoxelChunkView = Self->Parent.Get())
         {
             VoxelChunkView->OnBuildFinished.Broadcast();
         }
-        bIsReady.store(true, std::memory_order_release);
+        Self->FinishGeneration_AnyThread(BuildMs);
     });
 
     // End RenderDoc Capture
@@ -413,23 +852,374 @@ void FVoxelChunkViewRHIProxy::RegenerateMesh_RenderThread(FRHICommandListImmedia
 	}
 }
 
+void FVoxelChunkViewRHIProxy::RegenerateMeshCpu_AnyThread(int32 InLodIndex, const FNeighbourProxies& NeighbourProxies)
+{
+	check(IsGenerating());
+	// The task holds the proxy, the chunk may replace it while meshing
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [Self = AsShared(), Algorithm = MeshingAlgorithm, Faces = TransitionFaces, InLodIndex, NeighbourProxies]
+	{
+		if (Self->IsStale())
+		{
+			Self->FinishGeneration_AnyThread(0.0f);
+			return;
+		}
+		const double StartTime = FPlatformTime::Seconds();
+		Self->BuildLods_AnyThread(InLodIndex);
+		// The apron and level only reach the proxy with the mesh, the current one is drawn with them meanwhile
+		TSharedRef<FVoxelChunkApron> NewApron = MakeShared<FVoxelChunkApron>(InLodIndex == 0 ? Self->BuildApron_AnyThread(NeighbourProxies) : FVoxelChunkApron{ Self->BaseVoxelSize });
+
+		// The mesher gets the size of the grid, it pads the traversal with the apron itself
+		TSharedRef<FVoxelCpuMeshData> MeshData = MakeShared<FVoxelCpuMeshData>();
+		const FVoxelCpuMesher::FGridType* Grid = reinterpret_cast<const FVoxelCpuMesher::FGridType*>(Self->GetLodVoxelData(InLodIndex).GetData());
+		const FIntVector GridVoxelSize = Self->GetLodGridSize(InLodIndex);
+		if (Algorithm == EVoxelMeshingAlgorithm::SurfaceNets)
+		{
+			FVoxelSurfaceNetsMesher Mesher(*Grid, GridVoxelSize.X, GridVoxelSize.Y, GridVoxelSize.Z, Self->SurfaceIsoValue);
+			Mesher.SetApron(&NewApron.Get());
+			Mesher.Generate(*MeshData);
+		}
+		else
+		{
+			FVoxelCpuMesher Mesher(*Grid, GridVoxelSize.X, GridVoxelSize.Y, GridVoxelSize.Z, Self->SurfaceIsoValue);
+			Mesher.SetTransitionFaces(Faces);
+			Mesher.SetApron(&NewApron.Get());
+			Mesher.Generate(*MeshData);
+		}
+
+		const float BuildMs = static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		ENQUEUE_RENDER_COMMAND(VoxelMeshUploadCpuMesh)([Self, MeshData, NewApron, InLodIndex, BuildMs](FRHICommandListImmediate& RHICmdList)
+		{
+			// Superseded while meshing, the current mesh stays until the newest request is done
+			if (Self->IsStale())
+			{
+				Self->FinishGeneration_AnyThread(0.0f);
+				return;
+			}
+			Self->Apron = MoveTemp(*NewApron);
+			Self->SectionLayout.Reset();
+			Self->SelectLod(InLodIndex);
+			Self->UploadMesh_RenderThread(RHICmdList, *MeshData);
+			if (const UVoxelChunkView* VoxelChunkView = Self->Parent.Get())
+			{
+				VoxelChunkView->OnBuildFinished.Broadcast();
+			}
+			Self->FinishGeneration_AnyThread(BuildMs);
+		});
+	});
+}
+
+void FVoxelChunkViewRHIProxy::UploadMesh_RenderThread(FRHICommandListImmediate& RHICmdList, const FVoxelCpuMeshData& MeshData)
+{
+	// Empty buffers can't be created, keep a single degenerated triangle instead
+	static const FVector4f EmptyVertex(0.0f, 0.0f, 0.0f, 0.0f);
+	static const uint32 EmptyIndices[3] = { 0, 0, 0 };
+	const bool bIsEmpty = MeshData.IsEmpty();
+	const void* VertexData = bIsEmpty ? static_cast<const void*>(&EmptyVertex) : MeshData.Vertices.GetData();
+	const void* IndexData = bIsEmpty ? static_cast<const void*>(EmptyIndices) : MeshData.Indices.GetData();
+	const uint32 VertexBytes = bIsEmpty ? sizeof(EmptyVertex) : MeshData.Vertices.NumBytes();
+	const uint32 IndexBytes = bIsEmpty ? sizeof(EmptyIndices) : MeshData.Indices.NumBytes();
+
+	ResizeBuffer_RenderThread(VertexBytes, IndexBytes);
+
+	void* VertexStagingPtr = RHICmdList.LockBuffer(MeshVertexBuffer, 0, VertexBytes, RLM_WriteOnly);
+	FMemory::Memcpy(VertexStagingPtr, VertexData, VertexBytes);
+	RHICmdList.UnlockBuffer(MeshVertexBuffer);
+
+	void* IndexStagingPtr = RHICmdList.LockBuffer(MeshIndexBuffer, 0, IndexBytes, RLM_WriteOnly);
+	FMemory::Memcpy(IndexStagingPtr, IndexData, IndexBytes);
+	RHICmdList.UnlockBuffer(MeshIndexBuffer);
+}
+
+bool FVoxelChunkViewRHIProxy::InheritMesh(const FVoxelChunkViewRHIProxy& Previous)
+{
+	check(!IsGenerating());
+	// Coarse levels are meshed as a whole
+	if (Previous.IsGenerating() || !Previous.IsReady() || Previous.LodIndex != 0 || Previous.BaseVoxelSize != BaseVoxelSize)
+	{
+		return false;
+	}
+
+	MeshVertexBuffer = Previous.MeshVertexBuffer;
+	MeshIndexBuffer = Previous.MeshIndexBuffer;
+	MeshVertexBufferUAV = Previous.MeshVertexBufferUAV;
+	MeshIndexBufferUAV = Previous.MeshIndexBufferUAV;
+	Apron = Previous.Apron;
+	SectionLayout = Previous.SectionLayout;
+	return true;
+}
+
+void FVoxelChunkViewRHIProxy::RemeshVoxels_GameThread(const FIntVector& MinVoxel, const FIntVector& MaxVoxel)
+{
+	if (IsValid(Parent))
+	{
+		SurfaceIsoValue = Parent->SurfaceIsoValue;
+		MeshingAlgorithm = Parent->GetMeshingAlgorithm();
+		TransitionFaces = static_cast<uint8>(Parent->TransitionFaces & 0x3F);
+	}
+
+	{
+		FScopeLock Lock(&DirtyLeavesLock);
+		const FIntVector MinLeaf = FIntVector(FMath::Max(MinVoxel.X, 0), FMath::Max(MinVoxel.Y, 0), FMath::Max(MinVoxel.Z, 0)) / FVoxelBrickTraversal::BrickDim;
+		const FIntVector MaxLeaf = FIntVector(FMath::Max(MaxVoxel.X, 0), FMath::Max(MaxVoxel.Y, 0), FMath::Max(MaxVoxel.Z, 0)) / FVoxelBrickTraversal::BrickDim;
+		for (int32 X = MinLeaf.X; X <= MaxLeaf.X; ++X)
+		{
+			for (int32 Y = MinLeaf.Y; Y <= MaxLeaf.Y; ++Y)
+			{
+				for (int32 Z = MinLeaf.Z; Z <= MaxLeaf.Z; ++Z)
+				{
+					DirtyLeaves.Add(FIntVector(X, Y, Z));
+				}
+			}
+		}
+	}
+	RemeshDirtySections_AnyThread();
+}
+
+void FVoxelChunkViewRHIProxy::RemeshDirtySections_AnyThread()
+{
+	// A running build picks the leaves up when it finishes, a rebuild requested meanwhile still waits for these sections
+	if (!BuildHandoff.TryClaim(false))
+	{
+		return;
+	}
+	// Edits are never stale, the leaves are already taken out of DirtyLeaves
+	BuildingGeneration = RequestedGeneration.load(std::memory_order_acquire);
+
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [Self = AsShared(), Faces = TransitionFaces]
+	{
+		TSet<FIntVector> Leaves;
+		{
+			FScopeLock Lock(&Self->DirtyLeavesLock);
+			Leaves = MoveTemp(Self->DirtyLeaves);
+			Self->DirtyLeaves.Reset();
+		}
+
+		// The apron stays the one of the current mesh, level 0 is published with the sections
+		const FVoxelCpuMesher::FGridType* Grid = reinterpret_cast<const FVoxelCpuMesher::FGridType*>(Self->VoxelDataBuffer.GetData());
+		FVoxelCpuMesher Mesher(*Grid, Self->BaseVoxelSize.X, Self->BaseVoxelSize.Y, Self->BaseVoxelSize.Z, Self->SurfaceIsoValue);
+		Mesher.SetTransitionFaces(Faces);
+		Mesher.SetApron(&Self->Apron);
+
+		// Cells of the last layer don't emit triangles
+		const FIntVector NumCells = Mesher.GetTraversal().VoxelSize - FIntVector(1);
+		TSharedPtr<FVoxelMeshSectionLayout> Layout = Self->SectionLayout;
+		bool bReallocate = !Layout.IsValid() || Layout->NumCells != NumCells;
+
+		TArray<int32> Sections;
+		if (!bReallocate)
+		{
+			for (const FIntVector& Leaf : Leaves)
+			{
+				const FIntVector LeafMin = Leaf * FVoxelBrickTraversal::BrickDim;
+				Layout->GetSectionsUsingVoxels(LeafMin, LeafMin + FIntVector(FVoxelBrickTraversal::BrickDim - 1), Sections);
+			}
+		}
+
+		TArray<FVoxelCpuMeshData> SectionMeshes;
+		const auto MeshSections = [&Mesher, &Layout, &Sections, &SectionMeshes]
+		{
+			SectionMeshes.SetNum(Sections.Num());
+			ParallelFor(Sections.Num(), [&Mesher, &Layout, &Sections, &SectionMeshes](int32 Index)
+			{
+				FIntVector CellMin, CellMax;
+				Layout->GetSectionCells(Sections[Index], CellMin, CellMax);
+				Mesher.GenerateRegion(CellMin, CellMax, SectionMeshes[Index]);
+			});
+		};
+		MeshSections();
+
+		for (int32 Index = 0; Index < Sections.Num() && !bReallocate; ++Index)
+		{
+			bReallocate = !Layout->Fits(Sections[Index], SectionMeshes[Index]);
+		}
+
+		// First update, or a section outgrew its range: lay every section out again
+		if (bReallocate)
+		{
+			Layout = MakeShared<FVoxelMeshSectionLayout>(NumCells);
+			Sections.SetNum(Layout->GetNumSections());
+			for (int32 SectionIndex = 0; SectionIndex < Sections.Num(); ++SectionIndex)
+			{
+				Sections[SectionIndex] = SectionIndex;
+			}
+			MeshSections();
+			Layout->Allocate(SectionMeshes);
+		}
+
+		ENQUEUE_RENDER_COMMAND(VoxelMeshUploadSections)([Self, Layout, Sections = MoveTemp(Sections), SectionMeshes = MoveTemp(SectionMeshes), bReallocate](FRHICommandListImmediate& RHICmdList)
+		{
+			Self->UploadSections_RenderThread(RHICmdList, Layout.ToSharedRef(), Sections, SectionMeshes, bReallocate);
+			Self->SectionLayout = Layout;
+			Self->SelectLod(0);
+			if (const UVoxelChunkView* VoxelChunkView = Self->Parent.Get())
+			{
+				VoxelChunkView->OnBuildFinished.Broadcast();
+			}
+			// Sections don't tell how long the whole chunk takes, keep the estimate of FVoxelMeshRebuildScheduler
+			Self->FinishGeneration_AnyThread(0.0f);
+
+			// Edits made while meshing
+			bool bHasDirtyLeaves;
+			{
+				FScopeLock Lock(&Self->DirtyLeavesLock);
+				bHasDirtyLeaves = !Self->DirtyLeaves.IsEmpty();
+			}
+			if (bHasDirtyLeaves)
+			{
+				Self->RemeshDirtySections_AnyThread();
+			}
+		});
+	});
+}
+
+void FVoxelChunkViewRHIProxy::UploadSections_RenderThread(FRHICommandListImmediate& RHICmdList, const TSharedRef<FVoxelMeshSectionLayout>& Layout,
+	TConstArrayView<int32> Sections, TConstArrayView<FVoxelCpuMeshData> SectionMeshes, bool bReallocate)
+{
+	if (bReallocate)
+	{
+		ResizeBuffer_RenderThread(Layout->NumVertices * sizeof(FVector4f), Layout->NumIndices * sizeof(uint32));
+		FVector4f* VertexStagingPtr = static_cast<FVector4f*>(RHICmdList.LockBuffer(MeshVertexBuffer, 0, Layout->NumVertices * sizeof(FVector4f), RLM_WriteOnly));
+		uint32* IndexStagingPtr = static_cast<uint32*>(RHICmdList.LockBuffer(MeshIndexBuffer, 0, Layout->NumIndices * sizeof(uint32), RLM_WriteOnly));
+		for (int32 Index = 0; Index < Sections.Num(); ++Index)
+		{
+			const FVoxelMeshSectionLayout::FSection& Section = Layout->Sections[Sections[Index]];
+			Layout->WriteSection(Sections[Index], SectionMeshes[Index], VertexStagingPtr + Section.FirstVertex, IndexStagingPtr + Section.FirstIndex);
+		}
+		RHICmdList.UnlockBuffer(MeshVertexBuffer);
+		RHICmdList.UnlockBuffer(MeshIndexBuffer);
+		return;
+	}
+
+	// Only the ranges of the remeshed sections are uploaded
+	for (int32 Index = 0; Index < Sections.Num(); ++Index)
+	{
+		const FVoxelMeshSectionLayout::FSection& Section = Layout->Sections[Sections[Index]];
+		void* VertexStagingPtr = RHICmdList.LockBuffer(MeshVertexBuffer, Section.FirstVertex * sizeof(FVector4f), Section.VertexCapacity * sizeof(FVector4f), RLM_WriteOnly);
+		void* IndexStagingPtr = RHICmdList.LockBuffer(MeshIndexBuffer, Section.FirstIndex * sizeof(uint32), Section.IndexCapacity * sizeof(uint32), RLM_WriteOnly);
+		Layout->WriteSection(Sections[Index], SectionMeshes[Index], static_cast<FVector4f*>(VertexStagingPtr), static_cast<uint32*>(IndexStagingPtr));
+		RHICmdList.UnlockBuffer(MeshVertexBuffer);
+		RHICmdList.UnlockBuffer(MeshIndexBuffer);
+	}
+}
+
 void FVoxelChunkViewRHIProxy::RegenerateMesh_GameThread()
 {
+	// Settings are only read from the parent by the generation that owns the proxy
+	BuildHandoff.Request();
+	if (BuildHandoff.TryClaim(true))
+	{
+		StartGeneration_GameThread();
+	}
+}
+
+void FVoxelChunkViewRHIProxy::StartGeneration_GameThread()
+{
+	check(IsInGameThread() && IsGenerating());
+	BuildingGeneration = RequestedGeneration.load(std::memory_order_acquire);
+
+	int32 NewLodIndex = 0;
+	FNeighbourProxies NeighbourProxies;
+	bool bHasNeighbours = false;
 	if (IsValid(Parent))
 	{
 		SurfaceIsoValue = Parent->SurfaceIsoValue;
+		MeshingAlgorithm = Parent->GetMeshingAlgorithm();
+		TransitionFaces = static_cast<uint8>(Parent->TransitionFaces & 0x3F);
+		NumLods = FMath::Clamp(Parent->NumLods, 1, FVoxelGridPyramid::MaxNumLevels);
+		LodScreenSize = Parent->LodScreenSize;
+		NewLodIndex = FMath::Min(Parent->GetLodIndex(), NumLods - 1);
+
+		for (int32 OffsetBits = 1; OffsetBits < NeighbourProxies.Num(); ++OffsetBits)
+		{
+			if (UVoxelChunkView* Neighbour = Parent->Neighbours[OffsetBits]; IsValid(Neighbour))
+			{
+				NeighbourProxies[OffsetBits] = Neighbour->GetRHIProxy();
+				bHasNeighbours |= NeighbourProxies[OffsetBits].IsValid();
+			}
+		}
+
+		// Surface nets only have a CPU implementation
+		if (Parent->GetGenerationMode() == EVoxelMeshGenerationMode::CpuReference || MeshingAlgorithm == EVoxelMeshingAlgorithm::SurfaceNets)
+		{
+			RegenerateMeshCpu_AnyThread(NewLodIndex, NeighbourProxies);
+			return;
+		}
+	}
+
+	if (NewLodIndex > 0 || bHasNeighbours)
+	{
+		// Coarse levels and the apron are built off the render thread
+		UE::Tasks::Launch(UE_SOURCE_LOCATION, [Self = AsShared(), NewLodIndex, NeighbourProxies]
+		{
+			if (Self->IsStale())
+			{
+				Self->FinishGeneration_AnyThread(0.0f);
+				return;
+			}
+			Self->BuildLods_AnyThread(NewLodIndex);
+			TSharedPtr<FVoxelChunkApron> NewApron;
+			if (NewLodIndex == 0)
+			{
+				NewApron = MakeShared<FVoxelChunkApron>(Self->BuildApron_AnyThread(NeighbourProxies));
+			}
+			ENQUEUE_RENDER_COMMAND(VoxelMeshMarchingCubes)([Self, NewLodIndex, NewApron] (FRHICommandListImmediate& RHICmdList)
+			{
+				Self->RegenerateMesh_RenderThread(RHICmdList, NewLodIndex, NewApron);
+			});
+		});
+		return;
 	}
-	ENQUEUE_RENDER_COMMAND(VoxelMeshMarchingCubes)([this] (FRHICommandListImmediate& RHICmdList)
+	ENQUEUE_RENDER_COMMAND(VoxelMeshMarchingCubes)([Self = AsShared()] (FRHICommandListImmediate& RHICmdList)
 	{
-		RegenerateMesh_RenderThread(RHICmdList);
+		Self->RegenerateMesh_RenderThread(RHICmdList, 0, nullptr);
 	});
 }
 
 void FVoxelChunkViewRHIProxy::RegenerateMesh()
 {
+	RequestedGeneration.fetch_add(1, std::memory_order_acq_rel);
 	RegenerateMesh_GameThread();
 }
 
+void FVoxelChunkViewRHIProxy::CancelGeneration()
+{
+	RequestedGeneration.fetch_add(1, std::memory_order_acq_rel);
+}
+
+bool FVoxelChunkViewRHIProxy::IsStale() const
+{
+	return RequestedGeneration.load(std::memory_order_acquire) != BuildingGeneration;
+}
+
+void FVoxelChunkViewRHIProxy::FinishGeneration_AnyThread(float BuildMs)
+{
+	LastBuildMs.store(BuildMs, std::memory_order_relaxed);
+	NumBuilds.fetch_add(1, std::memory_order_release);
+
+	// Only the newest of the requests made meanwhile is left to run, the proxy stays claimed for it
+	if (BuildHandoff.Release())
+	{
+		AsyncTask(ENamedThreads::GameThread, [WeakSelf = AsWeak(), WeakParent = TWeakObjectPtr<UVoxelChunkView>(Parent)]
+		{
+			const TSharedPtr<FVoxelChunkViewRHIProxy> Self = WeakSelf.Pin();
+			if (!Self)
+			{
+				return;
+			}
+			UVoxelChunkView* View = WeakParent.Get();
+			if (View && View->GetRHIProxy() == Self)
+			{
+				Self->StartGeneration_GameThread();
+			}
+			else
+			{
+				// Replaced meanwhile, the new proxy generates on its own
+				Self->FinishGeneration_AnyThread(0.0f);
+			}
+		});
+	}
+}
+
 bool FVoxelChunkViewRHIProxy::IsReady() const
 {
 	return MeshVertexBuffer && MeshIndexBuffer;
@@ -437,5 +1227,5 @@ bool FVoxelChunkViewRHIProxy::IsReady() const
 
 bool FVoxelChunkViewRHIProxy::IsGenerating() const
 {
-	return !bIsReady.load(std::memory_order_acquire);
+	return BuildHandoff.IsClaimed();
 }
@@ -0,0 +1,402 @@
+﻿#include "VoxelCpuMesher.h"
+
+#include "Async/ParallelFor.h"
+#include "VoxelCubeClassify.h"
+#include "VoxelLeafDecode.h"
+#include "VoxelMarchingCubesTables.h"
+
+FVoxelCpuMesher::FVoxelCpuMesher(const FGridType& InGrid, uint32 InVoxelSizeX, uint32 InVoxelSizeY, uint32 InVoxelSizeZ, float InSurfaceIsoValue)
+	: Grid(InGrid)
+	, GridVoxelSize(InVoxelSizeX, InVoxelSizeY, InVoxelSizeZ)
+	, Traversal(InVoxelSizeX, InVoxelSizeY, InVoxelSizeZ)
+	, SurfaceIsoValue(InSurfaceIsoValue)
+{
+}
+
+void FVoxelCpuMesher::SetApron(const FVoxelChunkApron* InApron)
+{
+	check(!InApron || InApron->VoxelSize == GridVoxelSize);
+	Apron = InApron && !InApron->IsEmpty() ? InApron : nullptr;
+	const FIntVector PaddedVoxelSize = Apron ? Apron->GetPaddedVoxelSize() : GridVoxelSize;
+	Traversal = FVoxelBrickTraversal(PaddedVoxelSize.X, PaddedVoxelSize.Y, PaddedVoxelSize.Z);
+}
+
+void FVoxelCpuMesher::LoadBrickTile(const FIntVector& BrickOrigin, const FAccessorType& Accessor, FVoxelBrickTile& OutTile, const FIntVector& NumValidCubes) const
+{
+	constexpr int32 BrickDim = FVoxelBrickTraversal::BrickDim;
+
+	// Bricks are aligned on leaves: when no voxel needs clamping, the core of the tile is a whole leaf decoded at once
+	// and only the apron goes through the accessor.
+	const FIntVector BrickMax = BrickOrigin + FIntVector(BrickDim - 1);
+	const bool bWholeBrick = NumValidCubes.X >= BrickDim && NumValidCubes.Y >= BrickDim && NumValidCubes.Z >= BrickDim;
+	if (bWholeBrick && BrickMax.X < GridVoxelSize.X && BrickMax.Y < GridVoxelSize.Y && BrickMax.Z < GridVoxelSize.Z)
+	{
+		const nanovdb::Coord LeafOrigin(BrickOrigin.X, BrickOrigin.Y, BrickOrigin.Z);
+		float LeafValues[FVoxelLeafDecode::LeafSize];
+		if (const nanovdb::NanoLeaf<nanovdb::Fp4>* Leaf = Accessor.probeLeaf(LeafOrigin))
+		{
+			FVoxelLeafDecode::Decode(*Leaf, LeafValues);
+		}
+		else
+		{
+			// Tile or background value of an upper node, constant over the whole leaf
+			const float Value = Accessor.getValue(LeafOrigin);
+			for (float& LeafValue : LeafValues)
+			{
+				LeafValue = Value;
+			}
+		}
+
+		for (int32 X = 0; X < FVoxelBrickTile::Dim; ++X)
+		{
+			for (int32 Y = 0; Y < FVoxelBrickTile::Dim; ++Y)
+			{
+				float* Row = OutTile.Values + FVoxelBrickTile::GetIndex(FIntVector(X, Y, 0));
+				if (X < BrickDim && Y < BrickDim)
+				{
+					FMemory::Memcpy(Row, LeafValues + FVoxelLeafDecode::GetLeafOffset(FIntVector(X, Y, 0)), BrickDim * sizeof(float));
+					Row[BrickDim] = SampleVoxelPoint(BrickOrigin + FIntVector(X, Y, BrickDim), Accessor);
+				}
+				else
+				{
+					for (int32 Z = 0; Z < FVoxelBrickTile::Dim; ++Z)
+					{
+						Row[Z] = SampleVoxelPoint(BrickOrigin + FIntVector(X, Y, Z), Accessor);
+					}
+				}
+			}
+		}
+		ApplyTransitionFaces(BrickOrigin, OutTile);
+		return;
+	}
+
+	// Partial bricks only load what their cubes read, plus the layer read when snapping to transition faces
+	const FIntVector TileExtent(
+		FMath::Min(NumValidCubes.X + 2, FVoxelBrickTile::Dim),
+		FMath::Min(NumValidCubes.Y + 2, FVoxelBrickTile::Dim),
+		FMath::Min(NumValidCubes.Z + 2, FVoxelBrickTile::Dim));
+	for (int32 X = 0; X < TileExtent.X; ++X)
+	{
+		for (int32 Y = 0; Y < TileExtent.Y; ++Y)
+		{
+			float* Row = OutTile.Values + FVoxelBrickTile::GetIndex(FIntVector(X, Y, 0));
+			for (int32 Z = 0; Z < TileExtent.Z; ++Z)
+			{
+				Row[Z] = SampleVoxelPoint(BrickOrigin + FIntVector(X, Y, Z), Accessor);
+			}
+		}
+	}
+	ApplyTransitionFaces(BrickOrigin, OutTile);
+}
+
+FVector3f FVoxelCpuMesher::InterpolateVertex(const FVector3f& BeginPos, const FVector3f& EndPos, float BeginValue, float EndValue) const
+{
+	if (BeginValue == EndValue)
+	{
+		return (BeginPos + EndPos) * 0.5f;
+	}
+	const float T = (SurfaceIsoValue - BeginValue) / (EndValue - BeginValue);
+	return FMath::Lerp(BeginPos, EndPos, T);
+}
+
+void FVoxelCpuMesher::ApplyTransitionFaces(const FIntVector& BrickOrigin, FVoxelBrickTile& Tile) const
+{
+	// The coarser neighbour samples every other voxel: even coordinates are shared, bricks start on even coordinates.
+	// Faces are processed one after the other, in the same order as ApplyTransitionFaces in MarchingCubesCS.usf.
+	for (int32 Face = 0; Face < 6; ++Face)
+	{
+		const int32 Axis = Face >> 1;
+		const int32 LocalPlane = GetTransitionPlane(Face) - BrickOrigin[Axis];
+		if (!(TransitionFaces & (1u << Face)) || LocalPlane < 0 || LocalPlane >= FVoxelBrickTile::Dim)
+		{
+			continue;
+		}
+
+		const int32 AxisU = (Axis + 1) % 3;
+		const int32 AxisV = (Axis + 2) % 3;
+		FIntVector LocalCoord;
+		LocalCoord[Axis] = LocalPlane;
+		const auto GetValue = [&](int32 U, int32 V) -> float&
+		{
+			LocalCoord[AxisU] = U;
+			LocalCoord[AxisV] = V;
+			return Tile.Values[FVoxelBrickTile::GetIndex(LocalCoord)];
+		};
+
+		// Along the neighbour edges first, then across them
+		for (int32 U = 1; U < FVoxelBrickTile::Dim; U += 2)
+		{
+			for (int32 V = 0; V < FVoxelBrickTile::Dim; V += 2)
+			{
+				GetValue(U, V) = (GetValue(U - 1, V) + GetValue(U + 1, V)) * 0.5f;
+			}
+		}
+		for (int32 U = 0; U < FVoxelBrickTile::Dim; ++U)
+		{
+			for (int32 V = 1; V < FVoxelBrickTile::Dim; V += 2)
+			{
+				GetValue(U, V) = (GetValue(U, V - 1) + GetValue(U, V + 1)) * 0.5f;
+			}
+		}
+	}
+}
+
+FVector3f FVoxelCpuMesher::SnapToTransitionFaces(const FVoxelBrickTile& Tile, const FIntVector& BrickOrigin, const FIntVector& BeginCoord, const FIntVector& EndCoord, const FVector3f& Position) const
+{
+	if (TransitionFaces == 0)
+	{
+		return Position;
+	}
+
+	const int32 EdgeAxis = BeginCoord.X != EndCoord.X ? 0 : (BeginCoord.Y != EndCoord.Y ? 1 : 2);
+	FIntVector EdgeMin = BeginCoord;
+	EdgeMin[EdgeAxis] = FMath::Min(BeginCoord[EdgeAxis], EndCoord[EdgeAxis]);
+	for (int32 Face = 0; Face < 6; ++Face)
+	{
+		const int32 Axis = Face >> 1;
+		if (!(TransitionFaces & (1u << Face)) || Axis == EdgeAxis || EdgeMin[Axis] != GetTransitionPlane(Face))
+		{
+			continue;
+		}
+
+		// Edges on even lines are halves of the neighbour edges, their crossing already matches
+		const int32 LineAxis = 3 - Axis - EdgeAxis;
+		if ((EdgeMin[LineAxis] & 1) == 0)
+		{
+			continue;
+		}
+
+		// Face of the neighbour cube around the edge, and the surface crossings on its four edges
+		FIntVector SquareOrigin = EdgeMin;
+		SquareOrigin[EdgeAxis] &= ~1;
+		SquareOrigin[LineAxis] -= 1;
+		FIntVector Corners[4];
+		for (int32 i = 0; i < 4; ++i)
+		{
+			Corners[i] = SquareOrigin;
+			Corners[i][EdgeAxis] += (i == 1 || i == 2) ? 2 : 0;
+			Corners[i][LineAxis] += (i >= 2) ? 2 : 0;
+		}
+
+		FVector3f Crossings[4];
+		int32 NumCrossings = 0;
+		for (int32 i = 0; i < 4; ++i)
+		{
+			const FIntVector& Begin = Corners[i];
+			const FIntVector& End = Corners[(i + 1) & 3];
+			const float BeginValue = Tile.Get(Begin - BrickOrigin);
+			const float EndValue = Tile.Get(End - BrickOrigin);
+			if ((BeginValue <= SurfaceIsoValue) != (EndValue <= SurfaceIsoValue))
+			{
+				Crossings[NumCrossings++] = InterpolateVertex(FVector3f(Begin), FVector3f(End), BeginValue, EndValue);
+			}
+		}
+
+		// Ambiguous faces are left alone, the pairing of the neighbour depends on its whole cube
+		if (NumCrossings == 2)
+		{
+			const float Line = EdgeMin[LineAxis];
+			const float Delta = Crossings[1][LineAxis] - Crossings[0][LineAxis];
+			const float T = FMath::Abs(Delta) > UE_SMALL_NUMBER ? FMath::Clamp((Line - Crossings[0][LineAxis]) / Delta, 0.0f, 1.0f) : 0.5f;
+			return FMath::Lerp(Crossings[0], Crossings[1], T);
+		}
+	}
+	return Position;
+}
+
+void FVoxelCpuMesher::Generate(FVoxelCpuMeshData& OutMeshData) const
+{
+	GenerateRegion(FIntVector::ZeroValue, Traversal.VoxelSize, OutMeshData);
+}
+
+void FVoxelCpuMesher::GenerateRegion(const FIntVector& CellMin, const FIntVector& CellMax, FVoxelCpuMeshData& OutMeshData) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelCpuMesher::GenerateRegion);
+	using namespace VoxelMarchingCubes;
+	check(CellMin.X % FVoxelBrickTraversal::BrickDim == 0 && CellMin.Y % FVoxelBrickTraversal::BrickDim == 0 && CellMin.Z % FVoxelBrickTraversal::BrickDim == 0);
+
+	// The region also covers the first layer of cubes past CellMax: they own vertices of the last cells, as the last layer of the grid does
+	const FIntVector RegionEnd(
+		FMath::Min(CellMax.X + 1, Traversal.VoxelSize.X),
+		FMath::Min(CellMax.Y + 1, Traversal.VoxelSize.Y),
+		FMath::Min(CellMax.Z + 1, Traversal.VoxelSize.Z));
+	const FVoxelBrickTraversal Region(RegionEnd.X - CellMin.X, RegionEnd.Y - CellMin.Y, RegionEnd.Z - CellMin.Z);
+	const auto EmitsRegionTriangles = [&](const FIntVector& Coord)
+	{
+		return EmitsTriangles(Coord) && Coord.X < CellMax.X && Coord.Y < CellMax.Y && Coord.Z < CellMax.Z;
+	};
+
+	constexpr uint32 BrickSize = FVoxelBrickTraversal::BrickSize;
+	const int32 NumBricks = Region.GetNumBricks();
+	const uint32 TotalCubes = Region.GetNumTraversalIds();
+
+	OutMeshData.Reset();
+
+	// Step 1: Classify cubes and count their vertices/indices in one go, one brick per task.
+	// Each brick is decoded once into a tile, which is kept for the generation step when crossed by the surface.
+	TArray<uint32> CubeInfos;
+	TArray<uint32> BrickVertexOffsets;
+	TArray<uint32> BrickIndexOffsets;
+	TArray<TUniquePtr<FVoxelBrickTile>> SurfaceTiles;
+	CubeInfos.SetNumUninitialized(TotalCubes);
+	BrickVertexOffsets.SetNumZeroed(NumBricks + 1);
+	BrickIndexOffsets.SetNumZeroed(NumBricks + 1);
+	SurfaceTiles.SetNum(NumBricks);
+	ParallelFor(NumBricks, [&](int32 BrickIndex)
+	{
+		const FAccessorType Accessor = Grid.getAccessor();
+		const FIntVector BrickOrigin = CellMin + Region.GetBrickCoord(BrickIndex) * FVoxelBrickTraversal::BrickDim;
+		const FIntVector NumValidCubes = RegionEnd - BrickOrigin;
+		FVoxelBrickTile Tile;
+		LoadBrickTile(BrickOrigin, Accessor, Tile, NumValidCubes);
+
+		uint8 CubeIndices[FVoxelCubeClassify::NumCubes];
+		uint64 NonEmptyMask[FVoxelCubeClassify::NumMaskWords];
+		FVoxelCubeClassify::ClassifyBrick(Tile, SurfaceIsoValue, NumValidCubes, CubeIndices, NonEmptyMask);
+
+		// Only cubes producing geometry are visited, the others stay empty
+		const uint32 FirstId = BrickIndex * BrickSize;
+		FMemory::Memzero(&CubeInfos[FirstId], BrickSize * sizeof(uint32));
+		uint32 NumVertices = 0;
+		uint32 NumIndices = 0;
+		for (uint32 Word = 0; Word < FVoxelCubeClassify::NumMaskWords; ++Word)
+		{
+			for (uint64 Mask = NonEmptyMask[Word]; Mask != 0; Mask &= Mask - 1)
+			{
+				const uint32 LocalIndex = Word * 64 + FMath::CountTrailingZeros64(Mask);
+				const FIntVector LocalCoord(LocalIndex >> 6, (LocalIndex >> 3) & 7, LocalIndex & 7);
+				const FIntVector Coord = BrickOrigin + LocalCoord;
+				const uint32 LinearId = FirstId + FVoxelBrickTraversal::EncodeMorton(LocalCoord.X, LocalCoord.Y, LocalCoord.Z);
+				const uint32 CubeIndex = CubeIndices[LocalIndex];
+				const uint32 CubeNumVertices = CountOwnedVertices(CubeIndex);
+				const uint32 CubeNumIndices = EmitsRegionTriangles(Coord) ? CountIndices(CubeIndex) : 0;
+				CubeInfos[LinearId] = PackCubeInfo(CubeIndex, CubeNumVertices, CubeNumIndices);
+				NumVertices += CubeNumVertices;
+				NumIndices += CubeNumIndices;
+			}
+		}
+		BrickVertexOffsets[BrickIndex + 1] = NumVertices;
+		BrickIndexOffsets[BrickIndex + 1] = NumIndices;
+		if (NumVertices > 0 || NumIndices > 0)
+		{
+			SurfaceTiles[BrickIndex] = MakeUnique<FVoxelBrickTile>(Tile);
+		}
+	});
+
+	// Step 2: Prefix sum of vertices and indices, pure scan work over the counts of step 1.
+	// Done in traversal order so the output keeps the brick locality.
+	for (int32 BrickIndex = 0; BrickIndex < NumBricks; ++BrickIndex)
+	{
+		BrickVertexOffsets[BrickIndex + 1] += BrickVertexOffsets[BrickIndex];
+		BrickIndexOffsets[BrickIndex + 1] += BrickIndexOffsets[BrickIndex];
+	}
+
+	// Base vertex of every cube, needed to resolve the edges shared with neighbour cubes
+	TArray<uint32> CubeVertexOffsets;
+	CubeVertexOffsets.SetNumUninitialized(TotalCubes);
+	ParallelFor(NumBricks, [&](int32 BrickIndex)
+	{
+		uint32 VertexOffset = BrickVertexOffsets[BrickIndex];
+		const uint32 FirstId = BrickIndex * BrickSize;
+		for (uint32 LinearId = FirstId; LinearId < FirstId + BrickSize; ++LinearId)
+		{
+			CubeVertexOffsets[LinearId] = VertexOffset;
+			VertexOffset += UnpackNumVertices(CubeInfos[LinearId]);
+		}
+	});
+
+	OutMeshData.Vertices.SetNumUninitialized(BrickVertexOffsets[NumBricks]);
+	OutMeshData.Indices.SetNumUninitialized(BrickIndexOffsets[NumBricks]);
+
+	// Step 3: Generate Mesh
+	const FVector3f NormalizeScale = GetNormalizeScale();
+	ParallelFor(NumBricks, [&](int32 BrickIndex)
+	{
+		const FVoxelBrickTile* Tile = SurfaceTiles[BrickIndex].Get();
+		if (!Tile)
+		{
+			return;
+		}
+
+		const FIntVector BrickOrigin = CellMin + Region.GetBrickCoord(BrickIndex) * FVoxelBrickTraversal::BrickDim;
+		uint32 IndexOffset = BrickIndexOffsets[BrickIndex];
+		const uint32 FirstId = BrickIndex * BrickSize;
+		for (uint32 LinearId = FirstId; LinearId < FirstId + BrickSize; ++LinearId)
+		{
+			const uint32 CubeInfo = CubeInfos[LinearId];
+			const uint32 CubeIndex = UnpackCubeIndex(CubeInfo);
+			const uint32 Edges = EdgeTable[CubeIndex];
+			if (Edges == 0)
+			{
+				continue;
+			}
+
+			const FIntVector Coord = BrickOrigin + FVoxelBrickTraversal::DecodeMorton(LinearId - FirstId);
+			uint32 EdgeVertexIndices[12];
+
+			// Owned Edge
+			uint32 VertexOffset = CubeVertexOffsets[LinearId];
+			for (uint32 i = 0; i < NumOwnedEdges; ++i)
+			{
+				const uint32 Edge = OwnedEdge[i];
+				if (Edges & (1u << Edge))
+				{
+					FIntVector BeginCoord = Coord;
+					FIntVector EndCoord = Coord;
+					switch (Edge)
+					{
+					case 0:
+						EndCoord.X += 1;
+						break;
+					case 3:
+						BeginCoord.Y += 1;
+						break;
+					case 8:
+					default:
+						EndCoord.Z += 1;
+						break;
+					}
+
+					const float BeginPointValue = Tile->Get(BeginCoord - BrickOrigin);
+					const float EndPointValue = Tile->Get(EndCoord - BrickOrigin);
+					const FVector3f VertexPosition = SnapToTransitionFaces(*Tile, BrickOrigin, BeginCoord, EndCoord,
+						InterpolateVertex(FVector3f(BeginCoord), FVector3f(EndCoord), BeginPointValue, EndPointValue));
+					OutMeshData.Vertices[VertexOffset] = FVector4f(VertexPosition * NormalizeScale - 0.5f, 0.0f);
+					EdgeVertexIndices[Edge] = VertexOffset;
+					++VertexOffset;
+				}
+			}
+
+			if (!EmitsRegionTriangles(Coord))
+			{
+				continue;
+			}
+
+			// Shared Edge
+			for (uint32 i = 0; i < UE_ARRAY_COUNT(SharedEdgeCoordBias); ++i)
+			{
+				const uint32 BiasedId = Region.GetTraversalIdByCoord(Coord - CellMin + SharedEdgeCoordBias[i]);
+				const uint32 BiasedEdges = EdgeTable[UnpackCubeIndex(CubeInfos[BiasedId])];
+				uint32 BiasedVertexIndex = CubeVertexOffsets[BiasedId];
+				for (uint32 ei = 0; ei < NumOwnedEdges; ++ei)
+				{
+					if (BiasedEdges & (1u << OwnedEdge[ei]))
+					{
+						const int32 CorrespondingEdge = SharedEdgeCorrespondence[i][ei];
+						if (CorrespondingEdge != -1)
+						{
+							EdgeVertexIndices[CorrespondingEdge] = BiasedVertexIndex;
+						}
+						++BiasedVertexIndex;
+					}
+				}
+			}
+
+			const uint32 NumIndices = UnpackNumIndices(CubeInfo);
+			for (uint32 i = 0; i < NumIndices; ++i)
+			{
+				OutMeshData.Indices[IndexOffset++] = EdgeVertexIndices[TriangleTable[CubeIndex][i]];
+			}
+		}
+	});
+}
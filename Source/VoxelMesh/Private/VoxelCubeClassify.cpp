@@ -0,0 +1,218 @@
+﻿#include "VoxelCubeClassify.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#	include <arm_neon.h>
+#	define VOXEL_CUBE_CLASSIFY_NEON 1
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+#	include <emmintrin.h>
+#	define VOXEL_CUBE_CLASSIFY_SSE 1
+#	if defined(__AVX__) || PLATFORM_ALWAYS_HAS_AVX
+#		include <immintrin.h>
+#		define VOXEL_CUBE_CLASSIFY_AVX 1
+#	endif
+#endif
+
+#if !defined(VOXEL_CUBE_CLASSIFY_NEON)
+#	define VOXEL_CUBE_CLASSIFY_NEON 0
+#endif
+#if !defined(VOXEL_CUBE_CLASSIFY_SSE)
+#	define VOXEL_CUBE_CLASSIFY_SSE 0
+#endif
+#if !defined(VOXEL_CUBE_CLASSIFY_AVX)
+#	define VOXEL_CUBE_CLASSIFY_AVX 0
+#endif
+
+/// Tile row offsets (x, y) and z offset of the 8 cube corners, in marching cubes corner order
+static constexpr int32 CornerOffsets[8][3] = {
+	{0, 0, 0},
+	{1, 0, 0},
+	{1, 1, 0},
+	{0, 1, 0},
+	{0, 0, 1},
+	{1, 0, 1},
+	{1, 1, 1},
+	{0, 1, 1},
+};
+
+static FORCEINLINE uint32 GetCubeLocalIndex(int32 X, int32 Y, int32 Z)
+{
+	return (X << 6) | (Y << 3) | Z;
+}
+
+/// Whole brick on one side of the surface: no cube can produce geometry
+static bool ClassifyUniformBrick(const FVoxelBrickTile& Tile, float SurfaceIsoValue, uint8* RESTRICT OutCubeIndices, uint64* RESTRICT OutNonEmptyMask)
+{
+	float MinValue = Tile.Values[0];
+	float MaxValue = Tile.Values[0];
+	for (int32 i = 1; i < FVoxelBrickTile::Size; ++i)
+	{
+		MinValue = FMath::Min(MinValue, Tile.Values[i]);
+		MaxValue = FMath::Max(MaxValue, Tile.Values[i]);
+	}
+
+	const bool bAllOutside = MinValue > SurfaceIsoValue;
+	const bool bAllInside = MaxValue <= SurfaceIsoValue;
+	if (!bAllOutside && !bAllInside)
+	{
+		return false;
+	}
+
+	FMemory::Memset(OutCubeIndices, bAllInside ? 0xFF : 0x00, FVoxelCubeClassify::NumCubes);
+	FMemory::Memzero(OutNonEmptyMask, FVoxelCubeClassify::NumMaskWords * sizeof(uint64));
+	return true;
+}
+
+/// Cubes outside the grid are padding, same as CalcCubeIndex in MarchingCubesCS.usf
+static void ClearPaddingCubes(const FIntVector& NumValidCubes, uint8* RESTRICT OutCubeIndices, uint64* RESTRICT OutNonEmptyMask)
+{
+	constexpr int32 BrickDim = FVoxelBrickTraversal::BrickDim;
+	if (NumValidCubes.X >= BrickDim && NumValidCubes.Y >= BrickDim && NumValidCubes.Z >= BrickDim)
+	{
+		return;
+	}
+
+	for (int32 X = 0; X < BrickDim; ++X)
+	{
+		for (int32 Y = 0; Y < BrickDim; ++Y)
+		{
+			const int32 FirstInvalidZ = (X < NumValidCubes.X && Y < NumValidCubes.Y) ? FMath::Max(NumValidCubes.Z, 0) : 0;
+			for (int32 Z = FirstInvalidZ; Z < BrickDim; ++Z)
+			{
+				const uint32 LocalIndex = GetCubeLocalIndex(X, Y, Z);
+				OutCubeIndices[LocalIndex] = 0;
+				OutNonEmptyMask[LocalIndex >> 6] &= ~(1ull << (LocalIndex & 63));
+			}
+		}
+	}
+}
+
+static uint32 CountNonEmpty(const uint64* RESTRICT NonEmptyMask)
+{
+	uint32 NumNonEmpty = 0;
+	for (uint32 Word = 0; Word < FVoxelCubeClassify::NumMaskWords; ++Word)
+	{
+		NumNonEmpty += FMath::CountBits(NonEmptyMask[Word]);
+	}
+	return NumNonEmpty;
+}
+
+uint32 FVoxelCubeClassify::ClassifyBrickScalar(const FVoxelBrickTile& Tile, float SurfaceIsoValue, const FIntVector& NumValidCubes, uint8* RESTRICT OutCubeIndices, uint64* RESTRICT OutNonEmptyMask)
+{
+	constexpr int32 BrickDim = FVoxelBrickTraversal::BrickDim;
+	FMemory::Memzero(OutNonEmptyMask, NumMaskWords * sizeof(uint64));
+	for (int32 X = 0; X < BrickDim; ++X)
+	{
+		for (int32 Y = 0; Y < BrickDim; ++Y)
+		{
+			for (int32 Z = 0; Z < BrickDim; ++Z)
+			{
+				uint32 CubeIndex = 0;
+				for (uint32 i = 0; i < 8; ++i)
+				{
+					if (Tile.Get(FIntVector(X + CornerOffsets[i][0], Y + CornerOffsets[i][1], Z + CornerOffsets[i][2])) <= SurfaceIsoValue)
+					{
+						CubeIndex |= 1u << i;
+					}
+				}
+
+				const uint32 LocalIndex = GetCubeLocalIndex(X, Y, Z);
+				OutCubeIndices[LocalIndex] = CubeIndex;
+				if (CubeIndex != 0 && CubeIndex != 0xFF)
+				{
+					OutNonEmptyMask[LocalIndex >> 6] |= 1ull << (LocalIndex & 63);
+				}
+			}
+		}
+	}
+
+	ClearPaddingCubes(NumValidCubes, OutCubeIndices, OutNonEmptyMask);
+	return CountNonEmpty(OutNonEmptyMask);
+}
+
+uint32 FVoxelCubeClassify::ClassifyBrick(const FVoxelBrickTile& Tile, float SurfaceIsoValue, const FIntVector& NumValidCubes, uint8* RESTRICT OutCubeIndices, uint64* RESTRICT OutNonEmptyMask)
+{
+#if VOXEL_CUBE_CLASSIFY_SSE || VOXEL_CUBE_CLASSIFY_NEON
+	constexpr int32 BrickDim = FVoxelBrickTraversal::BrickDim;
+	if (ClassifyUniformBrick(Tile, SurfaceIsoValue, OutCubeIndices, OutNonEmptyMask))
+	{
+		ClearPaddingCubes(NumValidCubes, OutCubeIndices, OutNonEmptyMask);
+		return 0;
+	}
+
+	FMemory::Memzero(OutNonEmptyMask, NumMaskWords * sizeof(uint64));
+#	if VOXEL_CUBE_CLASSIFY_AVX
+	const __m256 IsoValue = _mm256_set1_ps(SurfaceIsoValue);
+#	elif VOXEL_CUBE_CLASSIFY_SSE
+	const __m128 IsoValue = _mm_set1_ps(SurfaceIsoValue);
+#	else
+	const float32x4_t IsoValue = vdupq_n_f32(SurfaceIsoValue);
+#	endif
+
+	for (int32 X = 0; X < BrickDim; ++X)
+	{
+		for (int32 Y = 0; Y < BrickDim; ++Y)
+		{
+			// Cube indices of the 8 cubes along z, one corner bit at a time
+			uint8* RESTRICT RowCubeIndices = OutCubeIndices + GetCubeLocalIndex(X, Y, 0);
+#	if VOXEL_CUBE_CLASSIFY_AVX
+			__m256 Bits = _mm256_setzero_ps();
+			for (uint32 i = 0; i < 8; ++i)
+			{
+				const float* Corners = Tile.Values + FVoxelBrickTile::GetIndex(FIntVector(X + CornerOffsets[i][0], Y + CornerOffsets[i][1], CornerOffsets[i][2]));
+				const __m256 Inside = _mm256_cmp_ps(_mm256_loadu_ps(Corners), IsoValue, _CMP_LE_OQ);
+				Bits = _mm256_or_ps(Bits, _mm256_and_ps(Inside, _mm256_castsi256_ps(_mm256_set1_epi32(1 << i))));
+			}
+			const __m128i Lo = _mm_castps_si128(_mm256_castps256_ps128(Bits));
+			const __m128i Hi = _mm_castps_si128(_mm256_extractf128_ps(Bits, 1));
+#	elif VOXEL_CUBE_CLASSIFY_SSE
+			__m128i Lo = _mm_setzero_si128();
+			__m128i Hi = _mm_setzero_si128();
+			for (uint32 i = 0; i < 8; ++i)
+			{
+				const float* Corners = Tile.Values + FVoxelBrickTile::GetIndex(FIntVector(X + CornerOffsets[i][0], Y + CornerOffsets[i][1], CornerOffsets[i][2]));
+				const __m128i Bit = _mm_set1_epi32(1 << i);
+				Lo = _mm_or_si128(Lo, _mm_and_si128(_mm_castps_si128(_mm_cmple_ps(_mm_loadu_ps(Corners + 0), IsoValue)), Bit));
+				Hi = _mm_or_si128(Hi, _mm_and_si128(_mm_castps_si128(_mm_cmple_ps(_mm_loadu_ps(Corners + 4), IsoValue)), Bit));
+			}
+#	endif
+
+#	if VOXEL_CUBE_CLASSIFY_SSE
+			const __m128i Words = _mm_packs_epi32(Lo, Hi);
+			const __m128i Bytes = _mm_packus_epi16(Words, Words);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(RowCubeIndices), Bytes);
+
+			// Runs of cubes entirely inside or outside produce nothing
+			const __m128i Empty = _mm_or_si128(_mm_cmpeq_epi8(Bytes, _mm_setzero_si128()), _mm_cmpeq_epi8(Bytes, _mm_set1_epi8(-1)));
+			const uint32 RowNonEmpty = ~_mm_movemask_epi8(Empty) & 0xFF;
+#	else
+			uint32x4_t Lo = vdupq_n_u32(0);
+			uint32x4_t Hi = vdupq_n_u32(0);
+			for (uint32 i = 0; i < 8; ++i)
+			{
+				const float* Corners = Tile.Values + FVoxelBrickTile::GetIndex(FIntVector(X + CornerOffsets[i][0], Y + CornerOffsets[i][1], CornerOffsets[i][2]));
+				const uint32x4_t Bit = vdupq_n_u32(1u << i);
+				Lo = vorrq_u32(Lo, vandq_u32(vcleq_f32(vld1q_f32(Corners + 0), IsoValue), Bit));
+				Hi = vorrq_u32(Hi, vandq_u32(vcleq_f32(vld1q_f32(Corners + 4), IsoValue), Bit));
+			}
+			const uint8x8_t Bytes = vmovn_u16(vcombine_u16(vmovn_u32(Lo), vmovn_u32(Hi)));
+			vst1_u8(RowCubeIndices, Bytes);
+
+			// Runs of cubes entirely inside or outside produce nothing
+			static const uint8 LaneBits[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+			const uint8x8_t NonEmpty = vand_u8(vtst_u8(Bytes, Bytes), vmvn_u8(vceq_u8(Bytes, vdup_n_u8(0xFF))));
+			const uint32 RowNonEmpty = vaddv_u8(vand_u8(NonEmpty, vld1_u8(LaneBits)));
+#	endif
+			if (RowNonEmpty != 0)
+			{
+				const uint32 LocalIndex = GetCubeLocalIndex(X, Y, 0);
+				OutNonEmptyMask[LocalIndex >> 6] |= uint64(RowNonEmpty) << (LocalIndex & 63);
+			}
+		}
+	}
+
+	ClearPaddingCubes(NumValidCubes, OutCubeIndices, OutNonEmptyMask);
+	return CountNonEmpty(OutNonEmptyMask);
+#else
+	return ClassifyBrickScalar(Tile, SurfaceIsoValue, NumValidCubes, OutCubeIndices, OutNonEmptyMask);
+#endif
+}
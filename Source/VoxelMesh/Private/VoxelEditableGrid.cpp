@@ -0,0 +1,491 @@
+﻿#include "VoxelEditableGrid.h"
+
+#include "VoxelChunkGrid.h"
+#include "VoxelLeafDecode.h"
+#include "VoxelMeshLog.h"
+
+/// ValueAccessor::touchLeaf returns the leaf by value with the new accessor methods, setting the origin again gives it back
+static FVoxelEditableGrid::FBuildLeaf& TouchLeaf(nanovdb::tools::build::ValueAccessor<float>& Accessor, const nanovdb::Coord& LeafOrigin)
+{
+	const bool bActive = Accessor.isActive(LeafOrigin);
+	FVoxelEditableGrid::FBuildLeaf* Leaf = Accessor.setValue(LeafOrigin, Accessor.getValue(LeafOrigin));
+	Leaf->mValueMask.set(0, bActive);
+	return *Leaf;
+}
+
+FVoxelEditableGrid::FVoxelEditableGrid(const nanovdb::NanoGrid<nanovdb::Fp4>& InGrid, const FIntVector& InVoxelSize)
+	: Grid(InGrid.tree().background(), InGrid.gridName(), nanovdb::GridClass::LevelSet)
+	, VoxelSize(InVoxelSize)
+	, Background(InGrid.tree().background())
+	, VoxelScale(static_cast<float>(InGrid.voxelSize()[0]))
+	, DirtyMin(INT32_MAX)
+	, DirtyMax(INT32_MIN)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelEditableGrid::FVoxelEditableGrid);
+	Grid.mMap = InGrid.map();
+
+	// Leaves are allocated one after the other, then decoded in parallel
+	using FNanoLeaf = nanovdb::NanoLeaf<nanovdb::Fp4>;
+	const uint32 NumLeaves = InGrid.tree().nodeCount(0);
+	const FNanoLeaf* FirstLeaf = InGrid.tree().getFirstNode<0>();
+	TArray<FBuildLeaf*> Leaves;
+	Leaves.SetNumUninitialized(NumLeaves);
+	{
+		nanovdb::tools::build::ValueAccessor<float> Accessor = Grid.getAccessor();
+		for (uint32 LeafIndex = 0; LeafIndex < NumLeaves; ++LeafIndex)
+		{
+			Leaves[LeafIndex] = &TouchLeaf(Accessor, FirstLeaf[LeafIndex].origin());
+		}
+	}
+	ParallelFor(NumLeaves, [&](int32 LeafIndex)
+	{
+		const FNanoLeaf& SrcLeaf = FirstLeaf[LeafIndex];
+		FBuildLeaf& DstLeaf = *Leaves[LeafIndex];
+		FVoxelLeafDecode::Decode(SrcLeaf, DstLeaf.mValues);
+		DstLeaf.mValueMask = SrcLeaf.valueMask();
+	});
+
+	// Only leaves were copied, the tiles inside the surface get their sign back from them
+	nanovdb::tools::build::NodeManager<FBuildGrid> NodeManager(Grid);
+	nanovdb::tools::build::sdfToLevelSet(NodeManager);
+}
+
+float FVoxelEditableGrid::GetValue(const FIntVector& Coord) const
+{
+	return Grid.getValue(nanovdb::Coord(Coord.X, Coord.Y, Coord.Z));
+}
+
+void FVoxelEditableGrid::SetValue(const FIntVector& Coord, float Value)
+{
+	ModifyBox(Coord, Coord, [Value](const FIntVector&, float) { return Value; });
+}
+
+bool FVoxelEditableGrid::TouchLeaves(const FIntVector& Min, const FIntVector& Max, TFunctionRef<bool(const FIntVector&)> LeafFilter,
+	FIntVector& OutBoxMin, FIntVector& OutBoxMax, TArray<FBuildLeaf*>& OutLeaves)
+{
+	OutBoxMin = FIntVector(FMath::Max(Min.X, 0), FMath::Max(Min.Y, 0), FMath::Max(Min.Z, 0));
+	OutBoxMax = FIntVector(FMath::Min(Max.X, VoxelSize.X - 1), FMath::Min(Max.Y, VoxelSize.Y - 1), FMath::Min(Max.Z, VoxelSize.Z - 1));
+	if (OutBoxMin.X > OutBoxMax.X || OutBoxMin.Y > OutBoxMax.Y || OutBoxMin.Z > OutBoxMax.Z)
+	{
+		return false;
+	}
+
+	nanovdb::tools::build::ValueAccessor<float> Accessor = Grid.getAccessor();
+	for (int32 X = OutBoxMin.X & ~7; X <= OutBoxMax.X; X += 8)
+	{
+		for (int32 Y = OutBoxMin.Y & ~7; Y <= OutBoxMax.Y; Y += 8)
+		{
+			for (int32 Z = OutBoxMin.Z & ~7; Z <= OutBoxMax.Z; Z += 8)
+			{
+				if (LeafFilter(FIntVector(X, Y, Z)))
+				{
+					FBuildLeaf& Leaf = TouchLeaf(Accessor, nanovdb::Coord(X, Y, Z));
+					RecordLeaf(Leaf);
+					OutLeaves.Add(&Leaf);
+				}
+			}
+		}
+	}
+
+	if (OutLeaves.IsEmpty())
+	{
+		return false;
+	}
+	DirtyMin = FIntVector(FMath::Min(DirtyMin.X, OutBoxMin.X), FMath::Min(DirtyMin.Y, OutBoxMin.Y), FMath::Min(DirtyMin.Z, OutBoxMin.Z));
+	DirtyMax = FIntVector(FMath::Max(DirtyMax.X, OutBoxMax.X), FMath::Max(DirtyMax.Y, OutBoxMax.Y), FMath::Max(DirtyMax.Z, OutBoxMax.Z));
+	return true;
+}
+
+void FVoxelEditableGrid::ApplyBrush(const FVoxelSdfBrush& Brush)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelEditableGrid::ApplyBrush);
+	check(Brush.Sdf);
+
+	// Past the narrow band and the blend, the brush only moves values that are clamped to the band anyway
+	const float Reach = Background / VoxelScale + Brush.Smoothness;
+	const float LeafReach = Reach + FMath::Sqrt(3.0f) * 3.5f;
+	const bool bIntersect = Brush.Operation == EVoxelBrushOperation::Intersect;
+
+	// Union and subtract change the leaves inside the brush, intersect the ones outside of it
+	FIntVector Min(0);
+	FIntVector Max = VoxelSize - FIntVector(1);
+	if (!bIntersect)
+	{
+		Min = FIntVector(
+			FMath::FloorToInt32(Brush.Bounds.Min.X - Reach),
+			FMath::FloorToInt32(Brush.Bounds.Min.Y - Reach),
+			FMath::FloorToInt32(Brush.Bounds.Min.Z - Reach));
+		Max = FIntVector(
+			FMath::CeilToInt32(Brush.Bounds.Max.X + Reach),
+			FMath::CeilToInt32(Brush.Bounds.Max.Y + Reach),
+			FMath::CeilToInt32(Brush.Bounds.Max.Z + Reach));
+	}
+
+	const float Scale = VoxelScale;
+	ModifyBox(Min, Max, [&Brush, Scale](const FIntVector& Coord, float Value)
+	{
+		const float Distance = Brush.Sdf(FVector3f(Coord.X, Coord.Y, Coord.Z)) * Scale;
+		return FVoxelSdfBrush::Blend(Brush.Operation, Value, Distance, Brush.Smoothness * Scale);
+	},
+	[&Brush, LeafReach, bIntersect](const FIntVector& LeafOrigin)
+	{
+		const float Distance = Brush.Sdf(FVector3f(LeafOrigin.X + 3.5f, LeafOrigin.Y + 3.5f, LeafOrigin.Z + 3.5f));
+		return bIntersect ? Distance >= -LeafReach : Distance <= LeafReach;
+	});
+}
+
+/// Solution of the Eikonal equation |grad d| = 1 at a voxel from the smallest neighbour distance along each axis, spacing H
+static float SolveEikonal(float A, float B, float C, float H)
+{
+	if (A > B) Swap(A, B);
+	if (B > C) Swap(B, C);
+	if (A > B) Swap(A, B);
+
+	float Distance = A + H;
+	if (Distance > B)
+	{
+		Distance = 0.5f * (A + B + FMath::Sqrt(FMath::Max(2.0f * H * H - (A - B) * (A - B), 0.0f)));
+		if (Distance > C)
+		{
+			const float Sum = A + B + C;
+			Distance = (Sum + FMath::Sqrt(FMath::Max(Sum * Sum - 3.0f * (A * A + B * B + C * C - H * H), 0.0f))) / 3.0f;
+		}
+	}
+	return Distance;
+}
+
+void FVoxelEditableGrid::Renormalize(const FIntVector& Min, const FIntVector& Max)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelEditableGrid::Renormalize);
+
+	// The nearest surface of a voxel within the band is at most a band away, solve on a block that wide around the box
+	const int32 BandWidth = FMath::CeilToInt32(Background / VoxelScale) + 1;
+	const FIntVector WriteMin(FMath::Max(Min.X, 0), FMath::Max(Min.Y, 0), FMath::Max(Min.Z, 0));
+	const FIntVector WriteMax(FMath::Min(Max.X, VoxelSize.X - 1), FMath::Min(Max.Y, VoxelSize.Y - 1), FMath::Min(Max.Z, VoxelSize.Z - 1));
+	if (WriteMin.X > WriteMax.X || WriteMin.Y > WriteMax.Y || WriteMin.Z > WriteMax.Z)
+	{
+		return;
+	}
+	const FIntVector BlockMin(FMath::Max(WriteMin.X - BandWidth, 0), FMath::Max(WriteMin.Y - BandWidth, 0), FMath::Max(WriteMin.Z - BandWidth, 0));
+	const FIntVector BlockMax(FMath::Min(WriteMax.X + BandWidth, VoxelSize.X - 1), FMath::Min(WriteMax.Y + BandWidth, VoxelSize.Y - 1), FMath::Min(WriteMax.Z + BandWidth, VoxelSize.Z - 1));
+	const FIntVector BlockSize = BlockMax - BlockMin + FIntVector(1);
+	const auto GetIndex = [&BlockSize](int32 X, int32 Y, int32 Z)
+	{
+		return Z + BlockSize.Z * (Y + BlockSize.Y * X);
+	};
+
+	TArray<float> Values;
+	Values.SetNumUninitialized(BlockSize.X * BlockSize.Y * BlockSize.Z);
+	ParallelFor(BlockSize.X, [&](int32 X)
+	{
+		nanovdb::tools::build::ValueAccessor<float> Accessor = Grid.getAccessor();
+		for (int32 Y = 0; Y < BlockSize.Y; ++Y)
+		{
+			for (int32 Z = 0; Z < BlockSize.Z; ++Z)
+			{
+				Values[GetIndex(X, Y, Z)] = Accessor.getValue(nanovdb::Coord(BlockMin.X + X, BlockMin.Y + Y, BlockMin.Z + Z));
+			}
+		}
+	});
+
+	// Voxels next to the surface are fixed at the distance to the crossing of their edges, the others start far away
+	const float H = VoxelScale;
+	TArray<float> Distances;
+	TBitArray<> Fixed(false, Values.Num());
+	Distances.SetNumUninitialized(Values.Num());
+	ParallelFor(BlockSize.X, [&](int32 X)
+	{
+		for (int32 Y = 0; Y < BlockSize.Y; ++Y)
+		{
+			for (int32 Z = 0; Z < BlockSize.Z; ++Z)
+			{
+				const int32 Index = GetIndex(X, Y, Z);
+				const float Value = Values[Index];
+				float Distance = Background;
+				const FIntVector Coord(X, Y, Z);
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					for (int32 Side = -1; Side <= 1; Side += 2)
+					{
+						FIntVector NeighbourCoord = Coord;
+						NeighbourCoord[Axis] += Side;
+						if (NeighbourCoord[Axis] < 0 || NeighbourCoord[Axis] >= BlockSize[Axis])
+						{
+							continue;
+						}
+						const float NeighbourValue = Values[GetIndex(NeighbourCoord.X, NeighbourCoord.Y, NeighbourCoord.Z)];
+						if ((Value > 0.0f) != (NeighbourValue > 0.0f))
+						{
+							Distance = FMath::Min(Distance, H * Value / (Value - NeighbourValue));
+						}
+					}
+				}
+				Distances[Index] = Distance;
+				if (Distance < Background)
+				{
+					Fixed[Index] = true;
+				}
+			}
+		}
+	});
+
+	// Godunov updates of every voxel at once, each pass moves the front by about a voxel so a few passes cover the band.
+	// Unlike ordered sweeps these run in parallel.
+	TArray<float> NextDistances = Distances;
+	const int32 SliceSize = BlockSize.Y * BlockSize.Z;
+	for (int32 Pass = 0; Pass < 2 * BandWidth; ++Pass)
+	{
+		std::atomic<bool> bChanged = false;
+		ParallelFor(BlockSize.X, [&](int32 X)
+		{
+			bool bSliceChanged = false;
+			for (int32 Y = 0; Y < BlockSize.Y; ++Y)
+			{
+				for (int32 Z = 0; Z < BlockSize.Z; ++Z)
+				{
+					const int32 Index = GetIndex(X, Y, Z);
+					if (Fixed[Index])
+					{
+						continue;
+					}
+					const float A = FMath::Min(X > 0 ? Distances[Index - SliceSize] : Background, X + 1 < BlockSize.X ? Distances[Index + SliceSize] : Background);
+					const float B = FMath::Min(Y > 0 ? Distances[Index - BlockSize.Z] : Background, Y + 1 < BlockSize.Y ? Distances[Index + BlockSize.Z] : Background);
+					const float C = FMath::Min(Z > 0 ? Distances[Index - 1] : Background, Z + 1 < BlockSize.Z ? Distances[Index + 1] : Background);
+					if (FMath::Min3(A, B, C) < Background)
+					{
+						const float Distance = FMath::Min(Distances[Index], SolveEikonal(A, B, C, H));
+						bSliceChanged |= Distance < NextDistances[Index];
+						NextDistances[Index] = Distance;
+					}
+				}
+			}
+			if (bSliceChanged)
+			{
+				bChanged = true;
+			}
+		});
+		Swap(Distances, NextDistances);
+		if (!bChanged)
+		{
+			break;
+		}
+		NextDistances = Distances;
+	}
+
+	// Leaves that are outside of the band before and after are left alone, they stay tiles or get pruned
+	const auto GetNewValue = [&](const FIntVector& Coord)
+	{
+		const int32 Index = GetIndex(Coord.X - BlockMin.X, Coord.Y - BlockMin.Y, Coord.Z - BlockMin.Z);
+		const float Distance = FMath::Min(Distances[Index], Background);
+		return Values[Index] > 0.0f ? Distance : -Distance;
+	};
+	ModifyBox(WriteMin, WriteMax, [&GetNewValue](const FIntVector& Coord, float)
+	{
+		return GetNewValue(Coord);
+	},
+	[&](const FIntVector& LeafOrigin)
+	{
+		for (int32 X = FMath::Max(LeafOrigin.X, WriteMin.X); X <= FMath::Min(LeafOrigin.X + 7, WriteMax.X); ++X)
+		{
+			for (int32 Y = FMath::Max(LeafOrigin.Y, WriteMin.Y); Y <= FMath::Min(LeafOrigin.Y + 7, WriteMax.Y); ++Y)
+			{
+				for (int32 Z = FMath::Max(LeafOrigin.Z, WriteMin.Z); Z <= FMath::Min(LeafOrigin.Z + 7, WriteMax.Z); ++Z)
+				{
+					const int32 Index = GetIndex(X - BlockMin.X, Y - BlockMin.Y, Z - BlockMin.Z);
+					if (FMath::Abs(Values[Index]) < Background || Distances[Index] < Background)
+					{
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	});
+}
+
+uint32 FVoxelEditableGrid::PruneInactiveLeaves()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelEditableGrid::PruneInactiveLeaves);
+	using FLowerNode = nanovdb::tools::build::InternalNode<FBuildLeaf>;
+
+	// Same as the pruning of tools::build::levelSetToFog, the flood filled values of an inactive leaf all have the sign of its tile
+	nanovdb::tools::build::NodeManager<FBuildGrid> NodeManager(Grid);
+	std::atomic<uint32> NumPrunedLeaves = 0;
+	ParallelFor(NodeManager.lowerCount(), [&](int32 NodeIndex)
+	{
+		FLowerNode& Node = NodeManager.lower(NodeIndex);
+		uint32 NumNodePrunedLeaves = 0;
+		for (uint32 Index = 0; Index < FLowerNode::SIZE; ++Index)
+		{
+			if (Node.mChildMask.isOn(Index) && Node.mTable[Index].child->mValueMask.isOff())
+			{
+				FBuildLeaf* Leaf = Node.mTable[Index].child;
+				Node.mTable[Index].value = Leaf->getFirstValue();
+				Node.mChildMask.setOff(Index);
+				delete Leaf;
+				++NumNodePrunedLeaves;
+			}
+		}
+		NumPrunedLeaves += NumNodePrunedLeaves;
+	});
+	return NumPrunedLeaves;
+}
+
+void FVoxelEditableGrid::BeginTransaction()
+{
+	++TransactionDepth;
+}
+
+void FVoxelEditableGrid::EndTransaction()
+{
+	check(TransactionDepth > 0);
+	// Edits not baked yet are committed by the next bake, along with their renormalization
+	if (--TransactionDepth == 0 && !IsDirty())
+	{
+		CommitTransaction();
+	}
+}
+
+void FVoxelEditableGrid::RecordLeaf(const FBuildLeaf& Leaf)
+{
+	const FIntVector Origin(Leaf.mOrigin[0], Leaf.mOrigin[1], Leaf.mOrigin[2]);
+	if (bRestoring || PendingLeaves.Contains(Origin))
+	{
+		return;
+	}
+	PendingLeaves.Add(Origin);
+
+	FLeafSnapshot& Snapshot = PendingTransaction.Leaves.AddDefaulted_GetRef();
+	Snapshot.Origin = Origin;
+	Snapshot.ValueMask = Leaf.mValueMask;
+	FMemory::Memcpy(Snapshot.Values, Leaf.mValues, sizeof(Snapshot.Values));
+}
+
+void FVoxelEditableGrid::CommitTransaction()
+{
+	if (PendingTransaction.Leaves.IsEmpty())
+	{
+		return;
+	}
+
+	// A new step makes the undone ones unreachable
+	for (const FTransaction& Transaction : RedoStack)
+	{
+		JournalSize -= Transaction.Leaves.GetAllocatedSize();
+	}
+	RedoStack.Reset();
+
+	JournalSize += PendingTransaction.Leaves.GetAllocatedSize();
+	UndoStack.Add(MoveTemp(PendingTransaction));
+	PendingTransaction = FTransaction();
+	PendingLeaves.Reset();
+	TrimJournal();
+}
+
+bool FVoxelEditableGrid::RestoreTransaction(TArray<FTransaction>& FromStack, TArray<FTransaction>& ToStack)
+{
+	if (FromStack.IsEmpty())
+	{
+		return false;
+	}
+
+	FTransaction Transaction = FromStack.Pop();
+	nanovdb::tools::build::ValueAccessor<float> Accessor = Grid.getAccessor();
+	for (FLeafSnapshot& Snapshot : Transaction.Leaves)
+	{
+		// Pruned leaves come back as copies of their tile
+		FBuildLeaf& Leaf = TouchLeaf(Accessor, nanovdb::Coord(Snapshot.Origin.X, Snapshot.Origin.Y, Snapshot.Origin.Z));
+		Swap(Leaf.mValueMask, Snapshot.ValueMask);
+		for (uint32 Index = 0; Index < FBuildLeaf::SIZE; ++Index)
+		{
+			Swap(Leaf.mValues[Index], Snapshot.Values[Index]);
+		}
+
+		const FIntVector LeafMax = Snapshot.Origin + FIntVector(7);
+		DirtyMin = FIntVector(FMath::Min(DirtyMin.X, Snapshot.Origin.X), FMath::Min(DirtyMin.Y, Snapshot.Origin.Y), FMath::Min(DirtyMin.Z, Snapshot.Origin.Z));
+		DirtyMax = FIntVector(FMath::Max(DirtyMax.X, LeafMax.X), FMath::Max(DirtyMax.Y, LeafMax.Y), FMath::Max(DirtyMax.Z, LeafMax.Z));
+	}
+	DirtyMin = FIntVector(FMath::Max(DirtyMin.X, 0), FMath::Max(DirtyMin.Y, 0), FMath::Max(DirtyMin.Z, 0));
+	DirtyMax = FIntVector(FMath::Min(DirtyMax.X, VoxelSize.X - 1), FMath::Min(DirtyMax.Y, VoxelSize.Y - 1), FMath::Min(DirtyMax.Z, VoxelSize.Z - 1));
+
+	// The snapshots now hold the state that was just replaced
+	ToStack.Add(MoveTemp(Transaction));
+	bRestoring = true;
+	return true;
+}
+
+bool FVoxelEditableGrid::Undo()
+{
+	CommitTransaction();
+	return RestoreTransaction(UndoStack, RedoStack);
+}
+
+bool FVoxelEditableGrid::Redo()
+{
+	return PendingTransaction.Leaves.IsEmpty() && RestoreTransaction(RedoStack, UndoStack);
+}
+
+void FVoxelEditableGrid::SetMaxJournalSize(uint64 InMaxJournalSize)
+{
+	MaxJournalSize = InMaxJournalSize;
+	TrimJournal();
+}
+
+void FVoxelEditableGrid::TrimJournal()
+{
+	while (JournalSize > MaxJournalSize && UndoStack.Num() > 1)
+	{
+		JournalSize -= UndoStack[0].Leaves.GetAllocatedSize();
+		UndoStack.RemoveAt(0);
+	}
+}
+
+nanovdb::GridHandle<nanovdb::HostBuffer> FVoxelEditableGrid::Bake(FIntVector& OutDirtyMin, FIntVector& OutDirtyMax, FBakeStats* OutStats)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelEditableGrid::Bake);
+	OutDirtyMin = DirtyMin;
+	OutDirtyMax = DirtyMax;
+	DirtyMin = FIntVector(INT32_MAX);
+	DirtyMax = FIntVector(INT32_MIN);
+
+	double StartTime = FPlatformTime::Seconds();
+	if (OutDirtyMin.X <= OutDirtyMax.X && !bRestoring)
+	{
+		Renormalize(OutDirtyMin, OutDirtyMax);
+		DirtyMin = FIntVector(INT32_MAX);
+		DirtyMax = FIntVector(INT32_MIN);
+	}
+	const double RenormalizeSeconds = FPlatformTime::Seconds() - StartTime;
+
+	bRestoring = false;
+	if (TransactionDepth == 0)
+	{
+		CommitTransaction();
+	}
+
+	StartTime = FPlatformTime::Seconds();
+	{
+		nanovdb::tools::build::NodeManager<FBuildGrid> NodeManager(Grid);
+		nanovdb::tools::build::sdfToLevelSet(NodeManager);
+	}
+	const double FloodFillSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	const uint32 NumPrunedLeaves = PruneInactiveLeaves();
+	const double PruneSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	// Edits can empty the faces of the chunk, its size is kept whatever voxels stay active
+	nanovdb::GridHandle<nanovdb::HostBuffer> Handle = FVoxelChunkGrid::Encode(Grid, VoxelSize);
+	if (OutStats)
+	{
+		OutStats->RenormalizeSeconds = RenormalizeSeconds;
+		OutStats->FloodFillSeconds = FloodFillSeconds;
+		OutStats->PruneSeconds = PruneSeconds;
+		OutStats->EncodeSeconds = FPlatformTime::Seconds() - StartTime;
+		OutStats->NumLeaves = Handle.grid<nanovdb::Fp4>()->tree().nodeCount(0);
+		OutStats->NumPrunedLeaves = NumPrunedLeaves;
+		OutStats->NumBytes = Handle.buffer().size();
+	}
+	return Handle;
+}
@@ -0,0 +1,133 @@
+﻿#include "VoxelGridPyramid.h"
+
+#include "Async/ParallelFor.h"
+
+static bool IsOnChunkFace(const FIntVector& Coord, const FIntVector& VoxelSize)
+{
+	return Coord.X == 0 || Coord.Y == 0 || Coord.Z == 0
+		|| Coord.X == VoxelSize.X - 1 || Coord.Y == VoxelSize.Y - 1 || Coord.Z == VoxelSize.Z - 1;
+}
+
+void FVoxelGridPyramid::BuildCoarseLevel(const nanovdb::NanoGrid<nanovdb::Fp4>& FineGrid, const FIntVector& FineVoxelSize, FVoxelGridLevel& OutLevel)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelGridPyramid::BuildCoarseLevel);
+	using FBuildGrid = nanovdb::tools::build::Grid<float>;
+
+	constexpr int32 LeafDim = 8;
+	constexpr int32 LeafSize = LeafDim * LeafDim * LeafDim;
+	// Fine voxels read by a coarse leaf: 2 per coarse voxel, and one more on each side for the filter
+	constexpr int32 BlockDim = LeafDim * 2 + 1;
+
+	const FIntVector CoarseVoxelSize = GetCoarseVoxelSize(FineVoxelSize);
+	const FIntVector LeafCount(
+		FMath::DivideAndRoundUp(CoarseVoxelSize.X, LeafDim),
+		FMath::DivideAndRoundUp(CoarseVoxelSize.Y, LeafDim),
+		FMath::DivideAndRoundUp(CoarseVoxelSize.Z, LeafDim));
+	const int32 NumLeaves = LeafCount.X * LeafCount.Y * LeafCount.Z;
+	const float Background = FineGrid.tree().background();
+
+	// Filter every coarse leaf in parallel, only those inside the narrow band are kept
+	TArray<TArray<float>> LeafValues;
+	LeafValues.SetNum(NumLeaves);
+	ParallelFor(NumLeaves, [&](int32 LeafIndex)
+	{
+		const FIntVector LeafOrigin = FIntVector(
+			LeafIndex / (LeafCount.Y * LeafCount.Z),
+			(LeafIndex / LeafCount.Z) % LeafCount.Y,
+			LeafIndex % LeafCount.Z) * LeafDim;
+		const FIntVector BlockOrigin = LeafOrigin * 2 - FIntVector(1);
+
+		const nanovdb::DefaultReadAccessor<nanovdb::Fp4> Accessor = FineGrid.getAccessor();
+		float Block[BlockDim * BlockDim * BlockDim];
+		int32 BlockIndex = 0;
+		for (int32 X = 0; X < BlockDim; ++X)
+		{
+			for (int32 Y = 0; Y < BlockDim; ++Y)
+			{
+				for (int32 Z = 0; Z < BlockDim; ++Z)
+				{
+					Block[BlockIndex++] = Accessor.getValue(nanovdb::Coord(
+						FMath::Clamp(BlockOrigin.X + X, 0, FineVoxelSize.X - 1),
+						FMath::Clamp(BlockOrigin.Y + Y, 0, FineVoxelSize.Y - 1),
+						FMath::Clamp(BlockOrigin.Z + Z, 0, FineVoxelSize.Z - 1)));
+				}
+			}
+		}
+
+		static constexpr float Weights[3] = { 0.25f, 0.5f, 0.25f };
+		TArray<float> Values;
+		Values.SetNumUninitialized(LeafSize);
+		bool bInNarrowBand = false;
+		for (int32 X = 0; X < LeafDim; ++X)
+		{
+			for (int32 Y = 0; Y < LeafDim; ++Y)
+			{
+				for (int32 Z = 0; Z < LeafDim; ++Z)
+				{
+					float Value = 0.0f;
+					if (IsOnChunkFace(LeafOrigin + FIntVector(X, Y, Z), CoarseVoxelSize))
+					{
+						// Point sampled, so a finer neighbour stitching to this level sees the same values (FVoxelCpuMesher::SetTransitionFaces)
+						Value = Block[(2 * Z + 1) + BlockDim * ((2 * Y + 1) + BlockDim * (2 * X + 1))];
+					}
+					else
+					{
+						for (int32 DX = 0; DX < 3; ++DX)
+						{
+							for (int32 DY = 0; DY < 3; ++DY)
+							{
+								const float* Row = Block + (2 * Z) + BlockDim * ((2 * Y + DY) + BlockDim * (2 * X + DX));
+								Value += Weights[DX] * Weights[DY] * (Weights[0] * Row[0] + Weights[1] * Row[1] + Weights[2] * Row[2]);
+							}
+						}
+					}
+					Values[Z + LeafDim * (Y + LeafDim * X)] = Value;
+					bInNarrowBand |= FMath::Abs(Value) < Background;
+				}
+			}
+		}
+
+		if (bInNarrowBand)
+		{
+			LeafValues[LeafIndex] = MoveTemp(Values);
+		}
+	});
+
+	// Insert the narrow band, then flood fill the inside like the NanoVDB level set primitives
+	FBuildGrid CoarseGrid(Background, FineGrid.gridName(), nanovdb::GridClass::LevelSet);
+	CoarseGrid.mMap.set(FineGrid.voxelSize()[0] * 2.0, FineGrid.map().applyMap(nanovdb::Vec3d(0.0)));
+	{
+		nanovdb::tools::build::ValueAccessor<float> Accessor = CoarseGrid.getAccessor();
+		for (int32 LeafIndex = 0; LeafIndex < NumLeaves; ++LeafIndex)
+		{
+			const TArray<float>& Values = LeafValues[LeafIndex];
+			if (Values.IsEmpty())
+			{
+				continue;
+			}
+
+			const FIntVector LeafOrigin = FIntVector(
+				LeafIndex / (LeafCount.Y * LeafCount.Z),
+				(LeafIndex / LeafCount.Z) % LeafCount.Y,
+				LeafIndex % LeafCount.Z) * LeafDim;
+			for (int32 Index = 0; Index < LeafSize; ++Index)
+			{
+				const float Value = Values[Index];
+				if (FMath::Abs(Value) < Background)
+				{
+					Accessor.setValue(nanovdb::Coord(
+						LeafOrigin.X + Index / (LeafDim * LeafDim),
+						LeafOrigin.Y + (Index / LeafDim) % LeafDim,
+						LeafOrigin.Z + Index % LeafDim), Value);
+				}
+			}
+		}
+	}
+	nanovdb::tools::build::NodeManager<FBuildGrid> NodeManager(CoarseGrid);
+	nanovdb::tools::build::sdfToLevelSet(NodeManager);
+
+	nanovdb::GridHandle<nanovdb::HostBuffer> Handle = nanovdb::tools::createNanoGrid<FBuildGrid, nanovdb::Fp4>(CoarseGrid);
+	OutLevel.VoxelDataBuffer.SetNumUninitialized(Handle.buffer().size());
+	FMemory::Memcpy(OutLevel.VoxelDataBuffer.GetData(), Handle.buffer().data(), Handle.buffer().size());
+	OutLevel.VoxelSize = CoarseVoxelSize;
+}
@@ -0,0 +1,299 @@
+﻿#include "VoxelHeightmapConverter.h"
+
+#include "Async/ParallelFor.h"
+#include "VoxelChunkGrid.h"
+#include "VoxelMeshLog.h"
+
+namespace VoxelHeightmapConverter
+{
+	static FORCEINLINE float ToVoxels(uint16 Height, const FVoxelHeightmapSettings& Settings)
+	{
+		return (Settings.HeightOffset + (static_cast<float>(Height) - 32768.0f) * Settings.HeightScale) / Settings.VoxelSize;
+	}
+
+	/// Voxel of the first sample
+	static FIntPoint GetSampleOrigin(const FVoxelHeightmapSettings& Settings)
+	{
+		return FIntPoint(FMath::RoundToInt32(Settings.Origin.X / Settings.VoxelSize), FMath::RoundToInt32(Settings.Origin.Y / Settings.VoxelSize));
+	}
+
+	static int32 FloorDiv(int32 Value, int32 Divisor)
+	{
+		return FMath::FloorToInt32(static_cast<double>(Value) / Divisor);
+	}
+
+	/// Heights of a column of chunks and its one sample border, clamped at the edges of the heightmap
+	struct FColumn
+	{
+		int32 Dim = 0;
+		TArray<float> Heights;
+		/// 1 / sqrt(1 + |gradient|^2), turns height differences into distances
+		TArray<float> InvSlopes;
+
+		void Load(TConstArrayView<uint16> Samples, const FIntPoint& Size, const FIntPoint& Origin, int32 ChunkSize, const FVoxelHeightmapSettings& Settings)
+		{
+			Dim = ChunkSize + 2;
+			TArray<float> Border;
+			Border.SetNumUninitialized(Dim * Dim);
+			for (int32 Y = 0; Y < Dim; ++Y)
+			{
+				const int32 SampleY = FMath::Clamp(Origin.Y + Y - 1, 0, Size.Y - 1);
+				for (int32 X = 0; X < Dim; ++X)
+				{
+					const int32 SampleX = FMath::Clamp(Origin.X + X - 1, 0, Size.X - 1);
+					Border[Y * Dim + X] = ToVoxels(Samples[SampleY * Size.X + SampleX], Settings);
+				}
+			}
+
+			Heights.SetNumUninitialized(ChunkSize * ChunkSize);
+			InvSlopes.SetNumUninitialized(ChunkSize * ChunkSize);
+			for (int32 Y = 0; Y < ChunkSize; ++Y)
+			{
+				for (int32 X = 0; X < ChunkSize; ++X)
+				{
+					const int32 Center = (Y + 1) * Dim + X + 1;
+					const float SlopeX = (Border[Center + 1] - Border[Center - 1]) * 0.5f;
+					const float SlopeY = (Border[Center + Dim] - Border[Center - Dim]) * 0.5f;
+					Heights[Y * ChunkSize + X] = Border[Center];
+					InvSlopes[Y * ChunkSize + X] = FMath::InvSqrt(1.0f + SlopeX * SlopeX + SlopeY * SlopeY);
+				}
+			}
+		}
+	};
+}
+
+void FVoxelHeightmapConverter::GetChunkRange(TConstArrayView<uint16> Heights, const FIntPoint& Size, const FVoxelHeightmapSettings& Settings, FIntVector& OutMin, FIntVector& OutMax)
+{
+	using namespace VoxelHeightmapConverter;
+	const int32 ChunkSize = FMath::Max(Align(Settings.ChunkSize, 8), 8);
+	// The band is widest on the steepest slope, bounded by the largest difference between two neighbour samples
+	uint16 MinSample = MAX_uint16;
+	uint16 MaxSample = 0;
+	int32 MaxDifference = 0;
+	for (int32 Y = 0; Y < Size.Y; ++Y)
+	{
+		for (int32 X = 0; X < Size.X; ++X)
+		{
+			const int32 Sample = Heights[Y * Size.X + X];
+			MinSample = FMath::Min<uint16>(MinSample, Sample);
+			MaxSample = FMath::Max<uint16>(MaxSample, Sample);
+			if (X + 1 < Size.X)
+			{
+				MaxDifference = FMath::Max(MaxDifference, FMath::Abs(Heights[Y * Size.X + X + 1] - Sample));
+			}
+			if (Y + 1 < Size.Y)
+			{
+				MaxDifference = FMath::Max(MaxDifference, FMath::Abs(Heights[(Y + 1) * Size.X + X] - Sample));
+			}
+		}
+	}
+	const float MaxSlope = MaxDifference * FMath::Abs(Settings.HeightScale) / Settings.VoxelSize;
+	const float Band = FMath::Max(Settings.BandWidth, 1.0f) * FMath::Sqrt(1.0f + 2.0f * MaxSlope * MaxSlope);
+	const float MinHeight = FMath::Min(ToVoxels(MinSample, Settings), ToVoxels(MaxSample, Settings));
+	const float MaxHeight = FMath::Max(ToVoxels(MinSample, Settings), ToVoxels(MaxSample, Settings));
+	const FIntPoint SampleOrigin = GetSampleOrigin(Settings);
+	OutMin = FIntVector(
+		FloorDiv(SampleOrigin.X, ChunkSize),
+		FloorDiv(SampleOrigin.Y, ChunkSize),
+		FMath::FloorToInt32((MinHeight - Band) / ChunkSize));
+	OutMax = FIntVector(
+		FloorDiv(SampleOrigin.X + Size.X - 1, ChunkSize),
+		FloorDiv(SampleOrigin.Y + Size.Y - 1, ChunkSize),
+		FMath::FloorToInt32((MaxHeight + Band) / ChunkSize));
+}
+
+bool FVoxelHeightmapConverter::Convert(TConstArrayView<uint16> Heights, const FIntPoint& Size, const FVoxelHeightmapSettings& Settings, FOnChunk OnChunk, FStats* OutStats)
+{
+	using namespace VoxelHeightmapConverter;
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelHeightmapConverter::Convert);
+	if (Size.X <= 0 || Size.Y <= 0 || Heights.Num() < Size.X * Size.Y)
+	{
+		UE_LOG(LogVoxelMesh, Error, TEXT("%d heights for a %dx%d heightmap"), Heights.Num(), Size.X, Size.Y);
+		return false;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 ChunkSize = FMath::Max(Align(Settings.ChunkSize, 8), 8);
+	const int32 LeavesPerAxis = ChunkSize / 8;
+	const float BandWidth = FMath::Max(Settings.BandWidth, 1.0f);
+	const float Background = BandWidth * Settings.VoxelSize;
+	FIntVector ChunkMin;
+	FIntVector ChunkMax;
+	GetChunkRange(Heights, Size, Settings, ChunkMin, ChunkMax);
+	const FIntPoint NumColumns(ChunkMax.X - ChunkMin.X + 1, ChunkMax.Y - ChunkMin.Y + 1);
+	const FIntPoint SampleOrigin = GetSampleOrigin(Settings);
+
+	struct FChunk
+	{
+		int32 ChunkZ = 0;
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle;
+	};
+	struct FColumnResult
+	{
+		TArray<FChunk> Chunks;
+		uint32 NumLeaves = 0;
+		uint32 NumTiles = 0;
+	};
+
+	// Columns are converted in batches so only a few of them are held before being handed over
+	const int32 NumColumnsTotal = NumColumns.X * NumColumns.Y;
+	const int32 BatchSize = FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads() * 4, 16);
+	TArray<FColumnResult> Results;
+	uint32 NumChunks = 0;
+	uint32 NumLeaves = 0;
+	uint32 NumTiles = 0;
+	for (int32 BatchStart = 0; BatchStart < NumColumnsTotal; BatchStart += BatchSize)
+	{
+		const int32 BatchNum = FMath::Min(BatchSize, NumColumnsTotal - BatchStart);
+		Results.Reset();
+		Results.SetNum(BatchNum);
+		ParallelFor(BatchNum, [&](int32 BatchIndex)
+		{
+			const int32 ColumnIndex = BatchStart + BatchIndex;
+			const FIntPoint ColumnCoord(ChunkMin.X + ColumnIndex % NumColumns.X, ChunkMin.Y + ColumnIndex / NumColumns.X);
+			const FIntPoint Origin = ColumnCoord * ChunkSize;
+			// Voxels of the column covered by samples, the others are left to the background
+			const FIntPoint FirstSample = Origin - SampleOrigin;
+			const FIntPoint ColumnMin(FMath::Max(-FirstSample.X, 0), FMath::Max(-FirstSample.Y, 0));
+			const FIntPoint ColumnMax(FMath::Min(ChunkSize, Size.X - FirstSample.X), FMath::Min(ChunkSize, Size.Y - FirstSample.Y));
+			FColumn Column;
+			Column.Load(Heights, Size, FirstSample, ChunkSize, Settings);
+
+			// Extremes of the heights and the band of every 8x8 column of leaves, in voxels
+			const int32 NumLeafColumns = LeavesPerAxis * LeavesPerAxis;
+			TArray<float, TInlineAllocator<1024>> LeafBottoms;
+			TArray<float, TInlineAllocator<1024>> LeafTops;
+			LeafBottoms.SetNumUninitialized(NumLeafColumns);
+			LeafTops.SetNumUninitialized(NumLeafColumns);
+			float ColumnBottom = UE_BIG_NUMBER;
+			float ColumnTop = -UE_BIG_NUMBER;
+			for (int32 LeafColumn = 0; LeafColumn < NumLeafColumns; ++LeafColumn)
+			{
+				const int32 LeafX = (LeafColumn / LeavesPerAxis) * 8;
+				const int32 LeafY = (LeafColumn % LeavesPerAxis) * 8;
+				float Bottom = UE_BIG_NUMBER;
+				float Top = -UE_BIG_NUMBER;
+				for (int32 Y = FMath::Max(LeafY, ColumnMin.Y); Y < FMath::Min(LeafY + 8, ColumnMax.Y); ++Y)
+				{
+					for (int32 X = FMath::Max(LeafX, ColumnMin.X); X < FMath::Min(LeafX + 8, ColumnMax.X); ++X)
+					{
+						// A voxel is in the band while its height difference is below the band width times the slope
+						const float Height = Column.Heights[Y * ChunkSize + X];
+						const float Band = BandWidth / Column.InvSlopes[Y * ChunkSize + X];
+						Bottom = FMath::Min(Bottom, Height - Band);
+						Top = FMath::Max(Top, Height + Band);
+					}
+				}
+				LeafBottoms[LeafColumn] = Bottom;
+				LeafTops[LeafColumn] = Top;
+				ColumnBottom = FMath::Min(ColumnBottom, Bottom);
+				ColumnTop = FMath::Max(ColumnTop, Top);
+			}
+			if (ColumnTop < ColumnBottom)
+			{
+				return;
+			}
+
+			FColumnResult& Result = Results[BatchIndex];
+			for (int32 ChunkZ = FMath::FloorToInt32(ColumnBottom / ChunkSize); ChunkZ <= FMath::FloorToInt32(ColumnTop / ChunkSize); ++ChunkZ)
+			{
+				const FIntVector ChunkOrigin(Origin.X, Origin.Y, ChunkZ * ChunkSize);
+				FBuildGrid Grid(Background, "heightmap", nanovdb::GridClass::LevelSet);
+				Grid.setTransform(Settings.VoxelSize, nanovdb::Vec3d(ChunkOrigin.X, ChunkOrigin.Y, ChunkOrigin.Z) * Settings.VoxelSize);
+				bool bHasSurface = false;
+				for (int32 LeafColumn = 0; LeafColumn < NumLeafColumns; ++LeafColumn)
+				{
+					const int32 LeafX = (LeafColumn / LeavesPerAxis) * 8;
+					const int32 LeafY = (LeafColumn % LeavesPerAxis) * 8;
+					if (LeafX >= ColumnMax.X || LeafY >= ColumnMax.Y || LeafX + 8 <= ColumnMin.X || LeafY + 8 <= ColumnMin.Y)
+					{
+						continue;
+					}
+					for (int32 LeafZ = 0; LeafZ < ChunkSize; LeafZ += 8)
+					{
+						const float Bottom = ChunkOrigin.Z + LeafZ;
+						if (Bottom > LeafTops[LeafColumn])
+						{
+							break;
+						}
+						const FIntVector LeafOrigin(LeafX, LeafY, LeafZ);
+						if (Bottom + 7.0f < LeafBottoms[LeafColumn])
+						{
+							FVoxelChunkGrid::AddLeaf(Grid, nullptr, true, LeafOrigin);
+							++Result.NumTiles;
+							continue;
+						}
+
+						FBuildLeaf* Leaf = new FBuildLeaf(nanovdb::Coord(LeafX, LeafY, LeafZ), Background, false);
+						for (int32 X = 0; X < 8; ++X)
+						{
+							for (int32 Y = 0; Y < 8; ++Y)
+							{
+								const bool bInside = LeafX + X >= ColumnMin.X && LeafX + X < ColumnMax.X && LeafY + Y >= ColumnMin.Y && LeafY + Y < ColumnMax.Y;
+								const int32 Sample = FMath::Clamp(LeafY + Y, ColumnMin.Y, ColumnMax.Y - 1) * ChunkSize + FMath::Clamp(LeafX + X, ColumnMin.X, ColumnMax.X - 1);
+								const float Height = Column.Heights[Sample];
+								const float InvSlope = Column.InvSlopes[Sample];
+								const uint32 Row = (X << 6) | (Y << 3);
+								for (int32 Z = 0; Z < 8; ++Z)
+								{
+									const float Distance = (Bottom + Z - Height) * InvSlope;
+									if (bInside && FMath::Abs(Distance) < BandWidth)
+									{
+										Leaf->mValues[Row | Z] = Distance * Settings.VoxelSize;
+										Leaf->mValueMask.setOn(Row | Z);
+									}
+									else
+									{
+										Leaf->mValues[Row | Z] = Distance < 0.0f ? -Background : Background;
+									}
+								}
+							}
+						}
+						const bool bInside = Leaf->mValues[0] < 0.0f;
+						if (Leaf->mValueMask.isOff())
+						{
+							delete Leaf;
+							Leaf = nullptr;
+							Result.NumTiles += bInside;
+						}
+						if (FVoxelChunkGrid::AddLeaf(Grid, Leaf, bInside, LeafOrigin))
+						{
+							++Result.NumLeaves;
+							bHasSurface = true;
+						}
+					}
+				}
+				if (!bHasSurface)
+				{
+					continue;
+				}
+				Result.Chunks.Add({ChunkZ, FVoxelChunkGrid::Encode(Grid, FIntVector(ColumnMax.X, ColumnMax.Y, ChunkSize))});
+			}
+		});
+
+		for (int32 BatchIndex = 0; BatchIndex < BatchNum; ++BatchIndex)
+		{
+			const int32 ColumnIndex = BatchStart + BatchIndex;
+			FColumnResult& Result = Results[BatchIndex];
+			for (FChunk& Chunk : Result.Chunks)
+			{
+				if (!OnChunk(FIntVector(ChunkMin.X + ColumnIndex % NumColumns.X, ChunkMin.Y + ColumnIndex / NumColumns.X, Chunk.ChunkZ), MoveTemp(Chunk.Handle)))
+				{
+					return false;
+				}
+			}
+			NumChunks += Result.Chunks.Num();
+			NumLeaves += Result.NumLeaves;
+			NumTiles += Result.NumTiles;
+		}
+	}
+
+	if (OutStats)
+	{
+		OutStats->Seconds = FPlatformTime::Seconds() - StartTime;
+		OutStats->NumChunks = NumChunks;
+		OutStats->NumLeaves = NumLeaves;
+		OutStats->NumTiles = NumTiles;
+	}
+	return true;
+}
@@ -0,0 +1,203 @@
+﻿#include "VoxelLeafDecode.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#	include <arm_neon.h>
+#	define VOXEL_LEAF_DECODE_NEON 1
+#elif PLATFORM_ENABLE_VECTORINTRINSICS
+#	include <emmintrin.h>
+#	define VOXEL_LEAF_DECODE_SSE 1
+#	if defined(__AVX2__) || PLATFORM_ALWAYS_HAS_AVX_2
+#		include <immintrin.h>
+#		define VOXEL_LEAF_DECODE_AVX2 1
+#	endif
+#endif
+
+#if !defined(VOXEL_LEAF_DECODE_NEON)
+#	define VOXEL_LEAF_DECODE_NEON 0
+#endif
+#if !defined(VOXEL_LEAF_DECODE_SSE)
+#	define VOXEL_LEAF_DECODE_SSE 0
+#endif
+#if !defined(VOXEL_LEAF_DECODE_AVX2)
+#	define VOXEL_LEAF_DECODE_AVX2 0
+#endif
+
+void FVoxelLeafDecode::DecodeScalar(const nanovdb::NanoLeaf<nanovdb::Fp4>& Leaf, float* RESTRICT OutValues)
+{
+	const auto* Data = Leaf.data();
+	const float Quantum = Data->mQuantum;
+	const float Minimum = Data->mMinimum;
+	for (uint32 i = 0; i < LeafSize / 2; ++i)
+	{
+		const uint8 Code = Data->mCode[i];
+		OutValues[2 * i + 0] = (Code & 15) * Quantum + Minimum;
+		OutValues[2 * i + 1] = (Code >> 4) * Quantum + Minimum;
+	}
+}
+
+void FVoxelLeafDecode::DecodeScalar(const nanovdb::NanoLeaf<nanovdb::Fp8>& Leaf, float* RESTRICT OutValues)
+{
+	const auto* Data = Leaf.data();
+	const float Quantum = Data->mQuantum;
+	const float Minimum = Data->mMinimum;
+	for (uint32 i = 0; i < LeafSize; ++i)
+	{
+		OutValues[i] = Data->mCode[i] * Quantum + Minimum;
+	}
+}
+
+void FVoxelLeafDecode::DecodeScalar(const nanovdb::NanoLeaf<nanovdb::Fp16>& Leaf, float* RESTRICT OutValues)
+{
+	const auto* Data = Leaf.data();
+	const float Quantum = Data->mQuantum;
+	const float Minimum = Data->mMinimum;
+	for (uint32 i = 0; i < LeafSize; ++i)
+	{
+		OutValues[i] = Data->mCode[i] * Quantum + Minimum;
+	}
+}
+
+#if VOXEL_LEAF_DECODE_AVX2
+
+/// 16 codes (one per byte) to 16 floats
+static FORCEINLINE void DecodeBytes16(__m128i Codes, __m256 Quantum, __m256 Minimum, float* RESTRICT OutValues)
+{
+	const __m256 Lo = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(Codes));
+	const __m256 Hi = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(Codes, 8)));
+	_mm256_storeu_ps(OutValues + 0, _mm256_add_ps(_mm256_mul_ps(Lo, Quantum), Minimum));
+	_mm256_storeu_ps(OutValues + 8, _mm256_add_ps(_mm256_mul_ps(Hi, Quantum), Minimum));
+}
+
+/// 8 codes (one per uint16) to 8 floats
+static FORCEINLINE void DecodeWords8(__m128i Codes, __m256 Quantum, __m256 Minimum, float* RESTRICT OutValues)
+{
+	const __m256 Values = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(Codes));
+	_mm256_storeu_ps(OutValues, _mm256_add_ps(_mm256_mul_ps(Values, Quantum), Minimum));
+}
+
+#elif VOXEL_LEAF_DECODE_SSE
+
+static FORCEINLINE void DecodeWords8(__m128i Codes, __m128 Quantum, __m128 Minimum, float* RESTRICT OutValues)
+{
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128 Lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(Codes, Zero));
+	const __m128 Hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(Codes, Zero));
+	_mm_storeu_ps(OutValues + 0, _mm_add_ps(_mm_mul_ps(Lo, Quantum), Minimum));
+	_mm_storeu_ps(OutValues + 4, _mm_add_ps(_mm_mul_ps(Hi, Quantum), Minimum));
+}
+
+static FORCEINLINE void DecodeBytes16(__m128i Codes, __m128 Quantum, __m128 Minimum, float* RESTRICT OutValues)
+{
+	const __m128i Zero = _mm_setzero_si128();
+	DecodeWords8(_mm_unpacklo_epi8(Codes, Zero), Quantum, Minimum, OutValues + 0);
+	DecodeWords8(_mm_unpackhi_epi8(Codes, Zero), Quantum, Minimum, OutValues + 8);
+}
+
+#elif VOXEL_LEAF_DECODE_NEON
+
+static FORCEINLINE void DecodeWords8(uint16x8_t Codes, float32x4_t Quantum, float32x4_t Minimum, float* RESTRICT OutValues)
+{
+	const float32x4_t Lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(Codes)));
+	const float32x4_t Hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(Codes)));
+	vst1q_f32(OutValues + 0, vmlaq_f32(Minimum, Lo, Quantum));
+	vst1q_f32(OutValues + 4, vmlaq_f32(Minimum, Hi, Quantum));
+}
+
+static FORCEINLINE void DecodeBytes16(uint8x16_t Codes, float32x4_t Quantum, float32x4_t Minimum, float* RESTRICT OutValues)
+{
+	DecodeWords8(vmovl_u8(vget_low_u8(Codes)), Quantum, Minimum, OutValues + 0);
+	DecodeWords8(vmovl_u8(vget_high_u8(Codes)), Quantum, Minimum, OutValues + 8);
+}
+
+#endif
+
+void FVoxelLeafDecode::Decode(const nanovdb::NanoLeaf<nanovdb::Fp4>& Leaf, float* RESTRICT OutValues)
+{
+	const auto* Data = Leaf.data();
+#if VOXEL_LEAF_DECODE_SSE
+#	if VOXEL_LEAF_DECODE_AVX2
+	const __m256 Quantum = _mm256_set1_ps(Data->mQuantum);
+	const __m256 Minimum = _mm256_set1_ps(Data->mMinimum);
+#	else
+	const __m128 Quantum = _mm_set1_ps(Data->mQuantum);
+	const __m128 Minimum = _mm_set1_ps(Data->mMinimum);
+#	endif
+	const __m128i LowNibbleMask = _mm_set1_epi8(15);
+	for (uint32 i = 0; i < LeafSize / 2; i += 16)
+	{
+		// Even values live in the low nibbles, odd values in the high ones
+		const __m128i Packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Data->mCode + i));
+		const __m128i Even = _mm_and_si128(Packed, LowNibbleMask);
+		const __m128i Odd = _mm_and_si128(_mm_srli_epi16(Packed, 4), LowNibbleMask);
+		DecodeBytes16(_mm_unpacklo_epi8(Even, Odd), Quantum, Minimum, OutValues + 2 * i + 0);
+		DecodeBytes16(_mm_unpackhi_epi8(Even, Odd), Quantum, Minimum, OutValues + 2 * i + 16);
+	}
+#elif VOXEL_LEAF_DECODE_NEON
+	const float32x4_t Quantum = vdupq_n_f32(Data->mQuantum);
+	const float32x4_t Minimum = vdupq_n_f32(Data->mMinimum);
+	const uint8x16_t LowNibbleMask = vdupq_n_u8(15);
+	for (uint32 i = 0; i < LeafSize / 2; i += 16)
+	{
+		const uint8x16_t Packed = vld1q_u8(Data->mCode + i);
+		const uint8x16x2_t Interleaved = vzipq_u8(vandq_u8(Packed, LowNibbleMask), vshrq_n_u8(Packed, 4));
+		DecodeBytes16(Interleaved.val[0], Quantum, Minimum, OutValues + 2 * i + 0);
+		DecodeBytes16(Interleaved.val[1], Quantum, Minimum, OutValues + 2 * i + 16);
+	}
+#else
+	DecodeScalar(Leaf, OutValues);
+#endif
+}
+
+void FVoxelLeafDecode::Decode(const nanovdb::NanoLeaf<nanovdb::Fp8>& Leaf, float* RESTRICT OutValues)
+{
+	const auto* Data = Leaf.data();
+#if VOXEL_LEAF_DECODE_SSE
+#	if VOXEL_LEAF_DECODE_AVX2
+	const __m256 Quantum = _mm256_set1_ps(Data->mQuantum);
+	const __m256 Minimum = _mm256_set1_ps(Data->mMinimum);
+#	else
+	const __m128 Quantum = _mm_set1_ps(Data->mQuantum);
+	const __m128 Minimum = _mm_set1_ps(Data->mMinimum);
+#	endif
+	for (uint32 i = 0; i < LeafSize; i += 16)
+	{
+		DecodeBytes16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Data->mCode + i)), Quantum, Minimum, OutValues + i);
+	}
+#elif VOXEL_LEAF_DECODE_NEON
+	const float32x4_t Quantum = vdupq_n_f32(Data->mQuantum);
+	const float32x4_t Minimum = vdupq_n_f32(Data->mMinimum);
+	for (uint32 i = 0; i < LeafSize; i += 16)
+	{
+		DecodeBytes16(vld1q_u8(Data->mCode + i), Quantum, Minimum, OutValues + i);
+	}
+#else
+	DecodeScalar(Leaf, OutValues);
+#endif
+}
+
+void FVoxelLeafDecode::Decode(const nanovdb::NanoLeaf<nanovdb::Fp16>& Leaf, float* RESTRICT OutValues)
+{
+	const auto* Data = Leaf.data();
+#if VOXEL_LEAF_DECODE_SSE
+#	if VOXEL_LEAF_DECODE_AVX2
+	const __m256 Quantum = _mm256_set1_ps(Data->mQuantum);
+	const __m256 Minimum = _mm256_set1_ps(Data->mMinimum);
+#	else
+	const __m128 Quantum = _mm_set1_ps(Data->mQuantum);
+	const __m128 Minimum = _mm_set1_ps(Data->mMinimum);
+#	endif
+	for (uint32 i = 0; i < LeafSize; i += 8)
+	{
+		DecodeWords8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Data->mCode + i)), Quantum, Minimum, OutValues + i);
+	}
+#elif VOXEL_LEAF_DECODE_NEON
+	const float32x4_t Quantum = vdupq_n_f32(Data->mQuantum);
+	const float32x4_t Minimum = vdupq_n_f32(Data->mMinimum);
+	for (uint32 i = 0; i < LeafSize; i += 8)
+	{
+		DecodeWords8(vld1q_u16(Data->mCode + i), Quantum, Minimum, OutValues + i);
+	}
+#else
+	DecodeScalar(Leaf, OutValues);
+#endif
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Marching cubes tables shared with the compute shaders, so the CPU mesher can never drift from MarchingCubesCS.usf.
+ * The shader directory is a private include path of this module.
+ */
+namespace VoxelMarchingCubes
+{
+	using uint = uint32;
+
+#include "MarchingCubeCommons.ush"
+
+	static constexpr uint32 NumOwnedEdges = UE_ARRAY_COUNT(OwnedEdge);
+
+	FORCEINLINE uint32 CountIndices(uint32 CubeIndex)
+	{
+		return TriangleNumTable[CubeIndex] * 3;
+	}
+
+	/// Offsets of the neighbour cubes owning the remaining edges, see MarchingCubeMeshGenerationCS
+	static const FIntVector SharedEdgeCoordBias[] = {
+		FIntVector(1, 0, 0),
+		FIntVector(0, 1, 0),
+		FIntVector(0, 0, 1),
+		FIntVector(0, 1, 1),
+		FIntVector(1, 0, 1),
+		FIntVector(1, 1, 0),
+	};
+
+	/// For each neighbour, the local edge matching its owned edges (0, 3, 8), -1 if not shared with this cube
+	static const int32 SharedEdgeCorrespondence[][NumOwnedEdges] = {
+		{-1, 1, 9},
+		{2, -1, 11},
+		{4, 7, -1},
+		{6, -1, -1},
+		{-1, 5, -1},
+		{-1, -1, 10},
+	};
+}
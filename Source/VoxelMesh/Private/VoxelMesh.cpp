@@ -8,6 +8,7 @@
 #endif // WITH_EDITOR
 
 #include "VoxelChunkView.h"
+#include "VoxelMeshRebuildScheduler.h"
 #include "VoxelShaders.h"
 #include "Interfaces/IPluginManager.h"
 
@@ -25,6 +26,7 @@ void FVoxelMeshModule::StartupModule()
 
 void FVoxelMeshModule::ShutdownModule()
 {
+	FVoxelMeshRebuildScheduler::Get().Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,837 @@
+﻿#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "VoxelBrickTraversal.h"
+#include "VoxelCpuMesher.h"
+#include "VoxelCubeClassify.h"
+#include "VoxelEditableGrid.h"
+#include "VoxelGridPyramid.h"
+#include "VoxelHeightmapConverter.h"
+#include "VoxelLeafDecode.h"
+#include "VoxelMeshLog.h"
+#include "VoxelMeshSectionLayout.h"
+#include "VoxelMeshVoxelizer.h"
+#include "VoxelPointSurfacer.h"
+#include "VoxelRawVolumeImporter.h"
+#include "VoxelSurfaceNetsMesher.h"
+#include "VoxelTerrainGenerator.h"
+#include "VoxelVdbCommon.h"
+#include "VoxelVoxImporter.h"
+
+namespace VoxelMeshBenchmarks
+{
+	using FGridType = FVoxelCpuMesher::FGridType;
+	using FAccessorType = FVoxelCpuMesher::FAccessorType;
+
+	struct FSampleStats
+	{
+		double Seconds = 0.0;
+		uint64 LeafSwitches = 0;
+		float Checksum = 0.0f;
+	};
+
+	/// Sample the 8 corners of every cube with a single accessor, visiting cubes in the order given by GetCoord
+	template <typename FCoordFunc>
+	static FSampleStats SampleCubes(const FGridType& Grid, const FIntVector& Size, uint32 NumIds, FCoordFunc&& GetCoord)
+	{
+		static const FIntVector CornerOffsets[8] = {
+			FIntVector(0, 0, 0), FIntVector(1, 0, 0), FIntVector(1, 1, 0), FIntVector(0, 1, 0),
+			FIntVector(0, 0, 1), FIntVector(1, 0, 1), FIntVector(1, 1, 1), FIntVector(0, 1, 1),
+		};
+
+		FSampleStats Stats;
+		const FAccessorType Accessor = Grid.getAccessor();
+		FIntVector LastLeaf(INT32_MAX);
+		const double StartTime = FPlatformTime::Seconds();
+		for (uint32 Id = 0; Id < NumIds; ++Id)
+		{
+			const FIntVector Coord = GetCoord(Id);
+			if (Coord.X >= Size.X || Coord.Y >= Size.Y || Coord.Z >= Size.Z)
+			{
+				continue;
+			}
+
+			const FIntVector Leaf(Coord.X >> 3, Coord.Y >> 3, Coord.Z >> 3);
+			Stats.LeafSwitches += Leaf != LastLeaf;
+			LastLeaf = Leaf;
+
+			for (const FIntVector& Offset : CornerOffsets)
+			{
+				Stats.Checksum += Accessor.getValue(nanovdb::Coord(
+					FMath::Min(Coord.X + Offset.X, Size.X - 1),
+					FMath::Min(Coord.Y + Offset.Y, Size.Y - 1),
+					FMath::Min(Coord.Z + Offset.Z, Size.Z - 1)));
+			}
+		}
+		Stats.Seconds = FPlatformTime::Seconds() - StartTime;
+		return Stats;
+	}
+
+	static void BenchmarkTraversal(const TArray<FString>& Args)
+	{
+		const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 8) : 256;
+
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle = nanovdb::tools::createLevelSetSphere<nanovdb::Fp4, nanovdb::HostBuffer>(
+			Size * 0.5 - 4.0, nanovdb::Vec3d(Size * 0.5), 1.0);
+		const FGridType* Grid = Handle.grid<nanovdb::Fp4>();
+		check(Grid);
+
+		const FIntVector VoxelSize(Size);
+		const FVoxelBrickTraversal Traversal(Size, Size, Size);
+
+		const FSampleStats RowMajor = SampleCubes(*Grid, VoxelSize, Size * Size * Size, [Size](uint32 Id)
+		{
+			return FIntVector(Id / (Size * Size), (Id / Size) % Size, Id % Size);
+		});
+		const FSampleStats Brick = SampleCubes(*Grid, VoxelSize, Traversal.GetNumTraversalIds(), [&Traversal](uint32 Id)
+		{
+			return Traversal.GetCoordByTraversalId(Id);
+		});
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("Traversal benchmark on a %d^3 sphere level set:"), Size);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Row-major:    %8.2f ms, %llu leaf switches (checksum %f)"), RowMajor.Seconds * 1000.0, RowMajor.LeafSwitches, RowMajor.Checksum);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Brick/Morton: %8.2f ms, %llu leaf switches (checksum %f)"), Brick.Seconds * 1000.0, Brick.LeafSwitches, Brick.Checksum);
+
+		FVoxelCpuMeshData MeshData;
+		const double StartTime = FPlatformTime::Seconds();
+		FVoxelCpuMesher(*Grid, Size, Size, Size, 0.0f).Generate(MeshData);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  CPU mesher:   %8.2f ms, %d vertices, %d triangles"),
+			(FPlatformTime::Seconds() - StartTime) * 1000.0, MeshData.Vertices.Num(), MeshData.Indices.Num() / 3);
+	}
+
+	/// Decode every leaf of a grid in bulk, then voxel by voxel through the leaf and through the read accessor
+	template <typename BuildT>
+	static void BenchmarkLeafDecode(const TCHAR* TypeName, int32 Size, int32 NumRepeats)
+	{
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle = nanovdb::tools::createLevelSetSphere<BuildT, nanovdb::HostBuffer>(
+			Size * 0.5 - 4.0, nanovdb::Vec3d(Size * 0.5), 1.0);
+		const nanovdb::NanoGrid<BuildT>* Grid = Handle.template grid<BuildT>();
+		check(Grid);
+
+		const nanovdb::NanoLeaf<BuildT>* Leaves = Grid->tree().getFirstLeaf();
+		const uint32 NumLeaves = Grid->tree().nodeCount(0);
+		const double NumVoxels = double(NumLeaves) * FVoxelLeafDecode::LeafSize * NumRepeats;
+		float Values[FVoxelLeafDecode::LeafSize];
+		float Checksum = 0.0f;
+
+		const auto Measure = [&](auto&& DecodeLeaf)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Repeat = 0; Repeat < NumRepeats; ++Repeat)
+			{
+				for (uint32 LeafIndex = 0; LeafIndex < NumLeaves; ++LeafIndex)
+				{
+					DecodeLeaf(Leaves[LeafIndex]);
+					Checksum += Values[LeafIndex % FVoxelLeafDecode::LeafSize];
+				}
+			}
+			return (FPlatformTime::Seconds() - StartTime) * 1e9 / NumVoxels;
+		};
+
+		const double BulkTime = Measure([&](const nanovdb::NanoLeaf<BuildT>& Leaf)
+		{
+			FVoxelLeafDecode::Decode(Leaf, Values);
+		});
+		const double ScalarTime = Measure([&](const nanovdb::NanoLeaf<BuildT>& Leaf)
+		{
+			FVoxelLeafDecode::DecodeScalar(Leaf, Values);
+		});
+		const double LeafGetValueTime = Measure([&](const nanovdb::NanoLeaf<BuildT>& Leaf)
+		{
+			for (uint32 i = 0; i < FVoxelLeafDecode::LeafSize; ++i)
+			{
+				Values[i] = Leaf.getValue(i);
+			}
+		});
+		const auto Accessor = Grid->getAccessor();
+		const double AccessorTime = Measure([&](const nanovdb::NanoLeaf<BuildT>& Leaf)
+		{
+			const nanovdb::Coord Origin = Leaf.origin();
+			for (uint32 i = 0; i < FVoxelLeafDecode::LeafSize; ++i)
+			{
+				Values[i] = Accessor.getValue(Origin + nanovdb::Coord(i >> 6, (i >> 3) & 7, i & 7));
+			}
+		});
+
+		float MaxError = 0.0f;
+		for (uint32 LeafIndex = 0; LeafIndex < NumLeaves; ++LeafIndex)
+		{
+			FVoxelLeafDecode::Decode(Leaves[LeafIndex], Values);
+			for (uint32 i = 0; i < FVoxelLeafDecode::LeafSize; ++i)
+			{
+				MaxError = FMath::Max(MaxError, FMath::Abs(Values[i] - Leaves[LeafIndex].getValue(i)));
+			}
+		}
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("  %-4s %6u leaves: bulk %.3f ns/voxel, scalar %.3f, leaf getValue %.3f, accessor getValue %.3f, max error %g (checksum %f)"),
+			TypeName, NumLeaves, BulkTime, ScalarTime, LeafGetValueTime, AccessorTime, MaxError, Checksum);
+	}
+
+	static void BenchmarkLeafDecode(const TArray<FString>& Args)
+	{
+		const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 8) : 256;
+		const int32 NumRepeats = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 8;
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("Leaf decode benchmark on a %d^3 sphere level set, %d repeats:"), Size, NumRepeats);
+		BenchmarkLeafDecode<nanovdb::Fp4>(TEXT("Fp4"), Size, NumRepeats);
+		BenchmarkLeafDecode<nanovdb::Fp8>(TEXT("Fp8"), Size, NumRepeats);
+		BenchmarkLeafDecode<nanovdb::Fp16>(TEXT("Fp16"), Size, NumRepeats);
+	}
+
+	static void BenchmarkClassify(const TArray<FString>& Args)
+	{
+		const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 8) : 128;
+		const int32 NumRepeats = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 8;
+
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle = nanovdb::tools::createLevelSetSphere<nanovdb::Fp4, nanovdb::HostBuffer>(
+			Size * 0.5 - 4.0, nanovdb::Vec3d(Size * 0.5), 1.0);
+		const FGridType* Grid = Handle.grid<nanovdb::Fp4>();
+		check(Grid);
+
+		// Decode all bricks upfront, only the classification is measured
+		const FVoxelBrickTraversal Traversal(Size, Size, Size);
+		const int32 NumBricks = Traversal.GetNumBricks();
+		TArray<FVoxelBrickTile> Tiles;
+		Tiles.SetNumUninitialized(NumBricks);
+		const FAccessorType Accessor = Grid->getAccessor();
+		for (int32 BrickIndex = 0; BrickIndex < NumBricks; ++BrickIndex)
+		{
+			const FIntVector BrickOrigin = Traversal.GetBrickCoord(BrickIndex) * FVoxelBrickTraversal::BrickDim;
+			for (int32 X = 0; X < FVoxelBrickTile::Dim; ++X)
+			{
+				for (int32 Y = 0; Y < FVoxelBrickTile::Dim; ++Y)
+				{
+					for (int32 Z = 0; Z < FVoxelBrickTile::Dim; ++Z)
+					{
+						const FIntVector Coord = BrickOrigin + FIntVector(X, Y, Z);
+						Tiles[BrickIndex].Values[FVoxelBrickTile::GetIndex(FIntVector(X, Y, Z))] = Accessor.getValue(nanovdb::Coord(
+							FMath::Min(Coord.X, Size - 1), FMath::Min(Coord.Y, Size - 1), FMath::Min(Coord.Z, Size - 1)));
+					}
+				}
+			}
+		}
+
+		uint8 CubeIndices[FVoxelCubeClassify::NumCubes];
+		uint64 NonEmptyMask[FVoxelCubeClassify::NumMaskWords];
+		const auto Measure = [&](auto&& Classify, uint64& OutNumNonEmpty)
+		{
+			OutNumNonEmpty = 0;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Repeat = 0; Repeat < NumRepeats; ++Repeat)
+			{
+				for (int32 BrickIndex = 0; BrickIndex < NumBricks; ++BrickIndex)
+				{
+					const FIntVector NumValidCubes = Traversal.VoxelSize - Traversal.GetBrickCoord(BrickIndex) * FVoxelBrickTraversal::BrickDim;
+					OutNumNonEmpty += Classify(Tiles[BrickIndex], 0.0f, NumValidCubes, CubeIndices, NonEmptyMask);
+				}
+			}
+			return double(NumBricks) * FVoxelCubeClassify::NumCubes * NumRepeats / (FPlatformTime::Seconds() - StartTime);
+		};
+
+		uint64 ScalarNonEmpty = 0;
+		uint64 VectorNonEmpty = 0;
+		const double ScalarRate = Measure(&FVoxelCubeClassify::ClassifyBrickScalar, ScalarNonEmpty);
+		const double VectorRate = Measure(&FVoxelCubeClassify::ClassifyBrick, VectorNonEmpty);
+
+		int32 NumMismatchingBricks = 0;
+		for (int32 BrickIndex = 0; BrickIndex < NumBricks; ++BrickIndex)
+		{
+			const FIntVector NumValidCubes = Traversal.VoxelSize - Traversal.GetBrickCoord(BrickIndex) * FVoxelBrickTraversal::BrickDim;
+			uint8 ScalarCubeIndices[FVoxelCubeClassify::NumCubes];
+			uint64 ScalarNonEmptyMask[FVoxelCubeClassify::NumMaskWords];
+			FVoxelCubeClassify::ClassifyBrickScalar(Tiles[BrickIndex], 0.0f, NumValidCubes, ScalarCubeIndices, ScalarNonEmptyMask);
+			FVoxelCubeClassify::ClassifyBrick(Tiles[BrickIndex], 0.0f, NumValidCubes, CubeIndices, NonEmptyMask);
+			NumMismatchingBricks += FMemory::Memcmp(ScalarCubeIndices, CubeIndices, sizeof(CubeIndices)) != 0
+				|| FMemory::Memcmp(ScalarNonEmptyMask, NonEmptyMask, sizeof(NonEmptyMask)) != 0;
+		}
+
+		FVoxelCpuMeshData MeshData;
+		const double StartTime = FPlatformTime::Seconds();
+		FVoxelCpuMesher(*Grid, Size, Size, Size, 0.0f).Generate(MeshData);
+		const double MesherRate = double(Traversal.GetNumTraversalIds()) / (FPlatformTime::Seconds() - StartTime);
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("Cube classification benchmark on a %d^3 sphere level set, %d repeats:"), Size, NumRepeats);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Scalar:     %8.1f Mcubes/s (%llu non-empty)"), ScalarRate * 1e-6, ScalarNonEmpty);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Vectorized: %8.1f Mcubes/s (%llu non-empty, %d bricks differ from scalar)"), VectorRate * 1e-6, VectorNonEmpty, NumMismatchingBricks);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  CPU mesher: %8.1f Mcubes/s"), MesherRate * 1e-6);
+	}
+
+	/// Triangles with an angle under 10 degrees, the slivers marching cubes is known for
+	static int32 CountSlivers(const FVoxelCpuMeshData& MeshData)
+	{
+		const float MinCosine = FMath::Cos(FMath::DegreesToRadians(170.0f));
+		const float MaxCosine = FMath::Cos(FMath::DegreesToRadians(10.0f));
+		int32 NumSlivers = 0;
+		for (int32 i = 0; i < MeshData.Indices.Num(); i += 3)
+		{
+			const FVector3f Corners[3] = {
+				FVector3f(MeshData.Vertices[MeshData.Indices[i]]),
+				FVector3f(MeshData.Vertices[MeshData.Indices[i + 1]]),
+				FVector3f(MeshData.Vertices[MeshData.Indices[i + 2]]),
+			};
+			for (int32 Corner = 0; Corner < 3; ++Corner)
+			{
+				const FVector3f Edge1 = (Corners[(Corner + 1) % 3] - Corners[Corner]).GetSafeNormal();
+				const FVector3f Edge2 = (Corners[(Corner + 2) % 3] - Corners[Corner]).GetSafeNormal();
+				const float Cosine = Edge1 | Edge2;
+				if (Cosine > MaxCosine || Cosine < MinCosine)
+				{
+					++NumSlivers;
+					break;
+				}
+			}
+		}
+		return NumSlivers;
+	}
+
+	template <typename FMesherType>
+	static void BenchmarkMesher(const TCHAR* Name, const FGridType& Grid, int32 Size)
+	{
+		FVoxelCpuMeshData MeshData;
+		const double StartTime = FPlatformTime::Seconds();
+		FMesherType(Grid, Size, Size, Size, 0.0f).Generate(MeshData);
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		const int32 NumTriangles = MeshData.Indices.Num() / 3;
+		UE_LOG(LogVoxelMesh, Display, TEXT("  %-15s %8.2f ms, %8d vertices, %8d triangles, %5.2f%% slivers"),
+			Name, Seconds * 1000.0, MeshData.Vertices.Num(), NumTriangles, 100.0 * CountSlivers(MeshData) / FMath::Max(NumTriangles, 1));
+	}
+
+	static void CompareMeshers(const TArray<FString>& Args)
+	{
+		const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 8) : 128;
+
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle = nanovdb::tools::createLevelSetSphere<nanovdb::Fp4, nanovdb::HostBuffer>(
+			Size * 0.5 - 4.0, nanovdb::Vec3d(Size * 0.5), 1.0);
+		const FGridType* Grid = Handle.grid<nanovdb::Fp4>();
+		check(Grid);
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("CPU meshers on a %d^3 sphere level set:"), Size);
+		BenchmarkMesher<FVoxelCpuMesher>(TEXT("Marching cubes:"), *Grid, Size);
+		BenchmarkMesher<FVoxelSurfaceNetsMesher>(TEXT("Surface nets:"), *Grid, Size);
+	}
+
+	static void BenchmarkLods(const TArray<FString>& Args)
+	{
+		const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 8) : 256;
+
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle = nanovdb::tools::createLevelSetSphere<nanovdb::Fp4, nanovdb::HostBuffer>(
+			Size * 0.5 - 4.0, nanovdb::Vec3d(Size * 0.5), 1.0);
+		check(Handle.grid<nanovdb::Fp4>());
+
+		FVoxelGridLevel Level;
+		Level.VoxelDataBuffer.SetNumUninitialized(Handle.buffer().size());
+		FMemory::Memcpy(Level.VoxelDataBuffer.GetData(), Handle.buffer().data(), Handle.buffer().size());
+		Level.VoxelSize = FIntVector(Size);
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("Levels of detail of a %d^3 sphere level set:"), Size);
+		double BuildSeconds = 0.0;
+		for (int32 LodIndex = 0; LodIndex < FVoxelGridPyramid::MaxNumLevels; ++LodIndex)
+		{
+			if (LodIndex > 0)
+			{
+				FVoxelGridLevel CoarseLevel;
+				const double StartTime = FPlatformTime::Seconds();
+				FVoxelGridPyramid::BuildCoarseLevel(*Level.GetGrid(), Level.VoxelSize, CoarseLevel);
+				BuildSeconds = FPlatformTime::Seconds() - StartTime;
+				Level = MoveTemp(CoarseLevel);
+			}
+
+			FVoxelCpuMeshData MeshData;
+			const double StartTime = FPlatformTime::Seconds();
+			FVoxelCpuMesher(*Level.GetGrid(), Level.VoxelSize.X, Level.VoxelSize.Y, Level.VoxelSize.Z, 0.0f).Generate(MeshData);
+			UE_LOG(LogVoxelMesh, Display, TEXT("  LOD %d (%3d^3): built in %7.2f ms, %8.1f KiB, meshed in %7.2f ms, %8d triangles"),
+				LodIndex, Level.VoxelSize.X, BuildSeconds * 1000.0, Level.VoxelDataBuffer.Num() / 1024.0,
+				(FPlatformTime::Seconds() - StartTime) * 1000.0, MeshData.Indices.Num() / 3);
+		}
+	}
+
+	static void BenchmarkSections(const TArray<FString>& Args)
+	{
+		const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 8) : 256;
+		const int32 EditSize = Args.Num() > 1 ? FMath::Clamp(FCString::Atoi(*Args[1]), 1, Size) : 8;
+
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle = nanovdb::tools::createLevelSetSphere<nanovdb::Fp4, nanovdb::HostBuffer>(
+			Size * 0.5 - 4.0, nanovdb::Vec3d(Size * 0.5), 1.0);
+		const FGridType* Grid = Handle.grid<nanovdb::Fp4>();
+		check(Grid);
+
+		const FVoxelCpuMesher Mesher(*Grid, Size, Size, Size, 0.0f);
+		FVoxelCpuMeshData WholeMesh;
+		double StartTime = FPlatformTime::Seconds();
+		Mesher.Generate(WholeMesh);
+		const double WholeSeconds = FPlatformTime::Seconds() - StartTime;
+
+		FVoxelMeshSectionLayout Layout(Mesher.GetTraversal().VoxelSize - FIntVector(1));
+		TArray<FVoxelCpuMeshData> SectionMeshes;
+		SectionMeshes.SetNum(Layout.GetNumSections());
+		StartTime = FPlatformTime::Seconds();
+		ParallelFor(Layout.GetNumSections(), [&](int32 SectionIndex)
+		{
+			FIntVector CellMin, CellMax;
+			Layout.GetSectionCells(SectionIndex, CellMin, CellMax);
+			Mesher.GenerateRegion(CellMin, CellMax, SectionMeshes[SectionIndex]);
+		});
+		const double SectionsSeconds = FPlatformTime::Seconds() - StartTime;
+		Layout.Allocate(SectionMeshes);
+
+		// An edit on the surface, where the sphere crosses the X axis
+		const FIntVector EditMin(FMath::Clamp(FMath::RoundToInt32(Size - 4.0 - EditSize * 0.5), 0, Size - EditSize), Size / 2, Size / 2);
+		TArray<int32> DirtySections;
+		Layout.GetSectionsUsingVoxels(EditMin, EditMin + FIntVector(EditSize - 1), DirtySections);
+		uint32 UploadBytes = 0;
+		StartTime = FPlatformTime::Seconds();
+		for (const int32 SectionIndex : DirtySections)
+		{
+			FIntVector CellMin, CellMax;
+			Layout.GetSectionCells(SectionIndex, CellMin, CellMax);
+			Mesher.GenerateRegion(CellMin, CellMax, SectionMeshes[SectionIndex]);
+			UploadBytes += Layout.Sections[SectionIndex].VertexCapacity * sizeof(FVector4f) + Layout.Sections[SectionIndex].IndexCapacity * sizeof(uint32);
+		}
+		const double EditSeconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("Sectioned meshing of a %d^3 sphere level set, %d^3 edit:"), Size, EditSize);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Whole mesh:    %8.2f ms, %8.1f KiB"), WholeSeconds * 1000.0, (WholeMesh.Vertices.NumBytes() + WholeMesh.Indices.NumBytes()) / 1024.0);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  All sections:  %8.2f ms, %8.1f KiB with slack, %d sections"), SectionsSeconds * 1000.0,
+			(Layout.NumVertices * sizeof(FVector4f) + Layout.NumIndices * sizeof(uint32)) / 1024.0, Layout.GetNumSections());
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Edit:          %8.2f ms, %8.1f KiB uploaded, %d sections"), EditSeconds * 1000.0, UploadBytes / 1024.0, DirtySections.Num());
+	}
+
+	static void BenchmarkRebake(const TArray<FString>& Args)
+	{
+		const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 8) : 128;
+		const int32 NumStrokes = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 16;
+
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle = nanovdb::tools::createLevelSetSphere<nanovdb::Fp4, nanovdb::HostBuffer>(
+			Size * 0.5 - 4.0, nanovdb::Vec3d(Size * 0.5), 1.0);
+		const FGridType* Grid = Handle.grid<nanovdb::Fp4>();
+		check(Grid);
+
+		double StartTime = FPlatformTime::Seconds();
+		FVoxelEditableGrid EditableGrid(*Grid, FIntVector(Size));
+		const double LoadSeconds = FPlatformTime::Seconds() - StartTime;
+
+		// Carve spheres along the equator, one bake per stroke like an interactive brush
+		const float Radius = FMath::Max(Size / 16.0f, 2.0f);
+		double EditSeconds = 0.0;
+		double RenormalizeSeconds = 0.0;
+		double FloodFillSeconds = 0.0;
+		double PruneSeconds = 0.0;
+		double EncodeSeconds = 0.0;
+		FVoxelEditableGrid::FBakeStats Stats;
+		for (int32 Stroke = 0; Stroke < NumStrokes; ++Stroke)
+		{
+			const float Angle = UE_TWO_PI * Stroke / NumStrokes;
+			const FVector3f Center = FVector3f(Size * 0.5f) + FVector3f(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f) * (Size * 0.5f - 4.0f);
+			const FIntVector Min(FMath::FloorToInt32(Center.X - Radius - 3.0f), FMath::FloorToInt32(Center.Y - Radius - 3.0f), FMath::FloorToInt32(Center.Z - Radius - 3.0f));
+			const FIntVector Max(FMath::CeilToInt32(Center.X + Radius + 3.0f), FMath::CeilToInt32(Center.Y + Radius + 3.0f), FMath::CeilToInt32(Center.Z + Radius + 3.0f));
+
+			StartTime = FPlatformTime::Seconds();
+			EditableGrid.ModifyBox(Min, Max, [&Center, Radius](const FIntVector& Coord, float Value)
+			{
+				return FMath::Max(Value, Radius - FVector3f::Distance(FVector3f(Coord.X, Coord.Y, Coord.Z), Center));
+			});
+			EditSeconds += FPlatformTime::Seconds() - StartTime;
+
+			FIntVector DirtyMin, DirtyMax;
+			EditableGrid.Bake(DirtyMin, DirtyMax, &Stats);
+			RenormalizeSeconds += Stats.RenormalizeSeconds;
+			FloodFillSeconds += Stats.FloodFillSeconds;
+			PruneSeconds += Stats.PruneSeconds;
+			EncodeSeconds += Stats.EncodeSeconds;
+		}
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("Editing a %d^3 sphere level set, %d strokes:"), Size, NumStrokes);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Load:       %8.2f ms"), LoadSeconds * 1000.0);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Edit:       %8.2f ms per stroke"), EditSeconds * 1000.0 / NumStrokes);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Renormalize:%8.2f ms per bake"), RenormalizeSeconds * 1000.0 / NumStrokes);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Flood fill: %8.2f ms per bake"), FloodFillSeconds * 1000.0 / NumStrokes);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Prune:      %8.2f ms per bake"), PruneSeconds * 1000.0 / NumStrokes);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Encode:     %8.2f ms per bake, %u leaves, %.1f KiB"), EncodeSeconds * 1000.0 / NumStrokes, Stats.NumLeaves, Stats.NumBytes / 1024.0);
+	}
+
+	static void BenchmarkTerrain(const TArray<FString>& Args)
+	{
+		FVoxelTerrainSettings Settings;
+		Settings.ChunkSize = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 8) : 128;
+		const int32 NumChunksXY = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 4;
+		const FVoxelTerrainGenerator Generator(Settings);
+
+		// Columns of chunks around the base height, from buried to empty
+		const int32 MinChunkZ = FMath::FloorToInt32((Settings.BaseHeight - Settings.HeightAmplitude) / Settings.ChunkSize) - 1;
+		const int32 MaxChunkZ = FMath::FloorToInt32((Settings.BaseHeight + Settings.HeightAmplitude) / Settings.ChunkSize) + 1;
+		double Seconds = 0.0;
+		uint64 NumSamples = 0;
+		uint64 NumLeaves = 0;
+		uint64 NumSkippedLeaves = 0;
+		uint64 NumBytes = 0;
+		int32 NumChunks = 0;
+		for (int32 ChunkX = 0; ChunkX < NumChunksXY; ++ChunkX)
+		{
+			for (int32 ChunkY = 0; ChunkY < NumChunksXY; ++ChunkY)
+			{
+				for (int32 ChunkZ = MinChunkZ; ChunkZ <= MaxChunkZ; ++ChunkZ)
+				{
+					FVoxelTerrainGenerator::FStats Stats;
+					nanovdb::GridHandle<nanovdb::HostBuffer> Handle = Generator.GenerateChunk(FIntVector(ChunkX, ChunkY, ChunkZ), &Stats);
+					Seconds += Stats.Seconds;
+					NumSamples += Stats.NumSamples;
+					NumLeaves += Stats.NumLeaves;
+					NumSkippedLeaves += Stats.NumSkippedLeaves;
+					NumBytes += Handle.buffer().size();
+					++NumChunks;
+				}
+			}
+		}
+
+		const int32 NumCores = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+		const double NumVoxels = static_cast<double>(NumChunks) * Settings.ChunkSize * Settings.ChunkSize * Settings.ChunkSize;
+		UE_LOG(LogVoxelMesh, Display, TEXT("Procedural terrain, %d chunks of %d^3 voxels on %d cores:"), NumChunks, Settings.ChunkSize, NumCores);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Generation: %8.2f ms per chunk, %8.2f Mvoxels/s per core"), Seconds * 1000.0 / NumChunks, NumVoxels / Seconds / NumCores * 1e-6);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Samples:    %8.2f per voxel, %llu leaves generated, %llu skipped"), NumSamples / NumVoxels, NumLeaves, NumSkippedLeaves);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Memory:     %8.1f KiB per chunk"), NumBytes / 1024.0 / NumChunks);
+	}
+
+	static void BenchmarkVoxelizer(const TArray<FString>& Args)
+	{
+		const int32 Rings = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 4) : 512;
+		const int32 Size = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 16) : 128;
+
+		// Latitude/longitude sphere, its seam vertices are duplicated like the UV seams of an imported mesh
+		const float Radius = Size * 0.5f - 4.0f;
+		const FVector3f Center(Size * 0.5f);
+		TArray<FVector3f> Positions;
+		TArray<uint32> Indices;
+		for (int32 Ring = 0; Ring <= Rings; ++Ring)
+		{
+			const float Theta = UE_PI * Ring / Rings;
+			for (int32 Segment = 0; Segment <= 2 * Rings; ++Segment)
+			{
+				const float Phi = UE_PI * Segment / Rings;
+				Positions.Add(Center + FVector3f(FMath::Sin(Theta) * FMath::Cos(Phi), FMath::Sin(Theta) * FMath::Sin(Phi), FMath::Cos(Theta)) * Radius);
+			}
+		}
+		for (int32 Ring = 0; Ring < Rings; ++Ring)
+		{
+			for (int32 Segment = 0; Segment < 2 * Rings; ++Segment)
+			{
+				const uint32 Corner = Ring * (2 * Rings + 1) + Segment;
+				const uint32 Below = Corner + 2 * Rings + 1;
+				Indices.Append({Corner, Below, Corner + 1, Corner + 1, Below, Below + 1});
+			}
+		}
+
+		double StartTime = FPlatformTime::Seconds();
+		const FVoxelMeshVoxelizer Voxelizer(Positions, Indices);
+		const double BvhSeconds = FPlatformTime::Seconds() - StartTime;
+		FVoxelMeshVoxelizer::FStats Stats;
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle = Voxelizer.Voxelize(1.0f, 3.0f, &Stats);
+		const FGridType* Grid = Handle.grid<nanovdb::Fp4>();
+		check(Grid);
+
+		// Against the analytic sphere, the mesh itself is off by its chord error
+		const nanovdb::Vec3d Origin = Grid->map().applyMap(nanovdb::Vec3d(0.0));
+		FAccessorType Accessor = Grid->getAccessor();
+		float MaxError = 0.0f;
+		int32 NumSignErrors = 0;
+		for (int32 X = 0; X < Stats.Size.X; ++X)
+		{
+			for (int32 Y = 0; Y < Stats.Size.Y; ++Y)
+			{
+				for (int32 Z = 0; Z < Stats.Size.Z; ++Z)
+				{
+					const FVector3f Position = FVector3f(X, Y, Z) + FVector3f(Origin[0], Origin[1], Origin[2]);
+					const float Distance = FVector3f::Distance(Position, Center) - Radius;
+					const float Value = Accessor.getValue(nanovdb::Coord(X, Y, Z));
+					if (FMath::Abs(Distance) < 2.5f)
+					{
+						MaxError = FMath::Max(MaxError, FMath::Abs(Value - Distance));
+					}
+					if (FMath::Abs(Distance) > 0.5f && (Distance < 0.0f) != (Value < 0.0f))
+					{
+						++NumSignErrors;
+					}
+				}
+			}
+		}
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("Voxelizing a sphere of %d triangles into %d^3 voxels:"), Stats.NumTriangles, Size);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Hierarchy:  %8.2f ms"), BvhSeconds * 1000.0);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Distances:  %8.2f ms, %u leaves"), Stats.DistanceSeconds * 1000.0, Stats.NumLeaves);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Encode:     %8.2f ms, %.1f KiB"), Stats.EncodeSeconds * 1000.0, Handle.buffer().size() / 1024.0);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Max error in the band %.3f voxels, %d sign errors"), MaxError, NumSignErrors);
+	}
+
+	static void BenchmarkPoints(const TArray<FString>& Args)
+	{
+		const int32 NumPoints = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1000) : 200000;
+		const int32 NumFrames = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 8;
+
+		// Block of fluid at rest, one particle per unit with a little jitter, twice as wide as high
+		const int32 Height = FMath::Max(FMath::RoundToInt32(FMath::Pow(NumPoints / 4.0f, 1.0f / 3.0f)), 1);
+		TArray<FVector3f> RestPositions;
+		FRandomStream Random(42);
+		for (int32 X = 0; X < 2 * Height; ++X)
+		{
+			for (int32 Y = 0; Y < 2 * Height; ++Y)
+			{
+				for (int32 Z = 0; Z < Height; ++Z)
+				{
+					RestPositions.Add(FVector3f(X, Y, Z) + FVector3f(Random.FRandRange(-0.1f, 0.1f), Random.FRandRange(-0.1f, 0.1f), Random.FRandRange(-0.1f, 0.1f)));
+				}
+			}
+		}
+
+		for (const EVoxelPointKernel Kernel : {EVoxelPointKernel::Spheres, EVoxelPointKernel::ZhuBridson})
+		{
+			FVoxelPointSurfaceSettings Settings;
+			Settings.Kernel = Kernel;
+			Settings.ParticleRadius = 1.0f;
+			Settings.VoxelSize = 0.5f;
+			Settings.Domain = FBox(FVector(-4.0), FVector(2 * Height + 4, 2 * Height + 4, 2 * Height));
+
+			double SurfaceSeconds = 0.0;
+			double MeshSeconds = 0.0;
+			uint64 NumLeaves = 0;
+			uint64 NumTriangles = 0;
+			TArray<FVector3f> Positions;
+			Positions.SetNumUninitialized(RestPositions.Num());
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				// A wave running through the block, so every frame surfaces different positions
+				for (int32 Point = 0; Point < RestPositions.Num(); ++Point)
+				{
+					const FVector3f& Rest = RestPositions[Point];
+					Positions[Point] = Rest + FVector3f(0.0f, 0.0f, 0.1f * Rest.Z * FMath::Sin(0.2f * Rest.X + Frame));
+				}
+
+				double StartTime = FPlatformTime::Seconds();
+				FVoxelPointSurfacer::FStats Stats;
+				nanovdb::GridHandle<nanovdb::HostBuffer> Handle = FVoxelPointSurfacer::Surface(Positions, Settings, &Stats);
+				SurfaceSeconds += FPlatformTime::Seconds() - StartTime;
+				const FGridType* Grid = Handle.grid<nanovdb::Fp4>();
+				check(Grid);
+
+				StartTime = FPlatformTime::Seconds();
+				FVoxelCpuMesher Mesher(*Grid, Stats.Size.X, Stats.Size.Y, Stats.Size.Z, 0.0f);
+				FVoxelCpuMeshData MeshData;
+				Mesher.Generate(MeshData);
+				MeshSeconds += FPlatformTime::Seconds() - StartTime;
+				NumLeaves += Stats.NumLeaves;
+				NumTriangles += MeshData.Indices.Num() / 3;
+			}
+
+			UE_LOG(LogVoxelMesh, Display, TEXT("Surfacing %d particles with the %s kernel, %d frames:"), RestPositions.Num(),
+				Kernel == EVoxelPointKernel::Spheres ? TEXT("spheres") : TEXT("Zhu-Bridson"), NumFrames);
+			UE_LOG(LogVoxelMesh, Display, TEXT("  Level set:  %8.2f ms per frame, %llu leaves"), SurfaceSeconds * 1000.0 / NumFrames, NumLeaves / NumFrames);
+			UE_LOG(LogVoxelMesh, Display, TEXT("  Mesh:       %8.2f ms per frame, %llu triangles"), MeshSeconds * 1000.0 / NumFrames, NumTriangles / NumFrames);
+		}
+	}
+
+	static void BenchmarkRawImport(const TArray<FString>& Args)
+	{
+		const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 16) : 512;
+		const int32 ChunkSize = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 8) : 256;
+
+		// 16-bit densities of a ball with a soft edge, generated slice by slice like a file would be read
+		FVoxelRawVolumeSettings Settings;
+		Settings.Dimensions = FIntVector(Size);
+		Settings.Format = EVoxelRawFormat::UInt16;
+		Settings.IsoValue = 32768.0f;
+		Settings.ChunkSize = ChunkSize;
+		const FVector3f Center(Size * 0.5f);
+		const float Radius = Size * 0.4f;
+		uint32 NumChunks = 0;
+		FVoxelRawVolumeImporter::FStats Stats;
+		const double StartTime = FPlatformTime::Seconds();
+		FVoxelRawVolumeImporter::Import([&](int32 SliceIndex, TArrayView<uint8> OutBytes)
+		{
+			uint16* Values = reinterpret_cast<uint16*>(OutBytes.GetData());
+			for (int32 Y = 0; Y < Size; ++Y)
+			{
+				for (int32 X = 0; X < Size; ++X)
+				{
+					const float Distance = FVector3f::Distance(FVector3f(X, Y, SliceIndex), Center) - Radius;
+					Values[Y * Size + X] = static_cast<uint16>(FMath::Clamp(32768.0f - Distance * 4096.0f, 0.0f, 65535.0f));
+				}
+			}
+			return true;
+		}, Settings, [&NumChunks](const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Grid)
+		{
+			++NumChunks;
+			return true;
+		}, [](int32 NumSlicesRead, int32 NumSlices) { return true; }, &Stats);
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		const double DenseBytes = double(Size) * Size * Size * sizeof(uint16);
+		UE_LOG(LogVoxelMesh, Display, TEXT("Importing a %d^3 16-bit volume in chunks of %d^3 voxels:"), Size, ChunkSize);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Total:      %8.2f ms, %8.2f Mvoxels/s"), Seconds * 1000.0, double(Size) * Size * Size / Seconds * 1e-6);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Read:       %8.2f ms (generating the slices)"), Stats.ReadSeconds * 1000.0);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Convert:    %8.2f ms, %u leaves"), Stats.ConvertSeconds * 1000.0, Stats.NumLeaves);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Encode:     %8.2f ms, %u chunks"), Stats.EncodeSeconds * 1000.0, NumChunks);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Slices:     %8.1f MiB held, the dense volume is %.1f MiB"), Stats.SlabBytes / (1024.0 * 1024.0), DenseBytes / (1024.0 * 1024.0));
+	}
+
+	static void BenchmarkVox(const TArray<FString>& Args)
+	{
+		const int32 Size = Args.Num() > 0 ? FMath::Clamp(FCString::Atoi(*Args[0]), 8, 256) : 128;
+		const int32 NumInstances = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 8;
+
+		// A ball of voxels colored by height, instanced along x with a quarter turn every other instance
+		FVoxelVoxScene Scene;
+		FVoxelVoxScene::FModel& Model = Scene.Models.AddDefaulted_GetRef();
+		Model.Size = FIntVector(Size);
+		const FVector3f Center(Size * 0.5f - 0.5f);
+		for (int32 X = 0; X < Size; ++X)
+		{
+			for (int32 Y = 0; Y < Size; ++Y)
+			{
+				for (int32 Z = 0; Z < Size; ++Z)
+				{
+					if (FVector3f::Distance(FVector3f(X, Y, Z), Center) < Size * 0.45f)
+					{
+						Model.Voxels.Add(FIntVector4(X, Y, Z, 1 + Z * 254 / Size));
+					}
+				}
+			}
+		}
+		for (int32 InstanceIndex = 0; InstanceIndex < NumInstances; ++InstanceIndex)
+		{
+			FVoxelVoxScene::FInstance& Instance = Scene.Instances.AddDefaulted_GetRef();
+			Instance.Translation = FIntVector(InstanceIndex * Size, 0, 0);
+			if (InstanceIndex & 1)
+			{
+				Instance.Rotation[0] = FIntVector(0, -1, 0);
+				Instance.Rotation[1] = FIntVector(1, 0, 0);
+			}
+		}
+
+		FVoxelVoxSettings Settings;
+		FVoxelVoxImporter::FStats Stats;
+		uint64 NumBytes = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		FVoxelVoxImporter::Import(Scene, Settings, [&NumBytes](const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Grid, nanovdb::GridHandle<nanovdb::HostBuffer>&& MaterialGrid)
+		{
+			NumBytes += Grid.size() + MaterialGrid.size();
+			return true;
+		}, [](int32 NumChunksDone, int32 NumChunks) { return true; }, &Stats);
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("Importing %d instances of a %d^3 MagicaVoxel model:"), NumInstances, Size);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Total:      %8.2f ms, %8.2f Mvoxels/s"), Seconds * 1000.0, Stats.NumVoxels / Seconds * 1e-6);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Rasterize:  %8.2f ms, %u voxels"), Stats.RasterizeSeconds * 1000.0, Stats.NumVoxels);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Distance:   %8.2f ms, %u leaves"), Stats.DistanceSeconds * 1000.0, Stats.NumLeaves);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Encode:     %8.2f ms, %u chunks, %.1f MiB with the palette indices"), Stats.EncodeSeconds * 1000.0, Stats.NumChunks, NumBytes / (1024.0 * 1024.0));
+	}
+
+	static void BenchmarkHeightmap(const TArray<FString>& Args)
+	{
+		const int32 Size = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 8) : 4096;
+		const int32 ChunkSize = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 8) : 128;
+
+		// Rolling hills about 80 voxels high, with a landscape z scale of 100
+		FVoxelHeightmapSettings Settings;
+		Settings.ChunkSize = ChunkSize;
+		TArray<uint16> Heights;
+		Heights.SetNumUninitialized(Size * Size);
+		ParallelFor(Size, [&](int32 Y)
+		{
+			for (int32 X = 0; X < Size; ++X)
+			{
+				const float Height = 30.0f * FMath::Sin(X * 0.02f) * FMath::Cos(Y * 0.015f) + 10.0f * FMath::Sin(X * 0.11f + Y * 0.07f);
+				Heights[Y * Size + X] = static_cast<uint16>(32768.0f + Height * Settings.VoxelSize / Settings.HeightScale);
+			}
+		});
+
+		uint64 NumBytes = 0;
+		FVoxelHeightmapConverter::FStats Stats;
+		FVoxelHeightmapConverter::Convert(Heights, FIntPoint(Size), Settings, [&NumBytes](const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Grid)
+		{
+			NumBytes += Grid.size();
+			return true;
+		}, &Stats);
+
+		UE_LOG(LogVoxelMesh, Display, TEXT("Converting a %dx%d heightmap in chunks of %d^3 voxels:"), Size, Size, ChunkSize);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Total:      %8.2f ms, %8.2f Msamples/s"), Stats.Seconds * 1000.0, double(Size) * Size / Stats.Seconds * 1e-6);
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Chunks:     %8u, %.1f MiB"), Stats.NumChunks, NumBytes / (1024.0 * 1024.0));
+		UE_LOG(LogVoxelMesh, Display, TEXT("  Leaves:     %8u, %u tiles below the band"), Stats.NumLeaves, Stats.NumTiles);
+	}
+
+	static FAutoConsoleCommand BenchmarkTraversalCommand(
+		TEXT("voxel.BenchmarkTraversal"),
+		TEXT("Compare row-major and brick/Morton cube traversal on a sphere level set.\n")
+		TEXT("Usage: voxel.BenchmarkTraversal [Size=256]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkTraversal));
+
+	static FAutoConsoleCommand BenchmarkLeafDecodeCommand(
+		TEXT("voxel.BenchmarkLeafDecode"),
+		TEXT("Compare bulk leaf decoding of Fp4/Fp8/Fp16 grids with per-voxel getValue.\n")
+		TEXT("Usage: voxel.BenchmarkLeafDecode [Size=256] [Repeats=8]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkLeafDecode));
+
+	static FAutoConsoleCommand BenchmarkClassifyCommand(
+		TEXT("voxel.BenchmarkClassify"),
+		TEXT("Compare scalar and vectorized marching cubes classification of decoded bricks, and report the CPU mesher throughput.\n")
+		TEXT("Usage: voxel.BenchmarkClassify [Size=128] [Repeats=8]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkClassify));
+
+	static FAutoConsoleCommand CompareMeshersCommand(
+		TEXT("voxel.CompareMeshers"),
+		TEXT("Compare time, vertex and triangle counts and sliver triangles of the marching cubes and surface nets CPU meshers.\n")
+		TEXT("Usage: voxel.CompareMeshers [Size=128]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&CompareMeshers));
+
+	static FAutoConsoleCommand BenchmarkLodsCommand(
+		TEXT("voxel.BenchmarkLods"),
+		TEXT("Build the mip chain of a sphere level set and mesh every level on the CPU.\n")
+		TEXT("Usage: voxel.BenchmarkLods [Size=256]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkLods));
+
+	static FAutoConsoleCommand BenchmarkSectionsCommand(
+		TEXT("voxel.BenchmarkSections"),
+		TEXT("Compare meshing a whole sphere level set with remeshing only the sections touched by a small edit.\n")
+		TEXT("Usage: voxel.BenchmarkSections [Size=256] [EditSize=8]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkSections));
+
+	static FAutoConsoleCommand BenchmarkRebakeCommand(
+		TEXT("voxel.BenchmarkRebake"),
+		TEXT("Carve a sphere level set stroke by stroke through an editable grid and time the rebake to NanoVDB.\n")
+		TEXT("Usage: voxel.BenchmarkRebake [Size=128] [Strokes=16]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkRebake));
+
+	static FAutoConsoleCommand BenchmarkTerrainCommand(
+		TEXT("voxel.BenchmarkTerrain"),
+		TEXT("Generate columns of procedural terrain chunks and report the throughput per core and the leaves skipped by the Lipschitz bound.\n")
+		TEXT("Usage: voxel.BenchmarkTerrain [ChunkSize=128] [ChunksPerAxis=4]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkTerrain));
+
+	static FAutoConsoleCommand BenchmarkVoxelizerCommand(
+		TEXT("voxel.BenchmarkVoxelizer"),
+		TEXT("Voxelize a triangulated sphere and compare the level set with the analytic one.\n")
+		TEXT("Usage: voxel.BenchmarkVoxelizer [Rings=512] [Size=128]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkVoxelizer));
+
+	static FAutoConsoleCommand BenchmarkPointsCommand(
+		TEXT("voxel.BenchmarkPoints"),
+		TEXT("Surface a moving block of particles into a level set and mesh it every frame, with both kernels.\n")
+		TEXT("Usage: voxel.BenchmarkPoints [NumPoints=200000] [Frames=8]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkPoints));
+
+	static FAutoConsoleCommand BenchmarkRawImportCommand(
+		TEXT("voxel.BenchmarkRawImport"),
+		TEXT("Stream a generated dense volume through the raw importer and report the throughput and the memory held.\n")
+		TEXT("Usage: voxel.BenchmarkRawImport [Size=512] [ChunkSize=256]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkRawImport));
+
+	static FAutoConsoleCommand BenchmarkVoxCommand(
+		TEXT("voxel.BenchmarkVox"),
+		TEXT("Convert instances of a generated MagicaVoxel model to chunked level sets with their palette indices.\n")
+		TEXT("Usage: voxel.BenchmarkVox [Size=128] [Instances=8]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkVox));
+
+	static FAutoConsoleCommand BenchmarkHeightmapCommand(
+		TEXT("voxel.BenchmarkHeightmap"),
+		TEXT("Convert a generated heightmap to chunked level sets and report the throughput.\n")
+		TEXT("Usage: voxel.BenchmarkHeightmap [Size=4096] [ChunkSize=128]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkHeightmap));
+}
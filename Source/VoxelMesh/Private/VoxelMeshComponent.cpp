@@ -9,6 +9,28 @@
 #include "Materials/MaterialRenderProxy.h"
 
 
+UVoxelMeshProxyComponent::UVoxelMeshProxyComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	bTickInEditor = true;
+}
+
+void UVoxelMeshProxyComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// Follow the level of detail requested by the views, once the previous mesh is done
+	if (IsValid(ChunkViewAsset))
+	{
+		const TSharedPtr<FVoxelChunkViewRHIProxy> RHIProxy = ChunkViewAsset->GetRHIProxy();
+		if (RHIProxy && RHIProxy->IsReady() && !RHIProxy->IsGenerating())
+		{
+			ChunkViewAsset->SetLodIndex(RHIProxy->DesiredLodIndex.load(std::memory_order_relaxed));
+		}
+	}
+}
+
 bool UVoxelMeshProxyComponent::ShouldCreateRenderState() const
 {
 	const bool bIsCPUResourceValid = IsValid(ChunkViewAsset) && !ChunkViewAsset->IsEmpty();
@@ -31,8 +53,9 @@ void UVoxelMeshProxyComponent::CreateRenderState_Concurrent(FRegisterComponentCo
 
 FBoxSphereBounds UVoxelMeshProxyComponent::CalcBounds(const FTransform& LocalToWorld) const
 {
-	const FBoxSphereBounds StaticBounds(FVector(0, 0, 0), FVector(30.f, 30.f, 30.f), 30.f);
-	return StaticBounds.TransformBy(LocalToWorld);
+	// Screen sizes of the levels of detail are measured on these bounds
+	const FBox LocalBounds = IsValid(ChunkViewAsset) ? ChunkViewAsset->GetLocalBounds() : FBox(FVector(-0.5), FVector(0.5));
+	return FBoxSphereBounds(LocalBounds).TransformBy(LocalToWorld);
 }
 
 FPrimitiveSceneProxy* UVoxelMeshProxyComponent::CreateSceneProxy()
@@ -52,19 +75,26 @@ void UVoxelMeshProxyComponent::UpdateChunkViewAsset(UVoxelChunkView* InAsset)
 	{
 		ChunkViewAsset->OnBuildFinished.AddUObject(this, &UVoxelMeshProxyComponent::OnVoxelMeshReady);
 	}
+	UpdateBounds();
+	MarkRenderTransformDirty();
 	MarkRenderStateDirty();
 }
 
 void UVoxelMeshProxyComponent::OnVoxelMeshReady()
 {
+	// The size of the grid or its neighbours may have changed with the mesh
 	if (IsInGameThread())
 	{
+		UpdateBounds();
+		MarkRenderTransformDirty();
 		MarkRenderStateDirty();
 	}
 	else
 	{
 		AsyncTask(ENamedThreads::GameThread, [this]()
 		{
+			UpdateBounds();
+			MarkRenderTransformDirty();
 			MarkRenderStateDirty();
 		});
 	}
@@ -124,12 +154,20 @@ void FVoxelChunkPrimitiveSceneProxy::GetDynamicMeshElements(const TArray<const F
 	
 	QUICK_SCOPE_CYCLE_COUNTER(STAT_FVoxelChunkPrimitiveSceneProxy_GetMeshElements);
 
+	int32 DesiredLodIndex = INT32_MAX;
+	float MaxScreenSize = 0.0f;
+
 	for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ++ViewIndex)
 	{
 		if (VisibilityMap & (1 << ViewIndex))
 		{
 			const FSceneView* View = Views[ViewIndex];
 			const FSceneViewFamily& ViewSpecificFamily = *View->Family;
+
+			const float ScreenSize = ComputeBoundsScreenSize(GetBounds().Origin, GetBounds().SphereRadius, *View);
+			DesiredLodIndex = FMath::Min(DesiredLodIndex, RHIProxy->ComputeLodIndex(ScreenSize));
+			MaxScreenSize = FMath::Max(MaxScreenSize, ScreenSize);
+
 			const bool bIsWireframe = ViewSpecificFamily.EngineShowFlags.Wireframe;
 
 			FMeshBatch& MeshBatch = Collector.AllocateMesh();
@@ -185,6 +223,14 @@ void FVoxelChunkPrimitiveSceneProxy::GetDynamicMeshElements(const TArray<const F
 			// PDI->DrawMesh(MeshBatch);
 		}
 	}
+
+	// Picked up by UVoxelMeshProxyComponent::TickComponent, the finest level wins when several views draw the chunk
+	if (DesiredLodIndex != INT32_MAX)
+	{
+		RHIProxy->DesiredLodIndex.store(DesiredLodIndex, std::memory_order_relaxed);
+		// Priority of the next rebuild, see FVoxelMeshRebuildScheduler
+		RHIProxy->ScreenSize.store(MaxScreenSize, std::memory_order_relaxed);
+	}
 }
 
 FPrimitiveViewRelevance FVoxelChunkPrimitiveSceneProxy::GetViewRelevance(const FSceneView* View) const
@@ -202,7 +248,7 @@ FPrimitiveViewRelevance FVoxelChunkPrimitiveSceneProxy::GetViewRelevance(const F
 
 void FVoxelChunkPrimitiveSceneProxy::TryInitialize() const
 {
-	TSharedPtr<FVoxelChunkViewRHIProxy> RHIProxy = VoxelMeshProxyComponent->ChunkViewAsset->GetRHIProxy();
+	RHIProxy = VoxelMeshProxyComponent->ChunkViewAsset->GetRHIProxy();
 	if (RHIProxy->IsReady())
 	{
 		NumVertices = RHIProxy->MeshVertexBuffer->GetSize() / sizeof(FVector4f);
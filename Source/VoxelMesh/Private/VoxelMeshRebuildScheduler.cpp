@@ -0,0 +1,269 @@
+﻿#include "VoxelMeshRebuildScheduler.h"
+
+#include "VoxelChunkView.h"
+#include "VoxelMeshLog.h"
+#include "Async/Async.h"
+
+DECLARE_STATS_GROUP(TEXT("Voxel Rebuild"), STATGROUP_VoxelRebuild, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Queued rebuilds"), STAT_VoxelRebuildQueued, STATGROUP_VoxelRebuild);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Coalesced rebuilds"), STAT_VoxelRebuildCoalesced, STATGROUP_VoxelRebuild);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Started rebuilds"), STAT_VoxelRebuildStarted, STATGROUP_VoxelRebuild);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred rebuilds"), STAT_VoxelRebuildDeferred, STATGROUP_VoxelRebuild);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rebuilds in flight"), STAT_VoxelRebuildInFlight, STATGROUP_VoxelRebuild);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Discarded rebuilds"), STAT_VoxelRebuildDiscarded, STATGROUP_VoxelRebuild);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Started cost (ms)"), STAT_VoxelRebuildStartedMs, STATGROUP_VoxelRebuild);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Max wait (s)"), STAT_VoxelRebuildMaxWait, STATGROUP_VoxelRebuild);
+
+static TAutoConsoleVariable<float> CVarVoxelRebuildBudgetMs(
+	TEXT("voxel.Rebuild.BudgetMs"),
+	4.0f,
+	TEXT("Estimated milliseconds of mesh rebuilds started per frame, at least one is started every frame.\n")
+	TEXT("0 or less: start every rebuild as soon as it is requested\n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarVoxelRebuildAgingPerSecond(
+	TEXT("voxel.Rebuild.AgingPerSecond"),
+	1.0f,
+	TEXT("Priority gained by a queued mesh rebuild per second of waiting"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarVoxelRebuildDistanceScale(
+	TEXT("voxel.Rebuild.DistanceScale"),
+	10000.0f,
+	TEXT("Distance at which the distance term of the rebuild priority is halved, in world units"),
+	ECVF_Default);
+
+/// A rebuild dropped by the proxy, because another path was generating, never reports back
+static constexpr double InFlightTimeoutSeconds = 10.0;
+
+FVoxelMeshRebuildScheduler& FVoxelMeshRebuildScheduler::Get()
+{
+	static FVoxelMeshRebuildScheduler Scheduler;
+	return Scheduler;
+}
+
+FVoxelMeshRebuildScheduler::FVoxelMeshRebuildScheduler()
+{
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([this](float)
+	{
+		Tick();
+		return true;
+	}));
+}
+
+void FVoxelMeshRebuildScheduler::Shutdown()
+{
+	check(IsInGameThread());
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+	Requests.Empty();
+	InFlight.Empty();
+}
+
+void FVoxelMeshRebuildScheduler::Request(UVoxelChunkView* View, float Urgency, float Distance)
+{
+	// Render states are created concurrently, the chunk is only looked at on the game thread
+	if (!IsInGameThread())
+	{
+		AsyncTask(ENamedThreads::GameThread, [WeakView = TWeakObjectPtr<UVoxelChunkView>(View), Urgency, Distance]
+		{
+			Get().Request(WeakView.Get(), Urgency, Distance);
+		});
+		return;
+	}
+
+	if (!IsValid(View))
+	{
+		return;
+	}
+
+	if (CVarVoxelRebuildBudgetMs.GetValueOnGameThread() <= 0.0f)
+	{
+		if (const TSharedPtr<FVoxelChunkViewRHIProxy> Proxy = View->GetRHIProxy())
+		{
+			Proxy->RegenerateMesh();
+		}
+		return;
+	}
+
+	// The result of a rebuild in flight is outdated, it is dropped and this request runs once it reports back
+	if (const TSharedPtr<FVoxelChunkViewRHIProxy> Proxy = View->GetRHIProxy(); Proxy && Proxy->IsGenerating())
+	{
+		Proxy->CancelGeneration();
+	}
+
+	if (FRequest* Existing = Requests.Find(View))
+	{
+		// The merged request keeps its place in the queue
+		Existing->Urgency = FMath::Max(Existing->Urgency, Urgency);
+		if (Distance >= 0.0f)
+		{
+			Existing->Distance = Existing->Distance >= 0.0f ? FMath::Min(Existing->Distance, Distance) : Distance;
+		}
+		++Stats.NumCoalesced;
+		return;
+	}
+	Requests.Add(View, FRequest{ FPlatformTime::Seconds(), Urgency, Distance });
+}
+
+void FVoxelMeshRebuildScheduler::Tick()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelMeshRebuildScheduler::Tick);
+	check(IsInGameThread());
+	StartRebuilds(CVarVoxelRebuildBudgetMs.GetValueOnGameThread());
+}
+
+void FVoxelMeshRebuildScheduler::Flush()
+{
+	check(IsInGameThread());
+	StartRebuilds(TNumericLimits<float>::Max());
+}
+
+const FVoxelMeshRebuildScheduler::FStats& FVoxelMeshRebuildScheduler::GetStats() const
+{
+	return Stats;
+}
+
+void FVoxelMeshRebuildScheduler::StartRebuilds(float BudgetMs)
+{
+	const double Now = FPlatformTime::Seconds();
+	UpdateInFlight(Now);
+
+	const float AgingPerSecond = CVarVoxelRebuildAgingPerSecond.GetValueOnGameThread();
+	const float DistanceScale = FMath::Max(CVarVoxelRebuildDistanceScale.GetValueOnGameThread(), UE_SMALL_NUMBER);
+
+	struct FCandidate
+	{
+		TWeakObjectPtr<UVoxelChunkView> View;
+		double RequestTime;
+		float Priority;
+	};
+	TArray<FCandidate> Candidates;
+	Candidates.Reserve(Requests.Num());
+	for (auto It = Requests.CreateIterator(); It; ++It)
+	{
+		UVoxelChunkView* View = It.Key().Get();
+		const TSharedPtr<FVoxelChunkViewRHIProxy> Proxy = View ? View->GetRHIProxy() : nullptr;
+		if (!Proxy)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+		const FRequest& Request = It.Value();
+		const float DistanceTerm = Request.Distance >= 0.0f ? 1.0f / (1.0f + Request.Distance / DistanceScale) : 0.0f;
+		const float Priority = Request.Urgency + Proxy->ScreenSize.load(std::memory_order_relaxed) + DistanceTerm
+			+ AgingPerSecond * static_cast<float>(Now - Request.RequestTime);
+		Candidates.Add(FCandidate{ It.Key(), Request.RequestTime, Priority });
+	}
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.Priority > B.Priority; });
+
+	int32 NumStarted = 0;
+	int32 NumDeferred = 0;
+	float StartedMs = 0.0f;
+	float MaxWaitSeconds = 0.0f;
+	for (const FCandidate& Candidate : Candidates)
+	{
+		UVoxelChunkView* View = Candidate.View.Get();
+		const TSharedPtr<FVoxelChunkViewRHIProxy> Proxy = View ? View->GetRHIProxy() : nullptr;
+		if (!Proxy)
+		{
+			continue;
+		}
+		// A rebuild requested while generating would be dropped by the proxy, wait for the current one instead
+		if (InFlight.Contains(Candidate.View) || Proxy->IsGenerating())
+		{
+			++NumDeferred;
+			continue;
+		}
+
+		const uint64 NumVoxels = GetNumVoxels(*Proxy, View->GetLodIndex());
+		const float Estimate = EstimateMs(*Proxy, NumVoxels);
+		if (NumStarted > 0 && StartedMs + Estimate > BudgetMs)
+		{
+			break;
+		}
+
+		Requests.Remove(Candidate.View);
+		InFlight.Add(Candidate.View, FInFlight{ Proxy, Now, NumVoxels, Proxy->NumBuilds.load(std::memory_order_acquire) });
+		Proxy->RegenerateMesh();
+
+		++NumStarted;
+		StartedMs += Estimate;
+		MaxWaitSeconds = FMath::Max(MaxWaitSeconds, static_cast<float>(Now - Candidate.RequestTime));
+	}
+
+	Stats.NumQueued = Requests.Num();
+	Stats.NumStarted = NumStarted;
+	Stats.NumDeferred = NumDeferred;
+	Stats.NumInFlight = InFlight.Num();
+	Stats.NumDiscarded = NumDiscarded;
+	Stats.StartedMs = StartedMs;
+	Stats.MaxWaitSeconds = MaxWaitSeconds;
+	Stats.MsPerMillionVoxels = static_cast<float>(MsPerVoxel * 1.0e6);
+	Stats.TotalStarted += NumStarted;
+
+	SET_DWORD_STAT(STAT_VoxelRebuildQueued, Stats.NumQueued);
+	SET_DWORD_STAT(STAT_VoxelRebuildCoalesced, Stats.NumCoalesced);
+	SET_DWORD_STAT(STAT_VoxelRebuildStarted, Stats.NumStarted);
+	SET_DWORD_STAT(STAT_VoxelRebuildDeferred, Stats.NumDeferred);
+	SET_DWORD_STAT(STAT_VoxelRebuildInFlight, Stats.NumInFlight);
+	SET_DWORD_STAT(STAT_VoxelRebuildDiscarded, Stats.NumDiscarded);
+	SET_FLOAT_STAT(STAT_VoxelRebuildStartedMs, Stats.StartedMs);
+	SET_FLOAT_STAT(STAT_VoxelRebuildMaxWait, Stats.MaxWaitSeconds);
+	Stats.NumCoalesced = 0;
+}
+
+void FVoxelMeshRebuildScheduler::UpdateInFlight(double Now)
+{
+	NumDiscarded = 0;
+	for (auto It = InFlight.CreateIterator(); It; ++It)
+	{
+		const FInFlight& Build = It.Value();
+		const TSharedPtr<FVoxelChunkViewRHIProxy> Proxy = Build.Proxy.Pin();
+		if (!Proxy)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+		if (Proxy->NumBuilds.load(std::memory_order_acquire) == Build.NumBuilds || Proxy->IsGenerating())
+		{
+			if (Now - Build.StartTime > InFlightTimeoutSeconds)
+			{
+				UE_LOG(LogVoxelMesh, Verbose, TEXT("Rebuild of %s never reported back"), *GetNameSafe(It.Key().Get()));
+				It.RemoveCurrent();
+			}
+			continue;
+		}
+
+		const float BuildMs = Proxy->LastBuildMs.load(std::memory_order_relaxed);
+		if (BuildMs > 0.0f)
+		{
+			const double PerVoxel = BuildMs / static_cast<double>(FMath::Max<uint64>(Build.NumVoxels, 1));
+			Proxy->BuildMsPerVoxel = PerVoxel;
+			MsPerVoxel = FMath::Lerp(MsPerVoxel, PerVoxel, 0.1);
+		}
+		else
+		{
+			// Superseded by a newer request
+			++NumDiscarded;
+		}
+		It.RemoveCurrent();
+	}
+}
+
+float FVoxelMeshRebuildScheduler::EstimateMs(const FVoxelChunkViewRHIProxy& Proxy, uint64 NumVoxels) const
+{
+	const double PerVoxel = Proxy.BuildMsPerVoxel > 0.0 ? Proxy.BuildMsPerVoxel : MsPerVoxel;
+	return static_cast<float>(PerVoxel * NumVoxels);
+}
+
+uint64 FVoxelMeshRebuildScheduler::GetNumVoxels(const FVoxelChunkViewRHIProxy& Proxy, int32 InLodIndex)
+{
+	// VoxelSizeX/Y/Z follow the level being generated and are written off the game thread, the base size never changes
+	const int32 Shift = FMath::Clamp(InLodIndex, 0, 30);
+	const FIntVector& Size = Proxy.BaseVoxelSize;
+	return static_cast<uint64>(FMath::Max(Size.X >> Shift, 1)) * FMath::Max(Size.Y >> Shift, 1) * FMath::Max(Size.Z >> Shift, 1);
+}
@@ -0,0 +1,86 @@
+﻿#include "VoxelMeshSectionLayout.h"
+
+#include "VoxelCpuMesher.h"
+
+FVoxelMeshSectionLayout::FVoxelMeshSectionLayout(const FIntVector& InNumCells)
+	: NumCells(InNumCells)
+	, SectionCount(
+		FMath::Max(FMath::DivideAndRoundUp(InNumCells.X, SectionDim), 1),
+		FMath::Max(FMath::DivideAndRoundUp(InNumCells.Y, SectionDim), 1),
+		FMath::Max(FMath::DivideAndRoundUp(InNumCells.Z, SectionDim), 1))
+{
+	Sections.SetNum(GetNumSections());
+}
+
+void FVoxelMeshSectionLayout::GetSectionCells(int32 SectionIndex, FIntVector& OutCellMin, FIntVector& OutCellMax) const
+{
+	OutCellMin = GetSectionCoord(SectionIndex) * SectionDim;
+	OutCellMax = FIntVector(
+		FMath::Min(OutCellMin.X + SectionDim, NumCells.X),
+		FMath::Min(OutCellMin.Y + SectionDim, NumCells.Y),
+		FMath::Min(OutCellMin.Z + SectionDim, NumCells.Z));
+}
+
+void FVoxelMeshSectionLayout::GetSectionsUsingVoxels(const FIntVector& MinVoxel, const FIntVector& MaxVoxel, TArray<int32>& OutSections) const
+{
+	// Cell c reads voxels c and c + 1
+	FIntVector SectionMin;
+	FIntVector SectionMax;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		SectionMin[Axis] = FMath::Clamp((MinVoxel[Axis] - 1) / SectionDim, 0, SectionCount[Axis] - 1);
+		SectionMax[Axis] = FMath::Clamp(MaxVoxel[Axis] / SectionDim, 0, SectionCount[Axis] - 1);
+	}
+
+	for (int32 X = SectionMin.X; X <= SectionMax.X; ++X)
+	{
+		for (int32 Y = SectionMin.Y; Y <= SectionMax.Y; ++Y)
+		{
+			for (int32 Z = SectionMin.Z; Z <= SectionMax.Z; ++Z)
+			{
+				OutSections.AddUnique(Z + SectionCount.Z * (Y + SectionCount.Y * X));
+			}
+		}
+	}
+}
+
+void FVoxelMeshSectionLayout::Allocate(TConstArrayView<FVoxelCpuMeshData> SectionMeshes)
+{
+	check(SectionMeshes.Num() == Sections.Num());
+	NumVertices = 0;
+	NumIndices = 0;
+	for (int32 SectionIndex = 0; SectionIndex < Sections.Num(); ++SectionIndex)
+	{
+		// A quarter more than needed, and enough for a small edit in an empty section
+		const FVoxelCpuMeshData& SectionMesh = SectionMeshes[SectionIndex];
+		FSection& Section = Sections[SectionIndex];
+		Section.FirstVertex = NumVertices;
+		Section.VertexCapacity = SectionMesh.Vertices.Num() + SectionMesh.Vertices.Num() / 4 + 64;
+		Section.FirstIndex = NumIndices;
+		Section.IndexCapacity = SectionMesh.Indices.Num() + (SectionMesh.Indices.Num() / 12) * 3 + 3 * 128;
+		NumVertices += Section.VertexCapacity;
+		NumIndices += Section.IndexCapacity;
+	}
+}
+
+bool FVoxelMeshSectionLayout::Fits(int32 SectionIndex, const FVoxelCpuMeshData& SectionMesh) const
+{
+	const FSection& Section = Sections[SectionIndex];
+	return static_cast<uint32>(SectionMesh.Vertices.Num()) <= Section.VertexCapacity && static_cast<uint32>(SectionMesh.Indices.Num()) <= Section.IndexCapacity;
+}
+
+void FVoxelMeshSectionLayout::WriteSection(int32 SectionIndex, const FVoxelCpuMeshData& SectionMesh, FVector4f* OutVertices, uint32* OutIndices) const
+{
+	check(Fits(SectionIndex, SectionMesh));
+	const FSection& Section = Sections[SectionIndex];
+	FMemory::Memcpy(OutVertices, SectionMesh.Vertices.GetData(), SectionMesh.Vertices.NumBytes());
+	FMemory::Memzero(OutVertices + SectionMesh.Vertices.Num(), (Section.VertexCapacity - SectionMesh.Vertices.Num()) * sizeof(FVector4f));
+	for (int32 Index = 0; Index < SectionMesh.Indices.Num(); ++Index)
+	{
+		OutIndices[Index] = Section.FirstVertex + SectionMesh.Indices[Index];
+	}
+	for (uint32 Index = SectionMesh.Indices.Num(); Index < Section.IndexCapacity; ++Index)
+	{
+		OutIndices[Index] = Section.FirstVertex;
+	}
+}
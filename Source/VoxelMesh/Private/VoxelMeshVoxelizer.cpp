@@ -0,0 +1,465 @@
+﻿#include "VoxelMeshVoxelizer.h"
+
+#include "Async/ParallelFor.h"
+#include "Engine/StaticMesh.h"
+#include "StaticMeshResources.h"
+#include "VoxelChunkGrid.h"
+#include "VoxelMeshLog.h"
+
+namespace VoxelMeshVoxelizer
+{
+	static constexpr uint32 MaxLeafTriangles = 4;
+	/// Nodes further than this many radii use their dipole for the winding number
+	static constexpr float FarFieldRatio = 2.0f;
+
+	/// Real-Time Collision Detection, 5.1.5
+	static FORCEINLINE FVector3f ClosestPointOnTriangle(const FVector3f& P, const FVector3f& A, const FVector3f& B, const FVector3f& C)
+	{
+		const FVector3f AB = B - A;
+		const FVector3f AC = C - A;
+		const FVector3f AP = P - A;
+		const float D1 = AB | AP;
+		const float D2 = AC | AP;
+		if (D1 <= 0.0f && D2 <= 0.0f)
+		{
+			return A;
+		}
+
+		const FVector3f BP = P - B;
+		const float D3 = AB | BP;
+		const float D4 = AC | BP;
+		if (D3 >= 0.0f && D4 <= D3)
+		{
+			return B;
+		}
+
+		const float VC = D1 * D4 - D3 * D2;
+		if (VC <= 0.0f && D1 >= 0.0f && D3 <= 0.0f)
+		{
+			return A + AB * (D1 / (D1 - D3));
+		}
+
+		const FVector3f CP = P - C;
+		const float D5 = AB | CP;
+		const float D6 = AC | CP;
+		if (D6 >= 0.0f && D5 <= D6)
+		{
+			return C;
+		}
+
+		const float VB = D5 * D2 - D1 * D6;
+		if (VB <= 0.0f && D2 >= 0.0f && D6 <= 0.0f)
+		{
+			return A + AC * (D2 / (D2 - D6));
+		}
+
+		const float VA = D3 * D6 - D5 * D4;
+		if (VA <= 0.0f && D4 - D3 >= 0.0f && D5 - D6 >= 0.0f)
+		{
+			return B + (C - B) * ((D4 - D3) / ((D4 - D3) + (D5 - D6)));
+		}
+
+		const float Denominator = 1.0f / (VA + VB + VC);
+		return A + AB * (VB * Denominator) + AC * (VC * Denominator);
+	}
+
+	/// Van Oosterom and Strackee, positive when Position is behind the triangle
+	static FORCEINLINE float SolidAngle(const FVector3f& A, const FVector3f& B, const FVector3f& C)
+	{
+		const float LengthA = A.Size();
+		const float LengthB = B.Size();
+		const float LengthC = C.Size();
+		const float Numerator = A | (B ^ C);
+		const float Denominator = LengthA * LengthB * LengthC + (A | B) * LengthC + (B | C) * LengthA + (C | A) * LengthB;
+		return 2.0f * FMath::Atan2(Numerator, Denominator);
+	}
+
+	static FORCEINLINE float BoxDistanceSquared(const FBox3f& Box, const FVector3f& Position)
+	{
+		return Box.ComputeSquaredDistanceToPoint(Position);
+	}
+}
+
+FVoxelMeshVoxelizer::FVoxelMeshVoxelizer(TConstArrayView<FVector3f> Positions, TConstArrayView<uint32> Indices)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelMeshVoxelizer::FVoxelMeshVoxelizer);
+	const int32 NumInputTriangles = Indices.Num() / 3;
+	Triangles.Reserve(NumInputTriangles);
+	for (int32 Triangle = 0; Triangle < NumInputTriangles; ++Triangle)
+	{
+		const FTriangle NewTriangle{Positions[Indices[3 * Triangle]], Positions[Indices[3 * Triangle + 1]], Positions[Indices[3 * Triangle + 2]]};
+		if (((NewTriangle.B - NewTriangle.A) ^ (NewTriangle.C - NewTriangle.A)).SizeSquared() > UE_SMALL_NUMBER * UE_SMALL_NUMBER)
+		{
+			Triangles.Add(NewTriangle);
+		}
+	}
+	if (Triangles.IsEmpty())
+	{
+		return;
+	}
+
+	TArray<FVector3f> Centroids;
+	Centroids.SetNumUninitialized(Triangles.Num());
+	for (int32 Triangle = 0; Triangle < Triangles.Num(); ++Triangle)
+	{
+		Centroids[Triangle] = (Triangles[Triangle].A + Triangles[Triangle].B + Triangles[Triangle].C) / 3.0f;
+	}
+	Nodes.Reserve(2 * Triangles.Num() / VoxelMeshVoxelizer::MaxLeafTriangles + 1);
+	BuildNode(0, Triangles.Num(), Centroids, 0);
+}
+
+uint32 FVoxelMeshVoxelizer::BuildNode(uint32 FirstTriangle, uint32 NumNodeTriangles, TArray<FVector3f>& Centroids, int32 Depth)
+{
+	const uint32 NodeIndex = Nodes.AddUninitialized();
+	FBox3f Bounds(ForceInit);
+	FBox3f CentroidBounds(ForceInit);
+	FVector3f AreaNormal = FVector3f::ZeroVector;
+	FVector3f Center = FVector3f::ZeroVector;
+	float Area = 0.0f;
+	for (uint32 Triangle = FirstTriangle; Triangle < FirstTriangle + NumNodeTriangles; ++Triangle)
+	{
+		const FTriangle& Tri = Triangles[Triangle];
+		Bounds += Tri.A;
+		Bounds += Tri.B;
+		Bounds += Tri.C;
+		CentroidBounds += Centroids[Triangle];
+		const FVector3f TriangleAreaNormal = ((Tri.B - Tri.A) ^ (Tri.C - Tri.A)) * 0.5f;
+		const float TriangleArea = TriangleAreaNormal.Size();
+		AreaNormal += TriangleAreaNormal;
+		Center += Centroids[Triangle] * TriangleArea;
+		Area += TriangleArea;
+	}
+	Center = Area > 0.0f ? Center / Area : Bounds.GetCenter();
+
+	FNode& Node = Nodes[NodeIndex];
+	Node.Bounds = Bounds;
+	Node.AreaNormal = AreaNormal;
+	Node.Center = Center;
+	Node.Radius = FMath::Max((Bounds.Min - Center).GetAbs().ComponentMax((Bounds.Max - Center).GetAbs()).Size(), UE_SMALL_NUMBER);
+	if (NumNodeTriangles <= VoxelMeshVoxelizer::MaxLeafTriangles)
+	{
+		Node.Index = FirstTriangle;
+		Node.NumTriangles = NumNodeTriangles;
+		return NodeIndex;
+	}
+
+	// Split the centroids at the middle of their longest axis, or in two halves when that leaves a side empty
+	const FVector3f Extent = CentroidBounds.GetExtent();
+	const int32 Axis = Extent.X >= Extent.Y && Extent.X >= Extent.Z ? 0 : (Extent.Y >= Extent.Z ? 1 : 2);
+	const float Middle = CentroidBounds.GetCenter()[Axis];
+	uint32 NumLeft = 0;
+	if (Depth < 64)
+	{
+		uint32 Begin = FirstTriangle;
+		uint32 End = FirstTriangle + NumNodeTriangles;
+		while (Begin < End)
+		{
+			if (Centroids[Begin][Axis] < Middle)
+			{
+				++Begin;
+			}
+			else
+			{
+				--End;
+				Swap(Centroids[Begin], Centroids[End]);
+				Swap(Triangles[Begin], Triangles[End]);
+			}
+		}
+		NumLeft = Begin - FirstTriangle;
+	}
+	if (NumLeft == 0 || NumLeft == NumNodeTriangles)
+	{
+		NumLeft = NumNodeTriangles / 2;
+	}
+
+	BuildNode(FirstTriangle, NumLeft, Centroids, Depth + 1);
+	const uint32 RightIndex = BuildNode(FirstTriangle + NumLeft, NumNodeTriangles - NumLeft, Centroids, Depth + 1);
+	Nodes[NodeIndex].Index = RightIndex;
+	Nodes[NodeIndex].NumTriangles = 0;
+	return NodeIndex;
+}
+
+float FVoxelMeshVoxelizer::GetDistanceSquared(const FVector3f& Position, float MaxDistanceSquared) const
+{
+	using namespace VoxelMeshVoxelizer;
+	float BestDistanceSquared = MaxDistanceSquared;
+	if (Nodes.IsEmpty())
+	{
+		return BestDistanceSquared;
+	}
+
+	TArray<uint32, TInlineAllocator<64>> Stack;
+	Stack.Add(0);
+	while (!Stack.IsEmpty())
+	{
+		const FNode& Node = Nodes[Stack.Pop(EAllowShrinking::No)];
+		if (BoxDistanceSquared(Node.Bounds, Position) >= BestDistanceSquared)
+		{
+			continue;
+		}
+		if (Node.NumTriangles > 0)
+		{
+			for (uint32 Triangle = Node.Index; Triangle < Node.Index + Node.NumTriangles; ++Triangle)
+			{
+				const FTriangle& Tri = Triangles[Triangle];
+				BestDistanceSquared = FMath::Min(BestDistanceSquared, (ClosestPointOnTriangle(Position, Tri.A, Tri.B, Tri.C) - Position).SizeSquared());
+			}
+			continue;
+		}
+
+		// The nearest child is popped first
+		const uint32 LeftIndex = static_cast<uint32>(&Node - Nodes.GetData()) + 1;
+		const bool bLeftFirst = BoxDistanceSquared(Nodes[LeftIndex].Bounds, Position) <= BoxDistanceSquared(Nodes[Node.Index].Bounds, Position);
+		Stack.Add(bLeftFirst ? Node.Index : LeftIndex);
+		Stack.Add(bLeftFirst ? LeftIndex : Node.Index);
+	}
+	return BestDistanceSquared;
+}
+
+float FVoxelMeshVoxelizer::GetWindingNumber(const FVector3f& Position) const
+{
+	using namespace VoxelMeshVoxelizer;
+	if (Nodes.IsEmpty())
+	{
+		return 0.0f;
+	}
+
+	float SolidAngleSum = 0.0f;
+	TArray<uint32, TInlineAllocator<64>> Stack;
+	Stack.Add(0);
+	while (!Stack.IsEmpty())
+	{
+		const uint32 NodeIndex = Stack.Pop(EAllowShrinking::No);
+		const FNode& Node = Nodes[NodeIndex];
+		const FVector3f ToCenter = Node.Center - Position;
+		const float DistanceSquared = ToCenter.SizeSquared();
+		if (DistanceSquared > FMath::Square(FarFieldRatio * Node.Radius))
+		{
+			SolidAngleSum += (Node.AreaNormal | ToCenter) / (DistanceSquared * FMath::Sqrt(DistanceSquared));
+			continue;
+		}
+		if (Node.NumTriangles > 0)
+		{
+			for (uint32 Triangle = Node.Index; Triangle < Node.Index + Node.NumTriangles; ++Triangle)
+			{
+				const FTriangle& Tri = Triangles[Triangle];
+				SolidAngleSum += SolidAngle(Tri.A - Position, Tri.B - Position, Tri.C - Position);
+			}
+			continue;
+		}
+		Stack.Add(NodeIndex + 1);
+		Stack.Add(Node.Index);
+	}
+	return SolidAngleSum / (4.0f * UE_PI);
+}
+
+nanovdb::GridHandle<nanovdb::HostBuffer> FVoxelMeshVoxelizer::Voxelize(float VoxelSize, float BandWidth, FStats* OutStats, TFunctionRef<bool()> IsCancelled) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelMeshVoxelizer::Voxelize);
+	using namespace VoxelMeshVoxelizer;
+	if (Nodes.IsEmpty() || VoxelSize <= 0.0f)
+	{
+		return {};
+	}
+
+	// Index space starts a band before the mesh
+	const float Background = BandWidth * VoxelSize;
+	const int32 Padding = FMath::CeilToInt32(BandWidth) + 1;
+	const FBox3f& Bounds = Nodes[0].Bounds;
+	const FIntVector Origin(
+		FMath::FloorToInt32(Bounds.Min.X / VoxelSize) - Padding,
+		FMath::FloorToInt32(Bounds.Min.Y / VoxelSize) - Padding,
+		FMath::FloorToInt32(Bounds.Min.Z / VoxelSize) - Padding);
+	const FIntVector Size(
+		FMath::CeilToInt32(Bounds.Max.X / VoxelSize) + Padding - Origin.X + 1,
+		FMath::CeilToInt32(Bounds.Max.Y / VoxelSize) + Padding - Origin.Y + 1,
+		FMath::CeilToInt32(Bounds.Max.Z / VoxelSize) + Padding - Origin.Z + 1);
+	const FIntVector LeafCount(FMath::DivideAndRoundUp(Size.X, 8), FMath::DivideAndRoundUp(Size.Y, 8), FMath::DivideAndRoundUp(Size.Z, 8));
+	const int32 NumLeaves = LeafCount.X * LeafCount.Y * LeafCount.Z;
+	auto GetPosition = [&](const FIntVector& Coord)
+	{
+		return FVector3f(Coord + Origin) * VoxelSize;
+	};
+
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<FBuildLeaf*> Leaves;
+	Leaves.SetNumZeroed(NumLeaves);
+	TArray<uint8> Inside;
+	Inside.SetNumZeroed(NumLeaves);
+	ParallelFor(NumLeaves, [&](int32 LeafIndex)
+	{
+		if (IsCancelled())
+		{
+			return;
+		}
+		const FIntVector LeafOrigin = FIntVector(LeafIndex / (LeafCount.Y * LeafCount.Z), (LeafIndex / LeafCount.Z) % LeafCount.Y, LeafIndex % LeafCount.Z) * 8;
+		const FVector3f LeafCenter = GetPosition(LeafOrigin) + FVector3f(3.5f * VoxelSize);
+
+		// No triangle closer than the band to any voxel of the leaf
+		const float LeafRadius = 3.5f * UE_SQRT_3 * VoxelSize;
+		if (GetDistanceSquared(LeafCenter, FMath::Square(LeafRadius + Background)) >= FMath::Square(LeafRadius + Background))
+		{
+			Inside[LeafIndex] = FMath::Abs(GetWindingNumber(LeafCenter)) >= 0.5f;
+			return;
+		}
+
+		float Distances[FBuildLeaf::SIZE];
+		FVector3f PreviousPosition = GetPosition(LeafOrigin);
+		float PreviousDistance = Background;
+		for (uint32 Offset = 0; Offset < FBuildLeaf::SIZE; ++Offset)
+		{
+			const FVector3f Position = GetPosition(LeafOrigin + FIntVector(Offset >> 6, (Offset >> 3) & 7, Offset & 7));
+
+			// The distance is 1-Lipschitz, the previous voxel bounds the search
+			const float MaxDistance = FMath::Min(PreviousDistance + (Position - PreviousPosition).Size() + UE_KINDA_SMALL_NUMBER, Background);
+			Distances[Offset] = FMath::Sqrt(GetDistanceSquared(Position, FMath::Square(MaxDistance)));
+			PreviousPosition = Position;
+			PreviousDistance = Distances[Offset];
+		}
+
+		// The surface can't cross between two neighbours whose distances add up to more than a voxel, they share a sign.
+		// A winding number is only needed once per group of voxels linked this way.
+		int8 Signs[FBuildLeaf::SIZE] = {};
+		uint16 Queue[FBuildLeaf::SIZE];
+		const float LinkDistance = VoxelSize * 1.001f;
+		FBuildLeaf* Leaf = new FBuildLeaf(nanovdb::Coord(LeafOrigin.X, LeafOrigin.Y, LeafOrigin.Z), Background, false);
+		for (uint32 Seed = 0; Seed < FBuildLeaf::SIZE; ++Seed)
+		{
+			if (Signs[Seed] != 0 || Distances[Seed] >= Background)
+			{
+				continue;
+			}
+
+			const FVector3f SeedPosition = GetPosition(LeafOrigin + FIntVector(Seed >> 6, (Seed >> 3) & 7, Seed & 7));
+			Signs[Seed] = FMath::Abs(GetWindingNumber(SeedPosition)) >= 0.5f ? -1 : 1;
+			int32 QueueEnd = 0;
+			Queue[QueueEnd++] = Seed;
+			for (int32 QueueBegin = 0; QueueBegin < QueueEnd; ++QueueBegin)
+			{
+				const uint32 Offset = Queue[QueueBegin];
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					const uint32 Shift = 6 - 3 * Axis;
+					const uint32 Coord = (Offset >> Shift) & 7;
+					for (const int32 Step : {-1, 1})
+					{
+						if ((Step < 0 && Coord == 0) || (Step > 0 && Coord == 7))
+						{
+							continue;
+						}
+						const uint32 Neighbour = Offset + (Step << Shift);
+						if (Signs[Neighbour] == 0 && Distances[Offset] + Distances[Neighbour] > LinkDistance)
+						{
+							Signs[Neighbour] = Signs[Offset];
+							Queue[QueueEnd++] = Neighbour;
+						}
+					}
+				}
+			}
+		}
+
+		for (uint32 Offset = 0; Offset < FBuildLeaf::SIZE; ++Offset)
+		{
+			const FIntVector Local = LeafOrigin + FIntVector(Offset >> 6, (Offset >> 3) & 7, Offset & 7);
+			if (Distances[Offset] < Background && Local.X < Size.X && Local.Y < Size.Y && Local.Z < Size.Z)
+			{
+				Leaf->mValues[Offset] = Signs[Offset] * Distances[Offset];
+				Leaf->mValueMask.setOn(Offset);
+			}
+		}
+		if (Leaf->mValueMask.isOff())
+		{
+			Inside[LeafIndex] = FMath::Abs(GetWindingNumber(LeafCenter)) >= 0.5f;
+			delete Leaf;
+			return;
+		}
+		Leaves[LeafIndex] = Leaf;
+	});
+
+	if (IsCancelled())
+	{
+		for (FBuildLeaf* Leaf : Leaves)
+		{
+			delete Leaf;
+		}
+		return {};
+	}
+	const double DistanceSeconds = FPlatformTime::Seconds() - StartTime;
+
+	const double EncodeStartTime = FPlatformTime::Seconds();
+	FBuildGrid Grid(Background, "mesh", nanovdb::GridClass::LevelSet);
+	Grid.setTransform(VoxelSize, nanovdb::Vec3d(Origin.X, Origin.Y, Origin.Z) * VoxelSize);
+	const uint32 NumGeneratedLeaves = FVoxelChunkGrid::AddLeaves(Grid, Leaves, Inside, [LeafCount](int32 LeafIndex)
+	{
+		return FIntVector(LeafIndex / (LeafCount.Y * LeafCount.Z), (LeafIndex / LeafCount.Z) % LeafCount.Y, LeafIndex % LeafCount.Z) * 8;
+	});
+
+	// Inactive voxels of the band leaves take the sign of their active neighbours
+	{
+		nanovdb::tools::build::NodeManager<FBuildGrid> NodeManager(Grid);
+		nanovdb::tools::build::sdfToLevelSet(NodeManager);
+	}
+	nanovdb::GridHandle<nanovdb::HostBuffer> Handle = FVoxelChunkGrid::Encode(Grid, Size);
+	if (OutStats)
+	{
+		OutStats->DistanceSeconds = DistanceSeconds;
+		OutStats->EncodeSeconds = FPlatformTime::Seconds() - EncodeStartTime;
+		OutStats->NumTriangles = Triangles.Num();
+		OutStats->NumLeaves = NumGeneratedLeaves;
+		OutStats->Size = Size;
+	}
+	return Handle;
+}
+
+bool FVoxelMeshVoxelizer::GetStaticMeshTriangles(const UStaticMesh& StaticMesh, TArray<FVector3f>& OutPositions, TArray<uint32>& OutIndices)
+{
+	const FStaticMeshRenderData* RenderData = StaticMesh.GetRenderData();
+	if (!RenderData || RenderData->LODResources.IsEmpty())
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("Can't voxelize %s, it has no render data"), *StaticMesh.GetName());
+		return false;
+	}
+
+	const FStaticMeshLODResources& LodResources = RenderData->LODResources[0];
+	const FPositionVertexBuffer& PositionBuffer = LodResources.VertexBuffers.PositionVertexBuffer;
+	if (!PositionBuffer.GetAllowCPUAccess() && !GIsEditor)
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("Can't voxelize %s, enable Allow CPU Access on it"), *StaticMesh.GetName());
+		return false;
+	}
+
+	OutPositions.SetNumUninitialized(PositionBuffer.GetNumVertices());
+	for (uint32 Vertex = 0; Vertex < PositionBuffer.GetNumVertices(); ++Vertex)
+	{
+		OutPositions[Vertex] = PositionBuffer.VertexPosition(Vertex);
+	}
+	LodResources.IndexBuffer.GetCopy(OutIndices);
+	return true;
+}
+
+nanovdb::GridHandle<nanovdb::HostBuffer> FVoxelMeshVoxelizer::VoxelizeStaticMesh(const UStaticMesh& StaticMesh, float VoxelSize, float BandWidth)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelMeshVoxelizer::VoxelizeStaticMesh);
+	TArray<FVector3f> Positions;
+	TArray<uint32> Indices;
+	if (!GetStaticMeshTriangles(StaticMesh, Positions, Indices))
+	{
+		return {};
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const FVoxelMeshVoxelizer Voxelizer(Positions, Indices);
+	const double BvhSeconds = FPlatformTime::Seconds() - StartTime;
+	FStats Stats;
+	nanovdb::GridHandle<nanovdb::HostBuffer> Handle = Voxelizer.Voxelize(VoxelSize, BandWidth, &Stats);
+	if (Handle.isEmpty())
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("Can't voxelize %s, it has no triangle"), *StaticMesh.GetName());
+		return {};
+	}
+
+	UE_LOG(LogVoxelMesh, Log, TEXT("Voxelized %s: %u triangles into %dx%dx%d voxels, hierarchy %.2f ms, distances %.2f ms, encode %.2f ms, %u leaves"),
+		*StaticMesh.GetName(), Stats.NumTriangles, Stats.Size.X, Stats.Size.Y, Stats.Size.Z, BvhSeconds * 1000.0, Stats.DistanceSeconds * 1000.0,
+		Stats.EncodeSeconds * 1000.0, Stats.NumLeaves);
+	return Handle;
+}
@@ -0,0 +1,236 @@
+﻿#include "VoxelPointSurfacer.h"
+
+#include "Async/ParallelFor.h"
+#include "VoxelChunkGrid.h"
+
+nanovdb::GridHandle<nanovdb::HostBuffer> FVoxelPointSurfacer::Surface(TConstArrayView<FVector3f> Positions, const FVoxelPointSurfaceSettings& Settings, FStats* OutStats)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelPointSurfacer::Surface);
+	const float VoxelSize = FMath::Max(Settings.VoxelSize, UE_KINDA_SMALL_NUMBER);
+	const float Background = Settings.BandWidth * VoxelSize;
+	const bool bZhuBridson = Settings.Kernel == EVoxelPointKernel::ZhuBridson;
+	const float KernelRadius = Settings.ParticleRadius * FMath::Max(Settings.KernelRadiusScale, 1.0f);
+	// Points further from a voxel than this don't change its value
+	const float SearchRadius = bZhuBridson ? KernelRadius : Settings.ParticleRadius + Background;
+
+	double StartTime = FPlatformTime::Seconds();
+	FBox3f Domain(ForceInit);
+	if (Settings.Domain.IsValid)
+	{
+		Domain = FBox3f(Settings.Domain);
+	}
+	else
+	{
+		for (const FVector3f& Position : Positions)
+		{
+			Domain += Position;
+		}
+		Domain = Domain.ExpandBy(SearchRadius);
+	}
+	if (!Domain.IsValid)
+	{
+		return {};
+	}
+
+	const FIntVector Origin(FMath::FloorToInt32(Domain.Min.X / VoxelSize), FMath::FloorToInt32(Domain.Min.Y / VoxelSize), FMath::FloorToInt32(Domain.Min.Z / VoxelSize));
+	const FIntVector Size(
+		FMath::CeilToInt32(Domain.Max.X / VoxelSize) - Origin.X + 1,
+		FMath::CeilToInt32(Domain.Max.Y / VoxelSize) - Origin.Y + 1,
+		FMath::CeilToInt32(Domain.Max.Z / VoxelSize) - Origin.Z + 1);
+	const FIntVector LeafCount(FMath::DivideAndRoundUp(Size.X, 8), FMath::DivideAndRoundUp(Size.Y, 8), FMath::DivideAndRoundUp(Size.Z, 8));
+	const int32 NumLeaves = LeafCount.X * LeafCount.Y * LeafCount.Z;
+	auto GetLeafIndex = [&LeafCount](const FIntVector& Leaf)
+	{
+		return Leaf.Z + LeafCount.Z * (Leaf.Y + LeafCount.Y * Leaf.X);
+	};
+
+	// Counting sort of the points by leaf, points outside of the domain are dropped
+	TArray<int32> PointLeaves;
+	PointLeaves.SetNumUninitialized(Positions.Num());
+	TArray<uint32> LeafStarts;
+	LeafStarts.SetNumZeroed(NumLeaves + 1);
+	for (int32 Point = 0; Point < Positions.Num(); ++Point)
+	{
+		const FVector3f Local = Positions[Point] / VoxelSize - FVector3f(Origin);
+		const FIntVector Leaf(FMath::FloorToInt32(Local.X) >> 3, FMath::FloorToInt32(Local.Y) >> 3, FMath::FloorToInt32(Local.Z) >> 3);
+		const bool bInDomain = Leaf.X >= 0 && Leaf.Y >= 0 && Leaf.Z >= 0 && Leaf.X < LeafCount.X && Leaf.Y < LeafCount.Y && Leaf.Z < LeafCount.Z;
+		PointLeaves[Point] = bInDomain ? GetLeafIndex(Leaf) : INDEX_NONE;
+		if (bInDomain)
+		{
+			++LeafStarts[PointLeaves[Point] + 1];
+		}
+	}
+	for (int32 LeafIndex = 0; LeafIndex < NumLeaves; ++LeafIndex)
+	{
+		LeafStarts[LeafIndex + 1] += LeafStarts[LeafIndex];
+	}
+	TArray<FVector3f> SortedPositions;
+	SortedPositions.SetNumUninitialized(LeafStarts[NumLeaves]);
+	{
+		TArray<uint32> LeafEnds(LeafStarts.GetData(), NumLeaves);
+		for (int32 Point = 0; Point < Positions.Num(); ++Point)
+		{
+			if (PointLeaves[Point] != INDEX_NONE)
+			{
+				SortedPositions[LeafEnds[PointLeaves[Point]]++] = Positions[Point];
+			}
+		}
+	}
+	const double SortSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	const int32 Ring = FMath::CeilToInt32(SearchRadius / (8.0f * VoxelSize));
+	const float SearchRadiusSquared = FMath::Square(SearchRadius);
+	const float InvKernelRadiusSquared = 1.0f / FMath::Square(KernelRadius);
+	TArray<FBuildLeaf*> Leaves;
+	Leaves.SetNumZeroed(NumLeaves);
+	TArray<uint8> Inside;
+	Inside.SetNumZeroed(NumLeaves);
+	ParallelFor(NumLeaves, [&](int32 LeafIndex)
+	{
+		const FIntVector LeafCoord(LeafIndex / (LeafCount.Y * LeafCount.Z), (LeafIndex / LeafCount.Z) % LeafCount.Y, LeafIndex % LeafCount.Z);
+		const FIntVector LeafOrigin = LeafCoord * 8;
+		const FBox3f LeafBox(FVector3f(LeafOrigin + Origin) * VoxelSize, FVector3f(LeafOrigin + Origin + FIntVector(7)) * VoxelSize);
+
+		// Points of the buckets around, close enough to one of the voxels
+		TArray<FVector3f, TInlineAllocator<256>> Candidates;
+		for (int32 X = FMath::Max(LeafCoord.X - Ring, 0); X <= FMath::Min(LeafCoord.X + Ring, LeafCount.X - 1); ++X)
+		{
+			for (int32 Y = FMath::Max(LeafCoord.Y - Ring, 0); Y <= FMath::Min(LeafCoord.Y + Ring, LeafCount.Y - 1); ++Y)
+			{
+				for (int32 Z = FMath::Max(LeafCoord.Z - Ring, 0); Z <= FMath::Min(LeafCoord.Z + Ring, LeafCount.Z - 1); ++Z)
+				{
+					const int32 Bucket = GetLeafIndex(FIntVector(X, Y, Z));
+					for (uint32 Point = LeafStarts[Bucket]; Point < LeafStarts[Bucket + 1]; ++Point)
+					{
+						if (LeafBox.ComputeSquaredDistanceToPoint(SortedPositions[Point]) < SearchRadiusSquared)
+						{
+							Candidates.Add(SortedPositions[Point]);
+						}
+					}
+				}
+			}
+		}
+
+		if (Candidates.IsEmpty())
+		{
+			return;
+		}
+
+		// Splat every point into the voxels of the leaf it reaches
+		float DistancesSquared[FBuildLeaf::SIZE];
+		float WeightSums[FBuildLeaf::SIZE];
+		FVector3f WeightedPositions[FBuildLeaf::SIZE];
+		if (bZhuBridson)
+		{
+			FMemory::Memzero(WeightSums);
+			FMemory::Memzero(WeightedPositions);
+		}
+		else
+		{
+			for (float& DistanceSquared : DistancesSquared)
+			{
+				DistanceSquared = SearchRadiusSquared;
+			}
+		}
+		const float Reach = SearchRadius / VoxelSize;
+		const float ReachSquared = FMath::Square(Reach);
+		const float VoxelSizeSquared = FMath::Square(VoxelSize);
+		for (const FVector3f& Candidate : Candidates)
+		{
+			const FVector3f Local = Candidate / VoxelSize - FVector3f(Origin + LeafOrigin);
+			const int32 MinX = FMath::Max(FMath::CeilToInt32(Local.X - Reach), 0);
+			const int32 MaxX = FMath::Min(FMath::FloorToInt32(Local.X + Reach), 7);
+			const int32 MinY = FMath::Max(FMath::CeilToInt32(Local.Y - Reach), 0);
+			const int32 MaxY = FMath::Min(FMath::FloorToInt32(Local.Y + Reach), 7);
+			const int32 MinZ = FMath::Max(FMath::CeilToInt32(Local.Z - Reach), 0);
+			const int32 MaxZ = FMath::Min(FMath::FloorToInt32(Local.Z + Reach), 7);
+			for (int32 X = MinX; X <= MaxX; ++X)
+			{
+				const float RowSquaredX = ReachSquared - FMath::Square(X - Local.X);
+				for (int32 Y = MinY; Y <= MaxY; ++Y)
+				{
+					// Rows missing the sphere of influence, the corners of the box are still visited and weigh nothing
+					const float RowSquared = RowSquaredX - FMath::Square(Y - Local.Y);
+					if (RowSquared < 0.0f)
+					{
+						continue;
+					}
+					const float DistanceSquaredXY = ReachSquared - RowSquared;
+					const uint32 RowOffset = (X << 6) | (Y << 3);
+					if (bZhuBridson)
+					{
+						for (int32 Z = MinZ; Z <= MaxZ; ++Z)
+						{
+							const float DistanceSquared = (DistanceSquaredXY + FMath::Square(Z - Local.Z)) * VoxelSizeSquared;
+							const float Weight = FMath::Cube(FMath::Max(1.0f - DistanceSquared * InvKernelRadiusSquared, 0.0f));
+							WeightSums[RowOffset | Z] += Weight;
+							WeightedPositions[RowOffset | Z] += Candidate * Weight;
+						}
+					}
+					else
+					{
+						for (int32 Z = MinZ; Z <= MaxZ; ++Z)
+						{
+							const float DistanceSquared = (DistanceSquaredXY + FMath::Square(Z - Local.Z)) * VoxelSizeSquared;
+							DistancesSquared[RowOffset | Z] = FMath::Min(DistancesSquared[RowOffset | Z], DistanceSquared);
+						}
+					}
+				}
+			}
+		}
+
+		FBuildLeaf* Leaf = new FBuildLeaf(nanovdb::Coord(LeafOrigin.X, LeafOrigin.Y, LeafOrigin.Z), Background, false);
+		bool bAllInside = !Candidates.IsEmpty();
+		for (uint32 Offset = 0; Offset < FBuildLeaf::SIZE; ++Offset)
+		{
+			const FIntVector Local = LeafOrigin + FIntVector(Offset >> 6, (Offset >> 3) & 7, Offset & 7);
+			float Value = Background;
+			if (!bZhuBridson)
+			{
+				Value = FMath::Sqrt(DistancesSquared[Offset]) - Settings.ParticleRadius;
+			}
+			else if (WeightSums[Offset] > 0.0f)
+			{
+				const FVector3f Position = FVector3f(Local + Origin) * VoxelSize;
+				Value = FVector3f::Distance(Position, WeightedPositions[Offset] / WeightSums[Offset]) - Settings.ParticleRadius;
+			}
+
+			Value = FMath::Clamp(Value, -Background, Background);
+			Leaf->mValues[Offset] = Value;
+			if (FMath::Abs(Value) < Background && Local.X < Size.X && Local.Y < Size.Y && Local.Z < Size.Z)
+			{
+				Leaf->mValueMask.setOn(Offset);
+			}
+			bAllInside &= Value <= -Background;
+		}
+
+		if (Leaf->mValueMask.isOff())
+		{
+			Inside[LeafIndex] = bAllInside;
+			delete Leaf;
+			return;
+		}
+		Leaves[LeafIndex] = Leaf;
+	});
+	const double SplatSeconds = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	FBuildGrid Grid(Background, "points", nanovdb::GridClass::LevelSet);
+	Grid.setTransform(VoxelSize, nanovdb::Vec3d(Origin.X, Origin.Y, Origin.Z) * VoxelSize);
+	const uint32 NumGeneratedLeaves = FVoxelChunkGrid::AddLeaves(Grid, Leaves, Inside, [LeafCount](int32 LeafIndex)
+	{
+		return FIntVector(LeafIndex / (LeafCount.Y * LeafCount.Z), (LeafIndex / LeafCount.Z) % LeafCount.Y, LeafIndex % LeafCount.Z) * 8;
+	});
+	nanovdb::GridHandle<nanovdb::HostBuffer> Handle = FVoxelChunkGrid::Encode(Grid, Size);
+	if (OutStats)
+	{
+		OutStats->SortSeconds = SortSeconds;
+		OutStats->SplatSeconds = SplatSeconds;
+		OutStats->EncodeSeconds = FPlatformTime::Seconds() - StartTime;
+		OutStats->NumPoints = SortedPositions.Num();
+		OutStats->NumLeaves = NumGeneratedLeaves;
+		OutStats->Size = Size;
+	}
+	return Handle;
+}
@@ -0,0 +1,348 @@
+﻿#include "VoxelRawVolumeImporter.h"
+
+#include "Async/ParallelFor.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/ByteSwap.h"
+#include "Misc/Paths.h"
+#include "VoxelChunkGrid.h"
+#include "VoxelMeshLog.h"
+
+int32 FVoxelRawVolumeImporter::GetBytesPerVoxel(EVoxelRawFormat Format)
+{
+	switch (Format)
+	{
+	case EVoxelRawFormat::UInt8:
+		return 1;
+	case EVoxelRawFormat::UInt16:
+		return 2;
+	case EVoxelRawFormat::Float32:
+		return 4;
+	}
+	return 1;
+}
+
+bool FVoxelRawVolumeImporter::Import(FReadSlice ReadSlice, const FVoxelRawVolumeSettings& Settings, FOnChunk OnChunk, FOnProgress OnProgress, FStats* OutStats)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelRawVolumeImporter::Import);
+	const FIntVector Dim = Settings.Dimensions;
+	if (Dim.X <= 0 || Dim.Y <= 0 || Dim.Z <= 0)
+	{
+		return false;
+	}
+	const int32 ChunkSize = FMath::Max(Align(Settings.ChunkSize, 8), 8);
+	const FIntVector ChunkCount(FMath::DivideAndRoundUp(Dim.X, ChunkSize), FMath::DivideAndRoundUp(Dim.Y, ChunkSize), FMath::DivideAndRoundUp(Dim.Z, ChunkSize));
+	const int32 LeafCountX = FMath::DivideAndRoundUp(Dim.X, 8);
+	const int32 LeafCountY = FMath::DivideAndRoundUp(Dim.Y, 8);
+	const int32 LeavesPerSlab = LeafCountX * LeafCountY;
+	const int32 BytesPerVoxel = GetBytesPerVoxel(Settings.Format);
+	const int64 SliceVoxels = int64(Dim.X) * Dim.Y;
+	const float Background = Settings.BandWidth * Settings.VoxelSize;
+	const float Sign = Settings.bInsideAboveIso ? -1.0f : 1.0f;
+
+	// Slot k holds slice SlabZ - 1 + k, clamped to the volume
+	constexpr int32 NumSlots = 8 + 2;
+	TArray<float> Window;
+	Window.SetNumUninitialized(NumSlots * SliceVoxels);
+	TArray<uint8> RawSlice;
+	RawSlice.SetNumUninitialized(SliceVoxels * BytesPerVoxel);
+	int32 NextSlice = 0;
+	double ReadSeconds = 0.0;
+	auto LoadSlot = [&](int32 Slot, int32 SliceIndex)
+	{
+		float* Values = Window.GetData() + Slot * SliceVoxels;
+		SliceIndex = FMath::Clamp(SliceIndex, 0, Dim.Z - 1);
+		if (SliceIndex < NextSlice)
+		{
+			// Clamped at the first or last slice, which the previous slot holds
+			check(Slot > 0);
+			FMemory::Memcpy(Values, Values - SliceVoxels, SliceVoxels * sizeof(float));
+			return true;
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+		check(SliceIndex == NextSlice);
+		++NextSlice;
+		if (!ReadSlice(SliceIndex, RawSlice))
+		{
+			return false;
+		}
+		ReadSeconds += FPlatformTime::Seconds() - StartTime;
+		ParallelFor(Dim.Y, [&](int32 Y)
+		{
+			const int64 RowStart = int64(Y) * Dim.X;
+			for (int64 Index = RowStart; Index < RowStart + Dim.X; ++Index)
+			{
+				const uint8* Bytes = RawSlice.GetData() + Index * BytesPerVoxel;
+				switch (Settings.Format)
+				{
+				case EVoxelRawFormat::UInt8:
+					Values[Index] = *Bytes;
+					break;
+				case EVoxelRawFormat::UInt16:
+				{
+					uint16 Value;
+					FMemory::Memcpy(&Value, Bytes, sizeof(Value));
+					Values[Index] = Settings.bBigEndian ? BYTESWAP_ORDER16(Value) : Value;
+					break;
+				}
+				case EVoxelRawFormat::Float32:
+				{
+					uint32 Bits;
+					FMemory::Memcpy(&Bits, Bytes, sizeof(Bits));
+					Bits = Settings.bBigEndian ? BYTESWAP_ORDER32(Bits) : Bits;
+					FMemory::Memcpy(&Values[Index], &Bits, sizeof(Bits));
+					break;
+				}
+				}
+			}
+		});
+		return true;
+	};
+
+	TArray<FBuildLeaf*> Leaves;
+	TArray<uint8> Inside;
+	TArray<TUniquePtr<FBuildGrid>> ChunkGrids;
+	TArray<uint8> ChunkHasSurface;
+	ChunkGrids.SetNum(ChunkCount.X * ChunkCount.Y);
+	ChunkHasSurface.SetNumZeroed(ChunkCount.X * ChunkCount.Y);
+	double ConvertSeconds = 0.0;
+	double EncodeSeconds = 0.0;
+	uint32 NumChunks = 0;
+	uint32 NumLeaves = 0;
+	for (int32 SlabZ = 0; SlabZ < Dim.Z; SlabZ += 8)
+	{
+		// Empty or solid regions read many slabs without any chunk coming out
+		if (!OnProgress(SlabZ, Dim.Z))
+		{
+			return false;
+		}
+		if (SlabZ == 0)
+		{
+			for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+			{
+				if (!LoadSlot(Slot, Slot - 1))
+				{
+					return false;
+				}
+			}
+		}
+		else
+		{
+			// The last two slices of the previous slab are the first two of this one
+			FMemory::Memcpy(Window.GetData(), Window.GetData() + 8 * SliceVoxels, 2 * SliceVoxels * sizeof(float));
+			for (int32 Slot = 2; Slot < NumSlots; ++Slot)
+			{
+				if (!LoadSlot(Slot, SlabZ - 1 + Slot))
+				{
+					return false;
+				}
+			}
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+		const int32 ChunkZ = SlabZ / ChunkSize;
+		Leaves.Reset();
+		Leaves.SetNumZeroed(LeavesPerSlab);
+		Inside.Reset();
+		Inside.SetNumZeroed(LeavesPerSlab);
+		ParallelFor(LeavesPerSlab, [&](int32 LeafIndex)
+		{
+			const FIntVector LeafOrigin(LeafIndex % LeafCountX * 8, LeafIndex / LeafCountX * 8, SlabZ);
+			const FIntVector ChunkOrigin = FIntVector(LeafOrigin.X / ChunkSize, LeafOrigin.Y / ChunkSize, ChunkZ) * ChunkSize;
+			const FIntVector LocalOrigin = LeafOrigin - ChunkOrigin;
+
+			auto Sample = [&](int32 X, int32 Y, int32 Z)
+			{
+				X = FMath::Clamp(X, 0, Dim.X - 1);
+				Y = FMath::Clamp(Y, 0, Dim.Y - 1);
+				return Window[(Z - SlabZ + 1) * SliceVoxels + int64(Y) * Dim.X + X];
+			};
+
+			// Skip the leaf when the range of its values and their neighbours keeps every voxel out of the band:
+			// no central difference can exceed the range, so the gradient is at most sqrt(3) / 2 times the range
+			float MinValue = UE_BIG_NUMBER;
+			float MaxValue = -UE_BIG_NUMBER;
+			float MinDistance = UE_BIG_NUMBER;
+			for (int32 Z = LeafOrigin.Z - 1; Z <= LeafOrigin.Z + 8; ++Z)
+			{
+				for (int32 Y = LeafOrigin.Y - 1; Y <= LeafOrigin.Y + 8; ++Y)
+				{
+					for (int32 X = LeafOrigin.X - 1; X <= LeafOrigin.X + 8; ++X)
+					{
+						const float Value = Sample(X, Y, Z);
+						MinValue = FMath::Min(MinValue, Value);
+						MaxValue = FMath::Max(MaxValue, Value);
+						MinDistance = FMath::Min(MinDistance, FMath::Abs(Value - Settings.IsoValue));
+					}
+				}
+			}
+			if (MinDistance > 0.0f && MinDistance >= Settings.BandWidth * UE_SQRT_3 * 0.5f * (MaxValue - MinValue))
+			{
+				Inside[LeafIndex] = Sign * (MinValue - Settings.IsoValue) < 0.0f;
+				return;
+			}
+
+			FBuildLeaf* Leaf = new FBuildLeaf(nanovdb::Coord(LocalOrigin.X, LocalOrigin.Y, LocalOrigin.Z), Background, false);
+			bool bAllInside = true;
+			for (uint32 Offset = 0; Offset < FBuildLeaf::SIZE; ++Offset)
+			{
+				const FIntVector Coord = LeafOrigin + FIntVector(Offset >> 6, (Offset >> 3) & 7, Offset & 7);
+				const int32 X = FMath::Min(Coord.X, Dim.X - 1);
+				const int32 Y = FMath::Min(Coord.Y, Dim.Y - 1);
+				const int32 Z = FMath::Min(Coord.Z, Dim.Z - 1);
+
+				// First order distance to the iso surface, in voxels
+				const float Value = Sample(X, Y, Z) - Settings.IsoValue;
+				const FVector3f Gradient(
+					Sample(X + 1, Y, Z) - Sample(X - 1, Y, Z),
+					Sample(X, Y + 1, Z) - Sample(X, Y - 1, Z),
+					Sample(X, Y, Z + 1) - Sample(X, Y, Z - 1));
+				const float GradientSize = Gradient.Size() * 0.5f;
+				float Distance = Settings.BandWidth;
+				if (FMath::Abs(Value) < Settings.BandWidth * GradientSize)
+				{
+					Distance = FMath::Abs(Value) / GradientSize;
+				}
+
+				const float LeafValue = FMath::CopySign(Distance, Sign * Value) * Settings.VoxelSize;
+				Leaf->mValues[Offset] = LeafValue;
+				if (Distance < Settings.BandWidth && Coord.X < Dim.X && Coord.Y < Dim.Y && Coord.Z < Dim.Z)
+				{
+					Leaf->mValueMask.setOn(Offset);
+				}
+				bAllInside &= LeafValue < 0.0f;
+			}
+			if (Leaf->mValueMask.isOff())
+			{
+				Inside[LeafIndex] = bAllInside;
+				delete Leaf;
+				return;
+			}
+			Leaves[LeafIndex] = Leaf;
+		});
+
+		for (int32 LeafIndex = 0; LeafIndex < LeavesPerSlab; ++LeafIndex)
+		{
+			const FIntVector LeafOrigin(LeafIndex % LeafCountX * 8, LeafIndex / LeafCountX * 8, SlabZ);
+			const int32 ChunkIndex = LeafOrigin.X / ChunkSize + ChunkCount.X * (LeafOrigin.Y / ChunkSize);
+			TUniquePtr<FBuildGrid>& Grid = ChunkGrids[ChunkIndex];
+			if (!Grid)
+			{
+				const FIntVector ChunkOrigin = FIntVector(LeafOrigin.X / ChunkSize, LeafOrigin.Y / ChunkSize, ChunkZ) * ChunkSize;
+				Grid = MakeUnique<FBuildGrid>(Background, "raw", nanovdb::GridClass::LevelSet);
+				Grid->setTransform(Settings.VoxelSize, nanovdb::Vec3d(ChunkOrigin.X, ChunkOrigin.Y, ChunkOrigin.Z) * Settings.VoxelSize);
+			}
+			const FIntVector LocalOrigin(LeafOrigin.X % ChunkSize, LeafOrigin.Y % ChunkSize, SlabZ % ChunkSize);
+			if (FVoxelChunkGrid::AddLeaf(*Grid, Leaves[LeafIndex], Inside[LeafIndex] != 0, LocalOrigin))
+			{
+				ChunkHasSurface[ChunkIndex] = true;
+				++NumLeaves;
+			}
+		}
+		ConvertSeconds += FPlatformTime::Seconds() - StartTime;
+
+		// Hand over the layer of chunks once its last slab is done, before reading any further
+		if (SlabZ + 8 >= FMath::Min((ChunkZ + 1) * ChunkSize, Dim.Z))
+		{
+			const double EncodeStartTime = FPlatformTime::Seconds();
+			TArray<nanovdb::GridHandle<nanovdb::HostBuffer>> Handles;
+			Handles.SetNum(ChunkGrids.Num());
+			ParallelFor(ChunkGrids.Num(), [&](int32 ChunkIndex)
+			{
+				if (ChunkGrids[ChunkIndex] && ChunkHasSurface[ChunkIndex])
+				{
+					const FIntVector ChunkOrigin = FIntVector(ChunkIndex % ChunkCount.X, ChunkIndex / ChunkCount.X, ChunkZ) * ChunkSize;
+					const FIntVector Extent(FMath::Min(ChunkSize, Dim.X - ChunkOrigin.X), FMath::Min(ChunkSize, Dim.Y - ChunkOrigin.Y), FMath::Min(ChunkSize, Dim.Z - ChunkOrigin.Z));
+					Handles[ChunkIndex] = FVoxelChunkGrid::Encode(*ChunkGrids[ChunkIndex], Extent);
+				}
+				ChunkGrids[ChunkIndex].Reset();
+			});
+			EncodeSeconds += FPlatformTime::Seconds() - EncodeStartTime;
+
+			for (int32 ChunkIndex = 0; ChunkIndex < Handles.Num(); ++ChunkIndex)
+			{
+				if (!Handles[ChunkIndex].isEmpty())
+				{
+					if (!OnChunk(FIntVector(ChunkIndex % ChunkCount.X, ChunkIndex / ChunkCount.X, ChunkZ), MoveTemp(Handles[ChunkIndex])))
+					{
+						return false;
+					}
+					++NumChunks;
+				}
+			}
+			FMemory::Memzero(ChunkHasSurface.GetData(), ChunkHasSurface.Num());
+		}
+	}
+
+	if (OutStats)
+	{
+		OutStats->ReadSeconds = ReadSeconds;
+		OutStats->ConvertSeconds = ConvertSeconds;
+		OutStats->EncodeSeconds = EncodeSeconds;
+		OutStats->NumChunks = NumChunks;
+		OutStats->NumLeaves = NumLeaves;
+		OutStats->SlabBytes = Window.GetAllocatedSize() + RawSlice.GetAllocatedSize();
+	}
+	return true;
+}
+
+bool FVoxelRawVolumeImporter::ImportFile(const FString& Filename, const FVoxelRawVolumeSettings& Settings, FOnChunk OnChunk, FOnProgress OnProgress, FStats* OutStats)
+{
+	TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*Filename));
+	if (!File)
+	{
+		UE_LOG(LogVoxelMesh, Error, TEXT("Cannot open %s"), *Filename);
+		return false;
+	}
+
+	const int64 SliceBytes = int64(Settings.Dimensions.X) * Settings.Dimensions.Y * GetBytesPerVoxel(Settings.Format);
+	const int64 ExpectedSize = Settings.HeaderSize + SliceBytes * Settings.Dimensions.Z;
+	if (File->Size() < ExpectedSize)
+	{
+		UE_LOG(LogVoxelMesh, Error, TEXT("%s holds %lld bytes, %lld are needed for %dx%dx%d voxels"), *Filename, File->Size(), ExpectedSize,
+			Settings.Dimensions.X, Settings.Dimensions.Y, Settings.Dimensions.Z);
+		return false;
+	}
+
+	bool bReadFailed = false;
+	const bool bSuccess = Import([&File, &Settings, SliceBytes, &bReadFailed](int32 SliceIndex, TArrayView<uint8> OutBytes)
+	{
+		bReadFailed = !File->Seek(Settings.HeaderSize + SliceIndex * SliceBytes) || !File->Read(OutBytes.GetData(), OutBytes.Num());
+		return !bReadFailed;
+	}, Settings, OnChunk, OnProgress, OutStats);
+	if (bReadFailed)
+	{
+		UE_LOG(LogVoxelMesh, Error, TEXT("Failed to read %s"), *Filename);
+	}
+	return bSuccess;
+}
+
+bool FVoxelRawVolumeImporter::ParseFileName(const FString& Filename, FVoxelRawVolumeSettings& InOutSettings)
+{
+	TArray<FString> Tokens;
+	FPaths::GetBaseFilename(Filename).ParseIntoArray(Tokens, TEXT("_"));
+	bool bFoundDimensions = false;
+	for (const FString& Token : Tokens)
+	{
+		TArray<FString> Sizes;
+		if (Token.ParseIntoArray(Sizes, TEXT("x")) == 3 && Sizes[0].IsNumeric() && Sizes[1].IsNumeric() && Sizes[2].IsNumeric())
+		{
+			InOutSettings.Dimensions = FIntVector(FCString::Atoi(*Sizes[0]), FCString::Atoi(*Sizes[1]), FCString::Atoi(*Sizes[2]));
+			bFoundDimensions = true;
+		}
+		else if (Token == TEXT("uint8"))
+		{
+			InOutSettings.Format = EVoxelRawFormat::UInt8;
+		}
+		else if (Token == TEXT("uint16"))
+		{
+			InOutSettings.Format = EVoxelRawFormat::UInt16;
+		}
+		else if (Token == TEXT("float32") || Token == TEXT("float"))
+		{
+			InOutSettings.Format = EVoxelRawFormat::Float32;
+		}
+	}
+	return bFoundDimensions;
+}
@@ -7,20 +7,24 @@
 #include "SceneViewExtension.h"
 #include "VoxelChunkView.h"
 #include "VoxelMeshComponent.h"
+#include "VoxelMeshLog.h"
+#include "VoxelMeshRebuildScheduler.h"
 #include "VoxelViewExtension.h"
 
+DECLARE_STATS_GROUP(TEXT("Voxel Streaming"), STATGROUP_VoxelStreaming, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Registered chunks"), STAT_VoxelStreamingRegistered, STATGROUP_VoxelStreaming);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending loads"), STAT_VoxelStreamingPendingLoads, STATGROUP_VoxelStreaming);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending meshes"), STAT_VoxelStreamingPendingMeshes, STATGROUP_VoxelStreaming);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending uploads"), STAT_VoxelStreamingPendingUploads, STATGROUP_VoxelStreaming);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Loads in flight"), STAT_VoxelStreamingLoadsInFlight, STATGROUP_VoxelStreaming);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Meshes in flight"), STAT_VoxelStreamingMeshesInFlight, STATGROUP_VoxelStreaming);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visible chunks"), STAT_VoxelStreamingVisible, STATGROUP_VoxelStreaming);
+
 void UVoxelRenderingWorldSubsystem::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
 	UpdateCurrentChunks_GameThread();
-
-	for (UVoxelChunkView* Chunk : Chunks)
-	{
-		if (Chunk->IsDirty())
-		{
-		}
-	}
 }
 
 void UVoxelRenderingWorldSubsystem::Initialize(FSubsystemCollectionBase& Collection)
@@ -37,7 +41,14 @@ void UVoxelRenderingWorldSubsystem::Deinitialize()
 {
 	Super::Deinitialize();
 
+	TArray<FIntVector> ChunkCoords;
+	StreamedChunks.GetKeys(ChunkCoords);
+	for (const FIntVector& ChunkCoord : ChunkCoords)
+	{
+		UnregisterChunk(ChunkCoord);
+	}
 	Chunks.Reset();
+	ExtraOrigins.Reset();
 	VoxelViewExtension.Reset();
 }
 
@@ -54,12 +65,200 @@ UVoxelRenderingWorldSubsystem* UVoxelRenderingWorldSubsystem::Get(const UWorld*
 
 void UVoxelRenderingWorldSubsystem::UpdateCurrentChunks_GameThread()
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(UVoxelRenderingWorldSubsystem::UpdateCurrentChunks_GameThread);
 	UWorld* World = GetWorld();
 	check(nullptr != World);
-	Chunks.Reset();
+
+	if (VoxelViewExtension && !VoxelViewExtension->ViewOrigins.IsEmpty())
+	{
+		ViewOrigins = MoveTemp(VoxelViewExtension->ViewOrigins);
+		VoxelViewExtension->ViewOrigins.Reset();
+	}
+	TArray<FVector> Origins = ViewOrigins;
+	for (const TPair<int32, FVector>& Origin : ExtraOrigins)
+	{
+		Origins.Add(Origin.Value);
+	}
+
+	// Meshes finished since the last tick
+	for (auto It = MeshingChunks.CreateIterator(); It; ++It)
+	{
+		const FStreamedChunk& Chunk = StreamedChunks.FindChecked(*It);
+		const TSharedPtr<FVoxelChunkViewRHIProxy> RHIProxy = Chunk.View ? Chunk.View->GetRHIProxy() : nullptr;
+		if (!RHIProxy)
+		{
+			Streamer.SetState(*It, EVoxelChunkStreamingState::Empty);
+			It.RemoveCurrent();
+		}
+		else if (RHIProxy->IsReady() && !RHIProxy->IsGenerating())
+		{
+			Streamer.SetState(*It, EVoxelChunkStreamingState::Meshed);
+			It.RemoveCurrent();
+		}
+	}
+
+	Streamer.Update(Origins, StreamingSettings, StreamingUpdate);
+	for (const FIntVector& ChunkCoord : StreamingUpdate.ToUnload)
+	{
+		UnloadChunk(ChunkCoord);
+	}
+	for (const FIntVector& ChunkCoord : StreamingUpdate.ToLoad)
+	{
+		FStreamedChunk& Chunk = StreamedChunks.FindChecked(ChunkCoord);
+		if (Chunk.Asset.Get() || Chunk.Asset.IsNull())
+		{
+			OnChunkLoaded(ChunkCoord);
+		}
+		else
+		{
+			Chunk.LoadHandle = StreamableManager.RequestAsyncLoad(Chunk.Asset.ToSoftObjectPath(),
+				FStreamableDelegate::CreateUObject(this, &UVoxelRenderingWorldSubsystem::OnChunkLoaded, ChunkCoord));
+		}
+	}
+	for (const FIntVector& ChunkCoord : StreamingUpdate.ToMesh)
+	{
+		MeshChunk(ChunkCoord, Origins);
+	}
+	for (const FIntVector& ChunkCoord : StreamingUpdate.ToUpload)
+	{
+		ShowChunk(ChunkCoord);
+	}
+
+	const FVoxelStreamingStats& Stats = Streamer.GetStats();
+	SET_DWORD_STAT(STAT_VoxelStreamingRegistered, Stats.NumRegistered);
+	SET_DWORD_STAT(STAT_VoxelStreamingPendingLoads, Stats.PendingLoads);
+	SET_DWORD_STAT(STAT_VoxelStreamingPendingMeshes, Stats.PendingMeshes);
+	SET_DWORD_STAT(STAT_VoxelStreamingPendingUploads, Stats.PendingUploads);
+	SET_DWORD_STAT(STAT_VoxelStreamingLoadsInFlight, Stats.LoadsInFlight);
+	SET_DWORD_STAT(STAT_VoxelStreamingMeshesInFlight, Stats.MeshesInFlight);
+	SET_DWORD_STAT(STAT_VoxelStreamingVisible, Stats.NumVisible);
 }
 
 TArrayView<UVoxelChunkView*> UVoxelRenderingWorldSubsystem::GetChunks()
 {
 	return Chunks;
 }
+
+void UVoxelRenderingWorldSubsystem::RegisterChunk(FIntVector ChunkCoord, TSoftObjectPtr<UVoxelChunkView> Asset)
+{
+	UnregisterChunk(ChunkCoord);
+	StreamedChunks.Add(ChunkCoord).Asset = Asset;
+	Streamer.AddChunk(ChunkCoord);
+}
+
+void UVoxelRenderingWorldSubsystem::UnregisterChunk(FIntVector ChunkCoord)
+{
+	if (StreamedChunks.Contains(ChunkCoord))
+	{
+		UnloadChunk(ChunkCoord);
+		Streamer.RemoveChunk(ChunkCoord);
+		StreamedChunks.Remove(ChunkCoord);
+	}
+}
+
+int32 UVoxelRenderingWorldSubsystem::AddStreamingOrigin(FVector Origin)
+{
+	const int32 Handle = NextOriginHandle++;
+	ExtraOrigins.Add(Handle, Origin);
+	return Handle;
+}
+
+void UVoxelRenderingWorldSubsystem::MoveStreamingOrigin(int32 Handle, FVector Origin)
+{
+	if (FVector* Existing = ExtraOrigins.Find(Handle))
+	{
+		*Existing = Origin;
+	}
+}
+
+void UVoxelRenderingWorldSubsystem::RemoveStreamingOrigin(int32 Handle)
+{
+	ExtraOrigins.Remove(Handle);
+}
+
+UVoxelChunkView* UVoxelRenderingWorldSubsystem::GetLoadedChunk(FIntVector ChunkCoord) const
+{
+	const FStreamedChunk* Chunk = StreamedChunks.Find(ChunkCoord);
+	return Chunk ? Chunk->View : nullptr;
+}
+
+void UVoxelRenderingWorldSubsystem::OnChunkLoaded(FIntVector ChunkCoord)
+{
+	FStreamedChunk* Chunk = StreamedChunks.Find(ChunkCoord);
+	if (!Chunk || Streamer.GetState(ChunkCoord) != EVoxelChunkStreamingState::Loading)
+	{
+		return;
+	}
+
+	Chunk->LoadHandle.Reset();
+	Chunk->View = Chunk->Asset.Get();
+	if (!Chunk->View)
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("Can't load chunk %s from %s"), *ChunkCoord.ToString(), *Chunk->Asset.ToString());
+		Streamer.SetState(ChunkCoord, EVoxelChunkStreamingState::Empty);
+		return;
+	}
+	Chunks.Add(Chunk->View);
+	// Chunks without a surface have nothing to draw, they aren't meshed nor counted as visible
+	const bool bHasSurface = !Chunk->View->IsEmpty() && Chunk->View->HasSurface();
+	Streamer.SetState(ChunkCoord, bHasSurface ? EVoxelChunkStreamingState::Loaded : EVoxelChunkStreamingState::Empty);
+}
+
+void UVoxelRenderingWorldSubsystem::MeshChunk(const FIntVector& ChunkCoord, TConstArrayView<FVector> Origins)
+{
+	UVoxelChunkView* View = StreamedChunks.FindChecked(ChunkCoord).View;
+	if (!View->GetRHIProxy())
+	{
+		View->MarkAsDirty();
+	}
+
+	// The asset may already be meshed for another component
+	const TSharedPtr<FVoxelChunkViewRHIProxy> RHIProxy = View->GetRHIProxy();
+	if (!RHIProxy->IsReady() && !RHIProxy->IsGenerating())
+	{
+		// Closest chunks first, see FVoxelMeshRebuildScheduler
+		double Distance = Origins.IsEmpty() ? -1.0 : TNumericLimits<double>::Max();
+		for (const FVector& Origin : Origins)
+		{
+			Distance = FMath::Min(Distance, FVoxelChunkStreamer::GetDistance(ChunkCoord, Origin, StreamingSettings.ChunkWorldSize));
+		}
+		FVoxelMeshRebuildScheduler::Get().Request(View, 0.0f, static_cast<float>(Distance));
+	}
+	MeshingChunks.Add(ChunkCoord);
+}
+
+void UVoxelRenderingWorldSubsystem::ShowChunk(const FIntVector& ChunkCoord)
+{
+	// Meshes are normalized to [-0.5, 0.5], the component scale is the chunk size and its origin the centre of the chunk
+	const double ChunkWorldSize = FMath::Max(StreamingSettings.ChunkWorldSize, 1.0f);
+	UVoxelMeshProxyComponent* Component = NewObject<UVoxelMeshProxyComponent>(this, NAME_None, RF_Transient);
+	Component->SetRelativeTransform(FTransform(FQuat::Identity, (FVector(ChunkCoord) + FVector(0.5)) * ChunkWorldSize, FVector(ChunkWorldSize)));
+	Component->UpdateChunkViewAsset(StreamedChunks.FindChecked(ChunkCoord).View);
+	Component->RegisterComponentWithWorld(GetWorld());
+	ChunkComponents.Add(ChunkCoord, Component);
+}
+
+void UVoxelRenderingWorldSubsystem::UnloadChunk(const FIntVector& ChunkCoord)
+{
+	FStreamedChunk& Chunk = StreamedChunks.FindChecked(ChunkCoord);
+	if (Chunk.LoadHandle)
+	{
+		Chunk.LoadHandle->CancelHandle();
+		Chunk.LoadHandle.Reset();
+	}
+
+	TObjectPtr<UVoxelMeshProxyComponent> Component;
+	if (ChunkComponents.RemoveAndCopyValue(ChunkCoord, Component) && IsValid(Component))
+	{
+		Component->UpdateChunkViewAsset(nullptr);
+		Component->DestroyComponent();
+	}
+	if (Chunk.View)
+	{
+		// The asset may stay loaded, its GPU buffers and mesh don't. MeshChunk builds them again when the chunk comes back.
+		Chunk.View->ReleaseRHIProxy();
+		Chunks.RemoveSingleSwap(Chunk.View);
+		Chunk.View = nullptr;
+	}
+	MeshingChunks.Remove(ChunkCoord);
+}
@@ -0,0 +1,222 @@
+﻿#include "VoxelSurfaceNetsMesher.h"
+
+#include "Async/ParallelFor.h"
+#include "VoxelCubeClassify.h"
+#include "VoxelMarchingCubesTables.h"
+
+namespace VoxelSurfaceNets
+{
+	/// Corner of a cube for each bit of its marching cubes index, see MCCubeVertex
+	static const FIntVector CornerOffsets[8] = {
+		FIntVector(0, 0, 0), FIntVector(1, 0, 0), FIntVector(1, 1, 0), FIntVector(0, 1, 0),
+		FIntVector(0, 0, 1), FIntVector(1, 0, 1), FIntVector(1, 1, 1), FIntVector(0, 1, 1),
+	};
+
+	/// Edges leaving the first corner of a cell along x, y and z, with the corner at their other end
+	static constexpr uint32 AxisEdgeEndCorner[3] = { 1, 3, 4 };
+
+	/// The four cells around an edge along each axis, relative to the cell owning it, in a consistent winding
+	static const FIntVector QuadCellOffsets[3][4] = {
+		{ FIntVector(0, 0, 0), FIntVector(0, -1, 0), FIntVector(0, -1, -1), FIntVector(0, 0, -1) },
+		{ FIntVector(0, 0, 0), FIntVector(0, 0, -1), FIntVector(-1, 0, -1), FIntVector(-1, 0, 0) },
+		{ FIntVector(0, 0, 0), FIntVector(-1, 0, 0), FIntVector(-1, -1, 0), FIntVector(0, -1, 0) },
+	};
+
+	static constexpr uint32 NumQuadIndices = 6;
+
+	FORCEINLINE bool IsEdgeCrossed(uint32 CubeIndex, uint32 Axis)
+	{
+		return ((CubeIndex ^ (CubeIndex >> AxisEdgeEndCorner[Axis])) & 1) != 0;
+	}
+}
+
+uint32 FVoxelSurfaceNetsMesher::CountOwnedQuads(const FIntVector& Coord, uint32 CubeIndex) const
+{
+	using namespace VoxelSurfaceNets;
+
+	uint32 NumQuads = 0;
+	for (uint32 Axis = 0; Axis < 3; ++Axis)
+	{
+		// The cells behind the edge on both other axes must exist
+		const uint32 Axis1 = (Axis + 1) % 3;
+		const uint32 Axis2 = (Axis + 2) % 3;
+		NumQuads += IsEdgeCrossed(CubeIndex, Axis) && Coord[Axis1] > 0 && Coord[Axis2] > 0;
+	}
+	return NumQuads;
+}
+
+FVector3f FVoxelSurfaceNetsMesher::PlaceCellVertex(const FVoxelBrickTile& Tile, const FIntVector& LocalCoord, uint32 CubeIndex) const
+{
+	using namespace VoxelMarchingCubes;
+
+	const uint32 Edges = EdgeTable[CubeIndex];
+	FVector3f Sum = FVector3f::ZeroVector;
+	uint32 NumCrossings = 0;
+	for (uint32 Edge = 0; Edge < 12; ++Edge)
+	{
+		if (Edges & (1u << Edge))
+		{
+			const FIntVector BeginOffset = VoxelSurfaceNets::CornerOffsets[EdgeVertexIndices[Edge][0]];
+			const FIntVector EndOffset = VoxelSurfaceNets::CornerOffsets[EdgeVertexIndices[Edge][1]];
+			Sum += InterpolateVertex(FVector3f(BeginOffset), FVector3f(EndOffset), Tile.Get(LocalCoord + BeginOffset), Tile.Get(LocalCoord + EndOffset));
+			++NumCrossings;
+		}
+	}
+	return FVector3f(LocalCoord) + Sum / float(FMath::Max(NumCrossings, 1u));
+}
+
+void FVoxelSurfaceNetsMesher::Generate(FVoxelCpuMeshData& OutMeshData) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelSurfaceNetsMesher::Generate);
+	using namespace VoxelMarchingCubes;
+	using namespace VoxelSurfaceNets;
+
+	constexpr uint32 BrickSize = FVoxelBrickTraversal::BrickSize;
+	const int32 NumBricks = Traversal.GetNumBricks();
+	const uint32 TotalCubes = Traversal.GetNumTraversalIds();
+	const FIntVector NumCells = GetNumCells();
+
+	OutMeshData.Reset();
+
+	// Step 1: Classify cells and count their vertex and quads, one brick per task.
+	// Same packing as the marching cubes path, with at most one vertex per cell.
+	TArray<uint32> CellInfos;
+	TArray<uint32> BrickVertexOffsets;
+	TArray<uint32> BrickIndexOffsets;
+	TArray<TUniquePtr<FVoxelBrickTile>> SurfaceTiles;
+	CellInfos.SetNumUninitialized(TotalCubes);
+	BrickVertexOffsets.SetNumZeroed(NumBricks + 1);
+	BrickIndexOffsets.SetNumZeroed(NumBricks + 1);
+	SurfaceTiles.SetNum(NumBricks);
+	ParallelFor(NumBricks, [&](int32 BrickIndex)
+	{
+		const FAccessorType Accessor = Grid.getAccessor();
+		const FIntVector BrickOrigin = Traversal.GetBrickCoord(BrickIndex) * FVoxelBrickTraversal::BrickDim;
+		FVoxelBrickTile Tile;
+		LoadBrickTile(BrickOrigin, Accessor, Tile);
+
+		uint8 CubeIndices[FVoxelCubeClassify::NumCubes];
+		uint64 NonEmptyMask[FVoxelCubeClassify::NumMaskWords];
+		FVoxelCubeClassify::ClassifyBrick(Tile, SurfaceIsoValue, NumCells - BrickOrigin, CubeIndices, NonEmptyMask);
+
+		const uint32 FirstId = BrickIndex * BrickSize;
+		FMemory::Memzero(&CellInfos[FirstId], BrickSize * sizeof(uint32));
+		uint32 NumVertices = 0;
+		uint32 NumIndices = 0;
+		for (uint32 Word = 0; Word < FVoxelCubeClassify::NumMaskWords; ++Word)
+		{
+			for (uint64 Mask = NonEmptyMask[Word]; Mask != 0; Mask &= Mask - 1)
+			{
+				const uint32 LocalIndex = Word * 64 + FMath::CountTrailingZeros64(Mask);
+				const FIntVector LocalCoord(LocalIndex >> 6, (LocalIndex >> 3) & 7, LocalIndex & 7);
+				const uint32 LinearId = FirstId + FVoxelBrickTraversal::EncodeMorton(LocalCoord.X, LocalCoord.Y, LocalCoord.Z);
+				const uint32 CubeIndex = CubeIndices[LocalIndex];
+				const uint32 CellNumIndices = CountOwnedQuads(BrickOrigin + LocalCoord, CubeIndex) * NumQuadIndices;
+				CellInfos[LinearId] = PackCubeInfo(CubeIndex, 1, CellNumIndices);
+				NumVertices += 1;
+				NumIndices += CellNumIndices;
+			}
+		}
+		BrickVertexOffsets[BrickIndex + 1] = NumVertices;
+		BrickIndexOffsets[BrickIndex + 1] = NumIndices;
+		if (NumVertices > 0)
+		{
+			SurfaceTiles[BrickIndex] = MakeUnique<FVoxelBrickTile>(Tile);
+		}
+	});
+
+	// Step 2: Prefix sum of vertices and indices, in traversal order
+	for (int32 BrickIndex = 0; BrickIndex < NumBricks; ++BrickIndex)
+	{
+		BrickVertexOffsets[BrickIndex + 1] += BrickVertexOffsets[BrickIndex];
+		BrickIndexOffsets[BrickIndex + 1] += BrickIndexOffsets[BrickIndex];
+	}
+
+	OutMeshData.Vertices.SetNumUninitialized(BrickVertexOffsets[NumBricks]);
+	OutMeshData.Indices.SetNumUninitialized(BrickIndexOffsets[NumBricks]);
+
+	// Step 3: Place the vertex of every surface cell, remembering where it went for the quads of the neighbour cells
+	const FVector3f NormalizeScale = GetNormalizeScale();
+	TArray<uint32> CellVertexIndices;
+	CellVertexIndices.SetNumUninitialized(TotalCubes);
+	ParallelFor(NumBricks, [&](int32 BrickIndex)
+	{
+		const FVoxelBrickTile* Tile = SurfaceTiles[BrickIndex].Get();
+		if (!Tile)
+		{
+			return;
+		}
+
+		const FIntVector BrickOrigin = Traversal.GetBrickCoord(BrickIndex) * FVoxelBrickTraversal::BrickDim;
+		uint32 VertexOffset = BrickVertexOffsets[BrickIndex];
+		const uint32 FirstId = BrickIndex * BrickSize;
+		for (uint32 LinearId = FirstId; LinearId < FirstId + BrickSize; ++LinearId)
+		{
+			const uint32 CellInfo = CellInfos[LinearId];
+			if (UnpackNumVertices(CellInfo) == 0)
+			{
+				continue;
+			}
+
+			const FIntVector LocalCoord = FVoxelBrickTraversal::DecodeMorton(LinearId - FirstId);
+			const FVector3f VertexPosition = FVector3f(BrickOrigin) + PlaceCellVertex(*Tile, LocalCoord, UnpackCubeIndex(CellInfo));
+			OutMeshData.Vertices[VertexOffset] = FVector4f(VertexPosition * NormalizeScale - 0.5f, 0.0f);
+			CellVertexIndices[LinearId] = VertexOffset;
+			++VertexOffset;
+		}
+	});
+
+	// Step 4: Emit the quads, split along their shorter diagonal. Needs the vertices of the lower neighbour bricks.
+	ParallelFor(NumBricks, [&](int32 BrickIndex)
+	{
+		if (BrickIndexOffsets[BrickIndex + 1] == BrickIndexOffsets[BrickIndex])
+		{
+			return;
+		}
+
+		const FIntVector BrickOrigin = Traversal.GetBrickCoord(BrickIndex) * FVoxelBrickTraversal::BrickDim;
+		uint32 IndexOffset = BrickIndexOffsets[BrickIndex];
+		const uint32 FirstId = BrickIndex * BrickSize;
+		for (uint32 LinearId = FirstId; LinearId < FirstId + BrickSize; ++LinearId)
+		{
+			const uint32 CellInfo = CellInfos[LinearId];
+			if (UnpackNumIndices(CellInfo) == 0)
+			{
+				continue;
+			}
+
+			const uint32 CubeIndex = UnpackCubeIndex(CellInfo);
+			const FIntVector Coord = BrickOrigin + FVoxelBrickTraversal::DecodeMorton(LinearId - FirstId);
+			for (uint32 Axis = 0; Axis < 3; ++Axis)
+			{
+				if (!IsEdgeCrossed(CubeIndex, Axis) || Coord[(Axis + 1) % 3] == 0 || Coord[(Axis + 2) % 3] == 0)
+				{
+					continue;
+				}
+
+				uint32 QuadVertices[4];
+				for (uint32 i = 0; i < 4; ++i)
+				{
+					QuadVertices[i] = CellVertexIndices[Traversal.GetTraversalIdByCoord(Coord + QuadCellOffsets[Axis][i])];
+				}
+
+				// Quads face away from the inside, same winding as the marching cubes triangles
+				if (CubeIndex & 1)
+				{
+					Swap(QuadVertices[1], QuadVertices[3]);
+				}
+
+				const FVector4f* Vertices = OutMeshData.Vertices.GetData();
+				const float Diagonal02 = FVector3f::DistSquared(FVector3f(Vertices[QuadVertices[0]]), FVector3f(Vertices[QuadVertices[2]]));
+				const float Diagonal13 = FVector3f::DistSquared(FVector3f(Vertices[QuadVertices[1]]), FVector3f(Vertices[QuadVertices[3]]));
+				const uint32 First = Diagonal02 <= Diagonal13 ? 0 : 1;
+				OutMeshData.Indices[IndexOffset++] = QuadVertices[First];
+				OutMeshData.Indices[IndexOffset++] = QuadVertices[First + 1];
+				OutMeshData.Indices[IndexOffset++] = QuadVertices[First + 2];
+				OutMeshData.Indices[IndexOffset++] = QuadVertices[First];
+				OutMeshData.Indices[IndexOffset++] = QuadVertices[First + 2];
+				OutMeshData.Indices[IndexOffset++] = QuadVertices[(First + 3) & 3];
+			}
+		}
+	});
+}
@@ -0,0 +1,267 @@
+﻿#include "VoxelTerrainGenerator.h"
+
+#include "Async/ParallelFor.h"
+#include "VoxelChunkGrid.h"
+
+namespace VoxelTerrainNoise
+{
+	/// Bounds of the gradient of the noises below, measured and rounded up
+	static constexpr float Noise2DLipschitz = 3.2f;
+	static constexpr float Noise3DLipschitz = 3.5f;
+
+	static FORCEINLINE uint32 Hash(int32 X, int32 Y, int32 Z, uint32 Seed)
+	{
+		uint32 H = Seed ^ (static_cast<uint32>(X) * 0x8da6b343u) ^ (static_cast<uint32>(Y) * 0xd8163841u) ^ (static_cast<uint32>(Z) * 0xcb1ab31fu);
+		H ^= H >> 16;
+		H *= 0x7feb352du;
+		H ^= H >> 15;
+		H *= 0x846ca68bu;
+		H ^= H >> 16;
+		return H;
+	}
+
+	static FORCEINLINE float Fade(float T)
+	{
+		return T * T * T * (T * (T * 6.0f - 15.0f) + 10.0f);
+	}
+
+	/// One of 8 unit directions
+	static FORCEINLINE float Gradient2D(uint32 H, float X, float Y)
+	{
+		static constexpr float Diagonal = 0.70710678f;
+		switch (H & 7)
+		{
+		case 0: return X;
+		case 1: return -X;
+		case 2: return Y;
+		case 3: return -Y;
+		case 4: return (X + Y) * Diagonal;
+		case 5: return (X - Y) * Diagonal;
+		case 6: return (-X + Y) * Diagonal;
+		default: return (-X - Y) * Diagonal;
+		}
+	}
+
+	/// One of the 12 edge directions of improved Perlin noise
+	static FORCEINLINE float Gradient3D(uint32 H, float X, float Y, float Z)
+	{
+		switch (H % 12)
+		{
+		case 0: return X + Y;
+		case 1: return -X + Y;
+		case 2: return X - Y;
+		case 3: return -X - Y;
+		case 4: return X + Z;
+		case 5: return -X + Z;
+		case 6: return X - Z;
+		case 7: return -X - Z;
+		case 8: return Y + Z;
+		case 9: return -Y + Z;
+		case 10: return Y - Z;
+		default: return -Y - Z;
+		}
+	}
+
+	/// Gradient noise in about [-1, 1]
+	static float Noise2D(float X, float Y, uint32 Seed)
+	{
+		const float FloorX = FMath::FloorToFloat(X);
+		const float FloorY = FMath::FloorToFloat(Y);
+		const int32 IX = static_cast<int32>(FloorX);
+		const int32 IY = static_cast<int32>(FloorY);
+		const float FX = X - FloorX;
+		const float FY = Y - FloorY;
+
+		const float N00 = Gradient2D(Hash(IX, IY, 0, Seed), FX, FY);
+		const float N10 = Gradient2D(Hash(IX + 1, IY, 0, Seed), FX - 1.0f, FY);
+		const float N01 = Gradient2D(Hash(IX, IY + 1, 0, Seed), FX, FY - 1.0f);
+		const float N11 = Gradient2D(Hash(IX + 1, IY + 1, 0, Seed), FX - 1.0f, FY - 1.0f);
+		const float U = Fade(FX);
+		return FMath::Lerp(FMath::Lerp(N00, N10, U), FMath::Lerp(N01, N11, U), Fade(FY)) * 1.4142136f;
+	}
+
+	static float Noise3D(const FVector3f& P, uint32 Seed)
+	{
+		const FVector3f Floor(FMath::FloorToFloat(P.X), FMath::FloorToFloat(P.Y), FMath::FloorToFloat(P.Z));
+		const FIntVector I(static_cast<int32>(Floor.X), static_cast<int32>(Floor.Y), static_cast<int32>(Floor.Z));
+		const FVector3f F = P - Floor;
+
+		float Corners[8];
+		for (int32 Corner = 0; Corner < 8; ++Corner)
+		{
+			const int32 CX = Corner >> 2;
+			const int32 CY = (Corner >> 1) & 1;
+			const int32 CZ = Corner & 1;
+			Corners[Corner] = Gradient3D(Hash(I.X + CX, I.Y + CY, I.Z + CZ, Seed), F.X - CX, F.Y - CY, F.Z - CZ);
+		}
+		const float U = Fade(F.X);
+		const float V = Fade(F.Y);
+		const float W = Fade(F.Z);
+		const float X0 = FMath::Lerp(FMath::Lerp(Corners[0], Corners[1], W), FMath::Lerp(Corners[2], Corners[3], W), V);
+		const float X1 = FMath::Lerp(FMath::Lerp(Corners[4], Corners[5], W), FMath::Lerp(Corners[6], Corners[7], W), V);
+		return FMath::Lerp(X0, X1, U);
+	}
+}
+
+FVoxelTerrainGenerator::FVoxelTerrainGenerator(const FVoxelTerrainSettings& InSettings)
+	: Settings(InSettings)
+{
+	using namespace VoxelTerrainNoise;
+	Settings.Octaves = FMath::Clamp(Settings.Octaves, 1, 12);
+
+	// Octaves are normalized by the sum of their amplitudes, each one is Lacunarity times steeper
+	float AmplitudeSum = 0.0f;
+	float SlopeSum = 0.0f;
+	float Amplitude = 1.0f;
+	float Frequency = 1.0f;
+	for (int32 Octave = 0; Octave < Settings.Octaves; ++Octave)
+	{
+		AmplitudeSum += Amplitude;
+		SlopeSum += Amplitude * Frequency;
+		Amplitude *= Settings.Gain;
+		Frequency *= Settings.Lacunarity;
+	}
+	const float WarpLipschitz = 1.0f + Settings.WarpAmplitude * Settings.WarpFrequency * Noise2DLipschitz * UE_SQRT_2;
+	const float HeightLipschitz = Settings.HeightAmplitude * Settings.HeightFrequency * Noise2DLipschitz * SlopeSum / AmplitudeSum * WarpLipschitz;
+
+	// Z - Height, the caves are already a distance bound
+	LipschitzBound = FMath::Max(FMath::Sqrt(1.0f + FMath::Square(HeightLipschitz)), 1.0f);
+}
+
+float FVoxelTerrainGenerator::EvaluateHeight(float X, float Y) const
+{
+	using namespace VoxelTerrainNoise;
+	const uint32 Seed = static_cast<uint32>(Settings.Seed);
+	if (Settings.WarpAmplitude > 0.0f)
+	{
+		const float WarpX = Noise2D(X * Settings.WarpFrequency, Y * Settings.WarpFrequency, Seed + 101);
+		const float WarpY = Noise2D(X * Settings.WarpFrequency + 5.2f, Y * Settings.WarpFrequency + 1.3f, Seed + 102);
+		X += Settings.WarpAmplitude * WarpX;
+		Y += Settings.WarpAmplitude * WarpY;
+	}
+
+	float Sum = 0.0f;
+	float AmplitudeSum = 0.0f;
+	float Amplitude = 1.0f;
+	float Frequency = Settings.HeightFrequency;
+	for (int32 Octave = 0; Octave < Settings.Octaves; ++Octave)
+	{
+		Sum += Amplitude * Noise2D(X * Frequency, Y * Frequency, Seed + Octave);
+		AmplitudeSum += Amplitude;
+		Amplitude *= Settings.Gain;
+		Frequency *= Settings.Lacunarity;
+	}
+	return Settings.BaseHeight + Settings.HeightAmplitude * Sum / AmplitudeSum;
+}
+
+float FVoxelTerrainGenerator::Evaluate(const FVector3f& Position) const
+{
+	return CarveCaves(Position, Position.Z - EvaluateHeight(Position.X, Position.Y));
+}
+
+float FVoxelTerrainGenerator::CarveCaves(const FVector3f& Position, float Value) const
+{
+	using namespace VoxelTerrainNoise;
+	if (Settings.CaveThreshold > 0.0f && Settings.CaveFrequency > 0.0f)
+	{
+		// Dividing by the slope of the noise keeps the cave field a lower bound of the distance to its tunnels
+		const float Noise = Noise3D(Position * Settings.CaveFrequency, static_cast<uint32>(Settings.Seed) + 201);
+		const float Cave = (FMath::Abs(Noise) - Settings.CaveThreshold) / (Settings.CaveFrequency * Noise3DLipschitz);
+		Value = FMath::Max(Value, -Cave);
+	}
+	return Value;
+}
+
+nanovdb::GridHandle<nanovdb::HostBuffer> FVoxelTerrainGenerator::GenerateChunk(const FIntVector& ChunkCoord, FStats* OutStats, TFunctionRef<bool()> IsCancelled) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelTerrainGenerator::GenerateChunk);
+	const double StartTime = FPlatformTime::Seconds();
+
+	const int32 Size = FMath::Max(Settings.ChunkSize, 8);
+	const int32 LeavesPerAxis = FMath::DivideAndRoundUp(Size, 8);
+	const int32 NumLeaves = LeavesPerAxis * LeavesPerAxis * LeavesPerAxis;
+	const FIntVector ChunkOrigin = ChunkCoord * Size;
+	const float Background = Settings.BandWidth * Settings.VoxelSize;
+	// Distance from the center of a leaf to its furthest voxel
+	const float LeafRadius = 3.5f * UE_SQRT_3;
+
+	TArray<FBuildLeaf*> Leaves;
+	Leaves.SetNumZeroed(NumLeaves);
+	TArray<uint8> Inside;
+	Inside.SetNumZeroed(NumLeaves);
+	std::atomic<uint64> NumSamples = 0;
+	ParallelFor(NumLeaves, [&](int32 LeafIndex)
+	{
+		if (IsCancelled())
+		{
+			return;
+		}
+		const FIntVector LeafOrigin = FIntVector(LeafIndex / (LeavesPerAxis * LeavesPerAxis), (LeafIndex / LeavesPerAxis) % LeavesPerAxis, LeafIndex % LeavesPerAxis) * 8;
+		const FVector3f LeafCenter = FVector3f(ChunkOrigin + LeafOrigin) + FVector3f(3.5f);
+		const float CenterValue = Evaluate(LeafCenter);
+		Inside[LeafIndex] = CenterValue < 0.0f;
+		if (FMath::Abs(CenterValue) - LipschitzBound * LeafRadius >= Settings.BandWidth)
+		{
+			NumSamples += 1;
+			return;
+		}
+
+		// Offsets are x-major then z, the height of a column is shared by its 8 voxels
+		FBuildLeaf* Leaf = new FBuildLeaf(nanovdb::Coord(LeafOrigin.X, LeafOrigin.Y, LeafOrigin.Z), Background, false);
+		for (int32 Column = 0; Column < 64; ++Column)
+		{
+			const FIntVector ColumnOrigin = ChunkOrigin + LeafOrigin + FIntVector(Column >> 3, Column & 7, 0);
+			const float Height = EvaluateHeight(ColumnOrigin.X, ColumnOrigin.Y);
+			for (int32 Z = 0; Z < 8; ++Z)
+			{
+				const uint32 Offset = (Column << 3) | Z;
+				const FVector3f Position(ColumnOrigin.X, ColumnOrigin.Y, ColumnOrigin.Z + Z);
+				const float Value = CarveCaves(Position, Position.Z - Height) * Settings.VoxelSize;
+				const FIntVector Local = ColumnOrigin - ChunkOrigin + FIntVector(0, 0, Z);
+				if (Local.X < Size && Local.Y < Size && Local.Z < Size && FMath::Abs(Value) < Background)
+				{
+					Leaf->mValues[Offset] = Value;
+					Leaf->mValueMask.setOn(Offset);
+				}
+				else
+				{
+					Leaf->mValues[Offset] = Value < 0.0f ? -Background : Background;
+				}
+			}
+		}
+		NumSamples += 1 + FBuildLeaf::SIZE;
+
+		if (Leaf->mValueMask.isOff())
+		{
+			Inside[LeafIndex] = Leaf->mValues[0] < 0.0f;
+			delete Leaf;
+			return;
+		}
+		Leaves[LeafIndex] = Leaf;
+	});
+
+	if (IsCancelled())
+	{
+		for (FBuildLeaf* Leaf : Leaves)
+		{
+			delete Leaf;
+		}
+		return {};
+	}
+
+	FBuildGrid Grid(Background, "terrain", nanovdb::GridClass::LevelSet);
+	Grid.setTransform(Settings.VoxelSize, nanovdb::Vec3d(ChunkOrigin.X, ChunkOrigin.Y, ChunkOrigin.Z) * Settings.VoxelSize);
+	const uint32 NumGeneratedLeaves = FVoxelChunkGrid::AddLeaves(Grid, Leaves, Inside, [LeavesPerAxis](int32 LeafIndex)
+	{
+		return FIntVector(LeafIndex / (LeavesPerAxis * LeavesPerAxis), (LeafIndex / LeavesPerAxis) % LeavesPerAxis, LeafIndex % LeavesPerAxis) * 8;
+	});
+	nanovdb::GridHandle<nanovdb::HostBuffer> Handle = FVoxelChunkGrid::Encode(Grid, FIntVector(Size));
+	if (OutStats)
+	{
+		OutStats->Seconds = FPlatformTime::Seconds() - StartTime;
+		OutStats->NumSamples = NumSamples;
+		OutStats->NumLeaves = NumGeneratedLeaves;
+		OutStats->NumSkippedLeaves = NumLeaves - NumGeneratedLeaves;
+	}
+	return Handle;
+}
@@ -3,6 +3,7 @@
 
 #include "VoxelUtilities.h"
 #include "VoxelChunkView.h"
+#include "VoxelMeshVoxelizer.h"
 #include "VoxelVdbCommon.h"
 
 UVoxelChunkView* UVoxelUtilities::CreateSphereChunkView(UObject* Outer)
@@ -12,3 +13,49 @@ UVoxelChunkView* UVoxelUtilities::CreateSphereChunkView(UObject* Outer)
 	ChunkView->SetVdbBuffer_GameThread(MoveTemp(NewGrid));
 	return ChunkView;
 }
+
+UVoxelChunkView* UVoxelUtilities::CreateTerrainChunkView(UObject* Outer, const FVoxelTerrainSettings& Settings, FIntVector ChunkCoord)
+{
+	const FVoxelTerrainGenerator Generator(Settings);
+	UVoxelChunkView* ChunkView = NewObject<UVoxelChunkView>(Outer);
+	ChunkView->SetVdbBuffer_GameThread(Generator.GenerateChunk(ChunkCoord));
+	return ChunkView;
+}
+
+UVoxelChunkView* UVoxelUtilities::CreateStaticMeshChunkView(UObject* Outer, UStaticMesh* StaticMesh, float VoxelSize, float BandWidth)
+{
+	if (!StaticMesh)
+	{
+		return nullptr;
+	}
+	nanovdb::GridHandle<nanovdb::HostBuffer> NewGrid = FVoxelMeshVoxelizer::VoxelizeStaticMesh(*StaticMesh, VoxelSize, BandWidth);
+	if (NewGrid.isEmpty())
+	{
+		return nullptr;
+	}
+
+	UVoxelChunkView* ChunkView = NewObject<UVoxelChunkView>(Outer);
+	ChunkView->SetVdbBuffer_GameThread(MoveTemp(NewGrid));
+	return ChunkView;
+}
+
+bool UVoxelUtilities::SurfacePoints(UVoxelChunkView* ChunkView, const TArray<FVector>& Points, const FVoxelPointSurfaceSettings& Settings)
+{
+	if (!ChunkView)
+	{
+		return false;
+	}
+	TArray<FVector3f> Positions;
+	Positions.SetNumUninitialized(Points.Num());
+	for (int32 Point = 0; Point < Points.Num(); ++Point)
+	{
+		Positions[Point] = FVector3f(Points[Point]);
+	}
+	nanovdb::GridHandle<nanovdb::HostBuffer> NewGrid = FVoxelPointSurfacer::Surface(Positions, Settings);
+	if (NewGrid.isEmpty())
+	{
+		return false;
+	}
+	ChunkView->QueueVdbBuffer_GameThread(MoveTemp(NewGrid));
+	return true;
+}
@@ -12,6 +12,7 @@ void FVoxelViewExtension::SetupViewFamily(FSceneViewFamily& InViewFamily)
 
 void FVoxelViewExtension::SetupView(FSceneViewFamily& InViewFamily, FSceneView& InView)
 {
+	ViewOrigins.Add(InView.ViewMatrices.GetViewOrigin());
 }
 
 void FVoxelViewExtension::BeginRenderViewFamily(FSceneViewFamily& InViewFamily)
@@ -0,0 +1,622 @@
+﻿#include "VoxelVoxImporter.h"
+
+#include "Async/ParallelFor.h"
+#include "Misc/FileHelper.h"
+#include "VoxelChunkGrid.h"
+#include "VoxelMeshLog.h"
+
+namespace VoxelVoxImporter
+{
+	/// Little endian reader of the chunks of a .vox file, reads past the end fail and return zeros
+	struct FReader
+	{
+		TConstArrayView<uint8> Bytes;
+		int64 Offset = 0;
+		bool bError = false;
+
+		bool Skip(int64 NumBytes)
+		{
+			if (NumBytes < 0 || Offset + NumBytes > Bytes.Num())
+			{
+				bError = true;
+				return false;
+			}
+			Offset += NumBytes;
+			return true;
+		}
+
+		int32 ReadInt32()
+		{
+			int32 Value = 0;
+			if (Skip(sizeof(Value)))
+			{
+				FMemory::Memcpy(&Value, Bytes.GetData() + Offset - sizeof(Value), sizeof(Value));
+			}
+			return Value;
+		}
+
+		FString ReadString()
+		{
+			const int32 Length = ReadInt32();
+			if (!Skip(Length))
+			{
+				return FString();
+			}
+			const uint8* Chars = Bytes.GetData() + Offset - Length;
+			return FString(Length, reinterpret_cast<const ANSICHAR*>(Chars));
+		}
+
+		TMap<FString, FString> ReadDict()
+		{
+			TMap<FString, FString> Dict;
+			const int32 NumPairs = ReadInt32();
+			for (int32 Pair = 0; Pair < NumPairs && !bError; ++Pair)
+			{
+				FString Key = ReadString();
+				Dict.Add(MoveTemp(Key), ReadString());
+			}
+			return Dict;
+		}
+	};
+
+	struct FNode
+	{
+		enum class EType : uint8
+		{
+			Transform,
+			Group,
+			Shape
+		};
+
+		EType Type = EType::Transform;
+		TArray<int32> Children;
+		int32 ModelIndex = INDEX_NONE;
+		int32 LayerIndex = INDEX_NONE;
+		bool bHidden = false;
+		FVoxelVoxScene::FInstance Transform;
+	};
+
+	static void ParseTransform(const TMap<FString, FString>& Frame, FVoxelVoxScene::FInstance& OutTransform)
+	{
+		if (const FString* Rotation = Frame.Find(TEXT("_r")))
+		{
+			// Column of the non zero entry of the first two rows in bits 0-1 and 2-3, signs of the three rows in bits 4-6
+			const int32 Bits = FCString::Atoi(**Rotation);
+			const int32 Columns[3] = {Bits & 3, (Bits >> 2) & 3, 3 - (Bits & 3) - ((Bits >> 2) & 3)};
+			for (int32 Row = 0; Row < 3; ++Row)
+			{
+				OutTransform.Rotation[Row] = FIntVector::ZeroValue;
+				OutTransform.Rotation[Row][FMath::Clamp(Columns[Row], 0, 2)] = (Bits >> (4 + Row)) & 1 ? -1 : 1;
+			}
+		}
+		if (const FString* Translation = Frame.Find(TEXT("_t")))
+		{
+			TArray<FString> Components;
+			if (Translation->ParseIntoArray(Components, TEXT(" ")) == 3)
+			{
+				OutTransform.Translation = FIntVector(FCString::Atoi(*Components[0]), FCString::Atoi(*Components[1]), FCString::Atoi(*Components[2]));
+			}
+		}
+	}
+
+	static FVoxelVoxScene::FInstance Compose(const FVoxelVoxScene::FInstance& Parent, const FVoxelVoxScene::FInstance& Child)
+	{
+		FVoxelVoxScene::FInstance Result;
+		for (int32 Row = 0; Row < 3; ++Row)
+		{
+			for (int32 Column = 0; Column < 3; ++Column)
+			{
+				Result.Rotation[Row][Column] = Parent.Rotation[Row].X * Child.Rotation[0][Column] + Parent.Rotation[Row].Y * Child.Rotation[1][Column]
+					+ Parent.Rotation[Row].Z * Child.Rotation[2][Column];
+			}
+		}
+		Result.Translation = Parent.Transform(Child.Translation);
+		Result.bHidden = Parent.bHidden || Child.bHidden;
+		return Result;
+	}
+
+	/// Solid voxels of a leaf by their palette index, 0 for empty
+	struct FOccupancyLeaf
+	{
+		uint8 Colors[512];
+	};
+}
+
+bool FVoxelVoxScene::Load(TConstArrayView<uint8> Bytes)
+{
+	using namespace VoxelVoxImporter;
+	Models.Reset();
+	Instances.Reset();
+	Palette.Reset();
+
+	FReader Reader{Bytes};
+	if (Bytes.Num() < 8 || FMemory::Memcmp(Bytes.GetData(), "VOX ", 4) != 0)
+	{
+		return false;
+	}
+	Reader.Skip(8);
+
+	TMap<int32, FNode> Nodes;
+	TSet<int32> HiddenLayers;
+	FIntVector PendingSize = FIntVector::ZeroValue;
+	while (Reader.Offset + 12 <= Bytes.Num() && !Reader.bError)
+	{
+		const uint8* Id = Bytes.GetData() + Reader.Offset;
+		Reader.Skip(4);
+		const int32 ContentBytes = Reader.ReadInt32();
+		Reader.ReadInt32();
+		const int64 ContentEnd = Reader.Offset + ContentBytes;
+		if (ContentBytes < 0 || ContentEnd > Bytes.Num())
+		{
+			return false;
+		}
+
+		// Children are read as the next chunks, MAIN only holds children
+		auto IsChunk = [Id](const char* Name)
+		{
+			return FMemory::Memcmp(Id, Name, 4) == 0;
+		};
+		if (IsChunk("SIZE"))
+		{
+			PendingSize.X = Reader.ReadInt32();
+			PendingSize.Y = Reader.ReadInt32();
+			PendingSize.Z = Reader.ReadInt32();
+		}
+		else if (IsChunk("XYZI"))
+		{
+			FModel& Model = Models.AddDefaulted_GetRef();
+			Model.Size = PendingSize;
+			const int32 NumVoxels = Reader.ReadInt32();
+			if (NumVoxels < 0 || Reader.Offset + int64(NumVoxels) * 4 > ContentEnd)
+			{
+				return false;
+			}
+			Model.Voxels.SetNumUninitialized(NumVoxels);
+			for (int32 Voxel = 0; Voxel < NumVoxels; ++Voxel)
+			{
+				const uint8* Data = Bytes.GetData() + Reader.Offset + Voxel * 4;
+				Model.Voxels[Voxel] = FIntVector4(Data[0], Data[1], Data[2], Data[3]);
+			}
+		}
+		else if (IsChunk("RGBA"))
+		{
+			// Entry i is the color of palette index i + 1
+			Palette.SetNumZeroed(256);
+			for (int32 Index = 0; Index < 255 && Reader.Offset + 4 * (Index + 1) <= ContentEnd; ++Index)
+			{
+				const uint8* Data = Bytes.GetData() + Reader.Offset + Index * 4;
+				Palette[Index + 1] = FColor(Data[0], Data[1], Data[2], Data[3]);
+			}
+		}
+		else if (IsChunk("nTRN"))
+		{
+			const int32 NodeId = Reader.ReadInt32();
+			FNode& Node = Nodes.Add(NodeId);
+			Node.Type = FNode::EType::Transform;
+			const TMap<FString, FString> Attributes = Reader.ReadDict();
+			Node.bHidden = Attributes.FindRef(TEXT("_hidden")) == TEXT("1");
+			Node.Children.Add(Reader.ReadInt32());
+			Reader.ReadInt32();
+			Node.LayerIndex = Reader.ReadInt32();
+			if (Reader.ReadInt32() > 0)
+			{
+				// Only the first frame of animations
+				ParseTransform(Reader.ReadDict(), Node.Transform);
+			}
+		}
+		else if (IsChunk("nGRP"))
+		{
+			const int32 NodeId = Reader.ReadInt32();
+			FNode& Node = Nodes.Add(NodeId);
+			Node.Type = FNode::EType::Group;
+			Reader.ReadDict();
+			const int32 NumChildren = Reader.ReadInt32();
+			for (int32 Child = 0; Child < NumChildren && !Reader.bError; ++Child)
+			{
+				Node.Children.Add(Reader.ReadInt32());
+			}
+		}
+		else if (IsChunk("nSHP"))
+		{
+			const int32 NodeId = Reader.ReadInt32();
+			FNode& Node = Nodes.Add(NodeId);
+			Node.Type = FNode::EType::Shape;
+			Reader.ReadDict();
+			if (Reader.ReadInt32() > 0)
+			{
+				Node.ModelIndex = Reader.ReadInt32();
+			}
+		}
+		else if (IsChunk("LAYR"))
+		{
+			const int32 LayerId = Reader.ReadInt32();
+			if (Reader.ReadDict().FindRef(TEXT("_hidden")) == TEXT("1"))
+			{
+				HiddenLayers.Add(LayerId);
+			}
+		}
+
+		if (!IsChunk("MAIN"))
+		{
+			Reader.Offset = ContentEnd;
+		}
+	}
+	if (Reader.bError)
+	{
+		return false;
+	}
+
+	if (Palette.IsEmpty())
+	{
+		// MagicaVoxel's default palette isn't embedded, files without one get a gray ramp
+		Palette.SetNumZeroed(256);
+		for (int32 Index = 1; Index < 256; ++Index)
+		{
+			Palette[Index] = FColor(Index, Index, Index);
+		}
+	}
+
+	if (Nodes.Contains(0))
+	{
+		// Flatten the graph from its root transform, depth first
+		TFunction<void(int32, const FInstance&, int32)> Visit = [&](int32 NodeId, const FInstance& Parent, int32 Depth)
+		{
+			const FNode* Node = Nodes.Find(NodeId);
+			if (!Node || Depth > 64)
+			{
+				return;
+			}
+			switch (Node->Type)
+			{
+			case FNode::EType::Transform:
+			{
+				FInstance Transform = Compose(Parent, Node->Transform);
+				Transform.bHidden |= Node->bHidden || HiddenLayers.Contains(Node->LayerIndex);
+				Visit(Node->Children[0], Transform, Depth + 1);
+				break;
+			}
+			case FNode::EType::Group:
+				for (const int32 Child : Node->Children)
+				{
+					Visit(Child, Parent, Depth + 1);
+				}
+				break;
+			case FNode::EType::Shape:
+				if (Models.IsValidIndex(Node->ModelIndex))
+				{
+					FInstance& Instance = Instances.Add_GetRef(Parent);
+					Instance.ModelIndex = Node->ModelIndex;
+				}
+				break;
+			}
+		};
+		Visit(0, FInstance(), 0);
+	}
+	else
+	{
+		// Older files, models side by side along x
+		int32 OffsetX = 0;
+		for (int32 ModelIndex = 0; ModelIndex < Models.Num(); ++ModelIndex)
+		{
+			FInstance& Instance = Instances.AddDefaulted_GetRef();
+			Instance.ModelIndex = ModelIndex;
+			Instance.Translation = FIntVector(OffsetX + Models[ModelIndex].Size.X / 2, 0, 0);
+			OffsetX += Models[ModelIndex].Size.X + 1;
+		}
+	}
+	return true;
+}
+
+bool FVoxelVoxImporter::Import(const FVoxelVoxScene& Scene, const FVoxelVoxSettings& Settings, FOnChunk OnChunk, FOnProgress OnProgress, FStats* OutStats)
+{
+	using namespace VoxelVoxImporter;
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelVoxImporter::Import);
+
+	// Solid voxels in Unreal space: y is flipped to go from right to left handed
+	double StartTime = FPlatformTime::Seconds();
+	TMap<FIntVector, FOccupancyLeaf> Occupancy;
+	FIntVector Min(MAX_int32);
+	FIntVector Max(MIN_int32);
+	uint32 NumVoxels = 0;
+	for (const FVoxelVoxScene::FInstance& Instance : Scene.Instances)
+	{
+		if ((Instance.bHidden && !Settings.bImportHidden) || !Scene.Models.IsValidIndex(Instance.ModelIndex))
+		{
+			continue;
+		}
+		const FVoxelVoxScene::FModel& Model = Scene.Models[Instance.ModelIndex];
+		const FIntVector Pivot = Model.Size / 2;
+		for (const FIntVector4& Voxel : Model.Voxels)
+		{
+			const FIntVector World = Instance.Transform(FIntVector(Voxel.X, Voxel.Y, Voxel.Z) - Pivot);
+			const FIntVector Position(World.X, -World.Y, World.Z);
+			const FIntVector LeafCoord(Position.X >> 3, Position.Y >> 3, Position.Z >> 3);
+			FOccupancyLeaf* Leaf = Occupancy.Find(LeafCoord);
+			if (!Leaf)
+			{
+				Leaf = &Occupancy.Add(LeafCoord);
+				FMemory::Memzero(Leaf->Colors);
+			}
+			Leaf->Colors[((Position.X & 7) << 6) | ((Position.Y & 7) << 3) | (Position.Z & 7)] = static_cast<uint8>(Voxel.W);
+			Min = FIntVector(FMath::Min(Min.X, Position.X), FMath::Min(Min.Y, Position.Y), FMath::Min(Min.Z, Position.Z));
+			Max = FIntVector(FMath::Max(Max.X, Position.X), FMath::Max(Max.Y, Position.Y), FMath::Max(Max.Z, Position.Z));
+			++NumVoxels;
+		}
+	}
+	if (Occupancy.IsEmpty())
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("The scene has no visible voxel"));
+		return false;
+	}
+	const double RasterizeSeconds = FPlatformTime::Seconds() - StartTime;
+
+	// The scene starts on a leaf, far enough from the voxels for the band to fit
+	StartTime = FPlatformTime::Seconds();
+	const float BandWidth = FMath::Clamp(Settings.BandWidth, 1.0f, 7.0f);
+	const float Background = BandWidth * Settings.VoxelSize;
+	const int32 Radius = FMath::CeilToInt32(BandWidth) + 1;
+	const FIntVector SceneMin(((Min.X - Radius) >> 3) << 3, ((Min.Y - Radius) >> 3) << 3, ((Min.Z - Radius) >> 3) << 3);
+	const FIntVector SceneSize = Max + FIntVector(Radius) - SceneMin + FIntVector(1);
+	const int32 ChunkSize = FMath::Max(Align(Settings.ChunkSize, 8), 8);
+
+	// Offsets by their distance to the voxel cube, the first one of the other state gives the distance to the surface
+	const int32 BlockDim = 8 + 2 * Radius;
+	struct FOffset
+	{
+		/// In the block gathered around a leaf
+		int32 Delta;
+		float Distance;
+	};
+	TArray<FOffset> Offsets;
+	for (int32 X = -Radius; X <= Radius; ++X)
+	{
+		for (int32 Y = -Radius; Y <= Radius; ++Y)
+		{
+			for (int32 Z = -Radius; Z <= Radius; ++Z)
+			{
+				const float Distance = FVector3f(
+					FMath::Max(FMath::Abs(X) - 0.5f, 0.0f),
+					FMath::Max(FMath::Abs(Y) - 0.5f, 0.0f),
+					FMath::Max(FMath::Abs(Z) - 0.5f, 0.0f)).Size();
+				if ((X != 0 || Y != 0 || Z != 0) && Distance < BandWidth)
+				{
+					Offsets.Add({(X * BlockDim + Y) * BlockDim + Z, Distance});
+				}
+			}
+		}
+	}
+	Offsets.Sort([](const FOffset& A, const FOffset& B)
+	{
+		return A.Distance < B.Distance;
+	});
+
+	TSet<FIntVector> CandidateSet;
+	for (const TPair<FIntVector, FOccupancyLeaf>& Pair : Occupancy)
+	{
+		for (int32 Neighbour = 0; Neighbour < 27; ++Neighbour)
+		{
+			CandidateSet.Add(Pair.Key + FIntVector(Neighbour % 3 - 1, (Neighbour / 3) % 3 - 1, Neighbour / 9 - 1));
+		}
+	}
+	TArray<FIntVector> Candidates = CandidateSet.Array();
+
+	TArray<FBuildLeaf*> Leaves;
+	TArray<FBuildMaterialLeaf*> MaterialLeaves;
+	TArray<uint8> Inside;
+	Leaves.SetNumZeroed(Candidates.Num());
+	MaterialLeaves.SetNumZeroed(Candidates.Num());
+	Inside.SetNumZeroed(Candidates.Num());
+	ParallelFor(Candidates.Num(), [&](int32 CandidateIndex)
+	{
+		const FIntVector LeafOrigin = Candidates[CandidateIndex] * 8;
+		const FIntVector SceneOrigin = LeafOrigin - SceneMin;
+		if (SceneOrigin.X + 8 <= 0 || SceneOrigin.Y + 8 <= 0 || SceneOrigin.Z + 8 <= 0
+			|| SceneOrigin.X >= SceneSize.X || SceneOrigin.Y >= SceneSize.Y || SceneOrigin.Z >= SceneSize.Z)
+		{
+			return;
+		}
+
+		// Palette indices around the leaf, the band never reaches past the neighbour leaves
+		TArray<uint8, TInlineAllocator<24 * 24 * 24>> Block;
+		Block.SetNumZeroed(BlockDim * BlockDim * BlockDim);
+		const FIntVector BlockOrigin = LeafOrigin - FIntVector(Radius);
+		for (int32 Neighbour = 0; Neighbour < 27; ++Neighbour)
+		{
+			const FIntVector NeighbourCoord = Candidates[CandidateIndex] + FIntVector(Neighbour % 3 - 1, (Neighbour / 3) % 3 - 1, Neighbour / 9 - 1);
+			const FOccupancyLeaf* NeighbourLeaf = Occupancy.Find(NeighbourCoord);
+			if (!NeighbourLeaf)
+			{
+				continue;
+			}
+			const FIntVector First = NeighbourCoord * 8 - BlockOrigin;
+			for (int32 X = FMath::Max(First.X, 0); X < FMath::Min(First.X + 8, BlockDim); ++X)
+			{
+				for (int32 Y = FMath::Max(First.Y, 0); Y < FMath::Min(First.Y + 8, BlockDim); ++Y)
+				{
+					for (int32 Z = FMath::Max(First.Z, 0); Z < FMath::Min(First.Z + 8, BlockDim); ++Z)
+					{
+						Block[(X * BlockDim + Y) * BlockDim + Z] = NeighbourLeaf->Colors[((X - First.X) << 6) | ((Y - First.Y) << 3) | (Z - First.Z)];
+					}
+				}
+			}
+		}
+
+		// Without both states around it the leaf is entirely inside or outside the band
+		int32 NumSolid = 0;
+		for (const uint8 Color : Block)
+		{
+			NumSolid += Color != 0;
+		}
+		if (NumSolid == 0 || NumSolid == Block.Num())
+		{
+			Inside[CandidateIndex] = NumSolid != 0;
+			return;
+		}
+
+		const FIntVector ChunkOrigin = FIntVector(SceneOrigin.X / ChunkSize, SceneOrigin.Y / ChunkSize, SceneOrigin.Z / ChunkSize) * ChunkSize;
+		const FIntVector LocalOrigin = SceneOrigin - ChunkOrigin;
+		FBuildLeaf* Leaf = new FBuildLeaf(nanovdb::Coord(LocalOrigin.X, LocalOrigin.Y, LocalOrigin.Z), Background, false);
+		FBuildMaterialLeaf* MaterialLeaf = new FBuildMaterialLeaf(nanovdb::Coord(LocalOrigin.X, LocalOrigin.Y, LocalOrigin.Z), 0, false);
+		bool bAllInside = true;
+		for (uint32 Offset = 0; Offset < FBuildLeaf::SIZE; ++Offset)
+		{
+			const FIntVector Local(Offset >> 6, (Offset >> 3) & 7, Offset & 7);
+			const FIntVector BlockCoord = Local + FIntVector(Radius);
+			const int32 BlockIndex = (BlockCoord.X * BlockDim + BlockCoord.Y) * BlockDim + BlockCoord.Z;
+			const uint8 Color = Block[BlockIndex];
+			float Distance = BandWidth;
+			uint8 Material = Color;
+			for (const FOffset& Candidate : Offsets)
+			{
+				const uint8 OtherColor = Block[BlockIndex + Candidate.Delta];
+				if ((OtherColor != 0) != (Color != 0))
+				{
+					Distance = Candidate.Distance;
+					Material = Color ? Color : OtherColor;
+					break;
+				}
+			}
+
+			const float Value = (Color ? -Distance : Distance) * Settings.VoxelSize;
+			const FIntVector SceneCoord = SceneOrigin + Local;
+			Leaf->mValues[Offset] = Value;
+			MaterialLeaf->mValues[Offset] = Material;
+			if (Distance < BandWidth && SceneCoord.X >= 0 && SceneCoord.Y >= 0 && SceneCoord.Z >= 0
+				&& SceneCoord.X < SceneSize.X && SceneCoord.Y < SceneSize.Y && SceneCoord.Z < SceneSize.Z)
+			{
+				Leaf->mValueMask.setOn(Offset);
+				MaterialLeaf->mValueMask.setOn(Offset);
+			}
+			bAllInside &= Value < 0.0f;
+		}
+
+		if (Leaf->mValueMask.isOff())
+		{
+			Inside[CandidateIndex] = bAllInside;
+			delete Leaf;
+			delete MaterialLeaf;
+			return;
+		}
+		Leaves[CandidateIndex] = Leaf;
+		MaterialLeaves[CandidateIndex] = MaterialLeaf;
+	});
+
+	struct FChunk
+	{
+		TUniquePtr<FBuildGrid> Grid;
+		TUniquePtr<FBuildMaterialGrid> MaterialGrid;
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle;
+		nanovdb::GridHandle<nanovdb::HostBuffer> MaterialHandle;
+	};
+	TMap<FIntVector, FChunk> Chunks;
+	uint32 NumLeaves = 0;
+	for (int32 CandidateIndex = 0; CandidateIndex < Candidates.Num(); ++CandidateIndex)
+	{
+		const FIntVector SceneOrigin = Candidates[CandidateIndex] * 8 - SceneMin;
+		const FIntVector ChunkCoord(SceneOrigin.X / ChunkSize, SceneOrigin.Y / ChunkSize, SceneOrigin.Z / ChunkSize);
+		if (FBuildLeaf* Leaf = Leaves[CandidateIndex])
+		{
+			FChunk& Chunk = Chunks.FindOrAdd(ChunkCoord);
+			if (!Chunk.Grid)
+			{
+				const FIntVector ChunkOrigin = SceneMin + ChunkCoord * ChunkSize;
+				const nanovdb::Vec3d Translation = nanovdb::Vec3d(ChunkOrigin.X, ChunkOrigin.Y, ChunkOrigin.Z) * Settings.VoxelSize;
+				Chunk.Grid = MakeUnique<FBuildGrid>(Background, "vox", nanovdb::GridClass::LevelSet);
+				Chunk.Grid->setTransform(Settings.VoxelSize, Translation);
+				Chunk.MaterialGrid = MakeUnique<FBuildMaterialGrid>(0, "palette", nanovdb::GridClass::Unknown);
+				Chunk.MaterialGrid->setTransform(Settings.VoxelSize, Translation);
+			}
+			NumLeaves += FVoxelChunkGrid::AddLeaf(*Chunk.Grid, Leaf, false, FIntVector::ZeroValue);
+			Chunk.MaterialGrid->root().addNode(MaterialLeaves[CandidateIndex]);
+		}
+	}
+	for (int32 CandidateIndex = 0; CandidateIndex < Candidates.Num(); ++CandidateIndex)
+	{
+		// Inside tiles only matter in chunks with a surface
+		const FIntVector SceneOrigin = Candidates[CandidateIndex] * 8 - SceneMin;
+		const FIntVector ChunkCoord(SceneOrigin.X / ChunkSize, SceneOrigin.Y / ChunkSize, SceneOrigin.Z / ChunkSize);
+		FChunk* Chunk = Inside[CandidateIndex] ? Chunks.Find(ChunkCoord) : nullptr;
+		if (Chunk)
+		{
+			FVoxelChunkGrid::AddLeaf(*Chunk->Grid, nullptr, true, SceneOrigin - ChunkCoord * ChunkSize);
+		}
+	}
+
+	TArray<FIntVector> ChunkCoords;
+	Chunks.GetKeys(ChunkCoords);
+	ChunkCoords.Sort([](const FIntVector& A, const FIntVector& B)
+	{
+		return A.Z != B.Z ? A.Z < B.Z : A.Y != B.Y ? A.Y < B.Y : A.X < B.X;
+	});
+	const double DistanceSeconds = FPlatformTime::Seconds() - StartTime;
+
+	// Chunks are encoded in batches and handed over right away, so only a batch of encoded chunks is held
+	const int32 BatchSize = FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads() * 4, 16);
+	double EncodeSeconds = 0.0;
+	for (int32 BatchStart = 0; BatchStart < ChunkCoords.Num(); BatchStart += BatchSize)
+	{
+		if (!OnProgress(BatchStart, ChunkCoords.Num()))
+		{
+			return false;
+		}
+		const int32 BatchNum = FMath::Min(BatchSize, ChunkCoords.Num() - BatchStart);
+		StartTime = FPlatformTime::Seconds();
+		ParallelFor(BatchNum, [&](int32 BatchIndex)
+		{
+			const FIntVector& ChunkCoord = ChunkCoords[BatchStart + BatchIndex];
+			FChunk& Chunk = Chunks[ChunkCoord];
+
+			const FIntVector Extent(
+				FMath::Min(ChunkSize, SceneSize.X - ChunkCoord.X * ChunkSize),
+				FMath::Min(ChunkSize, SceneSize.Y - ChunkCoord.Y * ChunkSize),
+				FMath::Min(ChunkSize, SceneSize.Z - ChunkCoord.Z * ChunkSize));
+			Chunk.Handle = FVoxelChunkGrid::Encode(*Chunk.Grid, Extent);
+			Chunk.MaterialHandle = FVoxelChunkGrid::Encode<uint8_t>(*Chunk.MaterialGrid, Extent);
+			Chunk.Grid.Reset();
+			Chunk.MaterialGrid.Reset();
+		});
+		EncodeSeconds += FPlatformTime::Seconds() - StartTime;
+
+		for (int32 Index = BatchStart; Index < BatchStart + BatchNum; ++Index)
+		{
+			FChunk Chunk = Chunks.FindAndRemoveChecked(ChunkCoords[Index]);
+			if (!OnChunk(ChunkCoords[Index], MoveTemp(Chunk.Handle), MoveTemp(Chunk.MaterialHandle)))
+			{
+				return false;
+			}
+		}
+	}
+
+	if (OutStats)
+	{
+		OutStats->RasterizeSeconds = RasterizeSeconds;
+		OutStats->DistanceSeconds = DistanceSeconds;
+		OutStats->EncodeSeconds = EncodeSeconds;
+		OutStats->NumVoxels = NumVoxels;
+		OutStats->NumChunks = ChunkCoords.Num();
+		OutStats->NumLeaves = NumLeaves;
+	}
+	return true;
+}
+
+bool FVoxelVoxImporter::ImportFile(const FString& Filename, const FVoxelVoxSettings& Settings, FOnChunk OnChunk, FOnProgress OnProgress, TArray<FColor>* OutPalette, FStats* OutStats)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+	{
+		UE_LOG(LogVoxelMesh, Error, TEXT("Cannot open %s"), *Filename);
+		return false;
+	}
+
+	FVoxelVoxScene Scene;
+	if (!Scene.Load(Bytes))
+	{
+		UE_LOG(LogVoxelMesh, Error, TEXT("%s is not a valid .vox file"), *Filename);
+		return false;
+	}
+	if (OutPalette)
+	{
+		*OutPalette = Scene.Palette;
+	}
+	return Import(Scene, Settings, OnChunk, OnProgress, OutStats);
+}
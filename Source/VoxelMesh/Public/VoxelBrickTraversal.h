@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Cube traversal ordered by 8^3 bricks (the size of a NanoVDB leaf), Morton (Z-order) inside each brick.
+ * Consecutive traversal ids stay inside the same leaf, so neighbouring threads/iterations reuse the read accessor cache.
+ * Must match VoxelBrickTraversal.ush.
+ */
+struct FVoxelBrickTraversal
+{
+	static constexpr uint32 BrickLog2Dim = 3;
+	static constexpr uint32 BrickDim = 1u << BrickLog2Dim;
+	static constexpr uint32 BrickSize = BrickDim * BrickDim * BrickDim;
+
+	FVoxelBrickTraversal(uint32 InVoxelSizeX, uint32 InVoxelSizeY, uint32 InVoxelSizeZ)
+		: VoxelSize(InVoxelSizeX, InVoxelSizeY, InVoxelSizeZ)
+		, BrickCount(FMath::DivideAndRoundUp<int32>(InVoxelSizeX, BrickDim),
+		             FMath::DivideAndRoundUp<int32>(InVoxelSizeY, BrickDim),
+		             FMath::DivideAndRoundUp<int32>(InVoxelSizeZ, BrickDim))
+	{
+	}
+
+	/// Spread the lower 3 bits of Value so that there are two zero bits between each of them
+	static FORCEINLINE uint32 SpreadBits3(uint32 Value)
+	{
+		return (Value & 1u) | ((Value & 2u) << 2) | ((Value & 4u) << 4);
+	}
+
+	static FORCEINLINE uint32 CompactBits3(uint32 Value)
+	{
+		return (Value & 1u) | ((Value >> 2) & 2u) | ((Value >> 4) & 4u);
+	}
+
+	/// z is the least significant axis to match the NanoVDB leaf layout
+	static FORCEINLINE uint32 EncodeMorton(uint32 X, uint32 Y, uint32 Z)
+	{
+		return SpreadBits3(Z) | (SpreadBits3(Y) << 1) | (SpreadBits3(X) << 2);
+	}
+
+	static FORCEINLINE FIntVector DecodeMorton(uint32 Code)
+	{
+		return FIntVector(CompactBits3(Code >> 2), CompactBits3(Code >> 1), CompactBits3(Code));
+	}
+
+	FORCEINLINE uint32 GetNumBricks() const
+	{
+		return BrickCount.X * BrickCount.Y * BrickCount.Z;
+	}
+
+	/// Number of traversal ids, including the padding of partially covered bricks
+	FORCEINLINE uint32 GetNumTraversalIds() const
+	{
+		return GetNumBricks() * BrickSize;
+	}
+
+	FORCEINLINE FIntVector GetBrickCoord(uint32 BrickIndex) const
+	{
+		const uint32 Z = BrickIndex % BrickCount.Z;
+		const uint32 XY = BrickIndex / BrickCount.Z;
+		const uint32 Y = XY % BrickCount.Y;
+		const uint32 X = XY / BrickCount.Y;
+		return FIntVector(X, Y, Z);
+	}
+
+	FORCEINLINE uint32 GetBrickIndex(const FIntVector& BrickCoord) const
+	{
+		return BrickCoord.Z + BrickCount.Z * (BrickCoord.Y + BrickCount.Y * BrickCoord.X);
+	}
+
+	FORCEINLINE FIntVector GetCoordByTraversalId(uint32 TraversalId) const
+	{
+		const FIntVector BrickCoord = GetBrickCoord(TraversalId >> (3 * BrickLog2Dim));
+		return BrickCoord * BrickDim + DecodeMorton(TraversalId & (BrickSize - 1));
+	}
+
+	FORCEINLINE uint32 GetTraversalIdByCoord(const FIntVector& Coord) const
+	{
+		const FIntVector BrickCoord(Coord.X >> BrickLog2Dim, Coord.Y >> BrickLog2Dim, Coord.Z >> BrickLog2Dim);
+		return (GetBrickIndex(BrickCoord) << (3 * BrickLog2Dim)) | EncodeMorton(Coord.X & (BrickDim - 1), Coord.Y & (BrickDim - 1), Coord.Z & (BrickDim - 1));
+	}
+
+	FORCEINLINE bool IsInside(const FIntVector& Coord) const
+	{
+		return Coord.X >= 0 && Coord.Y >= 0 && Coord.Z >= 0 && Coord.X < VoxelSize.X && Coord.Y < VoxelSize.Y && Coord.Z < VoxelSize.Z;
+	}
+
+	FIntVector VoxelSize;
+	FIntVector BrickCount;
+};
@@ -0,0 +1,106 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelBrush.generated.h"
+
+// How a brush is combined with the level set
+UENUM(BlueprintType)
+enum class EVoxelBrushOperation : uint8
+{
+	// Add the brush volume (building)
+	Union,
+
+	// Remove the brush volume (digging)
+	Subtract,
+
+	// Keep only what is inside the brush, affects the whole chunk
+	Intersect
+};
+
+UENUM(BlueprintType)
+enum class EVoxelBrushShape : uint8
+{
+	Sphere,
+	Box,
+	// Segment along the local Z axis with a radius
+	Capsule
+};
+
+/**
+ * Brush given by any signed distance, in voxels of the chunk and negative inside.
+ * Sdf must be thread safe and never overestimate the distance: leaves further than the narrow band from the surface are skipped.
+ */
+struct VOXELMESH_API FVoxelSdfBrush
+{
+	TFunction<float(const FVector3f&)> Sdf;
+	/// Where Sdf is negative
+	FBox3f Bounds;
+	EVoxelBrushOperation Operation = EVoxelBrushOperation::Union;
+	/// Width of the polynomial smooth min/max blend, 0 for sharp edges
+	float Smoothness = 0.0f;
+
+	/// Combine a level set value with a brush distance, both in the same units
+	static FORCEINLINE float Blend(EVoxelBrushOperation Operation, float Value, float Distance, float Smoothness)
+	{
+		switch (Operation)
+		{
+		case EVoxelBrushOperation::Union:
+			return SmoothMin(Value, Distance, Smoothness);
+		case EVoxelBrushOperation::Subtract:
+			return -SmoothMin(-Value, Distance, Smoothness);
+		default:
+			return -SmoothMin(-Value, -Distance, Smoothness);
+		}
+	}
+
+	static FORCEINLINE float SmoothMin(float A, float B, float Smoothness)
+	{
+		if (Smoothness <= 0.0f)
+		{
+			return FMath::Min(A, B);
+		}
+		const float H = FMath::Clamp(0.5f + 0.5f * (B - A) / Smoothness, 0.0f, 1.0f);
+		return FMath::Lerp(B, A, H) - Smoothness * H * (1.0f - H);
+	}
+};
+
+/**
+ * Signed distance brush of UVoxelChunkView::ApplyBrush, placed in the voxel coordinates of the chunk.
+ */
+USTRUCT(BlueprintType)
+struct VOXELMESH_API FVoxelBrush
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Brush")
+	EVoxelBrushShape Shape = EVoxelBrushShape::Sphere;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Brush")
+	EVoxelBrushOperation Operation = EVoxelBrushOperation::Union;
+
+	/** Center in voxels of the chunk */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Brush")
+	FVector Center = FVector::ZeroVector;
+
+	/** Orientation of the box and the capsule */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Brush")
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	/** Radius of the sphere and the capsule, in voxels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Brush", meta = (ClampMin = 0.0))
+	float Radius = 4.0f;
+
+	/** Half size of the box, in voxels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Brush")
+	FVector HalfExtent = FVector(4.0);
+
+	/** Half length of the capsule segment, in voxels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Brush", meta = (ClampMin = 0.0))
+	float HalfHeight = 4.0f;
+
+	/** Width of the smooth blend with the level set in voxels, 0 for sharp edges */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Brush", meta = (ClampMin = 0.0))
+	float Smoothness = 0.0f;
+
+	FVoxelSdfBrush ToSdfBrush() const;
+};
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+
+/**
+ * Samples one voxel past the positive faces of a chunk, read from the chunks following it.
+ * With an apron the chunk meshes the cells up to its neighbours, which start at their own voxel 0:
+ * adjacent chunks meet, and every cell is meshed by exactly one of them (the one at its negative corner).
+ * Planes are stored one after the other (X, Y, Z), each over the two other axes in order, the last one fastest.
+ * Must match SampleApron in MarchingCubesCS.usf.
+ */
+struct VOXELMESH_API FVoxelChunkApron
+{
+	using FGridType = nanovdb::NanoGrid<nanovdb::Fp4>;
+
+	/// Grids by offset bits: 1 for +X, 2 for +Y, 4 for +Z. Index 0 is the chunk itself, missing neighbours are null.
+	using FNeighbourGrids = TStaticArray<const FGridType*, 8>;
+
+	static FVoxelChunkApron Build(const FIntVector& InVoxelSize, const FNeighbourGrids& Grids);
+
+	bool IsEmpty() const { return Faces == 0; }
+
+	FORCEINLINE bool HasFace(int32 Axis) const { return (Faces >> Axis) & 1; }
+
+	/// Size of the chunk once the apron is appended to it
+	FORCEINLINE FIntVector GetPaddedVoxelSize() const
+	{
+		return VoxelSize + FIntVector(Faces & 1, (Faces >> 1) & 1, (Faces >> 2) & 1);
+	}
+
+	/// Whether a coordinate of the padded chunk (already clamped to it) lies in the apron
+	FORCEINLINE bool Contains(const FIntVector& Coord) const
+	{
+		return (HasFace(0) && Coord.X == VoxelSize.X) || (HasFace(1) && Coord.Y == VoxelSize.Y) || (HasFace(2) && Coord.Z == VoxelSize.Z);
+	}
+
+	FORCEINLINE float Sample(const FIntVector& Coord) const
+	{
+		const int32 Axis = (HasFace(0) && Coord.X == VoxelSize.X) ? 0 : ((HasFace(1) && Coord.Y == VoxelSize.Y) ? 1 : 2);
+		return Values[GetPlaneOffset(Axis) + GetPlaneIndex(Axis, Coord)];
+	}
+
+	FORCEINLINE int32 GetPlaneOffset(int32 Axis) const
+	{
+		const FIntVector PaddedVoxelSize = GetPaddedVoxelSize();
+		int32 Offset = 0;
+		for (int32 PlaneAxis = 0; PlaneAxis < Axis; ++PlaneAxis)
+		{
+			if (HasFace(PlaneAxis))
+			{
+				Offset += PaddedVoxelSize[(PlaneAxis + 1) % 3] * PaddedVoxelSize[(PlaneAxis + 2) % 3];
+			}
+		}
+		return Offset;
+	}
+
+	FORCEINLINE int32 GetPlaneIndex(int32 Axis, const FIntVector& Coord) const
+	{
+		const int32 AxisU = Axis == 0 ? 1 : 0;
+		const int32 AxisV = Axis == 2 ? 1 : 2;
+		return Coord[AxisU] * (VoxelSize[AxisV] + HasFace(AxisV)) + Coord[AxisV];
+	}
+
+	/// Size of the chunk without its apron
+	FIntVector VoxelSize = FIntVector::ZeroValue;
+	/// Bit per axis with a neighbour
+	uint32 Faces = 0;
+	TArray<float> Values;
+};
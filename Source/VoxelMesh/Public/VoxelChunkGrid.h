@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+
+/**
+ * Assembles the level set of a chunk, shared by the generators, importers and FVoxelEditableGrid::Bake. Leaves near the
+ * surface are moved in as they are, the leaves skipped away from it become inside tiles or stay background. The encoded
+ * grid gets the chunk extent as its index bounding box, so the size of a chunk view doesn't depend on its active voxels.
+ */
+struct VOXELMESH_API FVoxelChunkGrid
+{
+	using FBuildGrid = nanovdb::tools::build::Grid<float>;
+	using FBuildLeaf = nanovdb::tools::build::LeafNode<float>;
+
+	/**
+	 * Move a leaf to the grid, which takes ownership. A null leaf was skipped: the leaf sized tile at LeafOrigin is set to
+	 * the inside background when bInside. Returns whether a leaf was added.
+	 */
+	static bool AddLeaf(FBuildGrid& Grid, FBuildLeaf* Leaf, bool bInside, const FIntVector& LeafOrigin);
+
+	/// Same for every leaf of a generator, GetLeafOrigin gives the origin of a leaf index. Returns the number of leaves added.
+	static uint32 AddLeaves(FBuildGrid& Grid, TConstArrayView<FBuildLeaf*> Leaves, TConstArrayView<uint8> Inside, TFunctionRef<FIntVector(int32 LeafIndex)> GetLeafOrigin);
+
+	/// Encode a build grid with [0, Extent) as its index bounding box, whatever its active voxels
+	template<typename DstBuildT = nanovdb::Fp4, typename SrcGridT>
+	static nanovdb::GridHandle<nanovdb::HostBuffer> Encode(const SrcGridT& Grid, const FIntVector& Extent)
+	{
+		nanovdb::GridHandle<nanovdb::HostBuffer> Handle = nanovdb::tools::createNanoGrid<SrcGridT, DstBuildT>(Grid);
+		SetExtent(*Handle.template grid<DstBuildT>(), Extent);
+		return Handle;
+	}
+
+	/// The bounding boxes are part of the checksum, it is updated with them
+	template<typename BuildT>
+	static void SetExtent(nanovdb::NanoGrid<BuildT>& Grid, const FIntVector& Extent)
+	{
+		const nanovdb::CoordBBox IndexBBox(nanovdb::Coord(0), nanovdb::Coord(Extent.X - 1, Extent.Y - 1, Extent.Z - 1));
+		Grid.tree().root().data()->mBBox = IndexBBox;
+		Grid.data()->mWorldBBox = nanovdb::CoordBBox(IndexBBox.min(), IndexBBox.max().offsetBy(1)).transform(Grid.map());
+		nanovdb::tools::updateChecksum(Grid.data());
+	}
+};
@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelChunkStreamer.generated.h"
+
+/// Where a chunk is on its way to the screen, see FVoxelChunkStreamer
+UENUM(BlueprintType)
+enum class EVoxelChunkStreamingState : uint8
+{
+	Unloaded,
+	/// Data requested
+	Loading,
+	/// Data in memory, waiting to be meshed
+	Loaded,
+	Meshing,
+	/// Mesh built, waiting to be handed to the renderer
+	Meshed,
+	Visible,
+	/// Nothing to draw, the chunk has no surface or failed to load
+	Empty
+};
+
+USTRUCT(BlueprintType)
+struct VOXELMESH_API FVoxelStreamingSettings
+{
+	GENERATED_BODY()
+
+	/** Chunk (X, Y, Z) spans [X, X + 1] * ChunkWorldSize along X, and so on */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Streaming", meta = (ClampMin = 1.0))
+	float ChunkWorldSize = 12800.0f;
+
+	/** Chunks closer than this to a view are loaded, meshed and drawn */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Streaming", meta = (ClampMin = 0.0))
+	float LoadDistance = 25600.0f;
+
+	/** Chunks further than this from every view are released. Past LoadDistance, so the chunks at the border don't come and go every frame. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Streaming", meta = (ClampMin = 0.0))
+	float UnloadDistance = 38400.0f;
+
+	/** Loads started per update, closest chunks first */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Streaming", meta = (ClampMin = 1))
+	int32 MaxLoadsPerFrame = 4;
+
+	/** Meshes started per update, closest chunks first */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Streaming", meta = (ClampMin = 1))
+	int32 MaxMeshesPerFrame = 2;
+
+	/** Meshed chunks handed to the renderer per update, closest chunks first */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Streaming", meta = (ClampMin = 1))
+	int32 MaxUploadsPerFrame = 4;
+};
+
+USTRUCT(BlueprintType)
+struct VOXELMESH_API FVoxelStreamingStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 NumRegistered = 0;
+
+	/** Chunks waiting for a load once the budget of the update is spent */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 PendingLoads = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 PendingMeshes = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 PendingUploads = 0;
+
+	/** Started by an update and not done yet */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 LoadsInFlight = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 MeshesInFlight = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 NumVisible = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 NumEmpty = 0;
+
+	/** Work handed out by the last update */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 NumLoadsStarted = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 NumMeshesStarted = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 NumUploadsStarted = 0;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Voxel | Streaming")
+	int32 NumUnloaded = 0;
+};
+
+/**
+ * Decides which chunks to stream from the distance of their bounds to the view origins, see UVoxelRenderingWorldSubsystem.
+ * Chunks are kept in a spatial hash by coordinate and go through EVoxelChunkStreamingState: the owner does the work handed
+ * out by Update and reports the loads and meshes done. Loads, meshes and uploads each have a budget per update, spent on the
+ * closest chunks first, and chunks are only released past UnloadDistance.
+ */
+class VOXELMESH_API FVoxelChunkStreamer
+{
+public:
+	struct FUpdate
+	{
+		/// Now Loading
+		TArray<FIntVector> ToLoad;
+		/// Now Meshing
+		TArray<FIntVector> ToMesh;
+		/// Now Visible
+		TArray<FIntVector> ToUpload;
+		/// Now Unloaded, whatever they were doing
+		TArray<FIntVector> ToUnload;
+
+		void Reset()
+		{
+			ToLoad.Reset();
+			ToMesh.Reset();
+			ToUpload.Reset();
+			ToUnload.Reset();
+		}
+	};
+
+	void AddChunk(const FIntVector& ChunkCoord);
+
+	/// State the chunk was in, for the owner to release what it holds
+	EVoxelChunkStreamingState RemoveChunk(const FIntVector& ChunkCoord);
+
+	EVoxelChunkStreamingState GetState(const FIntVector& ChunkCoord) const;
+
+	/// Report a load or a mesh done (Loaded, Meshed or Empty), ignored when the chunk was unloaded since
+	void SetState(const FIntVector& ChunkCoord, EVoxelChunkStreamingState NewState);
+
+	/// Without any view origin nothing is loaded nor released
+	void Update(TConstArrayView<FVector> ViewOrigins, const FVoxelStreamingSettings& Settings, FUpdate& OutUpdate);
+
+	const FVoxelStreamingStats& GetStats() const { return Stats; }
+
+	/// Distance from a position to the bounds of a chunk, 0 inside
+	static double GetDistance(const FIntVector& ChunkCoord, const FVector& Position, double ChunkWorldSize);
+
+private:
+	TMap<FIntVector, EVoxelChunkStreamingState> Chunks;
+	/// Chunks not Unloaded, the only ones visited every update besides the ones in range
+	TSet<FIntVector> ActiveChunks;
+	FVoxelStreamingStats Stats;
+};
@@ -3,18 +3,26 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Containers/Ticker.h"
 
 #if WITH_EDITOR
 #include "AssetTypeActions_Base.h"
 #endif // WITH_EDITOR
 
 #include "UObject/Object.h"
+#include "VoxelBrush.h"
+#include "VoxelChunkApron.h"
+#include "VoxelEditableGrid.h"
+#include "VoxelGridPyramid.h"
+#include "VoxelMeshBuildHandoff.h"
+#include "VoxelMeshSectionLayout.h"
 #include "VoxelRHIUtility.h"
 #include "VoxelVdbCommon.h"
 #include "VoxelChunkView.generated.h"
 
 class FVoxelMarchingCubesUniforms;
 struct FVoxelChunkViewRHIProxy;
+struct FVoxelCpuMeshData;
 
 DECLARE_MULTICAST_DELEGATE(FVoxelChunkMeshBuildFinishedDelegate);
 
@@ -26,8 +34,36 @@ enum class EVoxelMeshGenerationMode : uint8
 	PerformanceOptimized UMETA(DisplayName = "Performance Optimized"),
 	
 	// Read counter buffer to allocate exact buffer size (slower, saves memory)
-	MemoryOptimized UMETA(DisplayName = "Memory Optimized")
+	MemoryOptimized UMETA(DisplayName = "Memory Optimized"),
+
+	// Generate the mesh on worker threads with the CPU mesher and upload it (reference for the compute passes)
+	CpuReference UMETA(DisplayName = "CPU Reference")
+};
+
+// Meshing algorithms
+UENUM(BlueprintType)
+enum class EVoxelMeshingAlgorithm : uint8
+{
+	// Marching cubes, generated by the compute passes or by the CPU reference mesher
+	MarchingCubes UMETA(DisplayName = "Marching Cubes"),
+
+	// Naive surface nets, one vertex per surface cell and one quad per crossed edge (always generated on the CPU)
+	SurfaceNets UMETA(DisplayName = "Surface Nets")
+};
+
+// Faces of a chunk, as a bitmask of the neighbours one level of detail coarser than the chunk
+UENUM(BlueprintType, meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class EVoxelTransitionFace : uint8
+{
+	None = 0 UMETA(Hidden),
+	NegativeX = 1 << 0,
+	PositiveX = 1 << 1,
+	NegativeY = 1 << 2,
+	PositiveY = 1 << 3,
+	NegativeZ = 1 << 4,
+	PositiveZ = 1 << 5,
 };
+ENUM_CLASS_FLAGS(EVoxelTransitionFace);
 
 UCLASS(BlueprintType, EditInlineNew)
 class VOXELMESH_API UVoxelChunkView : public UObject
@@ -46,15 +82,38 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	bool IsEmpty() const;
 
+	/** Whether the grid has leaves, the surface only crosses them: tiles are wholly inside or outside */
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool HasSurface() const;
+
+	/**
+	 * Queue a rebuild of the mesh, started when it fits in the budget of the frame (see FVoxelMeshRebuildScheduler).
+	 * @param Urgency	Raises the priority of the rebuild, for changes the player is waiting for
+	 */
 	UFUNCTION(BlueprintCallable)
-	void RebuildMesh();
+	void RebuildMesh(float Urgency = 0.0f);
 
 	TSharedPtr<FVoxelChunkViewRHIProxy> GetRHIProxy();
 
 	void MarkAsDirty();
 
+	/// Drop the render side: the mesh, its GPU buffers and the levels of detail are freed once the work in flight is done. MarkAsDirty builds it again.
+	void ReleaseRHIProxy();
+
 	void SetVdbBuffer_GameThread(nanovdb::GridHandle<nanovdb::HostBuffer>&& NewBuffer);
 
+	/**
+	 * Replace the grid and queue a rebuild, for grids replaced every frame. While a mesh is generating the grid waits for it,
+	 * only the newest one is kept: every mesh started lands instead of being cancelled by the next grid.
+	 */
+	void QueueVdbBuffer_GameThread(nanovdb::GridHandle<nanovdb::HostBuffer>&& NewBuffer);
+
+	/**
+	 * Replace the grid after an edit of the voxels in [DirtyMin, DirtyMax]. While the size stays the same, the current mesh is
+	 * kept and only its sections using these voxels are meshed again (marching cubes in CpuReference mode only).
+	 */
+	void UpdateVdbBuffer_GameThread(nanovdb::GridHandle<nanovdb::HostBuffer>&& NewBuffer, const FIntVector& DirtyMin, const FIntVector& DirtyMax);
+
 	UFUNCTION(BlueprintSetter)
 	void UpdateSurfaceIsoValue(float NewValue);
 
@@ -77,6 +136,135 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Voxel")
 	EVoxelMeshGenerationMode GetGenerationMode() const { return MeshGenerationMode; }
 
+	/** The algorithm extracting the surface */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel")
+	EVoxelMeshingAlgorithm MeshingAlgorithm = EVoxelMeshingAlgorithm::MarchingCubes;
+
+	/** Get the current meshing algorithm */
+	UFUNCTION(BlueprintCallable, Category = "Voxel")
+	EVoxelMeshingAlgorithm GetMeshingAlgorithm() const { return MeshingAlgorithm; }
+
+	/** Number of levels of detail, every level halves the resolution of the previous one */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | LOD", meta = (ClampMin = 1, ClampMax = 4))
+	int32 NumLods = FVoxelGridPyramid::MaxNumLevels;
+
+	/** Screen size under which the first coarse level is drawn, every next level halves it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | LOD", meta = (ClampMin = 0.0))
+	float LodScreenSize = 0.5f;
+
+	/** Mesh another level of detail, coarse levels are built the first time they are used */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | LOD")
+	void SetLodIndex(int32 NewLodIndex);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Voxel | LOD")
+	int32 GetLodIndex() const { return LodIndex; }
+
+	/**
+	 * Faces bordering a chunk drawn one level of detail coarser. Marching cubes stitch these faces to the coarse samples
+	 * so both chunks meet without cracks, chunk sizes must be odd (2^n + 1) for the samples to line up.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, BlueprintSetter = SetTransitionFaces, Category = "Voxel | LOD", meta = (Bitmask, BitmaskEnum = "/Script/VoxelMesh.EVoxelTransitionFace"))
+	int32 TransitionFaces = 0;
+
+	UFUNCTION(BlueprintSetter)
+	void SetTransitionFaces(int32 NewTransitionFaces);
+
+	/**
+	 * Set the chunk starting right after this one along Offset, (1, 0, 0), (0, 1, 0), (0, 0, 1) or one of their sums.
+	 * The chunk then also meshes the cells up to its neighbours, reading their first voxels as an apron, so adjacent chunks meet.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Voxel")
+	void SetNeighbour(FIntVector Offset, UVoxelChunkView* Neighbour);
+
+	/**
+	 * Box holding the mesh in the space of the component: meshes are normalized to [-0.5, 0.5], and the cells meshed up to
+	 * a neighbour go one cell past 0.5 on that axis.
+	 */
+	FBox GetLocalBounds() const;
+
+	/** Keep a write-friendly copy of the grid, edited by SetVoxelValue and baked back by RebakeEdits */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Editing")
+	void BeginEditing();
+
+	/** Bake the pending edits and drop the editable copy */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Editing")
+	void EndEditing();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Voxel | Editing")
+	bool IsEditing() const { return EditableGrid.IsValid(); }
+
+	/** Only while editing, the voxel shows up on the next RebakeEdits */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Editing")
+	void SetVoxelValue(FIntVector Coord, float Value);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Voxel | Editing")
+	float GetVoxelValue(FIntVector Coord) const;
+
+	/** Serialize the edits made since the last bake to the grid and remesh the sections they touch */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Editing")
+	void RebakeEdits();
+
+	/**
+	 * Queue a brush, starting to edit if needed. The brushes of a frame are applied together at the end of it,
+	 * then baked once and only the sections they touch are remeshed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Editing")
+	void ApplyBrush(const FVoxelBrush& Brush);
+
+	/// Queue a brush with any signed distance, see FVoxelSdfBrush
+	void ApplySdfBrush(FVoxelSdfBrush&& Brush);
+
+	/** Apply the queued brushes now instead of at the end of the frame */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Editing")
+	void FlushBrushes();
+
+	/**
+	 * Make the edits up to EndEditTransaction a single undo step, a brush stroke for instance.
+	 * Otherwise every rebake is one step.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Editing")
+	void BeginEditTransaction();
+
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Editing")
+	void EndEditTransaction();
+
+	/** Restore the leaves changed by the last step and remesh their sections. The history is dropped by EndEditing. */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Editing")
+	bool UndoEdit();
+
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Editing")
+	bool RedoEdit();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Voxel | Editing")
+	bool CanUndoEdit() const { return EditableGrid && EditableGrid->CanUndo(); }
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Voxel | Editing")
+	bool CanRedoEdit() const { return EditableGrid && EditableGrid->CanRedo(); }
+
+	/// Null unless editing
+	FVoxelEditableGrid* GetEditableGrid() const { return EditableGrid.Get(); }
+
+	/** Memory kept for undo while editing, the oldest steps are dropped past it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Editing", meta = (ClampMin = 0))
+	int32 UndoHistoryMiB = 64;
+
+	/**
+	 * Palette indices of the voxels, a uint8 grid in the index space of the level set, written by importers like
+	 * FVoxelVoxImporter. Edits don't change it.
+	 */
+	void SetMaterialBuffer_GameThread(nanovdb::GridHandle<nanovdb::HostBuffer>&& NewBuffer);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Voxel | Materials")
+	bool HasMaterials() const { return !MaterialBulkData.IsEmpty(); }
+
+	/** Palette index of a voxel, 0 without materials */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Voxel | Materials")
+	int32 GetVoxelMaterial(FIntVector Coord) const;
+
+	/** Colors of the palette indices */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Materials")
+	TArray<FColor> Palette;
+
 protected:
 	UPROPERTY(VisibleAnywhere, Category = "Voxel | Debug")
 	uint32 DimensionX;
@@ -87,11 +275,33 @@ protected:
 	UPROPERTY(VisibleAnywhere, Category = "Voxel | Debug")
 	uint32 DimensionZ;
 
+	UPROPERTY(VisibleAnywhere, Transient, Category = "Voxel | Debug")
+	int32 LodIndex = 0;
+
+	/// By offset bits: 1 for +X, 2 for +Y, 4 for +Z (see FVoxelChunkApron), the first one is unused
+	UPROPERTY(Transient)
+	TObjectPtr<UVoxelChunkView> Neighbours[8];
+
 	nanovdb::GridHandle<nanovdb::HostBuffer> HostVdbBuffer;
 
 	UPROPERTY()
 	TArray<uint8> VdbBulkData;
 
+	nanovdb::GridHandle<nanovdb::HostBuffer> HostMaterialBuffer;
+
+	UPROPERTY()
+	TArray<uint8> MaterialBulkData;
+
+	/// Replaced by SetVdbBuffer_GameThread, see BeginEditing
+	TUniquePtr<FVoxelEditableGrid> EditableGrid;
+
+	TArray<FVoxelSdfBrush> PendingBrushes;
+	FTSTicker::FDelegateHandle FlushBrushesHandle;
+
+	/// Newest grid given to QueueVdbBuffer_GameThread, waiting for the mesh in flight
+	nanovdb::GridHandle<nanovdb::HostBuffer> QueuedVdbBuffer;
+	FTSTicker::FDelegateHandle QueuedVdbBufferHandle;
+
 private:
 	TSharedPtr<FVoxelChunkViewRHIProxy> RHIProxy;
 	
@@ -99,24 +309,81 @@ private:
 	friend struct FVoxelChunkViewRHIProxy;
 };
 
-struct FVoxelChunkViewRHIProxy
+/**
+ * Render side of a chunk, replaced by UVoxelChunkView::MarkAsDirty. Work in flight on other threads holds the proxy through AsShared,
+ * the chunk may let go of it meanwhile.
+ */
+struct FVoxelChunkViewRHIProxy : public TSharedFromThis<FVoxelChunkViewRHIProxy>
 {
+	/// Proxies of UVoxelChunkView::Neighbours, they keep the neighbour grids alive while the apron is built
+	using FNeighbourProxies = TStaticArray<TSharedPtr<FVoxelChunkViewRHIProxy>, 8>;
+
 	explicit FVoxelChunkViewRHIProxy(const UVoxelChunkView* ChunkView);
 
 	void ResizeBuffer_RenderThread(uint32_t NewVBSize, uint32 NewIBSize);
-	void RegenerateMesh_RenderThread(FRHICommandListImmediate& RHICmdList);
+	void RegenerateMesh_RenderThread(FRHICommandListImmediate& RHICmdList, int32 InLodIndex, TSharedPtr<FVoxelChunkApron> InApron);
+	/// Start a generation, or leave the request to the one running
 	void RegenerateMesh_GameThread();
+	/// Read the settings of the parent and generate, the proxy is already claimed
+	void StartGeneration_GameThread();
+	void RegenerateMeshCpu_AnyThread(int32 InLodIndex, const FNeighbourProxies& NeighbourProxies);
+	void UploadMesh_RenderThread(FRHICommandListImmediate& RHICmdList, const FVoxelCpuMeshData& MeshData);
+	/// Start a generation, or when one is running mark it stale and start again once it is done
 	void RegenerateMesh();
 
 	bool IsReady() const;
 	bool IsGenerating() const;
 
+	/// Drop the result of the generation in flight, the current mesh is kept. Any thread.
+	void CancelGeneration();
+	/// A newer request came in since the generation in flight started, only meaningful while generating
+	bool IsStale() const;
+	/// Hand the proxy back, or keep it for the rebuild requested meanwhile and start that one. BuildMs is 0 when nothing was published.
+	void FinishGeneration_AnyThread(float BuildMs);
+
+	/// Level of detail to draw at a given screen size, see UVoxelChunkView::LodScreenSize
+	int32 ComputeLodIndex(float ScreenSize) const;
+
+	/// Build the missing levels of the mip chain up to InLodIndex, can take a while for large chunks
+	void BuildLods_AnyThread(int32 InLodIndex);
+
+	/// Samples of the neighbour grids past the positive faces of level 0
+	FVoxelChunkApron BuildApron_AnyThread(const FNeighbourProxies& NeighbourProxies) const;
+
+	/// Take over the mesh of the proxy this one replaces, false when it can't be updated in place
+	bool InheritMesh(const FVoxelChunkViewRHIProxy& Previous);
+
+	/// Remesh the sections using the voxels in [MinVoxel, MaxVoxel] of level 0, see UVoxelChunkView::UpdateVdbBuffer_GameThread
+	void RemeshVoxels_GameThread(const FIntVector& MinVoxel, const FIntVector& MaxVoxel);
+	void RemeshDirtySections_AnyThread();
+	void UploadSections_RenderThread(FRHICommandListImmediate& RHICmdList, const TSharedRef<FVoxelMeshSectionLayout>& Layout,
+		TConstArrayView<int32> Sections, TConstArrayView<FVoxelCpuMeshData> SectionMeshes, bool bReallocate);
+
+	/// Publish the level the new mesh was generated from, with Apron already set. Render thread only, while generating.
+	void SelectLod(int32 InLodIndex);
+	const TArray<uint8>& GetLodVoxelData(int32 InLodIndex) const;
+	/// Size of a level of the mip chain, without the apron
+	FIntVector GetLodGridSize(int32 InLodIndex) const;
+
 	TObjectPtr<UVoxelChunkView> Parent;
 	TRefCountPtr<FRHIBuffer> MeshVertexBuffer;
 	TRefCountPtr<FRHIBuffer> MeshIndexBuffer;
 	TRefCountPtr<FRHIUnorderedAccessView> MeshVertexBufferUAV;
 	TRefCountPtr<FRHIUnorderedAccessView> MeshIndexBufferUAV;
 	TArray<uint8> VoxelDataBuffer;
+
+	/// Levels 1 and above of the mip chain, VoxelDataBuffer being level 0. Slots are only written once.
+	TArray<TUniquePtr<FVoxelGridLevel>> CoarseLevels;
+	FCriticalSection CoarseLevelsLock;
+	FIntVector BaseVoxelSize;
+	/// Apron of the current mesh, empty for coarse levels. Written on the render thread along with the mesh.
+	FVoxelChunkApron Apron;
+
+	/// Layout of the current mesh when it was built by sections, null otherwise. Written on the render thread along with the mesh.
+	TSharedPtr<FVoxelMeshSectionLayout> SectionLayout;
+	/// Leaves of level 0 edited since the sections were last meshed
+	TSet<FIntVector> DirtyLeaves;
+	FCriticalSection DirtyLeavesLock;
 	
 	// 替换单一的VoxelSize为三个独立的维度
 	uint32 VoxelSizeX;
@@ -124,6 +391,27 @@ struct FVoxelChunkViewRHIProxy
 	uint32 VoxelSizeZ;
 	
 	float SurfaceIsoValue = 0.0f;
-	std::atomic<bool> bIsReady;
+	EVoxelMeshingAlgorithm MeshingAlgorithm = EVoxelMeshingAlgorithm::MarchingCubes;
+	/// EVoxelTransitionFace mask, see UVoxelChunkView::TransitionFaces
+	uint8 TransitionFaces = 0;
+	int32 NumLods = 1;
+	float LodScreenSize = 0.0f;
+	/// Level the current mesh was generated from
+	int32 LodIndex = 0;
+	/// Finest level requested by the views drawing the chunk last frame
+	std::atomic<int32> DesiredLodIndex;
+	/// Largest screen size of the chunk in the views drawing it last frame, carried over to the proxy replacing this one
+	std::atomic<float> ScreenSize;
+	/// Milliseconds spent by the last generation, on the render thread for the compute path. NumBuilds is bumped once it is written.
+	std::atomic<float> LastBuildMs;
+	std::atomic<uint32> NumBuilds;
+	/// Cost of the last generation per voxel, see FVoxelMeshRebuildScheduler. Game thread only.
+	double BuildMsPerVoxel = 0.0;
+	/// Bumped by every rebuild request, a generation started before the last bump is stale
+	std::atomic<uint32> RequestedGeneration;
+	/// RequestedGeneration when the generation in flight started, only written while generating
+	uint32 BuildingGeneration = 0;
+	/// Claimed while generating, a rebuild requested meanwhile runs once the generation is done
+	FVoxelMeshBuildHandoff BuildHandoff;
 };
 
@@ -0,0 +1,135 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelBrickTraversal.h"
+#include "VoxelChunkApron.h"
+#include "VoxelVdbCommon.h"
+
+/**
+ * Mesh produced on the CPU, laid out like the buffers written by MarchingCubesCS.usf.
+ */
+struct VOXELMESH_API FVoxelCpuMeshData
+{
+	/// xyz: normalized position, w: packed normal
+	TArray<FVector4f> Vertices;
+	TArray<uint32> Indices;
+
+	bool IsEmpty() const { return Indices.IsEmpty(); }
+
+	void Reset()
+	{
+		Vertices.Reset();
+		Indices.Reset();
+	}
+};
+
+/**
+ * Values of a brick and its +1 apron, decoded once and shared by classification and interpolation.
+ * Same layout as BrickTile in MarchingCubesCS.usf.
+ */
+struct FVoxelBrickTile
+{
+	static constexpr int32 Dim = FVoxelBrickTraversal::BrickDim + 1;
+	static constexpr int32 Size = Dim * Dim * Dim;
+
+	static FORCEINLINE int32 GetIndex(const FIntVector& LocalCoord)
+	{
+		return LocalCoord.Z + Dim * (LocalCoord.Y + Dim * LocalCoord.X);
+	}
+
+	FORCEINLINE float Get(const FIntVector& LocalCoord) const
+	{
+		return Values[GetIndex(LocalCoord)];
+	}
+
+	float Values[Size];
+};
+
+/**
+ * CPU counterpart of the marching cubes passes in MarchingCubesCS.usf.
+ * Cubes are visited in the same brick/Morton order as the compute dispatch, one brick per task.
+ */
+class VOXELMESH_API FVoxelCpuMesher
+{
+public:
+	using FGridType = nanovdb::NanoGrid<nanovdb::Fp4>;
+	using FAccessorType = nanovdb::DefaultReadAccessor<nanovdb::Fp4>;
+
+	FVoxelCpuMesher(const FGridType& InGrid, uint32 InVoxelSizeX, uint32 InVoxelSizeY, uint32 InVoxelSizeZ, float InSurfaceIsoValue);
+
+	void Generate(FVoxelCpuMeshData& OutMeshData) const;
+
+	/**
+	 * Triangles of the cells in [CellMin, CellMax) only, indexing their own vertices: sections meshed this way can be
+	 * replaced independently, see FVoxelMeshSectionLayout. CellMin must be aligned on bricks.
+	 */
+	void GenerateRegion(const FIntVector& CellMin, const FIntVector& CellMax, FVoxelCpuMeshData& OutMeshData) const;
+
+	/**
+	 * Faces bordering a neighbour one level of detail coarser, bit 2 * Axis for the negative face and 2 * Axis + 1 for the positive one
+	 * (see EVoxelTransitionFace). The samples of these faces are replaced by the ones the neighbour sees and the vertices
+	 * in between its edges are moved onto its boundary, so both meshes meet without cracks. Marching cubes only.
+	 */
+	void SetTransitionFaces(uint8 InTransitionFaces) { TransitionFaces = InTransitionFaces; }
+
+	/**
+	 * Mesh the cells up to the neighbour chunks, reading the samples past the grid from the apron instead of clamping.
+	 * The apron must be built for the size given to the constructor and outlive Generate.
+	 */
+	void SetApron(const FVoxelChunkApron* InApron);
+
+	const FVoxelBrickTraversal& GetTraversal() const { return Traversal; }
+
+protected:
+	FORCEINLINE float SampleVoxelPoint(const FIntVector& IndexSpaceCoord, const FAccessorType& Accessor) const
+	{
+		const FIntVector Coord(
+			FMath::Min(IndexSpaceCoord.X, Traversal.VoxelSize.X - 1),
+			FMath::Min(IndexSpaceCoord.Y, Traversal.VoxelSize.Y - 1),
+			FMath::Min(IndexSpaceCoord.Z, Traversal.VoxelSize.Z - 1));
+		if (Apron && Apron->Contains(Coord))
+		{
+			return Apron->Sample(Coord);
+		}
+		return Accessor.getValue(nanovdb::Coord(Coord.X, Coord.Y, Coord.Z));
+	}
+
+	/// Positions are normalized by the size of the grid, cells of the apron go past 0.5
+	FORCEINLINE FVector3f GetNormalizeScale() const
+	{
+		return FVector3f(
+			1.0f / FMath::Max(GridVoxelSize.X - 1, 1),
+			1.0f / FMath::Max(GridVoxelSize.Y - 1, 1),
+			1.0f / FMath::Max(GridVoxelSize.Z - 1, 1));
+	}
+
+	/// Cubes of the last layer only own vertices for their inner neighbours, all their other corners are clamped
+	FORCEINLINE bool EmitsTriangles(const FIntVector& Coord) const
+	{
+		return Coord.X < Traversal.VoxelSize.X - 1 && Coord.Y < Traversal.VoxelSize.Y - 1 && Coord.Z < Traversal.VoxelSize.Z - 1;
+	}
+
+	FORCEINLINE int32 GetTransitionPlane(int32 Face) const
+	{
+		return (Face & 1) ? Traversal.VoxelSize[Face >> 1] - 1 : 0;
+	}
+
+	/// Values past NumValidCubes (+1 apron, +1 for the transition faces) are left uninitialized
+	void LoadBrickTile(const FIntVector& BrickOrigin, const FAccessorType& Accessor, FVoxelBrickTile& OutTile,
+		const FIntVector& NumValidCubes = FIntVector(FVoxelBrickTraversal::BrickDim)) const;
+	FVector3f InterpolateVertex(const FVector3f& BeginPos, const FVector3f& EndPos, float BeginValue, float EndValue) const;
+
+	/// Samples of the transition faces that the coarser neighbour doesn't have become the interpolation of the ones it has
+	void ApplyTransitionFaces(const FIntVector& BrickOrigin, FVoxelBrickTile& Tile) const;
+
+	/// Move a vertex of a transition face lying between two edges of the coarser neighbour onto the neighbour segment
+	FVector3f SnapToTransitionFaces(const FVoxelBrickTile& Tile, const FIntVector& BrickOrigin, const FIntVector& BeginCoord, const FIntVector& EndCoord, const FVector3f& Position) const;
+
+	const FGridType& Grid;
+	/// Size of the grid, the traversal also covers the apron when there is one
+	FIntVector GridVoxelSize;
+	FVoxelBrickTraversal Traversal;
+	const FVoxelChunkApron* Apron = nullptr;
+	float SurfaceIsoValue;
+	uint8 TransitionFaces = 0;
+};
@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelCpuMesher.h"
+
+/**
+ * Marching cubes classification of a decoded brick tile, 8 cubes (one row along z) per instruction sequence.
+ * Outputs are in local row-major order: x << 6 | y << 3 | z.
+ */
+struct VOXELMESH_API FVoxelCubeClassify
+{
+	static constexpr uint32 NumCubes = FVoxelBrickTraversal::BrickSize;
+	static constexpr uint32 NumMaskWords = NumCubes / 64;
+
+	/**
+	 * @param NumValidCubes   Number of cubes inside the grid for each axis, the other ones are padding and classified as 0
+	 * @param OutCubeIndices  Marching cubes index of every cube
+	 * @param OutNonEmptyMask One bit per cube producing geometry (cube index neither 0 nor 255)
+	 * @return Number of non-empty cubes
+	 */
+	static uint32 ClassifyBrick(const FVoxelBrickTile& Tile, float SurfaceIsoValue, const FIntVector& NumValidCubes, uint8* RESTRICT OutCubeIndices, uint64* RESTRICT OutNonEmptyMask);
+
+	/// Reference implementation, also used when no vector instruction set is available
+	static uint32 ClassifyBrickScalar(const FVoxelBrickTile& Tile, float SurfaceIsoValue, const FIntVector& NumValidCubes, uint8* RESTRICT OutCubeIndices, uint64* RESTRICT OutNonEmptyMask);
+};
@@ -0,0 +1,165 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "VoxelBrush.h"
+#include "VoxelVdbCommon.h"
+
+/**
+ * Write-friendly copy of a chunk level set. Edits go to a NanoVDB build grid and are baked back to an Fp4 grid on demand,
+ * the box of voxels edited since the last bake is kept for UVoxelChunkView::UpdateVdbBuffer_GameThread.
+ */
+class VOXELMESH_API FVoxelEditableGrid
+{
+public:
+	using FBuildGrid = nanovdb::tools::build::Grid<float>;
+	using FBuildLeaf = nanovdb::tools::build::LeafNode<float>;
+
+	/// Content of a leaf before a transaction changed it
+	struct FLeafSnapshot
+	{
+		FIntVector Origin;
+		nanovdb::Mask<3> ValueMask;
+		float Values[FBuildLeaf::SIZE];
+	};
+
+	/// Leaves changed by one undo step, each recorded once when first touched
+	struct FTransaction
+	{
+		TArray<FLeafSnapshot> Leaves;
+	};
+
+	struct FBakeStats
+	{
+		double RenormalizeSeconds = 0.0;
+		double FloodFillSeconds = 0.0;
+		double PruneSeconds = 0.0;
+		double EncodeSeconds = 0.0;
+		uint32 NumLeaves = 0;
+		uint32 NumPrunedLeaves = 0;
+		uint64 NumBytes = 0;
+	};
+
+	/// Decode every leaf of a baked chunk grid, the chunk voxels are [0, VoxelSize)
+	FVoxelEditableGrid(const nanovdb::NanoGrid<nanovdb::Fp4>& Grid, const FIntVector& InVoxelSize);
+
+	float GetValue(const FIntVector& Coord) const;
+	void SetValue(const FIntVector& Coord, float Value);
+
+	/**
+	 * Set every voxel of [Min, Max] to Func(Coord, OldValue), clamped to the chunk. The leaves are allocated first,
+	 * then filled in parallel, so Func must be thread safe.
+	 */
+	template <typename FFunc>
+	void ModifyBox(const FIntVector& Min, const FIntVector& Max, FFunc&& Func)
+	{
+		ModifyBox(Min, Max, Forward<FFunc>(Func), [](const FIntVector&) { return true; });
+	}
+
+	/// Same, only for the leaves whose origin passes LeafFilter
+	template <typename FFunc>
+	void ModifyBox(const FIntVector& Min, const FIntVector& Max, FFunc&& Func, TFunctionRef<bool(const FIntVector&)> LeafFilter)
+	{
+		FIntVector BoxMin, BoxMax;
+		TArray<FBuildLeaf*> Leaves;
+		if (!TouchLeaves(Min, Max, LeafFilter, BoxMin, BoxMax, Leaves))
+		{
+			return;
+		}
+
+		ParallelFor(Leaves.Num(), [&](int32 LeafIndex)
+		{
+			FBuildLeaf& Leaf = *Leaves[LeafIndex];
+			const FIntVector LeafOrigin(Leaf.mOrigin[0], Leaf.mOrigin[1], Leaf.mOrigin[2]);
+			const FIntVector LocalMin = FIntVector(FMath::Max(BoxMin.X, LeafOrigin.X), FMath::Max(BoxMin.Y, LeafOrigin.Y), FMath::Max(BoxMin.Z, LeafOrigin.Z)) - LeafOrigin;
+			const FIntVector LocalMax = FIntVector(FMath::Min(BoxMax.X, LeafOrigin.X + 7), FMath::Min(BoxMax.Y, LeafOrigin.Y + 7), FMath::Min(BoxMax.Z, LeafOrigin.Z + 7)) - LeafOrigin;
+			for (int32 X = LocalMin.X; X <= LocalMax.X; ++X)
+			{
+				for (int32 Y = LocalMin.Y; Y <= LocalMax.Y; ++Y)
+				{
+					for (int32 Z = LocalMin.Z; Z <= LocalMax.Z; ++Z)
+					{
+						const uint32 Offset = (X << 6) | (Y << 3) | Z;
+						SetLeafValue(Leaf, Offset, Func(LeafOrigin + FIntVector(X, Y, Z), Leaf.mValues[Offset]));
+					}
+				}
+			}
+		});
+	}
+
+	/// Blend a brush into the leaves it can change, in parallel
+	void ApplyBrush(const FVoxelSdfBrush& Brush);
+
+	/**
+	 * Turn the values of [Min, Max] back into distances to the surface: voxels next to a sign change keep their distance
+	 * along the crossed edges, the rest of the band is solved with parallel Godunov upwind passes. Brushes only bound the
+	 * distance, without this the band widens and blends drift after many edits.
+	 */
+	void Renormalize(const FIntVector& Min, const FIntVector& Max);
+
+	/// Replace the leaves left without active voxels by tiles, once the values are flood filled. Returns the number of leaves removed.
+	uint32 PruneInactiveLeaves();
+
+	/// Renormalize the edited voxels, flood fill, prune and serialize the grid to Fp4 in parallel, Stats gets the timings.
+	/// The dirty box is returned and reset.
+	nanovdb::GridHandle<nanovdb::HostBuffer> Bake(FIntVector& OutDirtyMin, FIntVector& OutDirtyMax, FBakeStats* OutStats = nullptr);
+
+	/**
+	 * Group the edits up to the matching EndTransaction into one undo step. Outside of a transaction, the edits baked
+	 * together form one step.
+	 */
+	void BeginTransaction();
+	void EndTransaction();
+
+	/// Swap the leaves of the last step with their snapshots, the next bake serializes them without renormalizing.
+	/// Edits must be baked first.
+	bool Undo();
+	bool Redo();
+	bool CanUndo() const { return !UndoStack.IsEmpty() || !PendingTransaction.Leaves.IsEmpty(); }
+	bool CanRedo() const { return !RedoStack.IsEmpty(); }
+
+	/// The oldest steps are dropped past this size, the last one is always kept
+	void SetMaxJournalSize(uint64 InMaxJournalSize);
+	uint64 GetJournalSize() const { return JournalSize; }
+
+	bool IsDirty() const { return DirtyMin.X <= DirtyMax.X; }
+	const FIntVector& GetVoxelSize() const { return VoxelSize; }
+	float GetBackground() const { return Background; }
+
+protected:
+	/// Voxels outside of the narrow band are stored inactive and clamped to the background, like the NanoVDB level set primitives
+	FORCEINLINE void SetLeafValue(FBuildLeaf& Leaf, uint32 Offset, float Value) const
+	{
+		const bool bActive = FMath::Abs(Value) < Background;
+		Leaf.mValues[Offset] = bActive ? Value : FMath::Clamp(Value, -Background, Background);
+		Leaf.mValueMask.set(Offset, bActive);
+	}
+
+	void RecordLeaf(const FBuildLeaf& Leaf);
+	void CommitTransaction();
+	bool RestoreTransaction(TArray<FTransaction>& FromStack, TArray<FTransaction>& ToStack);
+	void TrimJournal();
+
+	/// Allocate the leaves of [Min, Max] clamped to the chunk and grow the dirty box, false when nothing is left
+	bool TouchLeaves(const FIntVector& Min, const FIntVector& Max, TFunctionRef<bool(const FIntVector&)> LeafFilter,
+		FIntVector& OutBoxMin, FIntVector& OutBoxMax, TArray<FBuildLeaf*>& OutLeaves);
+
+	FBuildGrid Grid;
+	FIntVector VoxelSize;
+	float Background;
+	/// Size of a voxel in the units of the level set values
+	float VoxelScale;
+	FIntVector DirtyMin;
+	FIntVector DirtyMax;
+
+	/// Copy-on-write journal: a leaf is copied the first time a step touches it, so its size follows the edits and not the chunk
+	FTransaction PendingTransaction;
+	TSet<FIntVector> PendingLeaves;
+	int32 TransactionDepth = 0;
+	TArray<FTransaction> UndoStack;
+	TArray<FTransaction> RedoStack;
+	uint64 JournalSize = 0;
+	uint64 MaxJournalSize = 64 * 1024 * 1024;
+	/// Set by Undo and Redo, the restored leaves are already renormalized and must not be recorded again
+	bool bRestoring = false;
+};
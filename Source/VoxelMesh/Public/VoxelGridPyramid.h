@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+
+/**
+ * One level of a chunk mip chain, stored like the chunk itself: a NanoVDB Fp4 grid buffer and its voxel size.
+ */
+struct VOXELMESH_API FVoxelGridLevel
+{
+	TArray<uint8> VoxelDataBuffer;
+	FIntVector VoxelSize = FIntVector::ZeroValue;
+
+	const nanovdb::NanoGrid<nanovdb::Fp4>* GetGrid() const
+	{
+		return reinterpret_cast<const nanovdb::NanoGrid<nanovdb::Fp4>*>(VoxelDataBuffer.GetData());
+	}
+};
+
+/**
+ * Downsampling of chunk level sets for the levels of detail, every level halves the resolution of the previous one.
+ */
+struct VOXELMESH_API FVoxelGridPyramid
+{
+	/// Full resolution, 2x, 4x and 8x
+	static constexpr int32 MaxNumLevels = 4;
+
+	/// Coarse voxel k samples fine voxel 2k, the last one is clamped to the fine grid when its size is even
+	static FIntVector GetCoarseVoxelSize(const FIntVector& FineVoxelSize)
+	{
+		return FIntVector(
+			FMath::DivideAndRoundUp(FineVoxelSize.X - 1, 2) + 1,
+			FMath::DivideAndRoundUp(FineVoxelSize.Y - 1, 2) + 1,
+			FMath::DivideAndRoundUp(FineVoxelSize.Z - 1, 2) + 1);
+	}
+
+	/**
+	 * Build the next level of a level set with a separable [1 2 1] filter centered on every other fine voxel,
+	 * so the surface doesn't drift. Values stay in the units of the fine grid, the iso value applies to every level.
+	 * Voxels on the faces of the chunk are point sampled instead, they are the ones a finer neighbour stitches to.
+	 */
+	static void BuildCoarseLevel(const nanovdb::NanoGrid<nanovdb::Fp4>& FineGrid, const FIntVector& FineVoxelSize, FVoxelGridLevel& OutLevel);
+};
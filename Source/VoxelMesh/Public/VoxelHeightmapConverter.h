@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+#include "VoxelHeightmapConverter.generated.h"
+
+/**
+ * How the samples of a 16-bit heightmap map to voxels, with the conventions of landscapes: a sample per voxel
+ * horizontally, and 32768 at HeightOffset.
+ */
+USTRUCT(BlueprintType)
+struct VOXELMESH_API FVoxelHeightmapSettings
+{
+	GENERATED_BODY()
+
+	/** World size of a voxel, also the distance between two samples */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Heightmap", meta = (ClampMin = 0.001))
+	float VoxelSize = 100.0f;
+
+	/** World height of a step of the samples, 100 / 128 for a landscape with a z scale of 100 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Heightmap", meta = (ClampMin = 0.0))
+	float HeightScale = 100.0f / 128.0f;
+
+	/** World height of the sample value 32768 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Heightmap")
+	float HeightOffset = 0.0f;
+
+	/** World position of the first sample, rounded to whole voxels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Heightmap")
+	FVector2D Origin = FVector2D::ZeroVector;
+
+	/** Half width of the narrow band, in voxels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Heightmap", meta = (ClampMin = 1.0))
+	float BandWidth = 3.0f;
+
+	/** Voxels per chunk and axis, rounded up to whole leaves */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Heightmap", meta = (ClampMin = 8))
+	int32 ChunkSize = 128;
+};
+
+/**
+ * Converts a heightfield to narrow band level set chunks, one task per column of chunks. The distance is the height
+ * difference divided by the slope, exact on planes. Leaves further from the surface than the band, according to the
+ * extremes of the heights and slopes of their 8x8 columns, are skipped: nothing is written above the surface and tiles
+ * below it.
+ */
+class VOXELMESH_API FVoxelHeightmapConverter
+{
+public:
+	using FBuildGrid = nanovdb::tools::build::Grid<float>;
+	using FBuildLeaf = nanovdb::tools::build::LeafNode<float>;
+
+	struct FStats
+	{
+		double Seconds = 0.0;
+		uint32 NumChunks = 0;
+		uint32 NumLeaves = 0;
+		uint32 NumTiles = 0;
+	};
+
+	/// Level set of a chunk, in local index space with the world offset of the chunk in the transform. Returning false stops the conversion.
+	using FOnChunk = TFunctionRef<bool(const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Grid)>;
+
+	/**
+	 * Heights are row major, Size.X samples per row. Chunks are given in batches of columns, in order, on the calling thread.
+	 * Chunks without a surface are skipped. False when the heights don't match the size or OnChunk stops the conversion.
+	 */
+	static bool Convert(TConstArrayView<uint16> Heights, const FIntPoint& Size, const FVoxelHeightmapSettings& Settings, FOnChunk OnChunk, FStats* OutStats = nullptr);
+
+	/// Chunks that may hold the surface, both inclusive. They start below zero when the origin does.
+	static void GetChunkRange(TConstArrayView<uint16> Heights, const FIntPoint& Size, const FVoxelHeightmapSettings& Settings, FIntVector& OutMin, FIntVector& OutMax);
+};
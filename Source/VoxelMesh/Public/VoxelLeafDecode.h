@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+
+/**
+ * Bulk decode of quantized NanoVDB leaves into plain floats.
+ * Decoding a whole leaf at once is much cheaper than going through the read accessor for each of its 512 voxels.
+ * Output is in leaf offset order: (x & 7) << 6 | (y & 7) << 3 | (z & 7), z fastest.
+ */
+struct VOXELMESH_API FVoxelLeafDecode
+{
+	static constexpr uint32 LeafSize = 512;
+
+	static FORCEINLINE uint32 GetLeafOffset(const FIntVector& Coord)
+	{
+		return ((Coord.X & 7) << 6) | ((Coord.Y & 7) << 3) | (Coord.Z & 7);
+	}
+
+	static void Decode(const nanovdb::NanoLeaf<nanovdb::Fp4>& Leaf, float* RESTRICT OutValues);
+	static void Decode(const nanovdb::NanoLeaf<nanovdb::Fp8>& Leaf, float* RESTRICT OutValues);
+	static void Decode(const nanovdb::NanoLeaf<nanovdb::Fp16>& Leaf, float* RESTRICT OutValues);
+
+	/// Reference implementations, also used when no vector instruction set is available
+	static void DecodeScalar(const nanovdb::NanoLeaf<nanovdb::Fp4>& Leaf, float* RESTRICT OutValues);
+	static void DecodeScalar(const nanovdb::NanoLeaf<nanovdb::Fp8>& Leaf, float* RESTRICT OutValues);
+	static void DecodeScalar(const nanovdb::NanoLeaf<nanovdb::Fp16>& Leaf, float* RESTRICT OutValues);
+};
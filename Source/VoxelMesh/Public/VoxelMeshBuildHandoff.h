@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Ownership of a FVoxelChunkViewRHIProxy between the generations using it. A generation claims it, and a rebuild requested meanwhile
+ * is left as a flag for that generation to run once it is done. Both sides publish before they look at the other one: the requester
+ * raises the flag before trying to claim, the generation gives the proxy back before looking at the flag. So at least one of them
+ * sees the request, and whoever claims the proxy with the flag raised is the only one taking it.
+ */
+struct FVoxelMeshBuildHandoff
+{
+	/// Leave a rebuild for the generation in flight, before trying to claim with bTakeRequest
+	void Request()
+	{
+		bRebuildPending.store(true, std::memory_order_seq_cst);
+	}
+
+	/**
+	 * Claim the proxy for a generation, false while another one holds it.
+	 * @param bTakeRequest	The generation covers the rebuilds requested so far, otherwise they wait for it to be done
+	 */
+	bool TryClaim(bool bTakeRequest)
+	{
+		if (bool Expected = true; !bIsReady.compare_exchange_strong(Expected, false, std::memory_order_seq_cst))
+		{
+			return false;
+		}
+		if (bTakeRequest)
+		{
+			bRebuildPending.store(false, std::memory_order_relaxed);
+		}
+		return true;
+	}
+
+	/**
+	 * Give the proxy back. True when a rebuild was requested meanwhile: the proxy is then claimed again for it and the caller
+	 * has to start it. False once nothing is left, or when the requester claimed the proxy back first.
+	 */
+	bool Release()
+	{
+		bIsReady.store(true, std::memory_order_seq_cst);
+		while (bRebuildPending.load(std::memory_order_seq_cst))
+		{
+			if (!TryClaim(false))
+			{
+				return false;
+			}
+			if (bRebuildPending.exchange(false, std::memory_order_acq_rel))
+			{
+				return true;
+			}
+			// Taken by a generation claiming the proxy in between, look again in case another one came in
+			bIsReady.store(true, std::memory_order_seq_cst);
+		}
+		return false;
+	}
+
+	bool IsClaimed() const
+	{
+		return !bIsReady.load(std::memory_order_acquire);
+	}
+
+	bool IsRequested() const
+	{
+		return bRebuildPending.load(std::memory_order_acquire);
+	}
+
+private:
+	std::atomic<bool> bIsReady{ true };
+	std::atomic<bool> bRebuildPending{ false };
+};
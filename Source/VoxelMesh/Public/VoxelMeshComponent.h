@@ -9,6 +9,7 @@
 
 class UVoxelChunkView;
 struct FVoxelChunkPrimitiveSceneProxy;
+struct FVoxelChunkViewRHIProxy;
 
 /**
  * Primitive component to render generated voxel mesh
@@ -19,6 +20,12 @@ class VOXELMESH_API UVoxelMeshProxyComponent : public UPrimitiveComponent
 	GENERATED_BODY()
 
 public:
+	UVoxelMeshProxyComponent(const FObjectInitializer& ObjectInitializer);
+
+	// Begin UActorComponent interface
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End UActorComponent interface
+
 	// Begin USceneComponent interface
 	virtual bool ShouldCreateRenderState() const override;
 	virtual void CreateRenderState_Concurrent(FRegisterComponentContext* Context) override;
@@ -105,6 +112,7 @@ struct VOXELMESH_API FVoxelChunkPrimitiveSceneProxy final : public FPrimitiveSce
 	mutable  uint32 NumPrimitives;
 	mutable uint32 NumVertices;
 	mutable UVoxelMeshProxyComponent* VoxelMeshProxyComponent;
+	mutable TSharedPtr<FVoxelChunkViewRHIProxy> RHIProxy;
 	mutable  bool bIsInitialized;
 };
 
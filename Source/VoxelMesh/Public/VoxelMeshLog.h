@@ -2,4 +2,4 @@
 
 #include "CoreMinimal.h"
 
-DECLARE_LOG_CATEGORY_EXTERN(LogVoxelMesh, Log, All);
+VOXELMESH_API DECLARE_LOG_CATEGORY_EXTERN(LogVoxelMesh, Log, All);
@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+
+class UVoxelChunkView;
+struct FVoxelChunkViewRHIProxy;
+
+/**
+ * Mesh rebuilds queued by UVoxelChunkView::RebuildMesh, started once per frame within a budget of milliseconds (voxel.Rebuild.BudgetMs).
+ * Requests for the same chunk are merged, and a chunk keeps its request while its previous rebuild is still running.
+ * The queue is sorted by
+ *     Urgency + ScreenSize + 1 / (1 + Distance / voxel.Rebuild.DistanceScale) + voxel.Rebuild.AgingPerSecond * SecondsWaiting
+ * so a far away chunk still gets its turn eventually. A request for a chunk being rebuilt makes that rebuild stale: its mesh is dropped
+ * and the request runs once it reports back, so a burst of edits ends with a single rebuild of the latest state.
+ * A rebuild is expected to cost what the last one of the chunk cost per voxel, or the running average over every chunk when it was
+ * never built. Game thread only, requests made on other threads are forwarded to it.
+ */
+class VOXELMESH_API FVoxelMeshRebuildScheduler
+{
+public:
+	struct FStats
+	{
+		/// Requests waiting after the last tick
+		int32 NumQueued = 0;
+		/// Requests merged into one already queued since the last tick
+		int32 NumCoalesced = 0;
+		/// Requests started by the last tick
+		int32 NumStarted = 0;
+		/// Requests kept by the last tick because their chunk was still being rebuilt
+		int32 NumDeferred = 0;
+		/// Rebuilds started and not finished yet
+		int32 NumInFlight = 0;
+		/// Rebuilds finished since the last tick without publishing their mesh, a newer request superseded them
+		int32 NumDiscarded = 0;
+		/// Estimated cost of the rebuilds started by the last tick
+		float StartedMs = 0.0f;
+		/// Longest wait of the requests started by the last tick
+		float MaxWaitSeconds = 0.0f;
+		float MsPerMillionVoxels = 0.0f;
+		uint64 TotalStarted = 0;
+	};
+
+	static FVoxelMeshRebuildScheduler& Get();
+
+	/**
+	 * Queue a rebuild of the mesh of View. Called on another thread, the request is queued by the game thread later on.
+	 * @param Urgency		Added to the priority, 1 weighs as much as a chunk filling the screen
+	 * @param Distance		To the closest view in world units, negative when unknown
+	 */
+	void Request(UVoxelChunkView* View, float Urgency = 0.0f, float Distance = -1.0f);
+
+	/// Start the queued rebuilds fitting in the budget, called by the core ticker once per frame
+	void Tick();
+
+	/// Start every queued rebuild, whatever the budget
+	void Flush();
+
+	const FStats& GetStats() const;
+
+	/// Stop ticking and drop the queue, called when the module shuts down
+	void Shutdown();
+
+private:
+	FVoxelMeshRebuildScheduler();
+
+	struct FRequest
+	{
+		double RequestTime = 0.0;
+		float Urgency = 0.0f;
+		float Distance = -1.0f;
+	};
+
+	struct FInFlight
+	{
+		TWeakPtr<FVoxelChunkViewRHIProxy> Proxy;
+		double StartTime = 0.0;
+		uint64 NumVoxels = 0;
+		uint32 NumBuilds = 0;
+	};
+
+	void StartRebuilds(float BudgetMs);
+	/// Learn the cost of the rebuilds finished since the last tick
+	void UpdateInFlight(double Now);
+	float EstimateMs(const FVoxelChunkViewRHIProxy& Proxy, uint64 NumVoxels) const;
+	/// Voxels of the level the chunk will be meshed from, without the apron
+	static uint64 GetNumVoxels(const FVoxelChunkViewRHIProxy& Proxy, int32 InLodIndex);
+
+	TMap<TWeakObjectPtr<UVoxelChunkView>, FRequest> Requests;
+	TMap<TWeakObjectPtr<UVoxelChunkView>, FInFlight> InFlight;
+	/// Running average over every chunk, until the first rebuild is measured a rough figure for the compute path
+	double MsPerVoxel = 2.0e-6;
+	int32 NumDiscarded = 0;
+	FStats Stats;
+	FTSTicker::FDelegateHandle TickerHandle;
+};
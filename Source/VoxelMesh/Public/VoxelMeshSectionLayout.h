@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+struct FVoxelCpuMeshData;
+
+/**
+ * Chunk mesh split into sections of SectionDim^3 cells, each owning a range of the vertex and index buffers.
+ * Ranges keep some slack, so a remeshed section usually fits in place and only its range is uploaded again.
+ * Unused slots hold degenerate triangles, the whole index buffer is still drawn at once.
+ */
+struct VOXELMESH_API FVoxelMeshSectionLayout
+{
+	/// Cells per section and axis, a multiple of the brick size
+	static constexpr int32 SectionDim = 16;
+
+	struct FSection
+	{
+		uint32 FirstVertex = 0;
+		uint32 VertexCapacity = 0;
+		uint32 FirstIndex = 0;
+		uint32 IndexCapacity = 0;
+	};
+
+	explicit FVoxelMeshSectionLayout(const FIntVector& InNumCells);
+
+	FORCEINLINE int32 GetNumSections() const
+	{
+		return SectionCount.X * SectionCount.Y * SectionCount.Z;
+	}
+
+	FORCEINLINE FIntVector GetSectionCoord(int32 SectionIndex) const
+	{
+		return FIntVector(SectionIndex / (SectionCount.Y * SectionCount.Z), (SectionIndex / SectionCount.Z) % SectionCount.Y, SectionIndex % SectionCount.Z);
+	}
+
+	/// Cells of a section, clamped to the chunk
+	void GetSectionCells(int32 SectionIndex, FIntVector& OutCellMin, FIntVector& OutCellMax) const;
+
+	/// Sections with a cell using one of the voxels in [MinVoxel, MaxVoxel]
+	void GetSectionsUsingVoxels(const FIntVector& MinVoxel, const FIntVector& MaxVoxel, TArray<int32>& OutSections) const;
+
+	/// Place every section one after the other, with room to grow
+	void Allocate(TConstArrayView<FVoxelCpuMeshData> SectionMeshes);
+
+	bool Fits(int32 SectionIndex, const FVoxelCpuMeshData& SectionMesh) const;
+
+	/// Write a section at its range, indices rebased on its first vertex and the rest padded with degenerate triangles
+	void WriteSection(int32 SectionIndex, const FVoxelCpuMeshData& SectionMesh, FVector4f* OutVertices, uint32* OutIndices) const;
+
+	FIntVector NumCells;
+	FIntVector SectionCount;
+	TArray<FSection> Sections;
+	uint32 NumVertices = 0;
+	uint32 NumIndices = 0;
+};
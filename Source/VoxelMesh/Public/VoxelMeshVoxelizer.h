@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+
+class UStaticMesh;
+
+/**
+ * Narrow band level set of a triangle mesh.
+ * Distances are exact, from a closest triangle search in a bounding volume hierarchy. The sign comes from the generalized
+ * winding number, approximated far from the triangles by the dipole of every node, so open or unwelded meshes
+ * (split along their UV seams for instance) still get a sensible inside. Either triangle orientation works.
+ */
+class VOXELMESH_API FVoxelMeshVoxelizer
+{
+public:
+	using FBuildGrid = nanovdb::tools::build::Grid<float>;
+	using FBuildLeaf = nanovdb::tools::build::LeafNode<float>;
+
+	struct FStats
+	{
+		double DistanceSeconds = 0.0;
+		double EncodeSeconds = 0.0;
+		uint32 NumTriangles = 0;
+		uint32 NumLeaves = 0;
+		FIntVector Size = FIntVector::ZeroValue;
+	};
+
+	/// Triangles are copied in the order of the hierarchy, degenerate ones are dropped
+	FVoxelMeshVoxelizer(TConstArrayView<FVector3f> Positions, TConstArrayView<uint32> Indices);
+
+	/**
+	 * Level set of the mesh with voxels of VoxelSize mesh units and a band of BandWidth voxels on each side.
+	 * The first voxel of the grid is at index 0, the transform places it back at the mesh position.
+	 * IsCancelled is polled from worker threads, the grid is empty once it returns true.
+	 */
+	nanovdb::GridHandle<nanovdb::HostBuffer> Voxelize(float VoxelSize, float BandWidth = 3.0f, FStats* OutStats = nullptr,
+		TFunctionRef<bool()> IsCancelled = [] { return false; }) const;
+
+	/// Voxelize the first level of detail of a static mesh, its vertices must be readable on the CPU outside of the editor
+	static nanovdb::GridHandle<nanovdb::HostBuffer> VoxelizeStaticMesh(const UStaticMesh& StaticMesh, float VoxelSize, float BandWidth = 3.0f);
+
+	/// Copy of the triangles VoxelizeStaticMesh uses, to voxelize them away from the game thread
+	static bool GetStaticMeshTriangles(const UStaticMesh& StaticMesh, TArray<FVector3f>& OutPositions, TArray<uint32>& OutIndices);
+
+	/// Squared distance to the closest triangle, MaxDistanceSquared when none is closer
+	float GetDistanceSquared(const FVector3f& Position, float MaxDistanceSquared) const;
+
+	/// About 1 inside a closed mesh and 0 outside, signed by the orientation of its triangles
+	float GetWindingNumber(const FVector3f& Position) const;
+
+	int32 GetNumTriangles() const { return Triangles.Num(); }
+	const FBox3f& GetBounds() const { return Nodes.IsEmpty() ? EmptyBounds : Nodes[0].Bounds; }
+
+private:
+	struct FTriangle
+	{
+		FVector3f A;
+		FVector3f B;
+		FVector3f C;
+	};
+
+	/// Interior nodes have their left child right after them
+	struct FNode
+	{
+		FBox3f Bounds;
+		/// Half the sum of the triangle cross products, and their area weighted center
+		FVector3f AreaNormal;
+		FVector3f Center;
+		/// Of the bounds around Center
+		float Radius;
+		/// Right child, or first triangle of a leaf
+		uint32 Index;
+		uint32 NumTriangles;
+	};
+
+	uint32 BuildNode(uint32 FirstTriangle, uint32 NumNodeTriangles, TArray<FVector3f>& Centroids, int32 Depth);
+
+	TArray<FTriangle> Triangles;
+	TArray<FNode> Nodes;
+	static inline const FBox3f EmptyBounds = FBox3f(ForceInit);
+};
@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+#include "VoxelPointSurfacer.generated.h"
+
+UENUM(BlueprintType)
+enum class EVoxelPointKernel : uint8
+{
+	// Union of spheres, exact distances but bumpy surfaces
+	Spheres,
+
+	// Zhu and Bridson: distance to a sphere at the kernel weighted average of the neighbours, smooth like a fluid
+	ZhuBridson
+};
+
+USTRUCT(BlueprintType)
+struct VOXELMESH_API FVoxelPointSurfaceSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Points")
+	EVoxelPointKernel Kernel = EVoxelPointKernel::ZhuBridson;
+
+	/** Both kernels are never deeper than the radius inside, larger than the band it lets the inside of the fluid become tiles */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Points", meta = (ClampMin = 0.001))
+	float ParticleRadius = 1.0f;
+
+	/** Radius of the Zhu-Bridson kernel, in particle radii */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Points", meta = (ClampMin = 1.0, EditCondition = "Kernel == EVoxelPointKernel::ZhuBridson"))
+	float KernelRadiusScale = 2.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Points", meta = (ClampMin = 0.001))
+	float VoxelSize = 0.5f;
+
+	/** Half width of the narrow band, in voxels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Points", meta = (ClampMin = 1.0))
+	float BandWidth = 2.0f;
+
+	/** Fixed region to surface, points outside are ignored. Keeps the size of the chunk when the points move. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Points")
+	FBox Domain = FBox(ForceInit);
+};
+
+/**
+ * Narrow band level set of particles, on the CPU. Points are sorted into buckets of one leaf, then every leaf gathers
+ * the buckets around it and splats their points into its own voxels, so leaves are evaluated in parallel without atomics.
+ * The grid covers the bounds of the points, or a fixed domain: stray particles far away make a large sort otherwise.
+ */
+class VOXELMESH_API FVoxelPointSurfacer
+{
+public:
+	using FBuildGrid = nanovdb::tools::build::Grid<float>;
+	using FBuildLeaf = nanovdb::tools::build::LeafNode<float>;
+
+	struct FStats
+	{
+		double SortSeconds = 0.0;
+		double SplatSeconds = 0.0;
+		double EncodeSeconds = 0.0;
+		uint32 NumPoints = 0;
+		uint32 NumLeaves = 0;
+		FIntVector Size = FIntVector::ZeroValue;
+	};
+
+	/// Empty when no point is in the domain. The first voxel of the grid is at index 0, the transform places it back.
+	static nanovdb::GridHandle<nanovdb::HostBuffer> Surface(TConstArrayView<FVector3f> Positions, const FVoxelPointSurfaceSettings& Settings, FStats* OutStats = nullptr);
+};
@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+#include "VoxelRawVolumeImporter.generated.h"
+
+UENUM(BlueprintType)
+enum class EVoxelRawFormat : uint8
+{
+	UInt8,
+	UInt16,
+	Float32
+};
+
+/**
+ * Layout of a raw dense volume: a header, then the voxels with x varying fastest and z slowest.
+ * Values are densities, the surface is where they cross IsoValue.
+ */
+USTRUCT(BlueprintType)
+struct VOXELMESH_API FVoxelRawVolumeSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Raw Volume", meta = (ClampMin = 1))
+	FIntVector Dimensions = FIntVector(256);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Raw Volume")
+	EVoxelRawFormat Format = EVoxelRawFormat::UInt8;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Raw Volume")
+	bool bBigEndian = false;
+
+	/** Bytes skipped at the start of the file */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Raw Volume", meta = (ClampMin = 0))
+	int64 HeaderSize = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Raw Volume")
+	float IsoValue = 128.0f;
+
+	/** Whether the solid is where the values are above IsoValue, like the densities of a scan */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Raw Volume")
+	bool bInsideAboveIso = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Raw Volume", meta = (ClampMin = 0.001))
+	float VoxelSize = 1.0f;
+
+	/** Half width of the narrow band, in voxels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Raw Volume", meta = (ClampMin = 1.0))
+	float BandWidth = 3.0f;
+
+	/** Voxels per chunk and axis, rounded up to whole leaves */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Raw Volume", meta = (ClampMin = 8))
+	int32 ChunkSize = 256;
+};
+
+/**
+ * Converts a raw dense volume to narrow band level sets, one per chunk, without ever holding the volume in memory.
+ * Slices are streamed in slabs one leaf deep, with one more slice on each side for the gradients. The leaves of a slab
+ * are built in parallel where the values are within the band of the iso value, and a layer of chunks is encoded and
+ * handed over as soon as the slabs reach its end. Memory is bounded by ten slices and the band leaves of one layer of chunks.
+ */
+class VOXELMESH_API FVoxelRawVolumeImporter
+{
+public:
+	using FBuildGrid = nanovdb::tools::build::Grid<float>;
+	using FBuildLeaf = nanovdb::tools::build::LeafNode<float>;
+
+	struct FStats
+	{
+		double ReadSeconds = 0.0;
+		double ConvertSeconds = 0.0;
+		double EncodeSeconds = 0.0;
+		uint32 NumChunks = 0;
+		uint32 NumLeaves = 0;
+		/// Slices held at once, in bytes
+		uint64 SlabBytes = 0;
+	};
+
+	/// Fill the bytes of a slice, in file order
+	using FReadSlice = TFunctionRef<bool(int32 SliceIndex, TArrayView<uint8> OutBytes)>;
+
+	/// Level set of a chunk with a surface, in local index space with its world offset in the transform. Returning false stops the import.
+	using FOnChunk = TFunctionRef<bool(const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Grid)>;
+
+	/// Called before every slab is read, whether chunks come out of it or not. Returning false stops the import.
+	using FOnProgress = TFunctionRef<bool(int32 NumSlicesRead, int32 NumSlices)>;
+
+	/// False when a slice can't be read, or OnChunk or OnProgress stops the import
+	static bool Import(FReadSlice ReadSlice, const FVoxelRawVolumeSettings& Settings, FOnChunk OnChunk, FOnProgress OnProgress, FStats* OutStats = nullptr);
+
+	static bool ImportFile(const FString& Filename, const FVoxelRawVolumeSettings& Settings, FOnChunk OnChunk, FOnProgress OnProgress, FStats* OutStats = nullptr);
+
+	/// Dimensions and format from names like bonsai_256x256x256_uint8.raw, returns whether the dimensions were found
+	static bool ParseFileName(const FString& Filename, FVoxelRawVolumeSettings& InOutSettings);
+
+	static int32 GetBytesPerVoxel(EVoxelRawFormat Format);
+};
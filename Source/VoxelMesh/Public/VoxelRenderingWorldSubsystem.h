@@ -3,10 +3,19 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
 #include "Subsystems/WorldSubsystem.h"
+#include "VoxelChunkStreamer.h"
 #include "VoxelRenderingWorldSubsystem.generated.h"
 
+class UVoxelMeshProxyComponent;
 
+/**
+ * Streams the registered chunk assets around the views of the world, see FVoxelChunkStreamer.
+ * Views are the ones rendered since the last tick plus the origins added by AddStreamingOrigin. Chunks in range are loaded
+ * asynchronously, meshed, then drawn by a component of their own, within the budgets of StreamingSettings. Unloaded chunks
+ * release their mesh, it is built again when they come back in range.
+ */
 UCLASS(BlueprintType, Blueprintable)
 class VOXELMESH_API UVoxelRenderingWorldSubsystem : public UTickableWorldSubsystem
 {
@@ -21,11 +30,69 @@ public:
 	static UVoxelRenderingWorldSubsystem* Get(const UWorld* World);
 
 	void UpdateCurrentChunks_GameThread();
+
+	/// Views of the chunks loaded by the streaming
 	TArrayView<class UVoxelChunkView*> GetChunks();
 
+	/** Stream a chunk asset at a chunk coordinate, replacing the one registered there */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Streaming")
+	void RegisterChunk(FIntVector ChunkCoord, TSoftObjectPtr<UVoxelChunkView> Asset);
+
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Streaming")
+	void UnregisterChunk(FIntVector ChunkCoord);
+
+	/** Stream around a position besides the views, for a player without a rendered view, until RemoveStreamingOrigin. Returns its handle. */
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Streaming")
+	int32 AddStreamingOrigin(FVector Origin);
+
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Streaming")
+	void MoveStreamingOrigin(int32 Handle, FVector Origin);
+
+	UFUNCTION(BlueprintCallable, Category = "Voxel | Streaming")
+	void RemoveStreamingOrigin(int32 Handle);
+
+	/** Null unless the chunk is loaded */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Voxel | Streaming")
+	UVoxelChunkView* GetLoadedChunk(FIntVector ChunkCoord) const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Voxel | Streaming")
+	FVoxelStreamingStats GetStreamingStats() const { return Streamer.GetStats(); }
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Streaming")
+	FVoxelStreamingSettings StreamingSettings;
+
 protected:
+	struct FStreamedChunk
+	{
+		TSoftObjectPtr<UVoxelChunkView> Asset;
+		/// Kept alive by Chunks while loaded
+		UVoxelChunkView* View = nullptr;
+		TSharedPtr<FStreamableHandle> LoadHandle;
+	};
+
+	void OnChunkLoaded(FIntVector ChunkCoord);
+	void MeshChunk(const FIntVector& ChunkCoord, TConstArrayView<FVector> Origins);
+	void ShowChunk(const FIntVector& ChunkCoord);
+	void UnloadChunk(const FIntVector& ChunkCoord);
+
 	TSharedPtr<class FVoxelViewExtension> VoxelViewExtension;
 
 	UPROPERTY()
 	TArray<class UVoxelChunkView*> Chunks;
+
+	UPROPERTY()
+	TMap<FIntVector, TObjectPtr<UVoxelMeshProxyComponent>> ChunkComponents;
+
+	TMap<FIntVector, FStreamedChunk> StreamedChunks;
+	/// Meshing chunks, polled until their mesh is ready
+	TSet<FIntVector> MeshingChunks;
+	FVoxelChunkStreamer Streamer;
+	FVoxelChunkStreamer::FUpdate StreamingUpdate;
+	FStreamableManager StreamableManager;
+
+	/// Of the views rendered last, kept while no view is rendered
+	TArray<FVector> ViewOrigins;
+	/// Added by AddStreamingOrigin, by handle
+	TMap<int32, FVector> ExtraOrigins;
+	int32 NextOriginHandle = 0;
 };
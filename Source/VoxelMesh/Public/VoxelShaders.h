@@ -19,8 +19,17 @@ BEGIN_UNIFORM_BUFFER_STRUCT(FVoxelMarchingCubeUniformParameters, VOXELMESH_API )
 	SHADER_PARAMETER(uint32, VoxelSizeZ)
 	SHADER_PARAMETER(uint32, TotalCubes)
 	SHADER_PARAMETER(float, SurfaceIsoValue)
+	SHADER_PARAMETER(uint32, BrickCountX)
+	SHADER_PARAMETER(uint32, BrickCountY)
+	SHADER_PARAMETER(uint32, BrickCountZ)
+	SHADER_PARAMETER(uint32, TransitionFaces)
+	SHADER_PARAMETER(uint32, ApronFaces)
 END_UNIFORM_BUFFER_STRUCT()
 
+/// Must match WORKGROUP_SIZE_X in MarchingCubesCS.usf, used by the per non-empty cube pass.
+/// The classification and generation passes run one group of VOXEL_BRICK_SIZE threads per brick.
+static constexpr uint32 VoxelMarchingCubesWorkgroupSize = 64;
+
 class VOXELMESH_API FVoxelMarchingCubesCalcCubeIndexCS : public FGlobalShader
 {
 	DECLARE_GLOBAL_SHADER(FVoxelMarchingCubesCalcCubeIndexCS);
@@ -29,8 +38,11 @@ class VOXELMESH_API FVoxelMarchingCubesCalcCubeIndexCS : public FGlobalShader
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER_STRUCT_REF(FVoxelMarchingCubeUniformParameters, MarchingCubeParameters)
 		VOXEL_SHADER_PARAMETER_BUFFER_SRV(StructuredBuffer<uint32>, SrcVoxelData)
+		VOXEL_SHADER_PARAMETER_BUFFER_SRV(StructuredBuffer<float>, SrcApronData)
 		VOXEL_SHADER_PARAMETER_BUFFER_UAV(RWBuffer<uint32>, OutCubeIndexOffsets)
 		VOXEL_SHADER_PARAMETER_BUFFER_UAV(RWBuffer<uint32>, Counter)
+		SHADER_PARAMETER_UAV(RWBuffer<uint32>, OutNonEmptyBrickIndex)
+		SHADER_PARAMETER_UAV(RWBuffer<uint32>, OutNonEmptyCubeIndex)
 	END_SHADER_PARAMETER_STRUCT()
 
 	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& Environment);
@@ -44,12 +56,9 @@ class VOXELMESH_API FVoxelMarchingCubesCalcCubeOffsetCS : public FGlobalShader
 	
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER_STRUCT_REF(FVoxelMarchingCubeUniformParameters, MarchingCubeParameters)
-		VOXEL_SHADER_PARAMETER_BUFFER_SRV(StructuredBuffer<uint32>, SrcVoxelData)
-		VOXEL_SHADER_PARAMETER_BUFFER_SRV(Buffer<uint32>, InCubeIndexOffsets)
 		VOXEL_SHADER_PARAMETER_BUFFER_UAV(RWBuffer<uint32>, Counter)
 		// The creation of these resource will be delayed. So it don't managed by render graph.
-		SHADER_PARAMETER_UAV(RWBuffer<uint32>, OutNonEmptyCubeLinearId)
-		SHADER_PARAMETER_UAV(RWBuffer<uint32>, OutNonEmptyCubeIndex)
+		SHADER_PARAMETER_SRV(Buffer<uint32>, InNonEmptyCubeIndex)
 		SHADER_PARAMETER_UAV(RWBuffer<uint32>, OutVertexIndexOffset)
 	END_SHADER_PARAMETER_STRUCT()
 };
@@ -62,15 +71,16 @@ class VOXELMESH_API FVoxelMarchingCubesGenerateMeshCS : public FGlobalShader
 	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
 		SHADER_PARAMETER_STRUCT_REF(FVoxelMarchingCubeUniformParameters, MarchingCubeParameters)
 		VOXEL_SHADER_PARAMETER_BUFFER_SRV(StructuredBuffer<uint32>, SrcVoxelData)
+		VOXEL_SHADER_PARAMETER_BUFFER_SRV(StructuredBuffer<float>, SrcApronData)
 		VOXEL_SHADER_PARAMETER_BUFFER_SRV(Buffer<uint32>, InCubeIndexOffsets)
 		// The creation of these resource will be delayed. So it don't managed by render graph.
-		SHADER_PARAMETER_SRV(Buffer<uint32>, InNonEmptyCubeLinearId)
+		SHADER_PARAMETER_SRV(Buffer<uint32>, InNonEmptyBrickIndex)
 		SHADER_PARAMETER_SRV(Buffer<uint32>, InNonEmptyCubeIndex)
 		SHADER_PARAMETER_SRV(Buffer<uint32>, InVertexIndexOffset)
 		// RHIProxy is going to manage these resources.
 		SHADER_PARAMETER_UAV(RWBuffer<float4>, OutVertexBuffer)
 		SHADER_PARAMETER_UAV(RWBuffer<uint32>, OutIndexBuffer)
-
-		SHADER_PARAMETER(uint32, NumNonEmptyCubes)
+		// Number of non-empty bricks
+		VOXEL_SHADER_PARAMETER_BUFFER_UAV(RWBuffer<uint32>, Counter)
 	END_SHADER_PARAMETER_STRUCT()
 };
@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelCpuMesher.h"
+
+/**
+ * Naive Surface Nets on the CPU, a dual alternative to marching cubes built on the same brick tiles and classification.
+ * Every cell crossed by the surface gets a single vertex at the mean of its edge crossings, and every crossed grid edge
+ * produces one quad joining the four cells around it.
+ * This yields roughly half the vertices and triangles of marching cubes, without its thin slivers.
+ */
+class VOXELMESH_API FVoxelSurfaceNetsMesher : public FVoxelCpuMesher
+{
+public:
+	using FVoxelCpuMesher::FVoxelCpuMesher;
+
+	void Generate(FVoxelCpuMeshData& OutMeshData) const;
+
+protected:
+	/// Cells of the last layer have clamped corners, they are left out so every quad joins four real cells
+	FORCEINLINE FIntVector GetNumCells() const
+	{
+		return Traversal.VoxelSize - FIntVector(1);
+	}
+
+	/// Number of quads owned by a cell, one per crossed edge leaving its first corner with the three other cells inside
+	uint32 CountOwnedQuads(const FIntVector& Coord, uint32 CubeIndex) const;
+
+	FVector3f PlaceCellVertex(const FVoxelBrickTile& Tile, const FIntVector& LocalCoord, uint32 CubeIndex) const;
+};
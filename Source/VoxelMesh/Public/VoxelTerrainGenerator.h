@@ -0,0 +1,106 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+#include "VoxelTerrainGenerator.generated.h"
+
+/**
+ * Layered noise terrain: a domain warped fractal heightfield with noise caves carved out of it.
+ * Lengths are in voxels, the world is unbounded and cut in chunks of ChunkSize^3 voxels.
+ */
+USTRUCT(BlueprintType)
+struct VOXELMESH_API FVoxelTerrainSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain")
+	int32 Seed = 1337;
+
+	/** Voxels per chunk and axis */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain", meta = (ClampMin = 8))
+	int32 ChunkSize = 128;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain", meta = (ClampMin = 0.001))
+	float VoxelSize = 1.0f;
+
+	/** Half width of the narrow band, in voxels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain", meta = (ClampMin = 1.0))
+	float BandWidth = 3.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain | Height")
+	float BaseHeight = 64.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain | Height", meta = (ClampMin = 0.0))
+	float HeightAmplitude = 48.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain | Height", meta = (ClampMin = 0.0))
+	float HeightFrequency = 1.0f / 256.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain | Height", meta = (ClampMin = 1, ClampMax = 12))
+	int32 Octaves = 5;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain | Height", meta = (ClampMin = 1.0))
+	float Lacunarity = 2.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain | Height", meta = (ClampMin = 0.0, ClampMax = 1.0))
+	float Gain = 0.5f;
+
+	/** How far the heightfield is pushed around, 0 to disable the domain warp */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain | Warp", meta = (ClampMin = 0.0))
+	float WarpAmplitude = 24.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain | Warp", meta = (ClampMin = 0.0))
+	float WarpFrequency = 1.0f / 512.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain | Caves", meta = (ClampMin = 0.0))
+	float CaveFrequency = 1.0f / 64.0f;
+
+	/** Caves follow the zero crossings of a 3D noise, this is their thickness in noise units. 0 to disable them. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Terrain | Caves", meta = (ClampMin = 0.0, ClampMax = 1.0))
+	float CaveThreshold = 0.08f;
+};
+
+/**
+ * Evaluate FVoxelTerrainSettings into narrow band level set chunks.
+ * Leaves are generated in parallel. A leaf is skipped after a single sample at its center when the Lipschitz bound of the
+ * field proves it further than the band from the surface, and becomes a tile with the sign of that sample.
+ */
+class VOXELMESH_API FVoxelTerrainGenerator
+{
+public:
+	using FBuildGrid = nanovdb::tools::build::Grid<float>;
+	using FBuildLeaf = nanovdb::tools::build::LeafNode<float>;
+
+	struct FStats
+	{
+		double Seconds = 0.0;
+		/// Samples of the field, one per skipped leaf and 512 per generated one
+		uint64 NumSamples = 0;
+		uint32 NumLeaves = 0;
+		uint32 NumSkippedLeaves = 0;
+	};
+
+	explicit FVoxelTerrainGenerator(const FVoxelTerrainSettings& InSettings);
+
+	/// Field at a world position in voxels, negative inside. Thread safe.
+	float Evaluate(const FVector3f& Position) const;
+
+	/// No two positions have their values further apart than this times their distance
+	float GetLipschitzBound() const { return LipschitzBound; }
+
+	/**
+	 * Level set of the chunk starting at ChunkCoord * ChunkSize voxels, in local index space with its world offset in the transform.
+	 * IsCancelled is polled from worker threads, the grid is empty once it returns true.
+	 */
+	nanovdb::GridHandle<nanovdb::HostBuffer> GenerateChunk(const FIntVector& ChunkCoord, FStats* OutStats = nullptr,
+		TFunctionRef<bool()> IsCancelled = [] { return false; }) const;
+
+	const FVoxelTerrainSettings& GetSettings() const { return Settings; }
+
+private:
+	float EvaluateHeight(float X, float Y) const;
+	float CarveCaves(const FVector3f& Position, float Value) const;
+
+	FVoxelTerrainSettings Settings;
+	float LipschitzBound = 1.0f;
+};
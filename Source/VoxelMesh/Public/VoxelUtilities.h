@@ -4,9 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "UObject/Object.h"
+#include "VoxelPointSurfacer.h"
+#include "VoxelTerrainGenerator.h"
 #include "VoxelUtilities.generated.h"
 
 
+class UStaticMesh;
 class UVoxelChunkView;
 
 /**
@@ -22,4 +25,19 @@ public:
 	/// Create a test nanovdb buffer
 	UFUNCTION(BlueprintCallable)
 	static UVoxelChunkView* CreateSphereChunkView(UObject* Outer);
+
+	/// Generate the chunk of a procedural terrain at a chunk coordinate, see FVoxelTerrainGenerator
+	UFUNCTION(BlueprintCallable)
+	static UVoxelChunkView* CreateTerrainChunkView(UObject* Outer, const FVoxelTerrainSettings& Settings, FIntVector ChunkCoord);
+
+	/// Voxelize the first level of detail of a static mesh, see FVoxelMeshVoxelizer. Its vertices must be readable on the CPU.
+	UFUNCTION(BlueprintCallable)
+	static UVoxelChunkView* CreateStaticMeshChunkView(UObject* Outer, UStaticMesh* StaticMesh, float VoxelSize = 1.0f, float BandWidth = 3.0f);
+
+	/**
+	 * Replace the grid of a chunk by the surface of particles, see FVoxelPointSurfacer. Cheap enough to call every frame: the grid
+	 * waits for the mesh in flight and the rebuild goes through FVoxelMeshRebuildScheduler, see UVoxelChunkView::QueueVdbBuffer_GameThread.
+	 */
+	UFUNCTION(BlueprintCallable)
+	static bool SurfacePoints(UVoxelChunkView* ChunkView, const TArray<FVector>& Points, const FVoxelPointSurfaceSettings& Settings);
 };
@@ -16,6 +16,9 @@ public:
 
 private:
 	TArrayView<class UVoxelChunkView*> Chunks;
+
+	/// Origins of the views set up since the streaming last took them, see UVoxelRenderingWorldSubsystem. Game thread.
+	TArray<FVector> ViewOrigins;
 	
 	friend class UVoxelRenderingWorldSubsystem;
 };
@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+#include "VoxelVoxImporter.generated.h"
+
+USTRUCT(BlueprintType)
+struct VOXELMESH_API FVoxelVoxSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Vox", meta = (ClampMin = 0.001))
+	float VoxelSize = 1.0f;
+
+	/** Half width of the narrow band, in voxels */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Vox", meta = (ClampMin = 1.0, ClampMax = 7.0))
+	float BandWidth = 3.0f;
+
+	/** Voxels per chunk and axis, rounded up to whole leaves */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Vox", meta = (ClampMin = 8))
+	int32 ChunkSize = 256;
+
+	/** Also import the instances hidden in MagicaVoxel, directly or by their group or layer */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel | Vox")
+	bool bImportHidden = false;
+};
+
+/**
+ * Content of a MagicaVoxel .vox file: models, the palette, and the instances of the scene graph with their transforms
+ * flattened. Positions are in MagicaVoxel space, z up and right handed.
+ */
+struct VOXELMESH_API FVoxelVoxScene
+{
+	struct FModel
+	{
+		FIntVector Size = FIntVector::ZeroValue;
+		/// x, y, z and palette index of every solid voxel
+		TArray<FIntVector4> Voxels;
+	};
+
+	struct FInstance
+	{
+		int32 ModelIndex = 0;
+		/// Rows of the rotation, every row has a single +1 or -1
+		FIntVector Rotation[3] = {FIntVector(1, 0, 0), FIntVector(0, 1, 0), FIntVector(0, 0, 1)};
+		FIntVector Translation = FIntVector::ZeroValue;
+		bool bHidden = false;
+
+		FIntVector Transform(const FIntVector& Position) const
+		{
+			return FIntVector(
+				Rotation[0].X * Position.X + Rotation[0].Y * Position.Y + Rotation[0].Z * Position.Z,
+				Rotation[1].X * Position.X + Rotation[1].Y * Position.Y + Rotation[1].Z * Position.Z,
+				Rotation[2].X * Position.X + Rotation[2].Y * Position.Y + Rotation[2].Z * Position.Z) + Translation;
+		}
+	};
+
+	TArray<FModel> Models;
+	TArray<FInstance> Instances;
+	/// Indexed by the palette index of the voxels, 0 is unused
+	TArray<FColor> Palette;
+
+	/// False when the bytes aren't a .vox file, a scene without a graph gets one instance per model
+	bool Load(TConstArrayView<uint8> Bytes);
+};
+
+/**
+ * Converts the occupancy of a .vox scene to narrow band level sets, split in chunks. Distances are exact distances to the
+ * voxel cubes, searched per leaf in parallel around every voxel, so the mesh follows the blocky shape of the voxel art.
+ * The palette index of the closest solid voxel is kept by a second grid with the same active voxels.
+ */
+class VOXELMESH_API FVoxelVoxImporter
+{
+public:
+	using FBuildGrid = nanovdb::tools::build::Grid<float>;
+	using FBuildLeaf = nanovdb::tools::build::LeafNode<float>;
+	using FBuildMaterialGrid = nanovdb::tools::build::Grid<uint8_t>;
+	using FBuildMaterialLeaf = nanovdb::tools::build::LeafNode<uint8_t>;
+
+	struct FStats
+	{
+		double RasterizeSeconds = 0.0;
+		double DistanceSeconds = 0.0;
+		double EncodeSeconds = 0.0;
+		uint32 NumVoxels = 0;
+		uint32 NumChunks = 0;
+		uint32 NumLeaves = 0;
+	};
+
+	/// Level set and palette indices of a chunk, in local index space with the world offset of the chunk in the transform. Returning false stops the import.
+	using FOnChunk = TFunctionRef<bool(const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Grid, nanovdb::GridHandle<nanovdb::HostBuffer>&& MaterialGrid)>;
+
+	/// Called before every batch of chunks is encoded. Returning false stops the import.
+	using FOnProgress = TFunctionRef<bool(int32 NumChunksDone, int32 NumChunks)>;
+
+	/**
+	 * Chunks are encoded in batches and given as soon as their batch is done, in order, on the calling thread. False when the
+	 * scene has no visible voxel, or OnChunk or OnProgress stops the import.
+	 */
+	static bool Import(const FVoxelVoxScene& Scene, const FVoxelVoxSettings& Settings, FOnChunk OnChunk, FOnProgress OnProgress, FStats* OutStats = nullptr);
+
+	static bool ImportFile(const FString& Filename, const FVoxelVoxSettings& Settings, FOnChunk OnChunk, FOnProgress OnProgress, TArray<FColor>* OutPalette = nullptr,
+		FStats* OutStats = nullptr);
+};
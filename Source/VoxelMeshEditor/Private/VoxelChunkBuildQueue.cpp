@@ -0,0 +1,133 @@
+﻿#include "VoxelChunkBuildQueue.h"
+
+#include "Async/Async.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "VoxelChunkView.h"
+#include "VoxelMeshLog.h"
+#include "Widgets/Notifications/SNotificationList.h"
+
+FVoxelChunkBuildQueue& FVoxelChunkBuildQueue::Get()
+{
+	static FVoxelChunkBuildQueue Queue;
+	return Queue;
+}
+
+void FVoxelChunkBuildQueue::Launch(UVoxelChunkView* View, FBuildFunction&& Build)
+{
+	check(IsInGameThread());
+	++NumLaunched;
+	Tasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, WeakView = TWeakObjectPtr<UVoxelChunkView>(View), Build = MoveTemp(Build), BuildGeneration = Generation.load()]() mutable
+	{
+		FResult Result;
+		Result.View = WeakView;
+		Result.Generation = BuildGeneration;
+		auto IsCancelled = [this, BuildGeneration] { return BuildGeneration != Generation; };
+		if (!IsCancelled())
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			Result.Grid = Build(IsCancelled);
+			Result.Seconds = FPlatformTime::Seconds() - StartTime;
+		}
+		if (IsCancelled())
+		{
+			// Freed here rather than after waiting for the game thread
+			Result.Grid.reset();
+		}
+		{
+			FScopeLock Lock(&ResultsLock);
+			Results.Add(MoveTemp(Result));
+		}
+		AsyncTask(ENamedThreads::GameThread, [this] { ApplyResults(); });
+	}));
+	UpdateNotification();
+}
+
+void FVoxelChunkBuildQueue::CancelAll()
+{
+	check(IsInGameThread());
+	if (GetNumPending() > 0)
+	{
+		UE_LOG(LogVoxelMesh, Log, TEXT("Cancelling %d voxel asset builds"), GetNumPending());
+		++Generation;
+		NumCancelled = GetNumPending();
+		UpdateNotification();
+	}
+}
+
+void FVoxelChunkBuildQueue::Flush()
+{
+	check(IsInGameThread());
+	UE::Tasks::Wait(Tasks);
+	ApplyResults();
+}
+
+void FVoxelChunkBuildQueue::ApplyResults()
+{
+	check(IsInGameThread());
+	TArray<FResult> Finished;
+	{
+		FScopeLock Lock(&ResultsLock);
+		Finished = MoveTemp(Results);
+	}
+
+	for (FResult& Result : Finished)
+	{
+		++NumFinished;
+		UVoxelChunkView* View = Result.View.Get();
+		if (Result.Generation != Generation || !View)
+		{
+			continue;
+		}
+		if (!Result.Grid)
+		{
+			UE_LOG(LogVoxelMesh, Warning, TEXT("Building %s gave no grid, it stays empty"), *View->GetName());
+			continue;
+		}
+		View->SetVdbBuffer_GameThread(MoveTemp(Result.Grid));
+		View->MarkPackageDirty();
+		UE_LOG(LogVoxelMesh, Log, TEXT("Built %s in %.2f s"), *View->GetName(), Result.Seconds);
+	}
+	Tasks.RemoveAll([](const UE::Tasks::FTask& Task) { return Task.IsCompleted(); });
+	UpdateNotification();
+}
+
+void FVoxelChunkBuildQueue::UpdateNotification()
+{
+	if (GetNumPending() == 0)
+	{
+		if (Notification)
+		{
+			Notification->SetText(NumCancelled > 0
+				? FText::Format(NSLOCTEXT("VoxelMesh", "CancelledVoxelBuilds", "Cancelled {0} of {1} voxel asset builds"), NumCancelled, NumLaunched)
+				: FText::Format(NSLOCTEXT("VoxelMesh", "FinishedVoxelBuilds", "Built {0} voxel assets"), NumLaunched));
+			Notification->SetCompletionState(NumCancelled > 0 ? SNotificationItem::CS_Fail : SNotificationItem::CS_Success);
+			Notification->ExpireAndFadeout();
+			Notification.Reset();
+		}
+		NumLaunched = 0;
+		NumFinished = 0;
+		NumCancelled = 0;
+		return;
+	}
+
+	const FText Text = NumCancelled > 0
+		? NSLOCTEXT("VoxelMesh", "CancellingVoxelBuilds", "Cancelling voxel asset builds")
+		: FText::Format(NSLOCTEXT("VoxelMesh", "BuildingVoxelAssets", "Building voxel assets ({0}/{1})"), NumFinished, NumLaunched);
+	if (Notification)
+	{
+		Notification->SetText(Text);
+		return;
+	}
+
+	FNotificationInfo Info(Text);
+	Info.bFireAndForget = false;
+	Info.ExpireDuration = 3.0f;
+	Info.ButtonDetails.Add(FNotificationButtonInfo(NSLOCTEXT("VoxelMesh", "CancelVoxelBuilds", "Cancel"),
+		NSLOCTEXT("VoxelMesh", "CancelVoxelBuildsTooltip", "Drop the voxel assets being built, they stay empty"),
+		FSimpleDelegate::CreateRaw(this, &FVoxelChunkBuildQueue::CancelAll), SNotificationItem::CS_Pending));
+	Notification = FSlateNotificationManager::Get().AddNotification(Info);
+	if (Notification)
+	{
+		Notification->SetCompletionState(SNotificationItem::CS_Pending);
+	}
+}
@@ -3,7 +3,14 @@
 
 #include "VoxelChunkViewEditor.h"
 
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/StaticMesh.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/PackageName.h"
+#include "ObjectTools.h"
 #include "VoxelChunkView.h"
+#include "VoxelMeshVoxelizer.h"
 #include "VoxelUtilities.h"
 #include "Editor/PropertyEditor/Private/SDetailsView.h"
 #include "Interfaces/IMainFrameModule.h"
@@ -29,59 +36,115 @@ UObject* UVoxelChunkViewFactory::FactoryCreateNew(UClass* InClass, UObject* InPa
 	
 	ShowVoxelCreationDialog(VoxelDataCreationOptions);
 
-	// Convert FVector to nanovdb Vec3d for center
-	nanovdb::Vec3d Center(
-		VoxelDataCreationOptions->Center.X, 
-		VoxelDataCreationOptions->Center.Y, 
-		VoxelDataCreationOptions->Center.Z
-	);
+	// The asset is returned empty, the grid is built on a worker thread
+	UVoxelChunkView* NewView = NewObject<UVoxelChunkView>(InParent, InClass, InName, Flags);
+	if (FVoxelChunkBuildQueue::FBuildFunction Build = MakeBuildFunction(*VoxelDataCreationOptions))
+	{
+		FVoxelChunkBuildQueue::Get().Launch(NewView, MoveTemp(Build));
+		if (FApp::IsUnattended())
+		{
+			FVoxelChunkBuildQueue::Get().Flush();
+		}
+	}
+
+	return NewView;
+}
 
-	// Initialize grid with default value
-	nanovdb::GridHandle<nanovdb::HostBuffer> NewGrid;
+FVoxelChunkBuildQueue::FBuildFunction UVoxelChunkViewFactory::MakeBuildFunction(const UVoxelDataCreationOptions& Options)
+{
+	// Options are copied, they can change before the build starts
+	const nanovdb::Vec3d Center(Options.Center.X, Options.Center.Y, Options.Center.Z);
+	const double VoxelSize = Options.VoxelSize;
 
-	// Create appropriate grid based on selected type
-	switch (VoxelDataCreationOptions->GridType)
+	switch (Options.GridType)
 	{
 	case EVoxelGridType::Sphere:
-		NewGrid = nanovdb::tools::createLevelSetSphere<nanovdb::Fp4, nanovdb::HostBuffer>(
-			VoxelDataCreationOptions->Radius,
-			nanovdb::Vec3f(Center), // Convert Vec3d to Vec3f if needed for this function
-			VoxelDataCreationOptions->VoxelSize);
-		break;
+		return [Radius = Options.Radius, Center, VoxelSize](TFunctionRef<bool()>)
+		{
+			return nanovdb::tools::createLevelSetSphere<nanovdb::Fp4, nanovdb::HostBuffer>(Radius, Center, VoxelSize);
+		};
 		
 	case EVoxelGridType::Box:
-		NewGrid = nanovdb::tools::createLevelSetBox<nanovdb::Fp4, nanovdb::HostBuffer>(
-			VoxelDataCreationOptions->Width,
-			VoxelDataCreationOptions->Height,
-			VoxelDataCreationOptions->Depth,
-			Center,
-			VoxelDataCreationOptions->VoxelSize,
-			VoxelDataCreationOptions->HalfWidth);
-		break;
+		return [Width = Options.Width, Height = Options.Height, Depth = Options.Depth, HalfWidth = Options.HalfWidth, Center, VoxelSize](TFunctionRef<bool()>)
+		{
+			return nanovdb::tools::createLevelSetBox<nanovdb::Fp4, nanovdb::HostBuffer>(Width, Height, Depth, Center, VoxelSize, HalfWidth);
+		};
 		
 	case EVoxelGridType::Torus:
-		NewGrid = nanovdb::tools::createLevelSetTorus<nanovdb::Fp4, nanovdb::HostBuffer>(
-			VoxelDataCreationOptions->MajorRadius,
-			VoxelDataCreationOptions->MinorRadius,
-			nanovdb::Vec3f(Center), // Convert Vec3d to Vec3f if needed for this function
-			VoxelDataCreationOptions->VoxelSize);
-		break;
+		return [MajorRadius = Options.MajorRadius, MinorRadius = Options.MinorRadius, Center, VoxelSize](TFunctionRef<bool()>)
+		{
+			return nanovdb::tools::createLevelSetTorus<nanovdb::Fp4, nanovdb::HostBuffer>(MajorRadius, MinorRadius, Center, VoxelSize);
+		};
 		
 	case EVoxelGridType::Octahedron:
-		NewGrid = nanovdb::tools::createLevelSetOctahedron<nanovdb::Fp4, nanovdb::HostBuffer>(
-			VoxelDataCreationOptions->Radius,
-			nanovdb::Vec3f(Center), // Convert Vec3d to Vec3f if needed for this function
-			VoxelDataCreationOptions->VoxelSize);
-		break;
+		return [Radius = Options.Radius, Center, VoxelSize](TFunctionRef<bool()>)
+		{
+			return nanovdb::tools::createLevelSetOctahedron<nanovdb::Fp4, nanovdb::HostBuffer>(Radius, Center, VoxelSize);
+		};
+
+	case EVoxelGridType::Terrain:
+		return [Generator = FVoxelTerrainGenerator(Options.Terrain), ChunkCoord = Options.ChunkCoord](TFunctionRef<bool()> IsCancelled)
+		{
+			return Generator.GenerateChunk(ChunkCoord, nullptr, IsCancelled);
+		};
+
+	case EVoxelGridType::StaticMesh:
+		{
+			// Render data can change on the game thread, the triangles are copied before leaving it
+			TArray<FVector3f> Positions;
+			TArray<uint32> Indices;
+			if (!Options.SourceMesh || !FVoxelMeshVoxelizer::GetStaticMeshTriangles(*Options.SourceMesh, Positions, Indices))
+			{
+				return nullptr;
+			}
+			return [Positions = MoveTemp(Positions), Indices = MoveTemp(Indices), VoxelSize, BandWidth = Options.BandWidth](TFunctionRef<bool()> IsCancelled)
+			{
+				return FVoxelMeshVoxelizer(Positions, Indices).Voxelize(VoxelSize, BandWidth, nullptr, IsCancelled);
+			};
+		}
 	}
+	return nullptr;
+}
 
-	UVoxelChunkView* NewView = NewObject<UVoxelChunkView>(InParent, InClass, InName, Flags);
-	NewView->SetVdbBuffer_GameThread(MoveTemp(NewGrid));
+UVoxelChunkView* UVoxelChunkViewFactory::CreateChunkAsset(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FIntVector& ChunkCoord, bool bSingleChunk)
+{
+	const FString ChunkName = bSingleChunk ? InName.ToString() : FString::Printf(TEXT("%s_%d_%d_%d"), *InName.ToString(), ChunkCoord.X, ChunkCoord.Y, ChunkCoord.Z);
+	const FString ParentName = InParent->GetOutermost()->GetName();
+	if (FPackageName::GetShortName(ParentName) == ChunkName)
+	{
+		return NewObject<UVoxelChunkView>(InParent, InClass, FName(*ChunkName), Flags);
+	}
 
-	return NewView;
+	return CreateChunkAsset(InClass, FPackageName::GetLongPackagePath(ParentName), InName, Flags, ChunkCoord, bSingleChunk);
+}
+
+UVoxelChunkView* UVoxelChunkViewFactory::CreateChunkAsset(UClass* InClass, const FString& PackagePath, FName InName, EObjectFlags Flags, const FIntVector& ChunkCoord, bool bSingleChunk)
+{
+	const FString ChunkName = bSingleChunk ? InName.ToString() : FString::Printf(TEXT("%s_%d_%d_%d"), *InName.ToString(), ChunkCoord.X, ChunkCoord.Y, ChunkCoord.Z);
+	UPackage* Package = CreatePackage(*(PackagePath / ChunkName));
+	UVoxelChunkView* View = NewObject<UVoxelChunkView>(Package, InClass, FName(*ChunkName), Flags | RF_Public | RF_Standalone);
+	FAssetRegistryModule::AssetCreated(View);
+	Package->MarkPackageDirty();
+	return View;
+}
+
+void UVoxelChunkViewFactory::DeleteChunkAssets(TConstArrayView<UVoxelChunkView*> Views)
+{
+	TArray<UObject*> Objects;
+	for (UVoxelChunkView* View : Views)
+	{
+		if (IsValid(View))
+		{
+			Objects.Add(View);
+		}
+	}
+	if (!Objects.IsEmpty())
+	{
+		ObjectTools::DeleteObjectsUnchecked(Objects);
+	}
 }
 
-bool UVoxelChunkViewFactory::ShowVoxelCreationDialog(UVoxelDataCreationOptions* OutOptions)
+bool UVoxelChunkViewFactory::ShowVoxelCreationDialog(UObject* OutOptions)
 {
 	if (!IsValid(OutOptions))
 	{
@@ -156,3 +219,38 @@ uint32 FVoxelChunkAssetTypeActions::GetCategories()
 {
 	return EAssetTypeCategories::Basic;
 }
+
+namespace VoxelChunkViewEditor
+{
+	static void CreateTerrainChunks(const TArray<FString>& Args)
+	{
+		const FString PackagePath = Args.Num() > 0 ? Args[0] : FString(TEXT("/Game/VoxelTerrain"));
+		const FIntVector NumChunks(
+			Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 4,
+			Args.Num() > 2 ? FMath::Max(FCString::Atoi(*Args[2]), 1) : 4,
+			Args.Num() > 3 ? FMath::Max(FCString::Atoi(*Args[3]), 1) : 1);
+
+		// Every chunk is its own build, they run concurrently
+		UVoxelDataCreationOptions* Options = NewObject<UVoxelDataCreationOptions>();
+		Options->GridType = EVoxelGridType::Terrain;
+		for (int32 Z = 0; Z < NumChunks.Z; ++Z)
+		{
+			for (int32 Y = 0; Y < NumChunks.Y; ++Y)
+			{
+				for (int32 X = 0; X < NumChunks.X; ++X)
+				{
+					Options->ChunkCoord = FIntVector(X, Y, Z);
+					UVoxelChunkView* View = UVoxelChunkViewFactory::CreateChunkAsset(UVoxelChunkView::StaticClass(), PackagePath, TEXT("Terrain"), RF_Public | RF_Standalone,
+						Options->ChunkCoord, false);
+					FVoxelChunkBuildQueue::Get().Launch(View, UVoxelChunkViewFactory::MakeBuildFunction(*Options));
+				}
+			}
+		}
+	}
+
+	static FAutoConsoleCommand CreateTerrainChunksCommand(
+		TEXT("voxel.CreateTerrainChunks"),
+		TEXT("Create chunk view assets of the default procedural terrain in the background, named Terrain_<X>_<Y>_<Z>.\n")
+		TEXT("Usage: voxel.CreateTerrainChunks [PackagePath=/Game/VoxelTerrain] [ChunksX=4] [ChunksY=4] [ChunksZ=1]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&CreateTerrainChunks));
+}
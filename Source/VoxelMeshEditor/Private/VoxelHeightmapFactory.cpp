@@ -0,0 +1,195 @@
+﻿#include "VoxelHeightmapFactory.h"
+
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Editor.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Landscape.h"
+#include "LandscapeEdit.h"
+#include "LandscapeInfo.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopedSlowTask.h"
+#include "VoxelChunkView.h"
+#include "VoxelChunkViewEditor.h"
+#include "VoxelMeshLog.h"
+
+UVoxelHeightmapFactory::UVoxelHeightmapFactory(const FObjectInitializer& Initializer)
+{
+	SupportedClass = UVoxelChunkView::StaticClass();
+	bCreateNew = false;
+	bEditorImport = true;
+	Formats.Add(TEXT("r16;Raw 16-bit heightmap"));
+	ImportOptions = Initializer.CreateDefaultSubobject<UVoxelHeightmapImportOptions>(this, "Options", true);
+}
+
+UObject* UVoxelHeightmapFactory::FactoryCreateFile(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms,
+	FFeedbackContext* Warn, bool& bOutOperationCanceled)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+	{
+		UE_LOG(LogVoxelMesh, Error, TEXT("Cannot open %s"), *Filename);
+		return nullptr;
+	}
+	const int32 NumSamples = Bytes.Num() / sizeof(uint16);
+	FIntPoint& Resolution = ImportOptions->Resolution;
+	if (Resolution.X <= 0 || Resolution.Y <= 0 || Resolution.X * Resolution.Y != NumSamples)
+	{
+		const int32 Side = FMath::RoundToInt32(FMath::Sqrt(static_cast<double>(NumSamples)));
+		Resolution = FIntPoint(Side, Side);
+	}
+	if (!IsAutomatedImport())
+	{
+		UVoxelChunkViewFactory::ShowVoxelCreationDialog(ImportOptions);
+	}
+	if (Resolution.X <= 0 || Resolution.Y <= 0 || Resolution.X * Resolution.Y != NumSamples)
+	{
+		UE_LOG(LogVoxelMesh, Error, TEXT("%s has %d samples, not %dx%d"), *Filename, NumSamples, Resolution.X, Resolution.Y);
+		return nullptr;
+	}
+
+	// .r16 files are little endian like the platforms the editor runs on
+	const TConstArrayView<uint16> Heights(reinterpret_cast<const uint16*>(Bytes.GetData()), NumSamples);
+	return CreateChunkAssets(Heights, Resolution, ImportOptions->Settings, InClass, InParent, InName, Flags, &bOutOperationCanceled);
+}
+
+UVoxelChunkView* UVoxelHeightmapFactory::CreateChunkAssets(TConstArrayView<uint16> Heights, const FIntPoint& Size, const FVoxelHeightmapSettings& Settings, UClass* InClass,
+	UObject* InParent, FName InName, EObjectFlags Flags, bool* bOutCanceled)
+{
+	FIntVector ChunkMin;
+	FIntVector ChunkMax;
+	FVoxelHeightmapConverter::GetChunkRange(Heights, Size, Settings, ChunkMin, ChunkMax);
+	const bool bSingleChunk = ChunkMin == ChunkMax;
+
+	FScopedSlowTask SlowTask(ChunkMax.Y - ChunkMin.Y + 1, NSLOCTEXT("VoxelMesh", "ConvertingHeightmap", "Converting the heightmap to voxels"));
+	SlowTask.MakeDialog(true);
+	int32 LastChunkY = ChunkMin.Y;
+	bool bCanceled = false;
+	TArray<UVoxelChunkView*> Views;
+	FVoxelHeightmapConverter::FStats Stats;
+	const bool bSuccess = FVoxelHeightmapConverter::Convert(Heights, Size, Settings, [&](const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Grid)
+	{
+		if (SlowTask.ShouldCancel())
+		{
+			bCanceled = true;
+			return false;
+		}
+		if (ChunkCoord.Y != LastChunkY)
+		{
+			SlowTask.EnterProgressFrame(ChunkCoord.Y - LastChunkY);
+			LastChunkY = ChunkCoord.Y;
+		}
+		// The first chunk is the imported asset, the others get packages of their own next to it
+		UVoxelChunkView* View = UVoxelChunkViewFactory::CreateChunkAsset(InClass, InParent, InName, Flags, ChunkCoord, bSingleChunk || Views.IsEmpty());
+		View->SetVdbBuffer_GameThread(MoveTemp(Grid));
+		Views.Add(View);
+		return true;
+	}, &Stats);
+	if (bOutCanceled)
+	{
+		*bOutCanceled = bCanceled;
+	}
+	if (bCanceled)
+	{
+		UE_LOG(LogVoxelMesh, Log, TEXT("Heightmap conversion canceled after %d chunks"), Views.Num());
+		UVoxelChunkViewFactory::DeleteChunkAssets(Views);
+		return nullptr;
+	}
+	if (!bSuccess)
+	{
+		return nullptr;
+	}
+	UE_LOG(LogVoxelMesh, Log, TEXT("Converted a %dx%d heightmap in %.2f s: %u chunks, %u leaves, %u tiles"), Size.X, Size.Y, Stats.Seconds,
+		Stats.NumChunks, Stats.NumLeaves, Stats.NumTiles);
+	return Views.IsEmpty() ? nullptr : Views[0];
+}
+
+bool UVoxelHeightmapFactory::ReadLandscape(ALandscapeProxy* Landscape, TArray<uint16>& OutHeights, FIntPoint& OutSize, FVoxelHeightmapSettings& InOutSettings)
+{
+	ULandscapeInfo* LandscapeInfo = Landscape ? Landscape->GetLandscapeInfo() : nullptr;
+	int32 MinX;
+	int32 MinY;
+	int32 MaxX;
+	int32 MaxY;
+	if (!LandscapeInfo || !LandscapeInfo->GetLandscapeExtent(MinX, MinY, MaxX, MaxY))
+	{
+		return false;
+	}
+
+	OutSize = FIntPoint(MaxX - MinX + 1, MaxY - MinY + 1);
+	OutHeights.SetNumZeroed(OutSize.X * OutSize.Y);
+	FLandscapeEditDataInterface LandscapeEdit(LandscapeInfo);
+	LandscapeEdit.GetHeightDataFast(MinX, MinY, MaxX, MaxY, OutHeights.GetData(), 0);
+
+	// The extent is in quads of the landscape actor, whose transform places them in the world. Landscape heights are
+	// 1/128 of the z scale, the samples are spaced by the x scale.
+	const ALandscape* LandscapeActor = LandscapeInfo->LandscapeActor.Get();
+	const FTransform Transform = LandscapeActor ? LandscapeActor->GetActorTransform() : Landscape->GetActorTransform();
+	const FVector Scale = Transform.GetScale3D();
+	const FVector Origin = Transform.TransformPosition(FVector(MinX, MinY, 0.0));
+	InOutSettings.VoxelSize = Scale.X;
+	InOutSettings.HeightScale = Scale.Z / 128.0f;
+	InOutSettings.HeightOffset = Origin.Z;
+	InOutSettings.Origin = FVector2D(Origin.X, Origin.Y);
+	if (!FMath::IsNearlyEqual(Scale.X, Scale.Y))
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("%s isn't scaled uniformly, voxels are cubes of its x scale"), *Landscape->GetName());
+	}
+	if (!Transform.GetRotation().IsIdentity(UE_KINDA_SMALL_NUMBER))
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("%s is rotated, its chunks are axis aligned and won't match it"), *Landscape->GetName());
+	}
+	const FVector2D Snapped = FVector2D(FMath::RoundToDouble(Origin.X / Scale.X), FMath::RoundToDouble(Origin.Y / Scale.X)) * Scale.X;
+	if (!Snapped.Equals(InOutSettings.Origin, 0.01 * Scale.X))
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("%s isn't placed on whole voxels, its chunks are off by up to half a voxel"), *Landscape->GetName());
+	}
+	return true;
+}
+
+namespace VoxelHeightmapFactory
+{
+	static void ConvertLandscape(const TArray<FString>& Args)
+	{
+		UWorld* World = GEditor ? GEditor->GetEditorWorldContext().World() : nullptr;
+		ALandscapeProxy* Landscape = nullptr;
+		for (TActorIterator<ALandscapeProxy> It(World); World && It; ++It)
+		{
+			Landscape = *It;
+			break;
+		}
+		if (!Landscape)
+		{
+			UE_LOG(LogVoxelMesh, Warning, TEXT("No landscape in the editor world"));
+			return;
+		}
+
+		FVoxelHeightmapSettings Settings;
+		Settings.ChunkSize = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 8) : Settings.ChunkSize;
+		TArray<uint16> Heights;
+		FIntPoint Size;
+		if (!UVoxelHeightmapFactory::ReadLandscape(Landscape, Heights, Size, Settings))
+		{
+			UE_LOG(LogVoxelMesh, Warning, TEXT("%s has no height data"), *Landscape->GetName());
+			return;
+		}
+
+		// Chunks get their own packages next to this one, which only holds a landscape fitting in a single chunk
+		const FString PackagePath = Args.Num() > 0 ? Args[0] : FString(TEXT("/Game/VoxelLandscape"));
+		const FString Name = Landscape->GetName();
+		UPackage* Package = CreatePackage(*(PackagePath / Name));
+		UVoxelChunkView* View = UVoxelHeightmapFactory::CreateChunkAssets(Heights, Size, Settings, UVoxelChunkView::StaticClass(), Package, FName(*Name),
+			RF_Public | RF_Standalone);
+		if (View && View->GetOutermost() == Package)
+		{
+			FAssetRegistryModule::AssetCreated(View);
+			Package->MarkPackageDirty();
+		}
+	}
+
+	static FAutoConsoleCommand ConvertLandscapeCommand(
+		TEXT("voxel.ConvertLandscape"),
+		TEXT("Convert the first landscape of the editor world to chunk view assets, named <Landscape>_<X>_<Y>_<Z>.\n")
+		TEXT("Usage: voxel.ConvertLandscape [PackagePath=/Game/VoxelLandscape] [ChunkSize=128]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&ConvertLandscape));
+}
@@ -2,6 +2,7 @@
 
 #include "AssetToolsModule.h"
 #include "IAssetTools.h"
+#include "VoxelChunkBuildQueue.h"
 #include "VoxelChunkViewEditor.h"
 
 #define LOCTEXT_NAMESPACE "FVoxelMeshEditorModule"
@@ -14,7 +15,9 @@ void FVoxelMeshEditorModule::StartupModule()
 
 void FVoxelMeshEditorModule::ShutdownModule()
 {
-    
+	// Builds still running point to the queue
+	FVoxelChunkBuildQueue::Get().CancelAll();
+	FVoxelChunkBuildQueue::Get().Flush();
 }
 
 #undef LOCTEXT_NAMESPACE
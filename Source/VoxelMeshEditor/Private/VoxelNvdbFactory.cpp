@@ -0,0 +1,134 @@
+﻿#include "VoxelNvdbFactory.h"
+
+#include "Async/Async.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "ObjectTools.h"
+#include "Tasks/Task.h"
+#include "VoxelChunkView.h"
+#include "VoxelChunkViewEditor.h"
+#include "VoxelMeshLog.h"
+#include "VoxelNvdbImporter.h"
+#include "Widgets/Notifications/SNotificationList.h"
+
+UVoxelNvdbFactory::UVoxelNvdbFactory(const FObjectInitializer& Initializer)
+{
+	SupportedClass = UVoxelChunkView::StaticClass();
+	bCreateNew = false;
+	bEditorImport = true;
+	Formats.Add(TEXT("nvdb;NanoVDB grids"));
+	ImportOptions = Initializer.CreateDefaultSubobject<UVoxelNvdbImportOptions>(this, "Options", true);
+}
+
+UObject* UVoxelNvdbFactory::FactoryCreateFile(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms,
+	FFeedbackContext* Warn, bool& bOutOperationCanceled)
+{
+	TArray<FVoxelNvdbGridInfo> GridInfos;
+	if (!FVoxelNvdbImporter::ReadGridInfos(Filename, GridInfos))
+	{
+		return nullptr;
+	}
+
+	// Level sets are selected by default, or the first supported grid when there is none
+	ImportOptions->Grids.Reset();
+	const bool bHasLevelSet = GridInfos.ContainsByPredicate([](const FVoxelNvdbGridInfo& Info) { return Info.bSupported && Info.bLevelSet; });
+	for (const FVoxelNvdbGridInfo& Info : GridInfos)
+	{
+		FVoxelNvdbGridSelection& Selection = ImportOptions->Grids.AddDefaulted_GetRef();
+		Selection.Index = Info.Index;
+		Selection.Name = Info.Name;
+		Selection.Type = Info.TypeName;
+		Selection.Size = Info.BBoxMax - Info.BBoxMin + FIntVector(1);
+		Selection.ActiveVoxels = Info.NumActiveVoxels;
+		Selection.bImport = Info.bSupported && (bHasLevelSet ? Info.bLevelSet : ImportOptions->Grids.Num() == 1);
+	}
+	if (!IsAutomatedImport())
+	{
+		UVoxelChunkViewFactory::ShowVoxelCreationDialog(ImportOptions);
+	}
+
+	struct FGridToImport
+	{
+		int32 Index;
+		FName AssetName;
+		/// Its chunk keeps the bare asset name, like the chunks of the other importers
+		bool bSingleChunk;
+	};
+	TArray<FGridToImport> Grids;
+	for (const FVoxelNvdbGridSelection& Selection : ImportOptions->Grids)
+	{
+		if (!Selection.bImport)
+		{
+			continue;
+		}
+		if (!GridInfos[Selection.Index].bSupported)
+		{
+			UE_LOG(LogVoxelMesh, Warning, TEXT("Skipping %s of %s, grids of type %s can't be imported"), *Selection.Name, *Filename, *Selection.Type);
+			continue;
+		}
+		const FName AssetName = Grids.IsEmpty() ? InName : FName(ObjectTools::SanitizeObjectName(InName.ToString() + TEXT("_") + Selection.Name));
+		Grids.Add({Selection.Index, AssetName, FVoxelNvdbImporter::GetNumChunks(GridInfos[Selection.Index], ImportOptions->ChunkSize) == FIntVector(1)});
+	}
+	if (Grids.IsEmpty())
+	{
+		bOutOperationCanceled = true;
+		return nullptr;
+	}
+
+	// Returned right away and filled with chunk (0, 0, 0) of the first grid, its only chunk when it fits in one
+	UVoxelChunkView* Placeholder = NewObject<UVoxelChunkView>(InParent, InClass, InName, Flags);
+
+	FNotificationInfo Info(FText::Format(NSLOCTEXT("VoxelMesh", "ImportingNvdb", "Importing {0}"), FText::FromString(FPaths::GetCleanFilename(Filename))));
+	Info.bFireAndForget = false;
+	Info.ExpireDuration = 3.0f;
+	TSharedPtr<SNotificationItem> Notification = FSlateNotificationManager::Get().AddNotification(Info);
+	if (Notification)
+	{
+		Notification->SetCompletionState(SNotificationItem::CS_Pending);
+	}
+
+	// Chunks are handed to the game thread one by one, so only the grid being split is kept in memory
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [Filename, Grids = MoveTemp(Grids), ChunkSize = ImportOptions->ChunkSize, WeakPlaceholder = TWeakObjectPtr<UVoxelChunkView>(Placeholder),
+		WeakParent = TWeakObjectPtr<UObject>(InParent), InClass, Flags, Notification]
+	{
+		uint32 NumChunks = 0;
+		bool bSuccess = true;
+		for (const FGridToImport& Grid : Grids)
+		{
+			const bool bFirstGrid = &Grid == &Grids[0];
+			FVoxelNvdbImporter::FStats Stats;
+			bSuccess &= FVoxelNvdbImporter::ImportGrid(Filename, Grid.Index, ChunkSize,
+				[&](const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Chunk)
+				{
+					AsyncTask(ENamedThreads::GameThread, [WeakPlaceholder, WeakParent, InClass, Flags, AssetName = Grid.AssetName, bSingleChunk = Grid.bSingleChunk, ChunkCoord,
+						bPlaceholder = bFirstGrid && ChunkCoord == FIntVector::ZeroValue, Chunk = MoveTemp(Chunk)]() mutable
+					{
+						UVoxelChunkView* View = bPlaceholder ? WeakPlaceholder.Get() : nullptr;
+						if (!bPlaceholder && WeakParent.IsValid())
+						{
+							View = UVoxelChunkViewFactory::CreateChunkAsset(InClass, WeakParent.Get(), AssetName, Flags, ChunkCoord, bSingleChunk);
+						}
+						if (View)
+						{
+							View->SetVdbBuffer_GameThread(MoveTemp(Chunk));
+							View->MarkPackageDirty();
+						}
+					});
+					++NumChunks;
+				}, &Stats);
+			UE_LOG(LogVoxelMesh, Log, TEXT("Imported grid %d of %s as %s: %u chunks, %u leaves, %u tiles, read %.2f s, split %.2f s, encode %.2f s"), Grid.Index, *Filename,
+				*Grid.AssetName.ToString(), Stats.NumChunks, Stats.NumLeaves, Stats.NumTiles, Stats.ReadSeconds, Stats.SplitSeconds, Stats.EncodeSeconds);
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [Notification, bSuccess, NumChunks]
+		{
+			if (Notification)
+			{
+				Notification->SetText(FText::Format(NSLOCTEXT("VoxelMesh", "ImportedNvdb", "Imported {0} chunks"), NumChunks));
+				Notification->SetCompletionState(bSuccess ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+				Notification->ExpireAndFadeout();
+			}
+		});
+	});
+
+	return Placeholder;
+}
@@ -0,0 +1,282 @@
+﻿#include "VoxelNvdbImporter.h"
+
+#include "Async/ParallelFor.h"
+#include "VoxelChunkGrid.h"
+#include "VoxelLeafDecode.h"
+#include "VoxelMeshLog.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "nanovdb/io/IO.h"
+THIRD_PARTY_INCLUDES_END
+
+namespace VoxelNvdbImporter
+{
+	using FBuildGrid = FVoxelNvdbImporter::FBuildGrid;
+	using FBuildLeaf = FVoxelNvdbImporter::FBuildLeaf;
+
+	template<typename BuildT>
+	static void DecodeLeaf(const nanovdb::NanoLeaf<BuildT>& Leaf, float* RESTRICT OutValues)
+	{
+		if constexpr (std::is_same_v<BuildT, nanovdb::Fp4> || std::is_same_v<BuildT, nanovdb::Fp8> || std::is_same_v<BuildT, nanovdb::Fp16>)
+		{
+			FVoxelLeafDecode::Decode(Leaf, OutValues);
+		}
+		else
+		{
+			for (uint32 Offset = 0; Offset < FVoxelLeafDecode::LeafSize; ++Offset)
+			{
+				OutValues[Offset] = Leaf.getValue(Offset);
+			}
+		}
+	}
+
+	template<typename BuildT>
+	static bool Split(const nanovdb::NanoGrid<BuildT>& Grid, int32 ChunkSize, FVoxelNvdbImporter::FOnChunk OnChunk, FVoxelNvdbImporter::FStats& OutStats)
+	{
+		const nanovdb::CoordBBox& BBox = Grid.indexBBox();
+		if (BBox.empty())
+		{
+			return false;
+		}
+
+		// Chunks start on the leaf holding the first voxel
+		double StartTime = FPlatformTime::Seconds();
+		const nanovdb::Coord Base = BBox.min() & ~7;
+		const nanovdb::Coord Last = BBox.max() - Base;
+		const float Background = Grid.tree().background();
+		const nanovdb::Vec3d VoxelSize = Grid.voxelSize();
+		if (!FMath::IsNearlyEqual(VoxelSize[0], VoxelSize[1]) || !FMath::IsNearlyEqual(VoxelSize[0], VoxelSize[2]))
+		{
+			UE_LOG(LogVoxelMesh, Warning, TEXT("%hs has non uniform voxels, using their size along x"), Grid.gridName());
+		}
+
+		const uint32 NumLeaves = Grid.tree().nodeCount(0);
+		const nanovdb::NanoLeaf<BuildT>* FirstLeaf = Grid.tree().getFirstLeaf();
+		TArray<FBuildLeaf*> Leaves;
+		TArray<FIntVector> LeafChunks;
+		Leaves.SetNumZeroed(NumLeaves);
+		LeafChunks.SetNumUninitialized(NumLeaves);
+		ParallelFor(NumLeaves, [&](int32 LeafIndex)
+		{
+			const nanovdb::NanoLeaf<BuildT>& Leaf = FirstLeaf[LeafIndex];
+			const nanovdb::Coord Origin = Leaf.origin() - Base;
+			const FIntVector ChunkCoord(Origin[0] / ChunkSize, Origin[1] / ChunkSize, Origin[2] / ChunkSize);
+			FBuildLeaf* BuildLeaf = new FBuildLeaf(nanovdb::Coord(Origin[0] - ChunkCoord.X * ChunkSize, Origin[1] - ChunkCoord.Y * ChunkSize, Origin[2] - ChunkCoord.Z * ChunkSize),
+				Background, false);
+			DecodeLeaf(Leaf, BuildLeaf->mValues);
+			BuildLeaf->mValueMask = Leaf.valueMask();
+			Leaves[LeafIndex] = BuildLeaf;
+			LeafChunks[LeafIndex] = ChunkCoord;
+		});
+
+		struct FChunk
+		{
+			TUniquePtr<FBuildGrid> Grid;
+			nanovdb::GridHandle<nanovdb::HostBuffer> Handle;
+		};
+		TMap<FIntVector, FChunk> Chunks;
+		auto FindOrAddChunk = [&](const FIntVector& ChunkCoord) -> FChunk&
+		{
+			FChunk& Chunk = Chunks.FindOrAdd(ChunkCoord);
+			if (!Chunk.Grid)
+			{
+				const nanovdb::Coord ChunkOrigin = Base + nanovdb::Coord(ChunkCoord.X * ChunkSize, ChunkCoord.Y * ChunkSize, ChunkCoord.Z * ChunkSize);
+				Chunk.Grid = MakeUnique<FBuildGrid>(Background, Grid.gridName(), Grid.gridClass());
+				Chunk.Grid->setTransform(VoxelSize[0], Grid.indexToWorld(ChunkOrigin.asVec3d()));
+			}
+			return Chunk;
+		};
+		for (uint32 LeafIndex = 0; LeafIndex < NumLeaves; ++LeafIndex)
+		{
+			FVoxelChunkGrid::AddLeaf(*FindOrAddChunk(LeafChunks[LeafIndex]).Grid, Leaves[LeafIndex], false, FIntVector::ZeroValue);
+		}
+
+		// Tiles cut in leaf sized tiles, creating the chunks entirely inside a level set. Background tiles are left out,
+		// they change nothing.
+		uint32 NumTiles = 0;
+		auto AddTiles = [&](const nanovdb::Coord& TileOrigin, int32 TileDim, float Value)
+		{
+			if (Value == Background)
+			{
+				return;
+			}
+			const nanovdb::Coord Min = (TileOrigin - Base).maxComponent(nanovdb::Coord(0));
+			const nanovdb::Coord Max = (TileOrigin - Base + nanovdb::Coord(TileDim - 1)).minComponent(Last);
+			for (int32 X = Min[0]; X <= Max[0]; X += 8)
+			{
+				for (int32 Y = Min[1]; Y <= Max[1]; Y += 8)
+				{
+					for (int32 Z = Min[2]; Z <= Max[2]; Z += 8)
+					{
+						const FIntVector ChunkCoord(X / ChunkSize, Y / ChunkSize, Z / ChunkSize);
+						const nanovdb::Coord Local(X - ChunkCoord.X * ChunkSize, Y - ChunkCoord.Y * ChunkSize, Z - ChunkCoord.Z * ChunkSize);
+						FindOrAddChunk(ChunkCoord).Grid->root().template addTile<1>(Local, Value, false);
+						++NumTiles;
+					}
+				}
+			}
+		};
+		const auto* FirstLower = Grid.tree().getFirstLower();
+		for (uint32 NodeIndex = 0; NodeIndex < Grid.tree().nodeCount(1); ++NodeIndex)
+		{
+			for (auto It = FirstLower[NodeIndex].cbeginValueAll(); It; ++It)
+			{
+				AddTiles(It.getOrigin(), 8, *It);
+			}
+		}
+		const auto* FirstUpper = Grid.tree().getFirstUpper();
+		for (uint32 NodeIndex = 0; NodeIndex < Grid.tree().nodeCount(2); ++NodeIndex)
+		{
+			for (auto It = FirstUpper[NodeIndex].cbeginValueAll(); It; ++It)
+			{
+				AddTiles(It.getOrigin(), 128, *It);
+			}
+		}
+		for (auto It = Grid.tree().root().cbeginValueAll(); It; ++It)
+		{
+			AddTiles(It.getOrigin(), 4096, *It);
+		}
+
+		TArray<FIntVector> ChunkCoords;
+		Chunks.GetKeys(ChunkCoords);
+		ChunkCoords.Sort([](const FIntVector& A, const FIntVector& B)
+		{
+			return A.Z != B.Z ? A.Z < B.Z : A.Y != B.Y ? A.Y < B.Y : A.X < B.X;
+		});
+		OutStats.SplitSeconds = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		ParallelFor(ChunkCoords.Num(), [&](int32 Index)
+		{
+			const FIntVector& ChunkCoord = ChunkCoords[Index];
+			FChunk& Chunk = Chunks[ChunkCoord];
+
+			const FIntVector Extent(
+				FMath::Min(ChunkSize, Last[0] - ChunkCoord.X * ChunkSize + 1),
+				FMath::Min(ChunkSize, Last[1] - ChunkCoord.Y * ChunkSize + 1),
+				FMath::Min(ChunkSize, Last[2] - ChunkCoord.Z * ChunkSize + 1));
+			Chunk.Handle = FVoxelChunkGrid::Encode(*Chunk.Grid, Extent);
+			Chunk.Grid.Reset();
+		});
+		OutStats.EncodeSeconds = FPlatformTime::Seconds() - StartTime;
+
+		for (const FIntVector& ChunkCoord : ChunkCoords)
+		{
+			OnChunk(ChunkCoord, MoveTemp(Chunks[ChunkCoord].Handle));
+		}
+		OutStats.NumChunks = ChunkCoords.Num();
+		OutStats.NumLeaves = NumLeaves;
+		OutStats.NumTiles = NumTiles;
+		return true;
+	}
+}
+
+FIntVector FVoxelNvdbImporter::GetNumChunks(const FVoxelNvdbGridInfo& Info, int32 ChunkSize)
+{
+	ChunkSize = FMath::Max(Align(ChunkSize, 8), 8);
+	const FIntVector Base(Info.BBoxMin.X & ~7, Info.BBoxMin.Y & ~7, Info.BBoxMin.Z & ~7);
+	return (Info.BBoxMax - Base) / ChunkSize + FIntVector(1);
+}
+
+bool FVoxelNvdbImporter::IsSupported(nanovdb::GridType GridType)
+{
+	return GridType == nanovdb::GridType::Float || GridType == nanovdb::GridType::Fp4 || GridType == nanovdb::GridType::Fp8
+		|| GridType == nanovdb::GridType::Fp16 || GridType == nanovdb::GridType::FpN;
+}
+
+bool FVoxelNvdbImporter::ReadGridInfos(const FString& Filename, TArray<FVoxelNvdbGridInfo>& OutGrids)
+{
+	std::vector<nanovdb::io::FileGridMetaData> MetaData;
+	try
+	{
+		MetaData = nanovdb::io::readGridMetaData(TCHAR_TO_UTF8(*Filename));
+	}
+	catch (const std::exception& Error)
+	{
+		UE_LOG(LogVoxelMesh, Error, TEXT("Cannot read the grids of %s: %hs"), *Filename, Error.what());
+		return false;
+	}
+
+	OutGrids.Reset(MetaData.size());
+	for (const nanovdb::io::FileGridMetaData& Meta : MetaData)
+	{
+		char TypeName[64];
+		FVoxelNvdbGridInfo& Info = OutGrids.AddDefaulted_GetRef();
+		Info.Index = OutGrids.Num() - 1;
+		Info.Name = UTF8_TO_TCHAR(Meta.gridName.c_str());
+		Info.TypeName = ANSI_TO_TCHAR(nanovdb::toStr(TypeName, Meta.gridType));
+		Info.bLevelSet = Meta.gridClass == nanovdb::GridClass::LevelSet;
+		Info.bSupported = IsSupported(Meta.gridType);
+		Info.BBoxMin = FIntVector(Meta.indexBBox.min()[0], Meta.indexBBox.min()[1], Meta.indexBBox.min()[2]);
+		Info.BBoxMax = FIntVector(Meta.indexBBox.max()[0], Meta.indexBBox.max()[1], Meta.indexBBox.max()[2]);
+		Info.NumActiveVoxels = Meta.voxelCount;
+		Info.FileBytes = Meta.fileSize;
+		Info.VoxelSize = Meta.voxelSize[0];
+	}
+	return true;
+}
+
+bool FVoxelNvdbImporter::ImportGrid(const FString& Filename, int32 GridIndex, int32 ChunkSize, FOnChunk OnChunk, FStats* OutStats)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelNvdbImporter::ImportGrid);
+	const double StartTime = FPlatformTime::Seconds();
+	nanovdb::GridHandle<nanovdb::HostBuffer> Handle;
+	try
+	{
+		Handle = nanovdb::io::readGrid<nanovdb::HostBuffer>(TCHAR_TO_UTF8(*Filename), GridIndex);
+	}
+	catch (const std::exception& Error)
+	{
+		UE_LOG(LogVoxelMesh, Error, TEXT("Cannot read grid %d of %s: %hs"), GridIndex, *Filename, Error.what());
+		return false;
+	}
+	const double ReadSeconds = FPlatformTime::Seconds() - StartTime;
+
+	if (!SplitGrid(Handle, ChunkSize, OnChunk, OutStats))
+	{
+		return false;
+	}
+	if (OutStats)
+	{
+		OutStats->ReadSeconds = ReadSeconds;
+	}
+	return true;
+}
+
+bool FVoxelNvdbImporter::SplitGrid(const nanovdb::GridHandle<nanovdb::HostBuffer>& Handle, int32 ChunkSize, FOnChunk OnChunk, FStats* OutStats)
+{
+	using namespace VoxelNvdbImporter;
+	TRACE_CPUPROFILER_EVENT_SCOPE(FVoxelNvdbImporter::SplitGrid);
+	ChunkSize = FMath::Max(Align(ChunkSize, 8), 8);
+	FStats Stats;
+	bool bSuccess = false;
+	switch (Handle.gridType())
+	{
+	case nanovdb::GridType::Float:
+		bSuccess = Split(*Handle.grid<float>(), ChunkSize, OnChunk, Stats);
+		break;
+	case nanovdb::GridType::Fp4:
+		bSuccess = Split(*Handle.grid<nanovdb::Fp4>(), ChunkSize, OnChunk, Stats);
+		break;
+	case nanovdb::GridType::Fp8:
+		bSuccess = Split(*Handle.grid<nanovdb::Fp8>(), ChunkSize, OnChunk, Stats);
+		break;
+	case nanovdb::GridType::Fp16:
+		bSuccess = Split(*Handle.grid<nanovdb::Fp16>(), ChunkSize, OnChunk, Stats);
+		break;
+	case nanovdb::GridType::FpN:
+		bSuccess = Split(*Handle.grid<nanovdb::FpN>(), ChunkSize, OnChunk, Stats);
+		break;
+	default:
+		{
+			char TypeName[64];
+			UE_LOG(LogVoxelMesh, Error, TEXT("Grids of type %hs can't be imported"), nanovdb::toStr(TypeName, Handle.gridType()));
+		}
+		break;
+	}
+	if (OutStats)
+	{
+		*OutStats = Stats;
+	}
+	return bSuccess;
+}
@@ -0,0 +1,69 @@
+﻿#include "VoxelRawVolumeFactory.h"
+
+#include "Misc/ScopedSlowTask.h"
+#include "VoxelChunkView.h"
+#include "VoxelChunkViewEditor.h"
+#include "VoxelMeshLog.h"
+
+UVoxelRawVolumeFactory::UVoxelRawVolumeFactory(const FObjectInitializer& Initializer)
+{
+	SupportedClass = UVoxelChunkView::StaticClass();
+	bCreateNew = false;
+	bEditorImport = true;
+	Formats.Add(TEXT("raw;Raw dense volume"));
+	ImportOptions = Initializer.CreateDefaultSubobject<UVoxelRawVolumeImportOptions>(this, "Options", true);
+}
+
+UObject* UVoxelRawVolumeFactory::FactoryCreateFile(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms,
+	FFeedbackContext* Warn, bool& bOutOperationCanceled)
+{
+	FVoxelRawVolumeSettings& Settings = ImportOptions->Settings;
+	FVoxelRawVolumeImporter::ParseFileName(Filename, Settings);
+	if (!IsAutomatedImport())
+	{
+		UVoxelChunkViewFactory::ShowVoxelCreationDialog(ImportOptions);
+	}
+
+	const FIntVector Dimensions = Settings.Dimensions;
+	const int32 ChunkSize = FMath::Max(Align(Settings.ChunkSize, 8), 8);
+	const bool bSingleChunk = Dimensions.X <= ChunkSize && Dimensions.Y <= ChunkSize && Dimensions.Z <= ChunkSize;
+
+	FScopedSlowTask SlowTask(FMath::Max(Dimensions.Z, 1), FText::Format(NSLOCTEXT("VoxelMesh", "ImportingRawVolume", "Importing {0}"), FText::FromString(Filename)));
+	SlowTask.MakeDialog(true);
+	int32 LastSlicesRead = 0;
+	TArray<UVoxelChunkView*> Views;
+	FVoxelRawVolumeImporter::FStats Stats;
+	const bool bSuccess = FVoxelRawVolumeImporter::ImportFile(Filename, Settings, [&](const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Grid)
+	{
+		// The first chunk is the imported asset, the others get packages of their own next to it
+		UVoxelChunkView* View = UVoxelChunkViewFactory::CreateChunkAsset(InClass, InParent, InName, Flags, ChunkCoord, bSingleChunk || Views.IsEmpty());
+		View->SetVdbBuffer_GameThread(MoveTemp(Grid));
+		Views.Add(View);
+		return true;
+	}, [&](int32 NumSlicesRead, int32 NumSlices)
+	{
+		SlowTask.EnterProgressFrame(NumSlicesRead - LastSlicesRead);
+		LastSlicesRead = NumSlicesRead;
+		bOutOperationCanceled = SlowTask.ShouldCancel();
+		return !bOutOperationCanceled;
+	}, &Stats);
+
+	if (bOutOperationCanceled)
+	{
+		UE_LOG(LogVoxelMesh, Log, TEXT("Import of %s canceled after %d chunks"), *Filename, Views.Num());
+		UVoxelChunkViewFactory::DeleteChunkAssets(Views);
+		return nullptr;
+	}
+	if (!bSuccess)
+	{
+		return nullptr;
+	}
+	UE_LOG(LogVoxelMesh, Log, TEXT("Imported %s: %u chunks, %u leaves, %.1f MiB of slices, read %.2f s, convert %.2f s, encode %.2f s"), *Filename,
+		Stats.NumChunks, Stats.NumLeaves, Stats.SlabBytes / (1024.0 * 1024.0), Stats.ReadSeconds, Stats.ConvertSeconds, Stats.EncodeSeconds);
+	if (Views.IsEmpty())
+	{
+		UE_LOG(LogVoxelMesh, Warning, TEXT("%s has no surface at the iso value %f"), *Filename, Settings.IsoValue);
+		return nullptr;
+	}
+	return Views[0];
+}
@@ -0,0 +1,64 @@
+﻿#include "VoxelVoxFactory.h"
+
+#include "Misc/ScopedSlowTask.h"
+#include "VoxelChunkView.h"
+#include "VoxelChunkViewEditor.h"
+#include "VoxelMeshLog.h"
+
+UVoxelVoxFactory::UVoxelVoxFactory(const FObjectInitializer& Initializer)
+{
+	SupportedClass = UVoxelChunkView::StaticClass();
+	bCreateNew = false;
+	bEditorImport = true;
+	Formats.Add(TEXT("vox;MagicaVoxel scene"));
+	ImportOptions = Initializer.CreateDefaultSubobject<UVoxelVoxImportOptions>(this, "Options", true);
+}
+
+UObject* UVoxelVoxFactory::FactoryCreateFile(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms,
+	FFeedbackContext* Warn, bool& bOutOperationCanceled)
+{
+	if (!IsAutomatedImport())
+	{
+		UVoxelChunkViewFactory::ShowVoxelCreationDialog(ImportOptions);
+	}
+
+	// Rasterizing and searching the distances take the first half, encoding the chunks the second one
+	FScopedSlowTask SlowTask(1.0f, FText::Format(NSLOCTEXT("VoxelMesh", "ImportingVox", "Importing {0}"), FText::FromString(Filename)));
+	SlowTask.MakeDialog(true);
+	SlowTask.EnterProgressFrame(0.5f);
+	int32 LastChunksDone = 0;
+	TArray<UVoxelChunkView*> Views;
+	TArray<FColor> Palette;
+	FVoxelVoxImporter::FStats Stats;
+	const bool bSuccess = FVoxelVoxImporter::ImportFile(Filename, ImportOptions->Settings,
+		[&](const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Grid, nanovdb::GridHandle<nanovdb::HostBuffer>&& MaterialGrid)
+		{
+			// The first chunk is the imported asset, the others get packages of their own next to it
+			UVoxelChunkView* View = UVoxelChunkViewFactory::CreateChunkAsset(InClass, InParent, InName, Flags, ChunkCoord, Views.IsEmpty());
+			View->SetVdbBuffer_GameThread(MoveTemp(Grid));
+			View->SetMaterialBuffer_GameThread(MoveTemp(MaterialGrid));
+			View->Palette = Palette;
+			Views.Add(View);
+			return true;
+		}, [&](int32 NumChunksDone, int32 NumChunks)
+		{
+			SlowTask.EnterProgressFrame(0.5f * (NumChunksDone - LastChunksDone) / NumChunks);
+			LastChunksDone = NumChunksDone;
+			bOutOperationCanceled = SlowTask.ShouldCancel();
+			return !bOutOperationCanceled;
+		}, &Palette, &Stats);
+
+	if (bOutOperationCanceled)
+	{
+		UE_LOG(LogVoxelMesh, Log, TEXT("Import of %s canceled after %d chunks"), *Filename, Views.Num());
+		UVoxelChunkViewFactory::DeleteChunkAssets(Views);
+		return nullptr;
+	}
+	if (!bSuccess)
+	{
+		return nullptr;
+	}
+	UE_LOG(LogVoxelMesh, Log, TEXT("Imported %s: %u voxels, %u chunks, %u leaves, rasterize %.2f s, distance %.2f s, encode %.2f s"), *Filename,
+		Stats.NumVoxels, Stats.NumChunks, Stats.NumLeaves, Stats.RasterizeSeconds, Stats.DistanceSeconds, Stats.EncodeSeconds);
+	return Views.IsEmpty() ? nullptr : Views[0];
+}
@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+#include "VoxelVdbCommon.h"
+
+class SNotificationItem;
+class UVoxelChunkView;
+
+/**
+ * Grids of chunk view assets built on worker threads, so creating assets doesn't freeze the editor.
+ * Assets are created empty and receive their grid on the game thread once it is built. Builds run concurrently and share a
+ * notification with their progress and a button cancelling them. Cancelling skips the builds not started yet, the others
+ * poll IsCancelled to stop early and their grids are dropped.
+ */
+class VOXELMESHEDITOR_API FVoxelChunkBuildQueue
+{
+public:
+	/// Given whether the build was cancelled, polled from any thread. A cancelled build may return an empty grid.
+	using FBuildFunction = TUniqueFunction<nanovdb::GridHandle<nanovdb::HostBuffer>(TFunctionRef<bool()> IsCancelled)>;
+
+	static FVoxelChunkBuildQueue& Get();
+
+	/// Build on a worker thread, the grid replaces the one of View unless View is deleted or the build cancelled first
+	void Launch(UVoxelChunkView* View, FBuildFunction&& Build);
+
+	void CancelAll();
+
+	/// Wait for every build and apply them, for when no one is there to watch the editor
+	void Flush();
+
+	int32 GetNumPending() const { return NumLaunched - NumFinished; }
+
+private:
+	struct FResult
+	{
+		TWeakObjectPtr<UVoxelChunkView> View;
+		nanovdb::GridHandle<nanovdb::HostBuffer> Grid;
+		uint32 Generation = 0;
+		double Seconds = 0.0;
+	};
+
+	void ApplyResults();
+	void UpdateNotification();
+
+	FCriticalSection ResultsLock;
+	TArray<FResult> Results;
+	TArray<UE::Tasks::FTask> Tasks;
+	/// Incremented by CancelAll, the builds launched before are dropped
+	std::atomic<uint32> Generation = 0;
+
+	/// Counted since the queue was last empty
+	int32 NumLaunched = 0;
+	int32 NumFinished = 0;
+	int32 NumCancelled = 0;
+	TSharedPtr<SNotificationItem> Notification;
+};
@@ -5,15 +5,22 @@
 #include "CoreMinimal.h"
 #include "AssetTypeActions_Base.h"
 #include "UObject/Object.h"
+#include "VoxelChunkBuildQueue.h"
+#include "VoxelTerrainGenerator.h"
 #include "VoxelChunkViewEditor.generated.h"
 
+class UStaticMesh;
+class UVoxelChunkView;
+
 UENUM()
 enum class EVoxelGridType : uint8
 {
 	Sphere UMETA(DisplayName = "Sphere"),
 	Box UMETA(DisplayName = "Box"),
 	Torus UMETA(DisplayName = "Torus"),
-	Octahedron UMETA(DisplayName = "Octahedron")
+	Octahedron UMETA(DisplayName = "Octahedron"),
+	Terrain UMETA(DisplayName = "Procedural Terrain"),
+	StaticMesh UMETA(DisplayName = "Static Mesh")
 };
 
 UCLASS()
@@ -57,6 +64,22 @@ public:
 	
 	UPROPERTY(EditAnywhere, Category = "Torus", meta = (EditCondition = "GridType == EVoxelGridType::Torus", EditConditionHides, ClampMin = "1.0"))
 	double MinorRadius = 40.0;
+
+	// Terrain specific parameters
+	// (the voxel size comes from the terrain settings)
+	UPROPERTY(EditAnywhere, Category = "Terrain", meta = (EditCondition = "GridType == EVoxelGridType::Terrain", EditConditionHides))
+	FVoxelTerrainSettings Terrain;
+
+	UPROPERTY(EditAnywhere, Category = "Terrain", meta = (EditCondition = "GridType == EVoxelGridType::Terrain", EditConditionHides))
+	FIntVector ChunkCoord = FIntVector::ZeroValue;
+
+	// Static mesh specific parameters
+	// (uses common voxel size parameter)
+	UPROPERTY(EditAnywhere, Category = "Static Mesh", meta = (EditCondition = "GridType == EVoxelGridType::StaticMesh", EditConditionHides))
+	TObjectPtr<UStaticMesh> SourceMesh;
+
+	UPROPERTY(EditAnywhere, Category = "Static Mesh", meta = (EditCondition = "GridType == EVoxelGridType::StaticMesh", EditConditionHides, ClampMin = "1.0"))
+	double BandWidth = 3.0;
 };
 
 UCLASS()
@@ -77,8 +100,24 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel Mesh Editor")
 	UVoxelDataCreationOptions* VoxelDataCreationOptions;
 
-protected:
-	static bool ShowVoxelCreationDialog(UVoxelDataCreationOptions* OutOptions);
+	/// Modal details view of the options, also used by the import factories
+	static bool ShowVoxelCreationDialog(UObject* OutOptions);
+
+	/**
+	 * Asset of an imported chunk: InName for a single chunk, otherwise <InName>_<X>_<Y>_<Z>. It goes in InParent when
+	 * that is its package, otherwise in a package of its own next to InParent.
+	 */
+	static UVoxelChunkView* CreateChunkAsset(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FIntVector& ChunkCoord, bool bSingleChunk);
+
+	/// Asset of a chunk in a package of its own under PackagePath, named as above
+	static UVoxelChunkView* CreateChunkAsset(UClass* InClass, const FString& PackagePath, FName InName, EObjectFlags Flags, const FIntVector& ChunkCoord, bool bSingleChunk);
+
+	/// Delete the chunk assets of an import that was canceled, so none of them is left to be saved
+	static void DeleteChunkAssets(TConstArrayView<UVoxelChunkView*> Views);
+
+	/// Build of the grid described by the options, to run on any thread. Null when the options can't give a grid.
+	/// Terrain and static mesh builds stop early and give no grid once cancelled, the primitives are quick enough to finish.
+	static FVoxelChunkBuildQueue::FBuildFunction MakeBuildFunction(const UVoxelDataCreationOptions& Options);
 };
 
 class VOXELMESHEDITOR_API FVoxelChunkAssetTypeActions : public FAssetTypeActions_Base
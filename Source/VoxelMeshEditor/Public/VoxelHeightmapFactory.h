@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Factories/Factory.h"
+#include "VoxelHeightmapConverter.h"
+#include "VoxelHeightmapFactory.generated.h"
+
+class ALandscapeProxy;
+class UVoxelChunkView;
+
+UCLASS()
+class UVoxelHeightmapImportOptions : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Samples per row and column, 0 for a square heightmap */
+	UPROPERTY(EditAnywhere, Category = "Heightmap")
+	FIntPoint Resolution = FIntPoint::ZeroValue;
+
+	UPROPERTY(EditAnywhere, Category = "Heightmap", meta = (ShowOnlyInnerProperties))
+	FVoxelHeightmapSettings Settings;
+};
+
+/**
+ * Imports a raw 16-bit heightmap, as exported for landscapes, as one chunk view asset per chunk with a surface, see
+ * FVoxelHeightmapConverter. Landscapes of the editor world are converted by voxel.ConvertLandscape.
+ */
+UCLASS()
+class VOXELMESHEDITOR_API UVoxelHeightmapFactory : public UFactory
+{
+	GENERATED_BODY()
+public:
+	UVoxelHeightmapFactory(const FObjectInitializer& Initializer);
+
+	// Begin UFactory interface
+	virtual UObject* FactoryCreateFile(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms,
+		FFeedbackContext* Warn, bool& bOutOperationCanceled) override;
+	// End UFactory interface
+
+	/// Chunk assets of a heightfield, named like the ones of UVoxelRawVolumeFactory. Returns the first one, null when the conversion fails or is canceled.
+	static UVoxelChunkView* CreateChunkAssets(TConstArrayView<uint16> Heights, const FIntPoint& Size, const FVoxelHeightmapSettings& Settings, UClass* InClass,
+		UObject* InParent, FName InName, EObjectFlags Flags, bool* bOutCanceled = nullptr);
+
+	/// Heights of a landscape with the matching settings, so its chunks line up with it in the world. Rotations aren't carried over.
+	static bool ReadLandscape(ALandscapeProxy* Landscape, TArray<uint16>& OutHeights, FIntPoint& OutSize, FVoxelHeightmapSettings& InOutSettings);
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel Mesh Editor")
+	UVoxelHeightmapImportOptions* ImportOptions;
+};
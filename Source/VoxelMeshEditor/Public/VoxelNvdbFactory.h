@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Factories/Factory.h"
+#include "VoxelNvdbFactory.generated.h"
+
+/// Grid of the imported file, filled from its metadata
+USTRUCT()
+struct FVoxelNvdbGridSelection
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = "Grid")
+	bool bImport = false;
+
+	UPROPERTY(VisibleAnywhere, Category = "Grid")
+	FString Name;
+
+	UPROPERTY(VisibleAnywhere, Category = "Grid")
+	FString Type;
+
+	/// Voxels of the index bounding box
+	UPROPERTY(VisibleAnywhere, Category = "Grid")
+	FIntVector Size = FIntVector::ZeroValue;
+
+	UPROPERTY(VisibleAnywhere, Category = "Grid")
+	int64 ActiveVoxels = 0;
+
+	UPROPERTY()
+	int32 Index = 0;
+};
+
+UCLASS()
+class UVoxelNvdbImportOptions : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/// Grids of other types than float can't be imported
+	UPROPERTY(EditAnywhere, EditFixedSize, Category = "NanoVDB")
+	TArray<FVoxelNvdbGridSelection> Grids;
+
+	/// Grids larger than this are split into chunk assets, rounded up to whole leaves
+	UPROPERTY(EditAnywhere, Category = "NanoVDB", meta = (ClampMin = "8", ClampMax = "1024"))
+	int32 ChunkSize = 256;
+};
+
+/**
+ * Imports the selected grids of a .nvdb file, see FVoxelNvdbImporter. Only the metadata is read before picking the grids.
+ * The asset returned is empty until the grids are read and split in the background, it receives the first chunk of the
+ * first grid. The other chunks become assets named like the ones of UVoxelRawVolumeFactory, with the grid name appended
+ * to InName for every grid but the first.
+ */
+UCLASS()
+class VOXELMESHEDITOR_API UVoxelNvdbFactory : public UFactory
+{
+	GENERATED_BODY()
+public:
+	UVoxelNvdbFactory(const FObjectInitializer& Initializer);
+
+	// Begin UFactory interface
+	virtual UObject* FactoryCreateFile(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms,
+		FFeedbackContext* Warn, bool& bOutOperationCanceled) override;
+	// End UFactory interface
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel Mesh Editor")
+	UVoxelNvdbImportOptions* ImportOptions;
+};
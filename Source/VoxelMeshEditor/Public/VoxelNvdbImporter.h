@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "VoxelVdbCommon.h"
+
+/// Metadata of a grid of a .nvdb file, read without its payload
+struct VOXELMESHEDITOR_API FVoxelNvdbGridInfo
+{
+	/// Position in the file, see FVoxelNvdbImporter::ImportGrid
+	int32 Index = 0;
+	FString Name;
+	FString TypeName;
+	bool bLevelSet = false;
+	/// Float grids, quantized or not, the others can't be meshed
+	bool bSupported = false;
+	FIntVector BBoxMin = FIntVector::ZeroValue;
+	FIntVector BBoxMax = FIntVector::ZeroValue;
+	uint64 NumActiveVoxels = 0;
+	/// Size of the payload in the file, compressed or not
+	uint64 FileBytes = 0;
+	double VoxelSize = 1.0;
+};
+
+/**
+ * Reads grids of .nvdb files and splits them into chunks of ChunkSize^3 voxels encoded as Fp4, the format of chunk views.
+ * Leaves are decoded and moved to their chunk in parallel, tiles are kept so the inside of level sets stays inside.
+ * Chunks entirely inside are given as constant tiles, only chunks of background are skipped. Lives in the editor module,
+ * built with exceptions for nanovdb::io.
+ */
+class VOXELMESHEDITOR_API FVoxelNvdbImporter
+{
+public:
+	using FBuildGrid = nanovdb::tools::build::Grid<float>;
+	using FBuildLeaf = nanovdb::tools::build::LeafNode<float>;
+
+	struct FStats
+	{
+		double ReadSeconds = 0.0;
+		double SplitSeconds = 0.0;
+		double EncodeSeconds = 0.0;
+		uint32 NumChunks = 0;
+		uint32 NumLeaves = 0;
+		uint32 NumTiles = 0;
+	};
+
+	/// Level set of a chunk, in local index space with the world offset of the chunk in the transform
+	using FOnChunk = TFunctionRef<void(const FIntVector& ChunkCoord, nanovdb::GridHandle<nanovdb::HostBuffer>&& Grid)>;
+
+	/// Only the metadata of the segments is read, payloads are skipped
+	static bool ReadGridInfos(const FString& Filename, TArray<FVoxelNvdbGridInfo>& OutGrids);
+
+	/// Read a single grid of the file and split it, chunks are given in order on the calling thread
+	static bool ImportGrid(const FString& Filename, int32 GridIndex, int32 ChunkSize, FOnChunk OnChunk, FStats* OutStats = nullptr);
+
+	/// Split the first grid of a handle, with the leaf holding the minimum of its index bounding box starting chunk (0, 0, 0)
+	static bool SplitGrid(const nanovdb::GridHandle<nanovdb::HostBuffer>& Handle, int32 ChunkSize, FOnChunk OnChunk, FStats* OutStats = nullptr);
+
+	/// Number of chunks per axis of a grid split with this chunk size
+	static FIntVector GetNumChunks(const FVoxelNvdbGridInfo& Info, int32 ChunkSize);
+
+	static bool IsSupported(nanovdb::GridType GridType);
+};
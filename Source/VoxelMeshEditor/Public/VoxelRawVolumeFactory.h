@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Factories/Factory.h"
+#include "VoxelRawVolumeImporter.h"
+#include "VoxelRawVolumeFactory.generated.h"
+
+UCLASS()
+class UVoxelRawVolumeImportOptions : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Raw Volume", meta = (ShowOnlyInnerProperties))
+	FVoxelRawVolumeSettings Settings;
+};
+
+/**
+ * Imports a raw dense volume as one chunk view asset per chunk with a surface, see FVoxelRawVolumeImporter.
+ * Chunks are named <Name>_<X>_<Y>_<Z> next to the imported asset when the volume spans more than one.
+ */
+UCLASS()
+class VOXELMESHEDITOR_API UVoxelRawVolumeFactory : public UFactory
+{
+	GENERATED_BODY()
+public:
+	UVoxelRawVolumeFactory(const FObjectInitializer& Initializer);
+
+	// Begin UFactory interface
+	virtual UObject* FactoryCreateFile(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms,
+		FFeedbackContext* Warn, bool& bOutOperationCanceled) override;
+	// End UFactory interface
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel Mesh Editor")
+	UVoxelRawVolumeImportOptions* ImportOptions;
+};
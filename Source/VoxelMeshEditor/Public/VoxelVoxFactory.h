@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Factories/Factory.h"
+#include "VoxelVoxImporter.h"
+#include "VoxelVoxFactory.generated.h"
+
+UCLASS()
+class UVoxelVoxImportOptions : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "MagicaVoxel", meta = (ShowOnlyInnerProperties))
+	FVoxelVoxSettings Settings;
+};
+
+/**
+ * Imports a MagicaVoxel scene as one chunk view asset per chunk with a surface, see FVoxelVoxImporter. The views keep the
+ * palette indices of the voxels and the colors of the palette. Chunks are named like the ones of UVoxelRawVolumeFactory.
+ */
+UCLASS()
+class VOXELMESHEDITOR_API UVoxelVoxFactory : public UFactory
+{
+	GENERATED_BODY()
+public:
+	UVoxelVoxFactory(const FObjectInitializer& Initializer);
+
+	// Begin UFactory interface
+	virtual UObject* FactoryCreateFile(UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms,
+		FFeedbackContext* Warn, bool& bOutOperationCanceled) override;
+	// End UFactory interface
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Voxel Mesh Editor")
+	UVoxelVoxImportOptions* ImportOptions;
+};
@@ -5,6 +5,8 @@ public class VoxelMeshEditor : ModuleRules
     public VoxelMeshEditor(ReadOnlyTargetRules Target) : base(Target)
     {
         PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+        // nanovdb::io reports bad files with exceptions, see FVoxelNvdbImporter. The runtime module is built without them.
+        bEnableExceptions = true;
 
         PublicDependencyModuleNames.AddRange(
             new string[]
@@ -22,6 +24,8 @@ public class VoxelMeshEditor : ModuleRules
                 "Slate",
                 "SlateCore",
                 "AssetTools",
+                "AssetRegistry",
+                "Landscape",
                 "VoxelMesh",
                 "VoxelNanoVDB",
                 "MainFrame",